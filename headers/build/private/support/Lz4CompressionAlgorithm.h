@@ -0,0 +1 @@
+#include <../private/support/Lz4CompressionAlgorithm.h>
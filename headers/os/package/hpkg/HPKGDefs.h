@@ -19,6 +19,9 @@ enum {
 	B_HPKG_MAGIC				= 'hpkg',
 	B_HPKG_VERSION				= 2,
 	B_HPKG_MINOR_VERSION		= 0,
+	B_HPKG_DATA_HASH_MINOR_VERSION	= 1,
+		// added B_HPKG_ATTRIBUTE_ID_DATA_HASH; only packages that contain
+		// the attribute are written with this minor version
 	//
 	B_HPKG_REPO_MAGIC			= 'hpkr',
 	B_HPKG_REPO_VERSION			= 2,
@@ -98,7 +101,8 @@ enum BHPKGAttributeID {
 // compression types
 enum {
 	B_HPKG_COMPRESSION_NONE	= 0,
-	B_HPKG_COMPRESSION_ZLIB	= 1
+	B_HPKG_COMPRESSION_ZLIB	= 1,
+	B_HPKG_COMPRESSION_LZ4	= 2
 };
 
 
@@ -127,6 +131,9 @@ enum {
 		// when updating a pre-existing entry, don't fail, but replace the
 		// entry, if possible (directories will be merged, but won't replace a
 		// non-directory)
+	B_HPKG_WRITER_CONTENT_HASHES	= 0x04,
+		// add the SHA-256 hash of the data of each regular file that isn't
+		// stored inline, so that readers can share identical file contents
 };
 
 
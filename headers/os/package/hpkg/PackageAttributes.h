@@ -82,3 +82,4 @@ B_DEFINE_HPKG_ATTRIBUTE(52, STRING,	"package:post-install-script",
 B_DEFINE_HPKG_ATTRIBUTE(53, UINT,	"package:is-writable-directory",
 	PACKAGE_IS_WRITABLE_DIRECTORY)
 B_DEFINE_HPKG_ATTRIBUTE(54, STRING,	"package",				PACKAGE)
+B_DEFINE_HPKG_ATTRIBUTE(55, STRING,	"data:hash",			DATA_HASH)
@@ -57,8 +57,13 @@ public:
 			int32				CompressionLevel() const;
 			void				SetCompressionLevel(int32 compressionLevel);
 
+			int32				CompressionThreads() const;
+			void				SetCompressionThreads(int32 threads);
+
 private:
 			uint32				fFlags;
+									// the upper bits hold the number of
+									// compression threads
 			uint32				fCompression;
 			int32				fCompressionLevel;
 };
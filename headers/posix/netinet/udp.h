@@ -47,4 +47,8 @@ struct udphdr {
 	uint16_t uh_sum;
 };
 
+/* options that can be set using setsockopt() and level IPPROTO_UDP */
+#define UDP_SEGMENT		0x01
+	/* cut the data of a send into datagrams of this size */
+
 #endif /* NETINET_UDP_H */
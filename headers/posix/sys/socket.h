@@ -60,6 +60,7 @@ typedef uint8_t sa_family_t;
 #define SO_REUSEPORT	0x00000080	/* allow local address & port reuse */
 #define SO_USELOOPBACK	0x00000100	/* bypass hardware when possible */
 #define SO_LINGER		0x00000200	/* linger on close if data present */
+#define SO_ZEROCOPY		0x00000400	/* allow MSG_ZEROCOPY sends */
 
 #define SO_SNDBUF		0x40000001	/* send buffer size */
 #define SO_SNDLOWAT		0x40000002	/* send low-water mark */
@@ -121,6 +122,15 @@ struct msghdr {
 #define MSG_BCAST		0x0100	/* this message rec'd as broadcast */
 #define MSG_MCAST		0x0200	/* this message rec'd as multicast */
 #define	MSG_EOF			0x0400	/* data completes connection */
+#define MSG_ERRQUEUE	0x2000	/* receive zero copy notifications */
+#define MSG_ZEROCOPY	0x4000	/* send the data without copying it */
+#define MSG_WAITFORONE	0x8000	/* recvmmsg(): only wait for the first one */
+
+/* one message of recvmmsg() and sendmmsg() */
+struct mmsghdr {
+	struct msghdr	msg_hdr;	/* the message */
+	unsigned int	msg_len;	/* bytes received or sent */
+};
 
 struct cmsghdr {
 	socklen_t	cmsg_len;
@@ -147,7 +157,19 @@ struct cmsghdr {
 #define	CMSG_ALIGN(len)	_ALIGN(len)
 
 /* SOL_SOCKET control message types */
-#define SCM_RIGHTS	0x01
+#define SCM_RIGHTS		0x01
+#define SCM_ZEROCOPY	0x02
+
+/* SCM_ZEROCOPY data: the MSG_ZEROCOPY sends from zc_first to zc_last are
+   complete, and their memory may be reused; the successful sends of a
+   socket are numbered in order, starting with 0 */
+struct zerocopy_notification {
+	uint32_t	zc_first;
+	uint32_t	zc_last;
+	uint32_t	zc_flags;
+};
+
+#define ZEROCOPY_COPIED	0x01	/* the data has been copied instead */
 
 /* parameter to SO_PEERCRED */
 struct ucred {
@@ -157,6 +179,9 @@ struct ucred {
 };
 
 
+struct timespec;
+
+
 #if __cplusplus
 extern "C" {
 #endif
@@ -177,8 +202,12 @@ ssize_t recv(int socket, void *buffer, size_t length, int flags);
 ssize_t recvfrom(int socket, void *buffer, size_t bufferLength, int flags,
 			struct sockaddr *address, socklen_t *_addressLength);
 ssize_t recvmsg(int socket, struct msghdr *message, int flags);
+int		recvmmsg(int socket, struct mmsghdr *messages, unsigned int count,
+			int flags, struct timespec *timeout);
 ssize_t send(int socket, const void *buffer, size_t length, int flags);
 ssize_t	sendmsg(int socket, const struct msghdr *message, int flags);
+int		sendmmsg(int socket, struct mmsghdr *messages, unsigned int count,
+			int flags);
 ssize_t sendto(int socket, const void *message, size_t length, int flags,
 			const struct sockaddr *address, socklen_t addressLength);
 int     setsockopt(int socket, int level, int option, const void *value,
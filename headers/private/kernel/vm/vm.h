@@ -105,6 +105,8 @@ area_id vm_map_physical_memory(team_id team, const char *name, void **address,
 area_id vm_map_physical_memory_vecs(team_id team, const char* name,
 	void** _address, uint32 addressSpec, addr_t* _size, uint32 protection,
 	struct generic_io_vec* vecs, uint32 vecCount);
+area_id vm_map_user_memory(team_id team, addr_t address, size_t size,
+			const char* name, void** _address, size_t* _size);
 area_id vm_map_file(team_id aid, const char *name, void **address,
 			uint32 addressSpec, addr_t size, uint32 protection, uint32 mapping,
 			bool unmapAddressRange, int fd, off_t offset);
@@ -120,6 +120,10 @@ public:
 			net_buffer*			Dequeue(bool clone);
 			status_t			BlockingDequeue(bool peek, bigtime_t timeout,
 									net_buffer** _buffer);
+			status_t			DequeueMultiple(uint32 flags,
+									bigtime_t deadline, net_buffer** _buffers,
+									size_t* _count);
+			void				Requeue(net_buffer** buffers, size_t count);
 
 			void				Clear();
 
@@ -260,6 +264,64 @@ DECL_DATAGRAM_SOCKET(inline status_t)::BlockingDequeue(bool peek,
 }
 
 
+/*!	Dequeues up to \a _count buffers with a single lock acquisition; it only
+	waits for the first one to arrive, and not beyond the absolute
+	\a deadline.
+*/
+DECL_DATAGRAM_SOCKET(inline status_t)::DequeueMultiple(uint32 flags,
+	bigtime_t deadline, net_buffer** _buffers, size_t* _count)
+{
+	bigtime_t timeout = _SocketTimeout(flags);
+	if (timeout != 0 && deadline != B_INFINITE_TIMEOUT
+		&& (timeout == B_INFINITE_TIMEOUT || deadline < timeout))
+		timeout = deadline;
+
+	if ((flags & MSG_PEEK) != 0) {
+		*_count = 1;
+		return BlockingDequeue(true, timeout, _buffers);
+	}
+
+	AutoLocker _(fLock);
+
+	while (fBuffers.IsEmpty()) {
+		status_t status = SocketStatus(false);
+		if (status != B_OK)
+			return status;
+
+		status = _Wait(timeout);
+		if (status != B_OK)
+			return status;
+	}
+
+	size_t count = 0;
+	while (count < *_count && !fBuffers.IsEmpty())
+		_buffers[count++] = _Dequeue(false);
+
+	*_count = count;
+	return B_OK;
+}
+
+
+/*!	Puts buffers that were dequeued, but could not be delivered, back to the
+	head of the queue, in the same order.
+*/
+DECL_DATAGRAM_SOCKET(inline void)::Requeue(net_buffer** buffers,
+	size_t count)
+{
+	if (count == 0)
+		return;
+
+	AutoLocker _(fLock);
+
+	for (size_t i = count; i-- > 0;) {
+		fBuffers.Add(buffers[i], false);
+		fCurrentBytes += buffers[i]->size;
+	}
+
+	_NotifyOneReader(true);
+}
+
+
 DECL_DATAGRAM_SOCKET(inline void)::Clear()
 {
 	AutoLocker _(fLock);
@@ -35,8 +35,17 @@ typedef struct net_buffer {
 	uint32					flags;
 	uint32					size;
 	uint8					protocol;
+	uint8					offload_flags;
+	uint16					segment_size;
+		// if not 0, the buffer contains a TCP segment or UDP datagram that
+		// is cut into segments or datagrams with that much data each before
+		// it is sent; the checksum is computed for each of them
 } net_buffer;
 
+// net_buffer::offload_flags
+#define NET_BUFFER_CHECKSUM_VALID	0x01
+	// the transport checksum has been verified, or is not needed
+
 struct ancillary_data_container;
 
 struct net_buffer_module_info {
@@ -67,6 +76,9 @@ struct net_buffer_module_info {
 	status_t		(*trim)(net_buffer* buffer, size_t newSize);
 	status_t		(*append_cloned)(net_buffer* buffer, net_buffer* source,
 						uint32 offset, size_t bytes);
+	status_t		(*append_external)(net_buffer* buffer, const void* data,
+						size_t bytes, void (*release)(void* cookie),
+						void* cookie);
 
 	status_t		(*associate_data)(net_buffer* buffer, void* data);
 
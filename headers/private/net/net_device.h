@@ -35,8 +35,18 @@ typedef struct net_device {
 	struct net_hardware_address address;
 
 	struct ifreq_stats stats;
+
+	uint32	offload;	// NET_DEVICE_SEGMENTATION_OFFLOAD, ...
 } net_device;
 
+// net_device::offload
+#define NET_DEVICE_SEGMENTATION_OFFLOAD	0x01
+	// the device cuts buffers with a net_buffer::segment_size into TCP
+	// segments itself, and computes their checksums (TSO)
+#define NET_DEVICE_RECEIVE_OFFLOAD		0x02
+	// the device coalesces received TCP segments itself (LRO), and marks
+	// them with NET_BUFFER_CHECKSUM_VALID
+
 
 struct net_device_module_info {
 	struct module_info info;
@@ -61,6 +71,11 @@ struct net_device_module_info {
 					const struct sockaddr* address);
 	status_t	(*remove_multicast)(net_device* device,
 					const struct sockaddr* address);
+
+	// optional, for devices with more than one receive queue
+	uint32		(*receive_queue_count)(net_device* device);
+	status_t	(*receive_queue_data)(net_device* device, uint32 queue,
+					net_buffer** _buffer);
 };
 
 
@@ -112,6 +112,12 @@ struct net_protocol_module_info {
 	ssize_t		(*read_data_no_buffer)(net_protocol* self, const iovec* vecs,
 					size_t vecCount, ancillary_data_container** _ancillaryData,
 					struct sockaddr* _address, socklen_t* _addressLength);
+
+	status_t	(*read_data_multiple)(net_protocol* self, uint32 flags,
+					bigtime_t deadline, net_buffer** _buffers,
+					size_t* _count);
+	void		(*unread_data)(net_protocol* self, net_buffer** buffers,
+					size_t count);
 };
 
 
@@ -110,6 +110,9 @@ struct net_socket_module_info {
 	int			(*listen)(net_socket* socket, int backlog);
 	ssize_t		(*receive)(net_socket* socket, struct msghdr* , void* data,
 					size_t length, int flags);
+	ssize_t		(*receive_multiple)(net_socket* socket,
+					struct mmsghdr* messages, uint32 count, int flags,
+					bigtime_t deadline);
 	ssize_t		(*send)(net_socket* socket, struct msghdr* , const void* data,
 					size_t length, int flags);
 	int			(*setsockopt)(net_socket* socket, int level, int option,
@@ -0,0 +1,59 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef _PACKAGE__PRIVATE__APPLY_REPOSITORY_DELTA_JOB_H_
+#define _PACKAGE__PRIVATE__APPLY_REPOSITORY_DELTA_JOB_H_
+
+
+#include <Entry.h>
+#include <String.h>
+
+#include <package/Job.h>
+
+
+namespace BPackageKit {
+
+namespace BPrivate {
+
+
+/*!	Tries to update the local cache of a repository by fetching and applying
+	the delta leading from its checksum to the one in the fetched checksum
+	file. Failing to do so is not an error; DeltaApplied() tells whether an
+	updated cache has been written to the target entry.
+*/
+class ApplyRepositoryDeltaJob : public BJob {
+	typedef	BJob				inherited;
+
+public:
+								ApplyRepositoryDeltaJob(
+									const BContext& context,
+									const BString& title,
+									const BString& repositoryName,
+									const BString& baseURL,
+									const BEntry& fetchedChecksumFile,
+									const BEntry& targetEntry);
+	virtual						~ApplyRepositoryDeltaJob();
+
+			bool				DeltaApplied() const;
+			const BEntry&		TargetEntry() const;
+
+protected:
+	virtual	status_t			Execute();
+
+private:
+			BString				fRepositoryName;
+			BString				fBaseURL;
+			BEntry				fFetchedChecksumFile;
+			BEntry				fTargetEntry;
+
+			bool				fDeltaApplied;
+};
+
+
+}	// namespace BPrivate
+
+}	// namespace BPackageKit
+
+
+#endif // _PACKAGE__PRIVATE__APPLY_REPOSITORY_DELTA_JOB_H_
@@ -49,6 +49,21 @@ private:
 };
 
 
+class RepositoryCacheChecksumAccessor : public ChecksumAccessor {
+public:
+								RepositoryCacheChecksumAccessor(
+									const BEntry& cacheEntry);
+
+	virtual	status_t			GetChecksum(BString& checksum) const;
+
+public:
+	static	const char* const	kChecksumAttribute;
+
+private:
+			BEntry				fCacheEntry;
+};
+
+
 class StringChecksumAccessor : public ChecksumAccessor {
 public:
 								StringChecksumAccessor(const BString& checksum);
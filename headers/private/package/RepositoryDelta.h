@@ -0,0 +1,80 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef _PACKAGE__PRIVATE__REPOSITORY_DELTA_H_
+#define _PACKAGE__PRIVATE__REPOSITORY_DELTA_H_
+
+
+#include <Entry.h>
+#include <ObjectList.h>
+#include <String.h>
+#include <StringList.h>
+
+#include <package/PackageInfo.h>
+#include <package/RepositoryInfo.h>
+
+
+namespace BPackageKit {
+
+
+class BRepositoryCache;
+
+
+namespace BPrivate {
+
+
+/*!	The difference between two versions of a repository file.
+
+	A delta is identified by the checksums of the repository files it was
+	computed from and leads to. It contains the repository info of the newer
+	repository, the canonical file names of the removed packages, and the
+	package infos of the added ones. A package whose info changed counts as
+	removed and added. The delta is stored as a flattened BMessage.
+*/
+class RepositoryDelta {
+public:
+								RepositoryDelta();
+								~RepositoryDelta();
+
+			status_t			SetTo(const BEntry& entry);
+			status_t			SetTo(const BRepositoryCache& baseCache,
+									const BString& baseChecksum,
+									const BRepositoryCache& targetCache,
+									const BString& targetChecksum);
+
+			status_t			WriteToFile(const BEntry& entry) const;
+			status_t			Apply(const BRepositoryCache& baseCache,
+									const BEntry& targetEntry) const;
+
+			const BString&		BaseChecksum() const
+									{ return fBaseChecksum; }
+			const BString&		TargetChecksum() const
+									{ return fTargetChecksum; }
+
+			int32				CountRemovedPackages() const
+									{ return fRemovedPackages.CountStrings(); }
+			int32				CountAddedPackages() const
+									{ return fAddedPackages.CountItems(); }
+
+private:
+			typedef BObjectList<BPackageInfo> PackageInfoList;
+
+private:
+			void				_Unset();
+
+private:
+			BString				fBaseChecksum;
+			BString				fTargetChecksum;
+			BRepositoryInfo		fRepositoryInfo;
+			BStringList			fRemovedPackages;
+			PackageInfoList		fAddedPackages;
+};
+
+
+}	// namespace BPrivate
+
+}	// namespace BPackageKit
+
+
+#endif // _PACKAGE__PRIVATE__REPOSITORY_DELTA_H_
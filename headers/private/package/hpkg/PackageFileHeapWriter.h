@@ -42,7 +42,7 @@ public:
 										decompressionAlgorithm);
 								~PackageFileHeapWriter();
 
-			void				Init();
+			void				Init(int32 compressionThreads = 1);
 			void				Reinit(PackageFileHeapReader* heapReader);
 
 			status_t			AddData(BDataReader& dataReader, off_t size,
@@ -63,6 +63,8 @@ private:
 			struct Chunk;
 			struct ChunkSegment;
 			struct ChunkBuffer;
+			struct CompressionJob;
+			struct CompressionPipeline;
 
 			friend struct ChunkBuffer;
 
@@ -77,6 +79,13 @@ private:
 			status_t			_WriteDataUncompressed(const void* data,
 									size_t size);
 
+			void				_StartCompressionThreads(int32 count);
+			void				_StopCompressionThreads();
+			status_t			_QueueCompressionJob();
+			status_t			_WriteCompressionJobs(bool wait,
+									bool all);
+			status_t			_WriteCompressionJob(CompressionJob& job);
+
 			void				_PushChunks(ChunkBuffer& chunkBuffer,
 									uint64 startOffset, uint64 endOffset);
 			void				_UnwriteLastPartialChunk();
@@ -87,6 +96,8 @@ private:
 			size_t				fPendingDataSize;
 			Array<uint64>		fOffsets;
 			CompressionAlgorithmOwner* fCompressionAlgorithm;
+			CompressionPipeline* fCompressionPipeline;
+			bool				fCompressionSuspended;
 };
 
 
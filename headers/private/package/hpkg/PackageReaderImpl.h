@@ -7,6 +7,7 @@
 #define _PACKAGE__HPKG__PRIVATE__PACKAGE_READER_IMPL_H_
 
 
+#include <package/hpkg/PackageEntry.h>
 #include <package/hpkg/ReaderImplBase.h>
 
 
@@ -15,7 +16,6 @@ namespace BPackageKit {
 namespace BHPKG {
 
 
-class BPackageEntry;
 class BPackageEntryAttribute;
 
 
@@ -26,6 +26,39 @@ struct hpkg_header;
 class PackageWriterImpl;
 
 
+/*!	The entries the reader passes to the content handler. They carry the
+	attributes that are not part of the BPackageEntry API.
+*/
+class PackageEntryImpl : public BPackageEntry {
+public:
+								PackageEntryImpl(BPackageEntry* parent,
+									const char* name)
+									:
+									BPackageEntry(parent, name),
+									fDataHash(NULL)
+								{
+								}
+
+			const char*			DataHash() const	{ return fDataHash; }
+									// hex SHA-256 of the data, may be NULL
+			void				SetDataHash(const char* hash)
+									{ fDataHash = hash; }
+
+	static	const char*			DataHashOf(const BPackageEntry* entry);
+									// entry must come from the reader
+
+private:
+			const char*			fDataHash;
+};
+
+
+/*static*/ inline const char*
+PackageEntryImpl::DataHashOf(const BPackageEntry* entry)
+{
+	return static_cast<const PackageEntryImpl*>(entry)->fDataHash;
+}
+
+
 class PackageReaderImpl : public ReaderImplBase {
 	typedef	ReaderImplBase		inherited;
 public:
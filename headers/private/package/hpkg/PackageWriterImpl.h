@@ -122,12 +122,15 @@ private:
 									uint64 dataSize, const uint8* data);
 
 			status_t			_AddData(BDataReader& dataReader, off_t size);
+			status_t			_AddDataHash(BDataReader& dataReader,
+									off_t size);
 
 private:
 			BPackageWriterListener*	fListener;
 
 			off_t				fHeapOffset;
 			uint16				fHeaderSize;
+			uint16				fMinorFormatVersion;
 
 			::BPrivate::RangeArray<uint64>* fHeapRangesToRemove;
 
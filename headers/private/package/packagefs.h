@@ -24,7 +24,10 @@ enum PackageFSMountType {
 enum {
 	PACKAGE_FS_OPERATION_GET_VOLUME_INFO		= B_DEVICE_OP_CODES_END + 1,
 	PACKAGE_FS_OPERATION_GET_PACKAGE_INFOS,
-	PACKAGE_FS_OPERATION_CHANGE_ACTIVATION
+	PACKAGE_FS_OPERATION_CHANGE_ACTIVATION,
+	PACKAGE_FS_OPERATION_GET_CHUNK_CACHE_STATS,
+	PACKAGE_FS_OPERATION_GET_FILE_CONTENT_STATS,
+	PACKAGE_FS_OPERATION_GET_NODE_MEMORY_STATS
 };
 
 
@@ -104,4 +107,47 @@ struct PackageFSActivationChangeRequest {
 };
 
 
+// PACKAGE_FS_OPERATION_GET_CHUNK_CACHE_STATS
+
+struct PackageFSChunkCacheStats {
+	// statistics of the decompressed heap chunk cache shared by all packagefs
+	// volumes
+	uint64							hits;
+	uint64							misses;
+	uint64							evictions;
+	uint64							size;
+	uint64							maxSize;
+	uint32							chunkCount;
+};
+
+
+// PACKAGE_FS_OPERATION_GET_FILE_CONTENT_STATS
+
+struct PackageFSFileContentStats {
+	// statistics of the files of all packagefs volumes that have a data hash
+	uint64							fileCount;
+	uint64							contentCount;
+		// number of distinct contents
+	uint64							dataSize;
+	uint64							deduplicatedSize;
+		// bytes of files whose content is shared with another file
+	uint64							sharedReads;
+		// reads served from the cache of another file
+};
+
+
+// PACKAGE_FS_OPERATION_GET_NODE_MEMORY_STATS
+
+struct PackageFSNodeMemoryStats {
+	// memory used by the package nodes of the volume's packages
+	uint32							packageCount;
+	uint64							nodeCount;
+	uint64							attributeCount;
+	uint64							nodeMemory;
+		// bytes of the node arenas' chunks
+	uint64							attributeMemory;
+		// bytes of the encoded attributes
+};
+
+
 #endif	// _PACKAGE__PRIVATE__PACKAGE_FS_H_
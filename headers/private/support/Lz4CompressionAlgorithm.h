@@ -0,0 +1,64 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef _LZ4_COMPRESSION_ALGORITHM_H_
+#define _LZ4_COMPRESSION_ALGORITHM_H_
+
+
+#include <CompressionAlgorithm.h>
+
+
+// compression level
+enum {
+	B_LZ4_COMPRESSION_FASTEST	= 1,
+	B_LZ4_COMPRESSION_BEST		= 9,
+	B_LZ4_COMPRESSION_DEFAULT	= B_LZ4_COMPRESSION_BEST,
+};
+
+
+class BLz4CompressionParameters : public BCompressionParameters {
+public:
+								BLz4CompressionParameters(
+									int compressionLevel
+										= B_LZ4_COMPRESSION_DEFAULT);
+	virtual						~BLz4CompressionParameters();
+
+			int32				CompressionLevel() const;
+			void				SetCompressionLevel(int32 level);
+
+private:
+			int32				fCompressionLevel;
+};
+
+
+class BLz4DecompressionParameters : public BDecompressionParameters {
+public:
+								BLz4DecompressionParameters();
+	virtual						~BLz4DecompressionParameters();
+};
+
+
+/*!	Block codec producing the LZ4 block format. Only whole buffers can be
+	processed; the stream methods are not supported.
+*/
+class BLz4CompressionAlgorithm : public BCompressionAlgorithm {
+public:
+								BLz4CompressionAlgorithm();
+	virtual						~BLz4CompressionAlgorithm();
+
+	virtual	status_t			CompressBuffer(const void* input,
+									size_t inputSize, void* output,
+									size_t outputSize, size_t& _compressedSize,
+									const BCompressionParameters* parameters
+										= NULL);
+	virtual	status_t			DecompressBuffer(const void* input,
+									size_t inputSize, void* output,
+									size_t outputSize,
+									size_t& _uncompressedSize,
+									const BDecompressionParameters* parameters
+										= NULL);
+};
+
+
+#endif	// _LZ4_COMPRESSION_ALGORITHM_H_
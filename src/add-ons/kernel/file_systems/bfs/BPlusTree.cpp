@@ -72,6 +72,29 @@ private:
 } _PACKED;
 
 
+static type_code
+key_type_to_type_code(uint32 keyType)
+{
+	switch (keyType) {
+		case BPLUSTREE_STRING_TYPE:
+			return B_STRING_TYPE;
+		case BPLUSTREE_INT32_TYPE:
+			return B_INT32_TYPE;
+		case BPLUSTREE_UINT32_TYPE:
+			return B_UINT32_TYPE;
+		case BPLUSTREE_INT64_TYPE:
+			return B_INT64_TYPE;
+		case BPLUSTREE_UINT64_TYPE:
+			return B_UINT64_TYPE;
+		case BPLUSTREE_FLOAT_TYPE:
+			return B_FLOAT_TYPE;
+		case BPLUSTREE_DOUBLE_TYPE:
+			return B_DOUBLE_TYPE;
+	}
+	return 0;
+}
+
+
 #ifdef DEBUG
 class NodeChecker {
 public:
@@ -1011,31 +1034,8 @@ int32
 BPlusTree::_CompareKeys(const void* key1, int keyLength1, const void* key2,
 	int keyLength2)
 {
-	type_code type = 0;
-	switch (fHeader.DataType()) {
-	    case BPLUSTREE_STRING_TYPE:
-	    	type = B_STRING_TYPE;
-	    	break;
-		case BPLUSTREE_INT32_TYPE:
-	    	type = B_INT32_TYPE;
-	    	break;
-		case BPLUSTREE_UINT32_TYPE:
-	    	type = B_UINT32_TYPE;
-	    	break;
-		case BPLUSTREE_INT64_TYPE:
-	    	type = B_INT64_TYPE;
-	    	break;
-		case BPLUSTREE_UINT64_TYPE:
-	    	type = B_UINT64_TYPE;
-	    	break;
-		case BPLUSTREE_FLOAT_TYPE:
-	    	type = B_FLOAT_TYPE;
-	    	break;
-		case BPLUSTREE_DOUBLE_TYPE:
-	    	type = B_DOUBLE_TYPE;
-	    	break;
-	}
-	return QueryParser::compareKeys(type, key1, keyLength1, key2, keyLength2);
+	return QueryParser::compareKeys(key_type_to_type_code(fHeader.DataType()),
+		key1, keyLength1, key2, keyLength2);
 }
 
 
@@ -2843,6 +2843,47 @@ TreeIterator::SkipDuplicates()
 }
 
 
+#if !_BOOT_MODE
+/*!	Starts reading in the leaf node following the current one in the
+	background. Since leaf nodes are usually allocated in key order, the
+	blocks behind it in the same block_run are read as well, up to
+	\a maxBlocks blocks in total.
+*/
+void
+TreeIterator::PrefetchNodes(uint32 maxBlocks)
+{
+	if (fTree == NULL || fTree->fStream == NULL
+		|| fCurrentNodeOffset == BPLUSTREE_NULL
+		|| fCurrentNodeOffset == BPLUSTREE_FREE)
+		return;
+
+	// lock access to stream
+	InodeReadLocker locker(fTree->fStream);
+
+	CachedNode cached(fTree);
+	const bplustree_node* node = cached.SetTo(fCurrentNodeOffset);
+	if (node == NULL)
+		return;
+
+	off_t nextOffset = node->RightLink();
+	if (nextOffset == BPLUSTREE_NULL)
+		return;
+
+	block_run run;
+	off_t fileOffset;
+	if (fTree->fStream->FindBlockRun(nextOffset, run, fileOffset) != B_OK)
+		return;
+
+	Volume* volume = fTree->fStream->GetVolume();
+	uint32 blockOffset = (nextOffset - fileOffset) >> volume->BlockShift();
+	size_t numBlocks = min_c(run.Length() - blockOffset, maxBlocks);
+
+	block_cache_prefetch(volume->BlockCache(),
+		volume->ToBlock(run) + blockOffset, &numBlocks);
+}
+#endif	// !_BOOT_MODE
+
+
 void
 TreeIterator::Update(off_t offset, off_t nextOffset, uint16 keyIndex,
 	uint16 splitAt, int8 change)
@@ -2893,6 +2934,481 @@ TreeIterator::Dump()
 #endif
 
 
+#if !_BOOT_MODE
+//	#pragma mark - TreeBuilder
+
+
+static const size_t kBuilderChunkSize = 65536;
+static const uint32 kBuilderMaxChunks = 32;
+	// bounds the memory used for a batch of entries to 2 MB
+static const uint32 kBuilderMaxLevels = 16;
+static const int32 kBuilderNodeFill = 75;
+	// how much of a node is filled, in percent; the rest is left for keys
+	// inserted later, so that they don't split every node
+
+
+struct builder_chunk {
+	builder_chunk*	next;
+	size_t			used;
+	uint8			data[0];
+};
+
+
+struct builder_entry {
+	off_t			value;
+	type_code		type;
+	uint32			length;
+	uint8			key[0];
+};
+
+
+struct TreeBuilder::level {
+	level()
+		:
+		node(NULL),
+		offset(BPLUSTREE_NULL)
+	{
+	}
+
+	bplustree_node*	node;
+	off_t			offset;
+};
+
+
+static int
+compare_builder_entries(const void* _first, const void* _second)
+{
+	const builder_entry* first = *(const builder_entry**)_first;
+	const builder_entry* second = *(const builder_entry**)_second;
+
+	int result = QueryParser::compareKeys(first->type, first->key,
+		first->length, second->key, second->length);
+	if (result != 0)
+		return result;
+
+	// keep duplicates ordered by their value
+	if (first->value < second->value)
+		return -1;
+	return first->value > second->value ? 1 : 0;
+}
+
+
+TreeBuilder::TreeBuilder(BPlusTree* tree)
+	:
+	fTree(tree),
+	fChunks(NULL),
+	fChunkCount(0),
+	fEntries(NULL),
+	fCount(0),
+	fCapacity(0),
+	fLevels(NULL),
+	fLevelCount(0)
+{
+}
+
+
+TreeBuilder::~TreeBuilder()
+{
+	_MakeEmpty();
+}
+
+
+/*!	Adds the key/value pair to the builder. The keys don't have to be added
+	in any particular order; they are collected in batches of bounded size,
+	and a batch is only written to the tree when it is full, or when calling
+	Finish(). Like the latter, this method may start its own transactions.
+*/
+status_t
+TreeBuilder::Add(const uint8* key, uint16 keyLength, off_t value)
+{
+	if (keyLength < BPLUSTREE_MIN_KEY_LENGTH
+		|| keyLength > BPLUSTREE_MAX_KEY_LENGTH)
+		RETURN_ERROR(B_BAD_VALUE);
+
+	size_t size = (sizeof(builder_entry) + keyLength + 7) & ~(size_t)7;
+	if (fChunkCount == kBuilderMaxChunks
+		&& fChunks->used + size > kBuilderChunkSize) {
+		status_t status = Finish();
+		if (status != B_OK)
+			return status;
+	}
+
+	if (fCount == fCapacity) {
+		int32 capacity = fCapacity > 0 ? fCapacity * 2 : 1024;
+		builder_entry** entries = (builder_entry**)realloc(fEntries,
+			capacity * sizeof(builder_entry*));
+		if (entries == NULL)
+			return B_NO_MEMORY;
+
+		fEntries = entries;
+		fCapacity = capacity;
+	}
+
+	if (fChunks == NULL || fChunks->used + size > kBuilderChunkSize) {
+		builder_chunk* chunk = (builder_chunk*)malloc(sizeof(builder_chunk)
+			+ kBuilderChunkSize);
+		if (chunk == NULL)
+			return B_NO_MEMORY;
+
+		chunk->next = fChunks;
+		chunk->used = 0;
+		fChunks = chunk;
+		fChunkCount++;
+	}
+
+	builder_entry* entry = (builder_entry*)(fChunks->data + fChunks->used);
+	fChunks->used += size;
+
+	entry->value = value;
+	entry->type = key_type_to_type_code(fTree->fHeader.DataType());
+	entry->length = keyLength;
+	memcpy(entry->key, key, keyLength);
+
+	fEntries[fCount++] = entry;
+	return B_OK;
+}
+
+
+/*!	Sorts the entries collected since the last batch, and writes them to the
+	tree.
+	If the tree is empty, it is built bottom-up: the nodes of each level are
+	filled up to kBuilderNodeFill, and allocated in key order, so that they
+	end up next to each other in the tree's stream. Otherwise, the entries
+	are inserted one by one; since they are sorted, they are inserted into
+	one node after the other, and the room left in the nodes keeps them from
+	being split right away.
+
+	This method starts its own transactions, and splits them up when they
+	become too large. The tree's inode must not be locked by the caller.
+*/
+status_t
+TreeBuilder::Finish()
+{
+	if (fCount == 0)
+		return B_OK;
+
+	qsort(fEntries, fCount, sizeof(builder_entry*), &compare_builder_entries);
+
+	Inode* stream = fTree->fStream;
+	Transaction transaction(stream->GetVolume(), stream->BlockNumber());
+	stream->WriteLockInTransaction(transaction);
+
+	CachedNode cached(fTree);
+	const bplustree_node* root = cached.SetTo(fTree->fHeader.RootNode());
+	bool isEmpty = root != NULL && root->IsLeaf() && root->NumKeys() == 0;
+	cached.Unset();
+
+	status_t status = B_OK;
+	if (isEmpty)
+		status = _Build(transaction);
+
+	// Insert the remaining entries the usual way - if the tree has been
+	// built above, these are only the duplicates
+	for (int32 i = 0; status == B_OK && i < fCount; i++) {
+		if (isEmpty && !_IsDuplicate(i))
+			continue;
+
+		builder_entry* entry = fEntries[i];
+		status = fTree->Insert(transaction, entry->key, entry->length,
+			entry->value);
+		if (status == B_OK && transaction.IsTooLarge())
+			status = _RestartTransaction(transaction);
+	}
+
+	if (status == B_OK)
+		status = transaction.Done();
+
+	_MakeEmpty();
+	return status;
+}
+
+
+status_t
+TreeBuilder::_Build(Transaction& transaction)
+{
+	fLevels = new(std::nothrow) level[kBuilderMaxLevels];
+	if (fLevels == NULL)
+		return B_NO_MEMORY;
+
+	// The empty root node becomes the first leaf
+	fLevels[0].node = (bplustree_node*)malloc(fTree->fNodeSize);
+	if (fLevels[0].node == NULL)
+		return B_NO_MEMORY;
+
+	fLevels[0].node->Initialize();
+	fLevels[0].offset = fTree->fHeader.RootNode();
+	fLevelCount = 1;
+
+	for (int32 i = 0; i < fCount; i++) {
+		if (_IsDuplicate(i))
+			continue;
+
+		builder_entry* entry = fEntries[i];
+		status_t status = _AddToLevel(transaction, 0, entry->key,
+			entry->length, entry->value);
+		if (status != B_OK)
+			return status;
+	}
+
+	// Note, _FinishLevel() may add another level
+	for (uint32 i = 0; i < fLevelCount; i++) {
+		status_t status = _FinishLevel(transaction, i);
+		if (status != B_OK)
+			return status;
+	}
+
+	CachedNode cached(fTree);
+	bplustree_header* header = cached.SetToWritableHeader(transaction);
+	if (header == NULL)
+		return B_IO_ERROR;
+
+	header->root_node_pointer = HOST_ENDIAN_TO_BFS_INT64(
+		fLevels[fLevelCount - 1].offset);
+	header->max_number_of_levels = HOST_ENDIAN_TO_BFS_INT32(fLevelCount);
+	return B_OK;
+}
+
+
+/*!	Appends the key/value pair to the current node of the given level.
+	If it doesn't fit anymore, the node is written back, and a key pointing
+	to it is added to the next higher level.
+*/
+status_t
+TreeBuilder::_AddToLevel(Transaction& transaction, uint32 levelIndex,
+	const uint8* key, uint16 keyLength, off_t value)
+{
+	if (levelIndex == fLevelCount) {
+		if (fLevelCount == kBuilderMaxLevels)
+			RETURN_ERROR(B_BAD_DATA);
+
+		bplustree_node* node = (bplustree_node*)malloc(fTree->fNodeSize);
+		if (node == NULL)
+			return B_NO_MEMORY;
+
+		node->Initialize();
+		fLevels[levelIndex].node = node;
+		fLevelCount++;
+
+		status_t status = _AllocateNode(transaction,
+			fLevels[levelIndex].offset);
+		if (status != B_OK)
+			return status;
+	}
+
+	level& current = fLevels[levelIndex];
+	bplustree_node* node = current.node;
+
+	if (!_HasRoom(node, keyLength)) {
+		off_t nextOffset;
+		status_t status = _AllocateNode(transaction, nextOffset);
+		if (status != B_OK)
+			return status;
+
+		uint8 separator[BPLUSTREE_MAX_KEY_LENGTH];
+		uint16 separatorLength;
+		if (levelIndex == 0) {
+			_MakeSeparator(node, key, keyLength, separator,
+				&separatorLength);
+		} else
+			_PopLastKey(node, separator, &separatorLength);
+
+		node->right_link = HOST_ENDIAN_TO_BFS_INT64(nextOffset);
+
+		status = _WriteNode(transaction, levelIndex);
+		if (status != B_OK)
+			return status;
+
+		off_t offset = current.offset;
+		node->Initialize();
+		node->left_link = HOST_ENDIAN_TO_BFS_INT64(offset);
+		current.offset = nextOffset;
+
+		status = _AddToLevel(transaction, levelIndex + 1, separator,
+			separatorLength, offset);
+		if (status != B_OK)
+			return status;
+	}
+
+	fTree->_InsertKey(node, node->NumKeys(), (uint8*)key, keyLength, value);
+	return B_OK;
+}
+
+
+/*!	Writes back the last node of the given level, and adds it to the next
+	higher level, unless it is the root node.
+*/
+status_t
+TreeBuilder::_FinishLevel(Transaction& transaction, uint32 levelIndex)
+{
+	level& current = fLevels[levelIndex];
+	bool isRoot = levelIndex == fLevelCount - 1;
+
+	uint8 key[BPLUSTREE_MAX_KEY_LENGTH];
+	uint16 keyLength = 0;
+	if (levelIndex > 0)
+		_PopLastKey(current.node, key, &keyLength);
+	else if (!isRoot) {
+		uint8* lastKey = current.node->KeyAt(current.node->NumKeys() - 1,
+			&keyLength);
+		memcpy(key, lastKey, keyLength);
+	}
+
+	status_t status = _WriteNode(transaction, levelIndex);
+	if (status != B_OK || isRoot)
+		return status;
+
+	return _AddToLevel(transaction, levelIndex + 1, key, keyLength,
+		current.offset);
+}
+
+
+status_t
+TreeBuilder::_AllocateNode(Transaction& transaction, off_t& _offset)
+{
+	CachedNode cached(fTree);
+	bplustree_node* node;
+	return cached.Allocate(transaction, &node, &_offset);
+}
+
+
+status_t
+TreeBuilder::_WriteNode(Transaction& transaction, uint32 levelIndex)
+{
+	CachedNode cached(fTree);
+	bplustree_node* node = cached.SetToWritable(transaction,
+		fLevels[levelIndex].offset, false);
+	if (node == NULL)
+		RETURN_ERROR(B_IO_ERROR);
+
+	memcpy(node, fLevels[levelIndex].node, fTree->fNodeSize);
+	cached.Unset();
+
+	if (transaction.IsTooLarge())
+		return _RestartTransaction(transaction);
+
+	return B_OK;
+}
+
+
+/*!	Removes the last key of an index node, and turns its value into the
+	overflow link of the node. The key is copied into \a key.
+*/
+void
+TreeBuilder::_PopLastKey(bplustree_node* node, uint8* key, uint16* _keyLength)
+{
+	uint16 index = node->NumKeys() - 1;
+	uint8* lastKey = node->KeyAt(index, _keyLength);
+	memcpy(key, lastKey, *_keyLength);
+
+	node->overflow_link = node->Values()[index];
+	fTree->_RemoveKey(node, index);
+}
+
+
+bool
+TreeBuilder::_HasRoom(const bplustree_node* node, uint16 keyLength) const
+{
+	if (node->NumKeys() == 0)
+		return true;
+
+	return int32(key_align(sizeof(bplustree_node) + node->AllKeyLength()
+			+ keyLength)
+		+ (node->NumKeys() + 1) * (sizeof(uint16) + sizeof(off_t)))
+			< fTree->fNodeSize * kBuilderNodeFill / 100;
+}
+
+
+/*!	Computes the key that will be used in the parent node for the full leaf
+	\a node, given the first key of the next leaf.
+	Any key between the last key of the node and \a nextKey would do; for
+	strings, the shortest prefix of \a nextKey that is still larger than the
+	last key is used, so that more keys fit into the index nodes.
+*/
+void
+TreeBuilder::_MakeSeparator(const bplustree_node* node, const uint8* nextKey,
+	uint16 nextKeyLength, uint8* separator, uint16* _separatorLength)
+{
+	uint16 lastLength;
+	uint8* last = node->KeyAt(node->NumKeys() - 1, &lastLength);
+
+	if (fTree->fHeader.DataType() == BPLUSTREE_STRING_TYPE) {
+		// string keys are compared up to their first null byte only
+		lastLength = strnlen((const char*)last, lastLength);
+		nextKeyLength = strnlen((const char*)nextKey, nextKeyLength);
+
+		uint16 common = 0;
+		while (common < lastLength && common < nextKeyLength
+			&& last[common] == nextKey[common]) {
+			common++;
+		}
+
+		if (common + 1 < nextKeyLength) {
+			memcpy(separator, nextKey, common + 1);
+			*_separatorLength = common + 1;
+			return;
+		}
+	}
+
+	memcpy(separator, last, lastLength);
+	*_separatorLength = lastLength;
+}
+
+
+bool
+TreeBuilder::_IsDuplicate(int32 index) const
+{
+	if (index == 0)
+		return false;
+
+	const builder_entry* previous = fEntries[index - 1];
+	const builder_entry* entry = fEntries[index];
+	return QueryParser::compareKeys(entry->type, previous->key,
+		previous->length, entry->key, entry->length) == 0;
+}
+
+
+status_t
+TreeBuilder::_RestartTransaction(Transaction& transaction)
+{
+	status_t status = transaction.Done();
+	if (status == B_OK) {
+		status = transaction.Start(fTree->fStream->GetVolume(),
+			fTree->fStream->BlockNumber());
+	}
+	if (status == B_OK)
+		fTree->fStream->WriteLockInTransaction(transaction);
+
+	return status;
+}
+
+
+void
+TreeBuilder::_MakeEmpty()
+{
+	while (fChunks != NULL) {
+		builder_chunk* next = fChunks->next;
+		free(fChunks);
+		fChunks = next;
+	}
+	fChunkCount = 0;
+
+	free(fEntries);
+	fEntries = NULL;
+	fCount = 0;
+	fCapacity = 0;
+
+	if (fLevels != NULL) {
+		for (uint32 i = 0; i < kBuilderMaxLevels; i++)
+			free(fLevels[i].node);
+
+		delete[] fLevels;
+		fLevels = NULL;
+	}
+	fLevelCount = 0;
+}
+#endif // !_BOOT_MODE
+
+
 // #pragma mark -
 
 
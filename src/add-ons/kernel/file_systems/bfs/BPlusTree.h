@@ -149,6 +149,10 @@ enum bplustree_traversing {
 class BPlusTree;
 struct TreeCheck;
 class TreeIterator;
+#if !_BOOT_MODE
+struct builder_chunk;
+struct builder_entry;
+#endif
 
 
 #if !_BOOT_MODE
@@ -356,6 +360,9 @@ private:
 			friend class TreeIterator;
 			friend class CachedNode;
 			friend class TreeCheck;
+#if !_BOOT_MODE
+			friend class TreeBuilder;
+#endif
 
 			Inode*				fStream;
 			bplustree_header	fHeader;
@@ -393,6 +400,9 @@ public:
 									uint16 maxLength, off_t* value,
 									uint16* duplicate = NULL);
 			void				SkipDuplicates();
+#if !_BOOT_MODE
+			void				PrefetchNodes(uint32 maxBlocks);
+#endif
 
 			BPlusTree*			Tree() const { return fTree; }
 
@@ -421,6 +431,60 @@ private:
 };
 
 
+#if !_BOOT_MODE
+/*!	Collects key/value pairs in memory, and writes them into the tree in
+	sorted batches; the first one builds the empty tree bottom-up.
+*/
+class TreeBuilder {
+public:
+								TreeBuilder(BPlusTree* tree);
+								~TreeBuilder();
+
+			status_t			Add(const uint8* key, uint16 keyLength,
+									off_t value);
+			status_t			Finish();
+
+			BPlusTree*			Tree() const { return fTree; }
+			int32				CountEntries() const { return fCount; }
+
+private:
+			struct level;
+
+			status_t			_Build(Transaction& transaction);
+			status_t			_AddToLevel(Transaction& transaction,
+									uint32 level, const uint8* key,
+									uint16 keyLength, off_t value);
+			status_t			_FinishLevel(Transaction& transaction,
+									uint32 level);
+			status_t			_AllocateNode(Transaction& transaction,
+									off_t& _offset);
+			status_t			_WriteNode(Transaction& transaction,
+									uint32 level);
+			void				_PopLastKey(bplustree_node* node,
+									uint8* key, uint16* _keyLength);
+			bool				_IsDuplicate(int32 index) const;
+			bool				_HasRoom(const bplustree_node* node,
+									uint16 keyLength) const;
+			void				_MakeSeparator(const bplustree_node* node,
+									const uint8* nextKey,
+									uint16 nextKeyLength, uint8* separator,
+									uint16* _separatorLength);
+			status_t			_RestartTransaction(Transaction& transaction);
+			void				_MakeEmpty();
+
+private:
+			BPlusTree*			fTree;
+			builder_chunk*		fChunks;
+			uint32				fChunkCount;
+			builder_entry**		fEntries;
+			int32				fCount;
+			int32				fCapacity;
+			level*				fLevels;
+			uint32				fLevelCount;
+};
+#endif // !_BOOT_MODE
+
+
 //	#pragma mark - BPlusTree's inline functions
 //	(most of them may not be needed)
 
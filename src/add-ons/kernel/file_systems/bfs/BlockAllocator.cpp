@@ -172,13 +172,32 @@ private:
 struct check_index {
 	check_index()
 		:
-		inode(NULL)
+		inode(NULL),
+		builder(NULL)
 	{
 	}
 
 	char				name[B_FILE_NAME_LENGTH];
 	block_run			run;
 	Inode*				inode;
+	TreeBuilder*		builder;
+};
+
+
+struct check_node : DoublyLinkedListLinkImpl<check_node> {
+	Inode*				inode;
+	char				name[B_FILE_NAME_LENGTH];
+	uint32				errors;
+	status_t			status;
+};
+
+typedef DoublyLinkedList<check_node> CheckNodeList;
+
+
+struct check_worker {
+	BlockAllocator*		allocator;
+	thread_id			thread;
+	check_control		control;
 };
 
 
@@ -195,9 +214,49 @@ struct check_cookie {
 	TreeIterator*		iterator;
 	check_control		control;
 	Stack<check_index*>	indices;
+	bool				errors_found;
+
+	// parallel checking (the lock guards the stack, and the node lists)
+	mutex				lock;
+	check_worker*		workers;
+	uint32				num_workers;
+	sem_id				queued_sem;
+	CheckNodeList		queued;
+	sem_id				finished_sem;
+	CheckNodeList		finished;
+	uint32				pending;
+		// nodes that have been queued, but not reported yet
 };
 
 
+static const uint32 kMaxCheckThreads = 32;
+static const uint32 kMaxPendingCheckNodes = 256;
+
+
+struct trim_range {
+	off_t				start;
+	uint32				length;
+};
+
+
+struct trim_queue {
+	thread_id			thread;
+	sem_id				sem;
+	bool				enabled;
+	trim_range*			ranges;
+	trim_range*			spare;
+	uint32				count;
+	bfs_trim_stats		stats;
+};
+
+
+static const uint32 kTrimRanges = 128;
+static const uint32 kMaxQueuedTrimRanges = 2048;
+static const uint32 kMaxTrimRequestsPerPass = 8;
+static const bigtime_t kTrimInterval = 5000000LL;
+	// at most kMaxTrimRequestsPerPass trim requests are issued every 5 seconds
+
+
 class AllocationBlock : public CachedBlock {
 public:
 	AllocationBlock(Volume* volume);
@@ -538,7 +597,8 @@ BlockAllocator::BlockAllocator(Volume* volume)
 	fVolume(volume),
 	fGroups(NULL),
 	fCheckBitmap(NULL),
-	fCheckCookie(NULL)
+	fCheckCookie(NULL),
+	fTrimQueue(NULL)
 {
 	recursive_lock_init(&fLock, "bfs allocator");
 }
@@ -741,6 +801,8 @@ BlockAllocator::_Initialize(BlockAllocator* allocator)
 void
 BlockAllocator::Uninitialize()
 {
+	StopBackgroundTrim();
+
 	// We only have to make sure that the initializer thread isn't running
 	// anymore.
 	recursive_lock_lock(&fLock);
@@ -1074,6 +1136,10 @@ BlockAllocator::Free(Transaction& transaction, block_run run)
 
 	fVolume->SuperBlock().used_blocks =
 		HOST_ENDIAN_TO_BFS_INT64(fVolume->UsedBlocks() - run.Length());
+
+	if (fTrimQueue != NULL)
+		_QueueTrim(fVolume->ToBlock(run), length);
+
 	return B_OK;
 }
 
@@ -1193,7 +1259,6 @@ BlockAllocator::_CheckGroup(int32 groupIndex) const
 status_t
 BlockAllocator::Trim(uint64 offset, uint64 size, uint64& trimmedSize)
 {
-	const uint32 kTrimRanges = 128;
 	fs_trim_data* trimData = (fs_trim_data*)malloc(sizeof(fs_trim_data)
 		+ sizeof(uint64) * kTrimRanges);
 	if (trimData == NULL)
@@ -1252,6 +1317,363 @@ BlockAllocator::Trim(uint64 offset, uint64 size, uint64& trimmedSize)
 }
 
 
+//	#pragma mark - Background trimming
+
+
+static int
+compare_trim_ranges(const void* _a, const void* _b)
+{
+	const trim_range* a = (const trim_range*)_a;
+	const trim_range* b = (const trim_range*)_b;
+
+	if (a->start < b->start)
+		return -1;
+	return a->start > b->start ? 1 : 0;
+}
+
+
+/*!	Sorts the ranges, and merges all of them that are adjacent or overlap.
+	Returns the new number of ranges.
+*/
+static uint32
+merge_trim_ranges(trim_range* ranges, uint32 count)
+{
+	if (count < 2)
+		return count;
+
+	qsort(ranges, count, sizeof(trim_range), &compare_trim_ranges);
+
+	uint32 last = 0;
+	for (uint32 i = 1; i < count; i++) {
+		off_t end = ranges[last].start + ranges[last].length;
+		if (ranges[i].start <= end) {
+			off_t newEnd = max_c(end, ranges[i].start + ranges[i].length);
+			ranges[last].length = newEnd - ranges[last].start;
+		} else
+			ranges[++last] = ranges[i];
+	}
+
+	return last + 1;
+}
+
+
+/*!	Starts a thread that trims the blocks that are freed while the volume
+	is mounted, so that the device learns about them without having to trim
+	the whole volume from time to time.
+*/
+status_t
+BlockAllocator::StartBackgroundTrim()
+{
+	if (fVolume->IsReadOnly() || fTrimQueue != NULL)
+		return B_OK;
+
+	trim_queue* queue = new(std::nothrow) trim_queue;
+	if (queue == NULL)
+		return B_NO_MEMORY;
+
+	queue->ranges = new(std::nothrow) trim_range[kMaxQueuedTrimRanges];
+	queue->spare = new(std::nothrow) trim_range[kMaxQueuedTrimRanges];
+	queue->sem = create_sem(0, "bfs trim");
+	if (queue->ranges == NULL || queue->spare == NULL || queue->sem < 0) {
+		status_t status = queue->sem < 0 ? queue->sem : B_NO_MEMORY;
+		if (queue->sem >= 0)
+			delete_sem(queue->sem);
+		delete[] queue->ranges;
+		delete[] queue->spare;
+		delete queue;
+		return status;
+	}
+
+	queue->enabled = true;
+	queue->count = 0;
+	memset(&queue->stats, 0, sizeof(bfs_trim_stats));
+
+	queue->thread = spawn_kernel_thread(&BlockAllocator::_BackgroundTrimmer,
+		"bfs trimmer", B_LOW_PRIORITY, this);
+	if (queue->thread < 0) {
+		status_t status = queue->thread;
+		delete_sem(queue->sem);
+		delete[] queue->ranges;
+		delete[] queue->spare;
+		delete queue;
+		return status;
+	}
+
+	// The volume is still being mounted, no one can free any blocks yet
+	fTrimQueue = queue;
+
+	resume_thread(queue->thread);
+	return B_OK;
+}
+
+
+/*!	Stops the trimmer thread; blocks that have been freed but are not yet
+	trimmed are forgotten about.
+*/
+void
+BlockAllocator::StopBackgroundTrim()
+{
+	if (fTrimQueue == NULL)
+		return;
+
+	delete_sem(fTrimQueue->sem);
+	wait_for_thread(fTrimQueue->thread, NULL);
+
+	RecursiveLocker locker(fLock);
+	trim_queue* queue = fTrimQueue;
+	fTrimQueue = NULL;
+	locker.Unlock();
+
+	delete[] queue->ranges;
+	delete[] queue->spare;
+	delete queue;
+}
+
+
+status_t
+BlockAllocator::GetTrimStats(bfs_trim_stats& stats)
+{
+	RecursiveLocker locker(fLock);
+
+	if (fTrimQueue == NULL)
+		return B_NOT_SUPPORTED;
+
+	stats = fTrimQueue->stats;
+	return B_OK;
+}
+
+
+/*!	Remembers a range of blocks that has just been freed, so that the
+	trimmer will pick it up. The range is merged with the last one queued
+	if they are adjacent.
+	The allocator lock must be held.
+*/
+void
+BlockAllocator::_QueueTrim(off_t start, uint32 length)
+{
+	trim_queue* queue = fTrimQueue;
+	if (!queue->enabled)
+		return;
+
+	if (queue->count > 0) {
+		trim_range& last = queue->ranges[queue->count - 1];
+		if (last.start + last.length == start) {
+			last.length += length;
+			queue->stats.merged_ranges++;
+			return;
+		}
+		if (start + length == last.start) {
+			last.start = start;
+			last.length += length;
+			queue->stats.merged_ranges++;
+			return;
+		}
+	}
+
+	if (queue->count == kMaxQueuedTrimRanges) {
+		queue->count = merge_trim_ranges(queue->ranges, queue->count);
+		queue->stats.merged_ranges += kMaxQueuedTrimRanges - queue->count;
+		if (queue->count == kMaxQueuedTrimRanges) {
+			// We'll have to live with these blocks staying untrimmed
+			queue->stats.dropped_ranges++;
+			return;
+		}
+	}
+
+	queue->ranges[queue->count].start = start;
+	queue->ranges[queue->count].length = length;
+	queue->count++;
+	queue->stats.queued_ranges++;
+
+	if (queue->count == kMaxQueuedTrimRanges / 2)
+		release_sem_etc(queue->sem, 1, B_DO_NOT_RESCHEDULE);
+}
+
+
+/*!	Adds the blocks in the given range that are still free to \a trimData,
+	until it is full. Blocks that have been allocated again in the mean time
+	are left alone. \a _start is set to the first block that has not been
+	added.
+	The allocator lock must be held.
+*/
+status_t
+BlockAllocator::_CollectFreeBlocks(fs_trim_data& trimData, off_t& _start,
+	off_t end)
+{
+	uint32 blockShift = fVolume->BlockShift();
+	uint32 bitsPerBlock = fVolume->BlockSize() << 3;
+	off_t firstFree = 0;
+	off_t freeLength = 0;
+	off_t last = min_c(end, fVolume->NumBlocks());
+
+	AllocationBlock cached(fVolume);
+
+	off_t block = _start;
+	while (block < last) {
+		int32 group = block >> fVolume->AllocationGroupShift();
+		uint32 bit = block - ((off_t)group << fVolume->AllocationGroupShift());
+		if (group >= fNumGroups || bit >= fGroups[group].NumBits())
+			break;
+
+		if (cached.SetTo(fGroups[group], bit / bitsPerBlock) != B_OK)
+			RETURN_ERROR(B_IO_ERROR);
+
+		for (uint32 i = bit % bitsPerBlock;
+				i < cached.NumBlockBits() && block < last; i++, block++) {
+			if (cached.IsUsed(i)) {
+				fTrimQueue->stats.reused_bytes += fVolume->BlockSize();
+
+				if (freeLength > 0) {
+					if (!_AddTrim(trimData, kTrimRanges,
+							firstFree << blockShift,
+							freeLength << blockShift)) {
+						_start = firstFree;
+						return B_OK;
+					}
+
+					freeLength = 0;
+				}
+			} else if (freeLength++ == 0)
+				firstFree = block;
+		}
+	}
+
+	if (freeLength > 0 && !_AddTrim(trimData, kTrimRanges,
+			firstFree << blockShift, freeLength << blockShift)) {
+		_start = firstFree;
+		return B_OK;
+	}
+
+	_start = end;
+	return B_OK;
+}
+
+
+/*!	Trims the ranges that have been queued since the last run. Blocks may
+	only be trimmed once the transaction that freed them is safely in the
+	log; otherwise they might come back in use after a crash. Also, no
+	transaction must be able to allocate them again until the device has
+	discarded them.
+	Therefore, the journal is locked, and written back for every request.
+	The still free blocks are collected with the allocator locked, but the
+	device processes the request without it, so that the volume can still
+	be read from; only transactions have to wait.
+*/
+status_t
+BlockAllocator::_TrimQueuedRanges()
+{
+	RecursiveLocker locker(fLock);
+
+	trim_queue* queue = fTrimQueue;
+	trim_range* ranges = queue->ranges;
+	uint32 count = queue->count;
+	if (count == 0)
+		return B_OK;
+
+	queue->ranges = queue->spare;
+	queue->spare = ranges;
+	queue->count = 0;
+
+	locker.Unlock();
+
+	uint32 queuedCount = count;
+	count = merge_trim_ranges(ranges, count);
+
+	fs_trim_data* trimData = (fs_trim_data*)malloc(sizeof(fs_trim_data)
+		+ sizeof(uint64) * kTrimRanges);
+	if (trimData == NULL)
+		return B_NO_MEMORY;
+
+	MemoryDeleter deleter(trimData);
+
+	Journal* journal = fVolume->GetJournal(0);
+	status_t status = B_OK;
+	uint32 index = 0;
+	off_t start = ranges[0].start;
+
+	for (uint32 request = 0; request < kMaxTrimRequestsPerPass
+			&& index < count; request++) {
+		status = journal->Lock(NULL, true);
+		if (status != B_OK)
+			break;
+
+		status = journal->FlushLogLocked();
+
+		locker.Lock();
+		trimData->range_count = 0;
+
+		while (status == B_OK && index < count
+			&& trimData->range_count < kTrimRanges) {
+			off_t end = ranges[index].start + ranges[index].length;
+			status = _CollectFreeBlocks(*trimData, start, end);
+			if (status != B_OK || start < end)
+				break;
+
+			if (++index < count)
+				start = ranges[index].start;
+		}
+
+		locker.Unlock();
+
+		trimData->trimmed_size = 0;
+		if (status == B_OK && trimData->range_count > 0
+			&& ioctl(fVolume->Device(), B_TRIM_DEVICE, trimData,
+				sizeof(fs_trim_data)) != 0) {
+			status = errno;
+		}
+
+		journal->Unlock(NULL, true);
+
+		if (status != B_OK || trimData->range_count == 0)
+			break;
+
+		locker.Lock();
+		queue->stats.trim_requests++;
+		queue->stats.trimmed_bytes += trimData->trimmed_size;
+		locker.Unlock();
+	}
+
+	locker.Lock();
+	queue->stats.merged_ranges += queuedCount - count;
+
+	if (status == B_OK && index < count) {
+		// leave the rest for the next run
+		_QueueTrim(start, ranges[index].start + ranges[index].length - start);
+		while (++index < count)
+			_QueueTrim(ranges[index].start, ranges[index].length);
+	}
+
+	return status;
+}
+
+
+/*static*/ status_t
+BlockAllocator::_BackgroundTrimmer(void* _self)
+{
+	BlockAllocator* self = (BlockAllocator*)_self;
+	sem_id sem = self->fTrimQueue->sem;
+
+	while (true) {
+		status_t status = acquire_sem_etc(sem, 1, B_RELATIVE_TIMEOUT,
+			kTrimInterval);
+		if (status != B_OK && status != B_TIMED_OUT)
+			break;
+
+		status = self->_TrimQueuedRanges();
+		if (status == B_DEV_INVALID_IOCTL || status == B_UNSUPPORTED
+			|| status == B_NOT_SUPPORTED) {
+			// The device doesn't support trimming, stop collecting ranges
+			RecursiveLocker locker(self->fLock);
+			self->fTrimQueue->enabled = false;
+			self->fTrimQueue->count = 0;
+			break;
+		}
+	}
+
+	return B_OK;
+}
+
+
 //	#pragma mark - Bitmap validity checking
 
 // TODO: implement new FS checking API
@@ -1305,6 +1727,11 @@ BlockAllocator::StartChecking(const check_control* control)
 	memcpy(&fCheckCookie->control, control, sizeof(check_control));
 	memset(&fCheckCookie->control.stats, 0, sizeof(control->stats));
 
+	if (!fVolume->HasDirtyGroups()) {
+		// we don't know which groups have changed
+		fCheckCookie->control.flags &= ~BFS_CHECK_INCREMENTAL;
+	}
+
 	// initialize bitmap
 	memset(fCheckBitmap, 0, size);
 	for (int32 block = fVolume->Log().Start() + fVolume->Log().Length();
@@ -1317,6 +1744,19 @@ BlockAllocator::StartChecking(const check_control* control)
 	fCheckCookie->stack.Push(fVolume->Indices());
 	fCheckCookie->iterator = NULL;
 	fCheckCookie->control.stats.block_size = fVolume->BlockSize();
+	fCheckCookie->errors_found = false;
+
+	mutex_init(&fCheckCookie->lock, "bfs check");
+	fCheckCookie->workers = NULL;
+	fCheckCookie->num_workers = 0;
+	fCheckCookie->queued_sem = -1;
+	fCheckCookie->finished_sem = -1;
+	fCheckCookie->pending = 0;
+
+	uint32 threads = (control->flags & BFS_CHECK_THREADS_MASK)
+		>> BFS_CHECK_THREADS_SHIFT;
+	if (threads > 1)
+		_StartCheckWorkers(min_c(threads, kMaxCheckThreads));
 
 	// Put removed vnodes to the stack -- they are not reachable by traversing
 	// the file system anymore.
@@ -1337,6 +1777,8 @@ BlockAllocator::StopChecking(check_control* control)
 	if (fCheckCookie == NULL)
 		return B_NO_INIT;
 
+	_StopCheckWorkers();
+
 	if (fCheckCookie->iterator != NULL) {
 		delete fCheckCookie->iterator;
 		fCheckCookie->iterator = NULL;
@@ -1366,6 +1808,14 @@ BlockAllocator::StopChecking(check_control* control)
 			break;
 	}
 
+	if (fCheckCookie->control.status == B_ENTRY_NOT_FOUND
+		&& !fCheckCookie->errors_found && !fVolume->IsReadOnly()) {
+		// The volume is consistent; only changes after this point need to
+		// be checked from now on
+		fVolume->ResetDirtyGroups();
+		fVolume->WriteSuperBlock();
+	}
+
 	fVolume->SetCheckingThread(-1);
 
 	if (control != NULL)
@@ -1373,6 +1823,7 @@ BlockAllocator::StopChecking(check_control* control)
 
 	free(fCheckBitmap);
 	fCheckBitmap = NULL;
+	mutex_destroy(&fCheckCookie->lock);
 	delete fCheckCookie;
 	fCheckCookie = NULL;
 	recursive_lock_unlock(&fLock);
@@ -1393,28 +1844,53 @@ BlockAllocator::CheckNextNode(check_control* control)
 	// Make sure the user control is copied on exit
 	class CopyControlOnExit {
 	public:
-		CopyControlOnExit(check_control* source, check_control* userTarget)
+		CopyControlOnExit(check_cookie* cookie, check_control* userTarget)
 			:
-			fSource(source),
+			fCookie(cookie),
 			fTarget(userTarget)
 		{
 		}
 
 		~CopyControlOnExit()
 		{
+			check_control& source = fCookie->control;
+			if (source.errors != 0
+				|| (source.status != B_OK
+					&& source.status != B_ENTRY_NOT_FOUND)) {
+				fCookie->errors_found = true;
+			}
+
 			if (fTarget != NULL)
-				user_memcpy(fTarget, fSource, sizeof(check_control));
+				user_memcpy(fTarget, &source, sizeof(check_control));
 		}
 
 	private:
-		check_control*	fSource;
+		check_cookie*	fCookie;
 		check_control*	fTarget;
-	} copyControl(&fCheckCookie->control, control);
+	} copyControl(fCheckCookie, control);
 
 	while (true) {
+		// Walk on until enough nodes are queued to keep the worker threads
+		// busy, and only then report the nodes they are done with; this
+		// way, they don't have to wait for each node to be reported first
+		if (fCheckCookie->pending >= kMaxPendingCheckNodes
+			&& _GetFinishedCheckNode())
+			return B_OK;
+
 		if (fCheckCookie->iterator == NULL) {
-			if (!fCheckCookie->stack.Pop(&fCheckCookie->current)) {
+			MutexLocker stackLocker(fCheckCookie->lock);
+			bool popped = fCheckCookie->stack.Pop(&fCheckCookie->current);
+			stackLocker.Unlock();
+
+			if (!popped) {
 				// No more runs on the stack, we might be finished!
+				if (fCheckCookie->pending > 0) {
+					// The workers may still push attribute directories
+					_GetFinishedCheckNode();
+					return B_OK;
+				}
+				_StopCheckWorkers();
+
 				if (fCheckCookie->pass == BFS_CHECK_PASS_BITMAP
 					&& !fCheckCookie->indices.IsEmpty()) {
 					// Start second pass to repair indices
@@ -1429,10 +1905,20 @@ BlockAllocator::CheckNextNode(check_control* control)
 						return status;
 					}
 
+					stackLocker.Lock();
 					fCheckCookie->stack.Push(fVolume->Root());
 					continue;
 				}
 
+				if (fCheckCookie->pass == BFS_CHECK_PASS_INDEX) {
+					// All entries have been collected, write the indices
+					status_t status = _BuildIndices();
+					if (status != B_OK) {
+						fCheckCookie->control.status = status;
+						return status;
+					}
+				}
+
 				fCheckCookie->control.status = B_ENTRY_NOT_FOUND;
 				return B_ENTRY_NOT_FOUND;
 			}
@@ -1604,9 +2090,17 @@ BlockAllocator::CheckNextNode(check_control* control)
 		}
 
 		// push the directory on the stack so that it will be scanned later
-		if (inode->IsContainer() && !inode->IsIndex())
+		if (inode->IsContainer() && !inode->IsIndex()) {
+			MutexLocker stackLocker(fCheckCookie->lock);
 			fCheckCookie->stack.Push(inode->BlockRun());
-		else {
+		} else if (fCheckCookie->num_workers > 0
+			&& fCheckCookie->pass == BFS_CHECK_PASS_BITMAP
+			&& !inode->IsContainer() && _IsCheckNeeded(inode)
+			&& _QueueCheckNode(inode, name) == B_OK) {
+			// one of the workers will check it, and keeps the inode in
+			// memory until it has been reported
+			vnode.Keep();
+		} else {
 			// check it now
 			fCheckCookie->control.status = CheckInode(inode, name);
 			return B_OK;
@@ -1616,6 +2110,215 @@ BlockAllocator::CheckNextNode(check_control* control)
 }
 
 
+/*!	Spawns the threads that check the nodes of the bitmap pass in parallel.
+	If that fails, the nodes are just checked by the calling thread.
+*/
+void
+BlockAllocator::_StartCheckWorkers(uint32 count)
+{
+	fCheckCookie->workers = new(std::nothrow) check_worker[count];
+	if (fCheckCookie->workers == NULL)
+		return;
+
+	fCheckCookie->queued_sem = create_sem(0, "bfs check queued");
+	fCheckCookie->finished_sem = create_sem(0, "bfs check finished");
+	if (fCheckCookie->queued_sem < 0 || fCheckCookie->finished_sem < 0) {
+		_StopCheckWorkers();
+		return;
+	}
+
+	for (uint32 i = 0; i < count; i++) {
+		check_worker& worker = fCheckCookie->workers[i];
+		worker.allocator = this;
+		memset(&worker.control, 0, sizeof(check_control));
+		worker.control.flags = fCheckCookie->control.flags;
+
+		worker.thread = spawn_kernel_thread(&BlockAllocator::_CheckWorker,
+			"bfs check worker", B_NORMAL_PRIORITY, &worker);
+		if (worker.thread < 0)
+			break;
+
+		fCheckCookie->num_workers++;
+		resume_thread(worker.thread);
+	}
+
+	if (fCheckCookie->num_workers == 0)
+		_StopCheckWorkers();
+}
+
+
+/*!	Stops all worker threads, releases the nodes they did not report yet,
+	and adds their statistics to the check control.
+	It is safe to call this method more than once.
+*/
+void
+BlockAllocator::_StopCheckWorkers()
+{
+	if (fCheckCookie->workers == NULL)
+		return;
+
+	check_control& control = fCheckCookie->control;
+
+	delete_sem(fCheckCookie->queued_sem);
+
+	for (uint32 i = 0; i < fCheckCookie->num_workers; i++) {
+		check_worker& worker = fCheckCookie->workers[i];
+		wait_for_thread(worker.thread, NULL);
+
+		const check_control& workerControl = worker.control;
+		control.stats.missing += workerControl.stats.missing;
+		control.stats.already_set += workerControl.stats.already_set;
+		control.stats.direct_block_runs
+			+= workerControl.stats.direct_block_runs;
+		control.stats.indirect_block_runs
+			+= workerControl.stats.indirect_block_runs;
+		control.stats.indirect_array_blocks
+			+= workerControl.stats.indirect_array_blocks;
+		control.stats.double_indirect_block_runs
+			+= workerControl.stats.double_indirect_block_runs;
+		control.stats.double_indirect_array_blocks
+			+= workerControl.stats.double_indirect_array_blocks;
+		control.stats.blocks_in_direct += workerControl.stats.blocks_in_direct;
+		control.stats.blocks_in_indirect
+			+= workerControl.stats.blocks_in_indirect;
+		control.stats.blocks_in_double_indirect
+			+= workerControl.stats.blocks_in_double_indirect;
+		control.stats.partial_block_runs
+			+= workerControl.stats.partial_block_runs;
+	}
+
+	while (check_node* node = fCheckCookie->queued.RemoveHead()) {
+		put_vnode(fVolume->FSVolume(), node->inode->ID());
+		delete node;
+	}
+	while (check_node* node = fCheckCookie->finished.RemoveHead()) {
+		put_vnode(fVolume->FSVolume(), node->inode->ID());
+		delete node;
+	}
+
+	delete_sem(fCheckCookie->finished_sem);
+	delete[] fCheckCookie->workers;
+
+	fCheckCookie->queued_sem = -1;
+	fCheckCookie->finished_sem = -1;
+	fCheckCookie->workers = NULL;
+	fCheckCookie->num_workers = 0;
+	fCheckCookie->pending = 0;
+}
+
+
+/*!	Hands the node over to the next worker thread that is idle. On success,
+	the reference to the \a inode is passed on as well.
+*/
+status_t
+BlockAllocator::_QueueCheckNode(Inode* inode, const char* name)
+{
+	check_node* node = new(std::nothrow) check_node;
+	if (node == NULL)
+		return B_NO_MEMORY;
+
+	node->inode = inode;
+	strlcpy(node->name, name, B_FILE_NAME_LENGTH);
+
+	MutexLocker locker(fCheckCookie->lock);
+	fCheckCookie->queued.Add(node);
+	locker.Unlock();
+
+	fCheckCookie->pending++;
+	release_sem_etc(fCheckCookie->queued_sem, 1, B_DO_NOT_RESCHEDULE);
+	return B_OK;
+}
+
+
+/*!	Fills the check control with the next node a worker thread is done
+	with, and releases it; waits for one, if necessary. Returns \c false
+	if no nodes are pending at all.
+*/
+bool
+BlockAllocator::_GetFinishedCheckNode()
+{
+	if (fCheckCookie->pending == 0
+		|| acquire_sem(fCheckCookie->finished_sem) != B_OK)
+		return false;
+
+	MutexLocker locker(fCheckCookie->lock);
+	check_node* node = fCheckCookie->finished.RemoveHead();
+	locker.Unlock();
+
+	fCheckCookie->pending--;
+
+	check_control& control = fCheckCookie->control;
+	strlcpy(control.name, node->name, B_FILE_NAME_LENGTH);
+	control.inode = node->inode->ID();
+	control.mode = node->inode->Mode();
+	control.errors = node->errors;
+	control.status = node->status;
+
+	put_vnode(fVolume->FSVolume(), node->inode->ID());
+	delete node;
+	return true;
+}
+
+
+/*static*/ status_t
+BlockAllocator::_CheckWorker(void* _worker)
+{
+	check_worker* worker = (check_worker*)_worker;
+	BlockAllocator* self = worker->allocator;
+	check_cookie* cookie = self->fCheckCookie;
+
+	while (acquire_sem(cookie->queued_sem) == B_OK) {
+		MutexLocker locker(cookie->lock);
+		check_node* node = cookie->queued.RemoveHead();
+		locker.Unlock();
+
+		if (node == NULL)
+			continue;
+
+		worker->control.errors = 0;
+		node->status = self->_CheckInodeBlocks(node->inode, node->name,
+			worker->control);
+		node->errors = worker->control.errors;
+
+		locker.Lock();
+		cookie->finished.Add(node);
+		locker.Unlock();
+
+		release_sem(cookie->finished_sem);
+	}
+
+	return B_OK;
+}
+
+
+/*!	In incremental mode, only nodes that may have been changed since the
+	last complete check need to be checked. These are the ones that have
+	their inode, or any of the top level block runs of their data stream
+	in a changed allocation group.
+*/
+bool
+BlockAllocator::_IsCheckNeeded(Inode* inode) const
+{
+	if (fCheckCookie->pass != BFS_CHECK_PASS_BITMAP
+		|| (fCheckCookie->control.flags & BFS_CHECK_INCREMENTAL) == 0
+		|| fVolume->IsGroupDirty(inode->BlockRun().AllocationGroup()))
+		return true;
+
+	const data_stream& data = inode->Node().data;
+	for (int32 i = 0; i < NUM_DIRECT_BLOCKS; i++) {
+		if (data.direct[i].IsZero())
+			break;
+		if (fVolume->IsGroupDirty(data.direct[i].AllocationGroup()))
+			return true;
+	}
+
+	return (!data.indirect.IsZero()
+			&& fVolume->IsGroupDirty(data.indirect.AllocationGroup()))
+		|| (!data.double_indirect.IsZero()
+			&& fVolume->IsGroupDirty(data.double_indirect.AllocationGroup()));
+}
+
+
 status_t
 BlockAllocator::_RemoveInvalidNode(Inode* parent, BPlusTree* tree, Inode* inode,
 	const char* name)
@@ -1675,11 +2378,31 @@ BlockAllocator::_SetCheckBitmapAt(off_t block)
 }
 
 
+/*!	Sets the block in the check bitmap, and returns whether or not it had
+	been set before. This is safe to be called from several threads at once.
+*/
+bool
+BlockAllocator::_TestAndSetCheckBitmapAt(off_t block)
+{
+	size_t size = BitmapSize();
+	uint32 index = block / 32;	// 32bit resolution
+	if (index > size / 4)
+		return false;
+
+	int32 mask = HOST_ENDIAN_TO_BFS_INT32(1UL << (block & 0x1f));
+	return (atomic_or((int32*)&fCheckBitmap[index], mask) & mask) != 0;
+}
+
+
 status_t
 BlockAllocator::_WriteBackCheckBitmap()
 {
-	if (fVolume->IsReadOnly())
+	if (fVolume->IsReadOnly()
+		|| (fCheckCookie->control.flags & BFS_CHECK_INCREMENTAL) != 0) {
+		// In incremental mode, the check bitmap only contains the blocks
+		// of the nodes that have actually been checked
 		return B_OK;
+	}
 
 	// calculate the number of used blocks in the check bitmap
 	size_t size = BitmapSize();
@@ -1794,6 +2517,19 @@ BlockAllocator::CheckBlocks(off_t start, off_t length, bool allocated)
 
 status_t
 BlockAllocator::CheckBlockRun(block_run run, const char* type, bool allocated)
+{
+	return _CheckBlockRun(run, type, allocated,
+		fCheckCookie != NULL ? &fCheckCookie->control : NULL);
+}
+
+
+/*!	Checks the block run against the block bitmap; if a \a control is
+	given, errors are only recorded in it, and the blocks are added to the
+	check bitmap.
+*/
+status_t
+BlockAllocator::_CheckBlockRun(block_run run, const char* type, bool allocated,
+	check_control* control)
 {
 	if (run.AllocationGroup() < 0 || run.AllocationGroup() >= fNumGroups
 		|| run.Start() > fGroups[run.AllocationGroup()].fNumBits
@@ -1802,10 +2538,10 @@ BlockAllocator::CheckBlockRun(block_run run, const char* type, bool allocated)
 		|| run.length == 0) {
 		PRINT(("%s: block_run(%ld, %u, %u) is invalid!\n", type,
 			run.AllocationGroup(), run.Start(), run.Length()));
-		if (fCheckCookie == NULL)
+		if (control == NULL)
 			return B_BAD_DATA;
 
-		fCheckCookie->control.errors |= BFS_INVALID_BLOCK_RUN;
+		control->errors |= BFS_INVALID_BLOCK_RUN;
 		return B_OK;
 	}
 
@@ -1830,7 +2566,7 @@ BlockAllocator::CheckBlockRun(block_run run, const char* type, bool allocated)
 
 		while (length < run.Length() && pos < cached.NumBlockBits()) {
 			if (cached.IsUsed(pos) != allocated) {
-				if (fCheckCookie == NULL) {
+				if (control == NULL) {
 					PRINT(("%s: block_run(%ld, %u, %u) is only partially "
 						"allocated (pos = %ld, length = %ld)!\n", type,
 						run.AllocationGroup(), run.Start(), run.Length(),
@@ -1839,9 +2575,9 @@ BlockAllocator::CheckBlockRun(block_run run, const char* type, bool allocated)
 				}
 				if (firstMissing == -1) {
 					firstMissing = firstGroupBlock + pos + block * bitsPerBlock;
-					fCheckCookie->control.errors |= BFS_MISSING_BLOCKS;
+					control->errors |= BFS_MISSING_BLOCKS;
 				}
-				fCheckCookie->control.stats.missing++;
+				control->stats.missing++;
 			} else if (firstMissing != -1) {
 				PRINT(("%s: block_run(%ld, %u, %u): blocks %Ld - %Ld are "
 					"%sallocated!\n", type, run.AllocationGroup(), run.Start(),
@@ -1851,18 +2587,18 @@ BlockAllocator::CheckBlockRun(block_run run, const char* type, bool allocated)
 				firstMissing = -1;
 			}
 
-			if (fCheckBitmap != NULL) {
+			if (control != NULL && fCheckBitmap != NULL) {
 				// Set the block in the check bitmap as well, but have a look
 				// if it is already allocated first
 				uint32 offset = pos + block * bitsPerBlock;
-				if (_CheckBitmapIsUsedAt(firstGroupBlock + offset)) {
+				if (_TestAndSetCheckBitmapAt(firstGroupBlock + offset)) {
 					if (firstSet == -1) {
 						firstSet = firstGroupBlock + offset;
-						fCheckCookie->control.errors |= BFS_BLOCKS_ALREADY_SET;
+						control->errors |= BFS_BLOCKS_ALREADY_SET;
 						dprintf("block %" B_PRIdOFF " is already set!!!\n",
 							firstGroupBlock + offset);
 					}
-					fCheckCookie->control.stats.already_set++;
+					control->stats.already_set++;
 				} else {
 					if (firstSet != -1) {
 						FATAL(("%s: block_run(%d, %u, %u): blocks %" B_PRIdOFF
@@ -1872,7 +2608,6 @@ BlockAllocator::CheckBlockRun(block_run run, const char* type, bool allocated)
 							firstGroupBlock + offset - 1));
 						firstSet = -1;
 					}
-					_SetCheckBitmapAt(firstGroupBlock + offset);
 				}
 			}
 			length++;
@@ -1911,7 +2646,18 @@ BlockAllocator::CheckInode(Inode* inode, const char* name)
 	switch (fCheckCookie->pass) {
 		case BFS_CHECK_PASS_BITMAP:
 		{
-			status_t status = _CheckInodeBlocks(inode, name);
+			if (!_IsCheckNeeded(inode)) {
+				// The node hasn't been changed since the last check, but
+				// its attributes might have been
+				if (!inode->Attributes().IsZero()) {
+					MutexLocker stackLocker(fCheckCookie->lock);
+					fCheckCookie->stack.Push(inode->Attributes());
+				}
+				return B_OK;
+			}
+
+			status_t status = _CheckInodeBlocks(inode, name,
+				fCheckCookie->control);
 			if (status != B_OK)
 				return status;
 
@@ -1948,15 +2694,19 @@ BlockAllocator::CheckInode(Inode* inode, const char* name)
 
 
 status_t
-BlockAllocator::_CheckInodeBlocks(Inode* inode, const char* name)
+BlockAllocator::_CheckInodeBlocks(Inode* inode, const char* name,
+	check_control& control)
 {
-	status_t status = CheckBlockRun(inode->BlockRun(), "inode");
+	status_t status = _CheckBlockRun(inode->BlockRun(), "inode", true,
+		&control);
 	if (status != B_OK)
 		return status;
 
 	// If the inode has an attribute directory, push it on the stack
-	if (!inode->Attributes().IsZero())
+	if (!inode->Attributes().IsZero()) {
+		MutexLocker stackLocker(fCheckCookie->lock);
 		fCheckCookie->stack.Push(inode->Attributes());
+	}
 
 	if (inode->IsSymLink() && (inode->Flags() & INODE_LONG_SYMLINK) == 0) {
 		// symlinks may not have a valid data stream
@@ -1975,12 +2725,13 @@ BlockAllocator::_CheckInodeBlocks(Inode* inode, const char* name)
 			if (data->direct[i].IsZero())
 				break;
 
-			status = CheckBlockRun(data->direct[i], "direct");
+			status = _CheckBlockRun(data->direct[i], "direct", true,
+				&control);
 			if (status < B_OK)
 				return status;
 
-			fCheckCookie->control.stats.direct_block_runs++;
-			fCheckCookie->control.stats.blocks_in_direct
+			control.stats.direct_block_runs++;
+			control.stats.blocks_in_direct
 				+= data->direct[i].Length();
 		}
 	}
@@ -1990,7 +2741,7 @@ BlockAllocator::_CheckInodeBlocks(Inode* inode, const char* name)
 	// check the indirect range
 
 	if (data->max_indirect_range) {
-		status = CheckBlockRun(data->indirect, "indirect");
+		status = _CheckBlockRun(data->indirect, "indirect", true, &control);
 		if (status < B_OK)
 			return status;
 
@@ -2007,15 +2758,16 @@ BlockAllocator::_CheckInodeBlocks(Inode* inode, const char* name)
 				if (runs[index].IsZero())
 					break;
 
-				status = CheckBlockRun(runs[index], "indirect->run");
+				status = _CheckBlockRun(runs[index], "indirect->run", true,
+					&control);
 				if (status < B_OK)
 					return status;
 
-				fCheckCookie->control.stats.indirect_block_runs++;
-				fCheckCookie->control.stats.blocks_in_indirect
+				control.stats.indirect_block_runs++;
+				control.stats.blocks_in_indirect
 					+= runs[index].Length();
 			}
-			fCheckCookie->control.stats.indirect_array_blocks++;
+			control.stats.indirect_array_blocks++;
 
 			if (index < runsPerBlock)
 				break;
@@ -2025,7 +2777,8 @@ BlockAllocator::_CheckInodeBlocks(Inode* inode, const char* name)
 	// check the double indirect range
 
 	if (data->max_double_indirect_range) {
-		status = CheckBlockRun(data->double_indirect, "double indirect");
+		status = _CheckBlockRun(data->double_indirect, "double indirect",
+			true, &control);
 		if (status != B_OK)
 			return status;
 
@@ -2048,7 +2801,8 @@ BlockAllocator::_CheckInodeBlocks(Inode* inode, const char* name)
 			if (indirect.IsZero())
 				return B_OK;
 
-			status = CheckBlockRun(indirect, "double indirect->runs");
+			status = _CheckBlockRun(indirect, "double indirect->runs", true,
+				&control);
 			if (status != B_OK)
 				return status;
 
@@ -2067,18 +2821,18 @@ BlockAllocator::_CheckInodeBlocks(Inode* inode, const char* name)
 					if (runs[index % runsPerBlock].IsZero())
 						return B_OK;
 
-					status = CheckBlockRun(runs[index % runsPerBlock],
-						"double indirect->runs->run");
+					status = _CheckBlockRun(runs[index % runsPerBlock],
+						"double indirect->runs->run", true, &control);
 					if (status != B_OK)
 						return status;
 
-					fCheckCookie->control.stats.double_indirect_block_runs++;
-					fCheckCookie->control.stats.blocks_in_double_indirect
+					control.stats.double_indirect_block_runs++;
+					control.stats.blocks_in_double_indirect
 						+= runs[index % runsPerBlock].Length();
 				} while ((++index % runsPerBlock) != 0);
 			}
 
-			fCheckCookie->control.stats.double_indirect_array_blocks++;
+			control.stats.double_indirect_array_blocks++;
 		}
 	}
 
@@ -2112,6 +2866,12 @@ BlockAllocator::_PrepareIndices()
 		if (status != B_OK)
 			return status;
 
+		// The entries are collected during the index pass, and written in
+		// sorted batches; _BuildIndices() writes the last one
+		index->builder = new(std::nothrow) TreeBuilder(tree);
+		if (index->builder == NULL)
+			return B_NO_MEMORY;
+
 		index->inode = inode;
 		vnode.Keep();
 		count++;
@@ -2126,6 +2886,7 @@ BlockAllocator::_FreeIndices()
 {
 	for (int32 i = 0; i < fCheckCookie->indices.CountItems(); i++) {
 		check_index* index = fCheckCookie->indices.Array()[i];
+		delete index->builder;
 		if (index->inode != NULL) {
 			put_vnode(fVolume->FSVolume(),
 				fVolume->ToVnode(index->inode->BlockRun()));
@@ -2136,21 +2897,34 @@ BlockAllocator::_FreeIndices()
 
 
 status_t
-BlockAllocator::_AddInodeToIndex(Inode* inode)
+BlockAllocator::_BuildIndices()
 {
-	Transaction transaction(fVolume, inode->BlockNumber());
-
 	for (int32 i = 0; i < fCheckCookie->indices.CountItems(); i++) {
 		check_index* index = fCheckCookie->indices.Array()[i];
-		if (index->inode == NULL)
+		if (index->builder == NULL)
 			continue;
 
-		index->inode->WriteLockInTransaction(transaction);
+		status_t status = index->builder->Finish();
+		if (status != B_OK) {
+			FATAL(("check: Could not rebuild index \"%s\": %s\n", index->name,
+				strerror(status)));
+			return status;
+		}
+	}
 
-		BPlusTree* tree = index->inode->Tree();
-		if (tree == NULL)
-			return B_ERROR;
+	return B_OK;
+}
+
+
+status_t
+BlockAllocator::_AddInodeToIndex(Inode* inode)
+{
+	for (int32 i = 0; i < fCheckCookie->indices.CountItems(); i++) {
+		check_index* index = fCheckCookie->indices.Array()[i];
+		if (index->builder == NULL)
+			continue;
 
+		TreeBuilder* builder = index->builder;
 		status_t status = B_OK;
 
 		if (!strcmp(index->name, "name")) {
@@ -2159,22 +2933,25 @@ BlockAllocator::_AddInodeToIndex(Inode* inode)
 				if (inode->GetName(name, B_FILE_NAME_LENGTH) != B_OK)
 					return B_ERROR;
 
-				status = tree->Insert(transaction, name, inode->ID());
+				status = builder->Add((uint8*)name, strlen(name), inode->ID());
 			}
 		} else if (!strcmp(index->name, "last_modified")) {
 			if (inode->InLastModifiedIndex()) {
-				status = tree->Insert(transaction, inode->OldLastModified(),
-					inode->ID());
+				int64 lastModified = inode->OldLastModified();
+				status = builder->Add((uint8*)&lastModified,
+					sizeof(lastModified), inode->ID());
 			}
 		} else if (!strcmp(index->name, "size")) {
-			if (inode->InSizeIndex())
-				status = tree->Insert(transaction, inode->Size(), inode->ID());
+			if (inode->InSizeIndex()) {
+				int64 size = inode->Size();
+				status = builder->Add((uint8*)&size, sizeof(size), inode->ID());
+			}
 		} else {
 			uint8 key[BPLUSTREE_MAX_KEY_LENGTH];
 			size_t keyLength = BPLUSTREE_MAX_KEY_LENGTH;
 			if (inode->ReadAttribute(index->name, B_ANY_TYPE, 0, key,
 					&keyLength) == B_OK) {
-				status = tree->Insert(transaction, key, keyLength, inode->ID());
+				status = builder->Add(key, keyLength, inode->ID());
 			}
 		}
 
@@ -2182,7 +2959,7 @@ BlockAllocator::_AddInodeToIndex(Inode* inode)
 			return status;
 	}
 
-	return transaction.Done();
+	return B_OK;
 }
 
 
@@ -2213,16 +2990,16 @@ BlockAllocator::_TrimNext(fs_trim_data& trimData, uint32 maxRanges,
 	if (!pushed || force) {
 		// Trim now
 		trimData.trimmed_size = 0;
-dprintf("TRIM FS:\n");
-for (uint32 i = 0; i < trimData.range_count; i++) {
-	dprintf("[%3" B_PRIu32 "] %" B_PRIu64 " : %" B_PRIu64 "\n", i,
-		trimData.ranges[i].offset, trimData.ranges[i].size);
-}
 		if (ioctl(fVolume->Device(), B_TRIM_DEVICE, &trimData,
 				sizeof(fs_trim_data)) != 0) {
 			return errno;
 		}
 
+		if (fTrimQueue != NULL) {
+			fTrimQueue->stats.trim_requests++;
+			fTrimQueue->stats.trimmed_bytes += trimData.trimmed_size;
+		}
+
 		trimmedSize += trimData.trimmed_size;
 		trimData.range_count = 0;
 	}
@@ -18,6 +18,8 @@ struct disk_super_block;
 struct block_run;
 struct check_control;
 struct check_cookie;
+struct bfs_trim_stats;
+struct trim_queue;
 
 
 //#define DEBUG_ALLOCATION_GROUPS
@@ -49,6 +51,10 @@ public:
 			status_t		Trim(uint64 offset, uint64 size,
 								uint64& trimmedSize);
 
+			status_t		StartBackgroundTrim();
+			void			StopBackgroundTrim();
+			status_t		GetTrimStats(bfs_trim_stats& stats);
+
 			status_t		StartChecking(const check_control* control);
 			status_t		StopChecking(check_control* control);
 			status_t		CheckNextNode(check_control* control);
@@ -78,10 +84,20 @@ private:
 			bool			_IsValidCheckControl(const check_control* control);
 			bool			_CheckBitmapIsUsedAt(off_t block) const;
 			void			_SetCheckBitmapAt(off_t block);
-			status_t		_CheckInodeBlocks(Inode* inode, const char* name);
+			bool			_TestAndSetCheckBitmapAt(off_t block);
+			status_t		_CheckBlockRun(block_run run, const char* type,
+								bool allocated, check_control* control);
+			status_t		_CheckInodeBlocks(Inode* inode, const char* name,
+								check_control& control);
+			bool			_IsCheckNeeded(Inode* inode) const;
+			void			_StartCheckWorkers(uint32 count);
+			void			_StopCheckWorkers();
+			status_t		_QueueCheckNode(Inode* inode, const char* name);
+			bool			_GetFinishedCheckNode();
 			status_t		_FinishBitmapPass();
 			status_t		_PrepareIndices();
 			void			_FreeIndices();
+			status_t		_BuildIndices();
 			status_t		_AddInodeToIndex(Inode* inode);
 			status_t		_WriteBackCheckBitmap();
 			status_t		_AddTrim(fs_trim_data& trimData, uint32 maxRanges,
@@ -89,8 +105,14 @@ private:
 			status_t		_TrimNext(fs_trim_data& trimData, uint32 maxRanges,
 								uint64 offset, uint64 size, bool force,
 								uint64& trimmedSize);
+			void			_QueueTrim(off_t start, uint32 length);
+			status_t		_CollectFreeBlocks(fs_trim_data& trimData,
+								off_t& _start, off_t end);
+			status_t		_TrimQueuedRanges();
 
 	static	status_t		_Initialize(BlockAllocator* self);
+	static	status_t		_CheckWorker(void* _worker);
+	static	status_t		_BackgroundTrimmer(void* _self);
 
 private:
 			Volume*			fVolume;
@@ -102,6 +124,7 @@ private:
 
 			uint32*			fCheckBitmap;
 			check_cookie*	fCheckCookie;
+			trim_queue*		fTrimQueue;
 };
 
 #ifdef BFS_DEBUGGER_COMMANDS
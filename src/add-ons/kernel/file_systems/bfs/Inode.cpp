@@ -391,6 +391,8 @@ Inode::Inode(Volume* volume, Transaction& transaction, ino_t id, mode_t mode,
 	Node().inode_num = run;
 	Node().mode = HOST_ENDIAN_TO_BFS_INT32(mode);
 	Node().flags = HOST_ENDIAN_TO_BFS_INT32(INODE_IN_USE);
+	if (volume->HasInlineData() && IsFile())
+		Node().flags |= HOST_ENDIAN_TO_BFS_INT32(INODE_INLINE_DATA);
 
 	Node().create_time = Node().last_modified_time = Node().status_change_time
 		= HOST_ENDIAN_TO_BFS_INT64(bfs_inode::ToInode(real_time_clock_usecs()));
@@ -573,7 +575,9 @@ Inode::_MakeSpaceForSmallData(Transaction& transaction, bfs_inode* node,
 		int32 index = 0, maxIndex = 0;
 		for (; !item->IsLast(node); item = item->Next(), index++) {
 			// should not remove those
-			if (*item->Name() == FILE_NAME_NAME || !strcmp(name, item->Name()))
+			if (*item->Name() == FILE_NAME_NAME
+				|| *item->Name() == FILE_DATA_NAME
+				|| !strcmp(name, item->Name()))
 				continue;
 
 			if (max == NULL || max->Size() < item->Size()) {
@@ -841,7 +845,7 @@ Inode::_AddSmallData(Transaction& transaction, NodeGetter& nodeGetter,
 	memset(item, 0, spaceNeeded);
 	item->type = HOST_ENDIAN_TO_BFS_INT32(type);
 	item->name_size = HOST_ENDIAN_TO_BFS_INT16(nameLength);
-	item->data_size = HOST_ENDIAN_TO_BFS_INT16(length);
+	item->data_size = HOST_ENDIAN_TO_BFS_INT16(pos + length);
 	strcpy(item->Name(), name);
 	memcpy(item->Data() + pos, data, length);
 
@@ -1599,6 +1603,7 @@ Inode::WriteAt(Transaction& transaction, off_t pos, const uint8* buffer,
 	}
 
 	off_t oldSize = Size();
+	bool wasInline = HasInlineData();
 
 	if ((uint64)pos + (uint64)length > (uint64)oldSize) {
 		// let's grow the data stream to the size needed
@@ -1624,6 +1629,17 @@ Inode::WriteAt(Transaction& transaction, off_t pos, const uint8* buffer,
 
 	writeLocker.Unlock();
 
+	if (wasInline && !HasInlineData()) {
+		// the data that was moved out of the inode must be in its new block
+		// before the transaction is done
+		status_t status = file_cache_sync(FileCache());
+		if (status != B_OK) {
+			*_length = 0;
+			WriteLockInTransaction(transaction);
+			return status;
+		}
+	}
+
 	if (oldSize < pos)
 		FillGapWithZeros(oldSize, pos);
 
@@ -1668,6 +1684,169 @@ Inode::FillGapWithZeros(off_t pos, off_t newSize)
 }
 
 
+/*!	Reads from the file data stored in the small_data section of the inode.
+	This is how bfs_io() fills the file cache of inline files.
+	You need to hold the inode lock when you call this method.
+*/
+status_t
+Inode::ReadInlineData(off_t pos, uint8* buffer, size_t* _length)
+{
+	if (pos < 0)
+		return B_BAD_VALUE;
+
+	size_t length = *_length;
+	if (pos >= Size() || length == 0) {
+		*_length = 0;
+		return B_OK;
+	}
+	if ((uint64)pos + (uint64)length > (uint64)Size())
+		length = Size() - pos;
+
+	NodeGetter node(fVolume, this);
+	if (node.Node() == NULL)
+		return B_IO_ERROR;
+
+	RecursiveLocker locker(fSmallDataLock);
+
+	const char dataTag[2] = {FILE_DATA_NAME, 0};
+	small_data* item = FindSmallData(node.Node(), dataTag);
+	if (item == NULL || (off_t)item->DataSize() < pos + (off_t)length) {
+		FATAL(("inline data of inode %" B_PRIdINO " is corrupt!\n", ID()));
+		RETURN_ERROR(B_BAD_DATA);
+	}
+
+	if (user_memcpy(buffer, item->Data() + pos, length) != B_OK)
+		return B_BAD_ADDRESS;
+
+	*_length = length;
+	return B_OK;
+}
+
+
+/*!	Writes to the file data stored in the small_data section of the inode.
+	This does not change the size of the file; the range written to must
+	already be covered by it (use SetFileSize() to make room first).
+	This is how bfs_io() writes the file cache of inline files back.
+	You need to hold the inode's write lock when you call this method.
+*/
+status_t
+Inode::WriteInlineData(Transaction& transaction, off_t pos,
+	const uint8* buffer, size_t* _length)
+{
+	size_t length = *_length;
+	if (pos < 0 || (uint64)pos + (uint64)length > (uint64)Size())
+		return B_BAD_VALUE;
+	if (length == 0)
+		return B_OK;
+
+	NodeGetter node(fVolume, transaction, this);
+	bfs_inode* writableNode = node.WritableNode();
+	if (writableNode == NULL)
+		return B_IO_ERROR;
+
+	RecursiveLocker locker(fSmallDataLock);
+
+	const char dataTag[2] = {FILE_DATA_NAME, 0};
+	small_data* item = FindSmallData(writableNode, dataTag);
+	if (item == NULL || (off_t)item->DataSize() < pos + (off_t)length) {
+		FATAL(("inline data of inode %" B_PRIdINO " is corrupt!\n", ID()));
+		RETURN_ERROR(B_BAD_DATA);
+	}
+
+	if (user_memcpy(item->Data() + pos, buffer, length) != B_OK)
+		return B_BAD_ADDRESS;
+
+	return B_OK;
+}
+
+
+/*!	Resizes the small_data item that contains the inline file data to
+	\a size bytes; new space is filled with zeros. If there is not enough
+	space left in the inode, B_DEVICE_FULL is returned, and nothing is
+	changed.
+	Other attributes are never moved out of the small_data section to make
+	room, as they are much cheaper to keep there than the file data is.
+*/
+status_t
+Inode::_SetInlineDataSize(Transaction& transaction, off_t size)
+{
+	if (size > fVolume->InodeSize())
+		return B_DEVICE_FULL;
+
+	NodeGetter node(fVolume, transaction, this);
+	if (node.WritableNode() == NULL)
+		return B_IO_ERROR;
+
+	const char dataTag[2] = {FILE_DATA_NAME, 0};
+
+	if (size == 0) {
+		status_t status = _RemoveSmallData(transaction, node, dataTag);
+		if (status == B_ENTRY_NOT_FOUND)
+			return B_OK;
+
+		return status;
+	}
+
+	// Writing nothing at the new end of the data makes _AddSmallData() clear
+	// the gap, or cut off anything behind it
+	const uint8 zero = 0;
+	return _AddSmallData(transaction, node, dataTag, FILE_DATA_TYPE, size,
+		&zero, 0);
+}
+
+
+/*!	Moves the file data from the small_data section into a regular data
+	stream. This is done once the file has grown too large to be stored in
+	its inode; the inode will be written back by the caller.
+	The data is taken from the file cache, as it may have changed since it
+	was last written back, and stays there as modified, so that it will be
+	written to the new block. Since that must not be done with the inode
+	locked, the caller has to sync the file cache before \a transaction
+	is done, so that the inode never points to a block without the data.
+	You need to hold the inode's write lock when you call this method.
+*/
+status_t
+Inode::_MoveInlineDataToStream(Transaction& transaction)
+{
+	off_t size = Size();
+	if (size > fVolume->BlockSize())
+		RETURN_ERROR(B_BAD_DATA);
+
+	uint8* buffer = (uint8*)calloc(1, fVolume->BlockSize());
+	if (buffer == NULL)
+		return B_NO_MEMORY;
+	MemoryDeleter bufferDeleter(buffer);
+
+	// bfs_io() doesn't wait for our transaction, so we can wait for its
+	// pages; as long as the data is inline, it serves them synchronously
+	size_t length = size;
+	status_t status = file_cache_read(FileCache(), NULL, 0, buffer, &length);
+	if (status == B_OK)
+		status = file_cache_write(FileCache(), NULL, 0, buffer, &length);
+	if (status != B_OK)
+		return status;
+
+	status = _SetInlineDataSize(transaction, 0);
+	if (status != B_OK)
+		return status;
+
+	Node().flags &= ~HOST_ENDIAN_TO_BFS_INT32(INODE_INLINE_DATA);
+	Node().data.size = 0;
+
+	if (size == 0)
+		return B_OK;
+
+	status = _GrowStream(transaction, size);
+	if (status != B_OK)
+		return status;
+
+	file_cache_set_size(FileCache(), size);
+	file_map_set_size(Map(), size);
+
+	return B_OK;
+}
+
+
 /*!	Allocates \a length blocks, and clears their contents. Growing
 	the indirect and double indirect range uses this method.
 	The allocated block_run is saved in "run"
@@ -2245,8 +2424,28 @@ Inode::SetFileSize(Transaction& transaction, off_t size)
 
 	T(Resize(this, oldSize, size, false));
 
-	// should the data stream grow or shrink?
 	status_t status;
+	if (HasInlineData()) {
+		status = _SetInlineDataSize(transaction, size);
+		if (status == B_OK) {
+			Node().data.size = HOST_ENDIAN_TO_BFS_INT64(size);
+			file_cache_set_size(FileCache(), size);
+			file_map_set_size(Map(), size);
+
+			return WriteBack(transaction);
+		}
+		if (status != B_DEVICE_FULL)
+			return status;
+
+		// the data doesn't fit into the inode anymore
+		status = _MoveInlineDataToStream(transaction);
+		if (status != B_OK)
+			return status;
+
+		oldSize = Size();
+	}
+
+	// should the data stream grow or shrink?
 	if (size > oldSize) {
 		status = _GrowStream(transaction, size);
 		if (status < B_OK) {
@@ -2260,6 +2459,11 @@ Inode::SetFileSize(Transaction& transaction, off_t size)
 	if (status < B_OK)
 		return status;
 
+	if (size == 0 && fVolume->HasInlineData() && IsFile()) {
+		// an empty file can store its data in the inode again
+		Node().flags |= HOST_ENDIAN_TO_BFS_INT32(INODE_INLINE_DATA);
+	}
+
 	file_cache_set_size(FileCache(), size);
 	file_map_set_size(Map(), size);
 
@@ -2285,7 +2489,7 @@ Inode::NeedsTrimming() const
 	// possible. There are only few indices anyway, so this doesn't hurt.
 	// Also, if an inode is already in deleted state, we don't bother trimming
 	// it.
-	if (IsIndex() || IsDeleted()
+	if (IsIndex() || IsDeleted() || HasInlineData()
 		|| (IsSymLink() && (Flags() & INODE_LONG_SYMLINK) == 0))
 		return false;
 
@@ -2352,6 +2556,23 @@ Inode::Free(Transaction& transaction)
 status_t
 Inode::Sync()
 {
+	if (HasInlineData()) {
+		// The data is written back into the inode, and therefore the log.
+		// bfs_io() doesn't wait for the transaction of another thread, but
+		// it can join ours.
+		Transaction transaction(fVolume, BlockNumber());
+		if (!transaction.IsStarted())
+			return B_ERROR;
+
+		status_t status = file_cache_sync(FileCache());
+		if (status == B_OK)
+			status = transaction.Done();
+		if (status != B_OK)
+			return status;
+
+		return fVolume->GetJournal(BlockNumber())->FlushLogAndBlocks();
+	}
+
 	if (FileCache())
 		return file_cache_sync(FileCache());
 
@@ -2850,8 +3071,10 @@ AttributeIterator::GetNext(char* name, size_t* _length, uint32* _type,
 
 		int32 index = 0;
 		for (; !item->IsLast(node); item = item->Next(), index++) {
-			if (item->NameSize() == FILE_NAME_NAME_LENGTH
-				&& *item->Name() == FILE_NAME_NAME)
+			if ((item->NameSize() == FILE_NAME_NAME_LENGTH
+					&& *item->Name() == FILE_NAME_NAME)
+				|| (item->NameSize() == FILE_DATA_NAME_LENGTH
+					&& *item->Name() == FILE_DATA_NAME))
 				continue;
 
 			if (index >= fCurrentSmallData)
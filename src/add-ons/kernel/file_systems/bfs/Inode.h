@@ -71,6 +71,9 @@ public:
 			bool				IsLongSymLink() const
 									{ return (Flags() & INODE_LONG_SYMLINK)
 										!= 0; }
+			bool				HasInlineData() const
+									{ return (Flags() & INODE_INLINE_DATA)
+										!= 0; }
 
 			bool				HasUserAccessableStream() const
 									{ return IsFile(); }
@@ -143,6 +146,13 @@ public:
 									const uint8* buffer, size_t* length);
 			status_t			FillGapWithZeros(off_t oldSize, off_t newSize);
 
+			// inline data access (the caller must hold the inode lock)
+			status_t			ReadInlineData(off_t pos, uint8* buffer,
+									size_t* _length);
+			status_t			WriteInlineData(Transaction& transaction,
+									off_t pos, const uint8* buffer,
+									size_t* _length);
+
 			status_t			SetFileSize(Transaction& transaction,
 									off_t size);
 			status_t			Append(Transaction& transaction, off_t bytes);
@@ -246,6 +256,10 @@ private:
 									off_t size);
 			status_t			_ShrinkStream(Transaction& transaction,
 									off_t size);
+			status_t			_SetInlineDataSize(Transaction& transaction,
+									off_t size);
+			status_t			_MoveInlineDataToStream(
+									Transaction& transaction);
 
 private:
 			rw_lock				fLock;
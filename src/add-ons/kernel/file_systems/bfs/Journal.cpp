@@ -560,7 +560,7 @@ Journal::ReplayLog()
 
 	INFORM(("Replay log, disk was not correctly unmounted...\n"));
 
-	if (fVolume->SuperBlock().flags != SUPER_BLOCK_DISK_DIRTY) {
+	if (!fVolume->SuperBlock().IsDirty()) {
 		INFORM(("log_start and log_end differ, but disk is marked clean - "
 			"trying to replay log...\n"));
 	}
@@ -594,7 +594,7 @@ Journal::ReplayLog()
 	fVolume->SuperBlock().log_start = HOST_ENDIAN_TO_BFS_INT64(
 		fVolume->LogEnd());
 	fVolume->LogStart() = HOST_ENDIAN_TO_BFS_INT64(fVolume->LogEnd());
-	fVolume->SuperBlock().flags = SUPER_BLOCK_DISK_CLEAN;
+	fVolume->SuperBlock().SetDirty(false);
 
 	return fVolume->WriteSuperBlock();
 }
@@ -667,7 +667,7 @@ Journal::_TransactionWritten(int32 transactionID, int32 event, void* _logEntry)
 
 	if (update) {
 		if (superBlock.log_start == superBlock.log_end)
-			superBlock.flags = SUPER_BLOCK_DISK_CLEAN;
+			superBlock.SetDirty(false);
 
 		status_t status = journal->fVolume->WriteSuperBlock();
 		if (status != B_OK) {
@@ -752,6 +752,8 @@ Journal::_WriteTransactionToLog()
 			FATAL(("filling log entry failed!"));
 			return status;
 		}
+
+		fVolume->SetBlockDirty(blockNumber);
 	}
 
 	if (runArrays.CountBlocks() == 0) {
@@ -866,7 +868,7 @@ Journal::_WriteTransactionToLog()
 
 	// Update the log end pointer in the superblock
 
-	fVolume->SuperBlock().flags = SUPER_BLOCK_DISK_DIRTY;
+	fVolume->SuperBlock().SetDirty(true);
 	fVolume->SuperBlock().log_end = HOST_ENDIAN_TO_BFS_INT64(logPosition);
 
 	status = fVolume->WriteSuperBlock();
@@ -952,10 +954,34 @@ Journal::FlushLogAndBlocks()
 }
 
 
+/*!	Writes all finished transactions to the log, but doesn't write back
+	any blocks. The caller must have locked the journal without starting a
+	transaction, ie. via Lock(NULL, ...).
+*/
+status_t
+Journal::FlushLogLocked()
+{
+	ASSERT_LOCKED_RECURSIVE(&fLock);
+
+	if (fOwner != NULL)
+		return B_BUSY;
+
+	if (fUnwrittenTransactions != 0 && _TransactionSize() != 0)
+		return _WriteTransactionToLog();
+
+	return B_OK;
+}
+
+
+/*!	Locks the journal, and starts a transaction for \a owner, or joins the
+	current one. If \a wait is \c false, B_WOULD_BLOCK is returned in case
+	another thread holds the journal.
+*/
 status_t
-Journal::Lock(Transaction* owner, bool separateSubTransactions)
+Journal::Lock(Transaction* owner, bool separateSubTransactions, bool wait)
 {
-	status_t status = recursive_lock_lock(&fLock);
+	status_t status = wait
+		? recursive_lock_lock(&fLock) : recursive_lock_trylock(&fLock);
 	if (status != B_OK)
 		return status;
 
@@ -1169,6 +1195,27 @@ Transaction::Start(Volume* volume, off_t refBlock)
 }
 
 
+/*!	Like Start(), but does not wait for a transaction of another thread to
+	finish; B_WOULD_BLOCK is returned instead.
+*/
+status_t
+Transaction::TryStart(Volume* volume, off_t refBlock)
+{
+	if (fJournal != NULL)
+		return B_OK;
+
+	fJournal = volume->GetJournal(refBlock);
+	if (fJournal == NULL)
+		return B_ERROR;
+
+	status_t status = fJournal->Lock(this, false, false);
+	if (status != B_OK)
+		fJournal = NULL;
+
+	return status;
+}
+
+
 void
 Transaction::AddListener(TransactionListener* listener)
 {
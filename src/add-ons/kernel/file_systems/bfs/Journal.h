@@ -26,7 +26,8 @@ public:
 			status_t		InitCheck();
 
 			status_t		Lock(Transaction* owner,
-								bool separateSubTransactions);
+								bool separateSubTransactions,
+								bool wait = true);
 			status_t		Unlock(Transaction* owner, bool success);
 
 			status_t		ReplayLog();
@@ -36,6 +37,7 @@ public:
 			bool			CurrentTransactionTooLarge() const;
 
 			status_t		FlushLogAndBlocks();
+			status_t		FlushLogLocked();
 			Volume*			GetVolume() const { return fVolume; }
 			int32			TransactionID() const { return fTransactionID; }
 
@@ -133,6 +135,7 @@ public:
 	}
 
 	status_t Start(Volume* volume, off_t refBlock);
+	status_t TryStart(Volume* volume, off_t refBlock);
 	bool IsStarted() const { return fJournal != NULL; }
 
 	status_t Done()
@@ -192,7 +192,10 @@ DeviceOpener::GetSize(off_t* _size, uint32* _blockSize)
 bool
 disk_super_block::IsValid() const
 {
-	if (Magic1() != (int32)SUPER_BLOCK_MAGIC1
+	int32 magic1 = Features() != 0
+		? (int32)SUPER_BLOCK_FEATURES_MAGIC1 : (int32)SUPER_BLOCK_MAGIC1;
+
+	if (Magic1() != magic1
 		|| Magic2() != (int32)SUPER_BLOCK_MAGIC2
 		|| Magic3() != (int32)SUPER_BLOCK_MAGIC3
 		|| (int32)block_size != inode_size
@@ -203,13 +206,50 @@ disk_super_block::IsValid() const
 		|| BlocksPerAllocationGroup() < 1
 		|| NumBlocks() < 10
 		|| AllocationGroups() != divide_roundup(NumBlocks(),
-			1L << AllocationGroupShift()))
+			1L << AllocationGroupShift())
+		|| (Features() & ~SUPER_BLOCK_KNOWN_FEATURES) != 0)
 		return false;
 
 	return true;
 }
 
 
+bool
+disk_super_block::IsDirty() const
+{
+	return Flags() == SUPER_BLOCK_DISK_DIRTY
+		|| Flags() == SUPER_BLOCK_DISK_DIRTY_TRACKED;
+}
+
+
+/*!	Marks the file system as dirty or clean, and keeps the changed allocation
+	groups valid if they are tracked.
+*/
+void
+disk_super_block::SetDirty(bool dirty)
+{
+	int32 newFlags;
+	if (HasDirtyGroups()) {
+		newFlags = dirty
+			? SUPER_BLOCK_DISK_DIRTY_TRACKED : SUPER_BLOCK_DISK_CLEAN_TRACKED;
+	} else
+		newFlags = dirty ? SUPER_BLOCK_DISK_DIRTY : SUPER_BLOCK_DISK_CLEAN;
+
+	flags = HOST_ENDIAN_TO_BFS_INT32(newFlags);
+}
+
+
+/*!	Returns whether or not the \c dirty_groups field is valid. Drivers that
+	do not know about it only ever write the untracked flags.
+*/
+bool
+disk_super_block::HasDirtyGroups() const
+{
+	return Flags() == SUPER_BLOCK_DISK_CLEAN_TRACKED
+		|| Flags() == SUPER_BLOCK_DISK_DIRTY_TRACKED;
+}
+
+
 void
 disk_super_block::Initialize(const char* diskName, off_t numBlocks,
 	uint32 blockSize)
@@ -545,6 +585,63 @@ Volume::AllocateForInode(Transaction& transaction, const Inode* parent,
 }
 
 
+/*!	Marks the allocation group the given block belongs to as changed since
+	the last file system check. Blocks of the block bitmap mark the group
+	they describe.
+	The caller must hold the journal lock.
+*/
+void
+Volume::SetBlockDirty(off_t block)
+{
+	int32 group;
+	if (block < ToBlock(Log())) {
+		// the super block doesn't belong to any group
+		if (block == 0)
+			return;
+
+		group = (block - 1) / fSuperBlock.BlocksPerAllocationGroup();
+	} else
+		group = block >> AllocationGroupShift();
+
+	uint32 bit = group / divide_roundup(fSuperBlock.AllocationGroups(),
+		SUPER_BLOCK_DIRTY_GROUP_BITS);
+	if (bit >= SUPER_BLOCK_DIRTY_GROUP_BITS)
+		return;
+
+	fSuperBlock.dirty_groups[bit / 32]
+		|= HOST_ENDIAN_TO_BFS_INT32(1UL << (bit % 32));
+}
+
+
+bool
+Volume::IsGroupDirty(int32 group) const
+{
+	if (!HasDirtyGroups())
+		return true;
+
+	uint32 bit = group / divide_roundup(fSuperBlock.AllocationGroups(),
+		SUPER_BLOCK_DIRTY_GROUP_BITS);
+	if (bit >= SUPER_BLOCK_DIRTY_GROUP_BITS)
+		return true;
+
+	return (BFS_ENDIAN_TO_HOST_INT32(fSuperBlock.dirty_groups[bit / 32])
+		& (1UL << (bit % 32))) != 0;
+}
+
+
+/*!	Is called after a complete file system check, and starts tracking the
+	changed allocation groups from scratch. The super block is not written
+	back.
+*/
+void
+Volume::ResetDirtyGroups()
+{
+	fSuperBlock.flags = HOST_ENDIAN_TO_BFS_INT32(fSuperBlock.IsDirty()
+		? SUPER_BLOCK_DISK_DIRTY_TRACKED : SUPER_BLOCK_DISK_CLEAN_TRACKED);
+	memset(fSuperBlock.dirty_groups, 0, sizeof(fSuperBlock.dirty_groups));
+}
+
+
 status_t
 Volume::WriteSuperBlock()
 {
@@ -695,6 +792,14 @@ Volume::Initialize(int fd, const char* name, uint32 blockSize,
 	// create valid superblock
 
 	fSuperBlock.Initialize(name, numBlocks, blockSize);
+	if ((flags & VOLUME_INLINE_DATA) != 0) {
+		fSuperBlock.magic1
+			= HOST_ENDIAN_TO_BFS_INT32(SUPER_BLOCK_FEATURES_MAGIC1);
+		fSuperBlock.features = HOST_ENDIAN_TO_BFS_INT32(
+			fSuperBlock.Features() | SUPER_BLOCK_FEATURE_INLINE_DATA);
+	}
+	ResetDirtyGroups();
+		// a new file system doesn't need to be checked
 
 	// initialize short hands to the superblock (to save byte swapping)
 	fBlockSize = fSuperBlock.BlockSize();
@@ -23,6 +23,7 @@ enum volume_flags {
 
 enum volume_initialize_flags {
 	VOLUME_NO_INDICES	= 0x0001,
+	VOLUME_INLINE_DATA	= 0x0002,
 };
 
 typedef DoublyLinkedList<Inode> InodeList;
@@ -76,6 +77,9 @@ public:
 			uint32			AllocationGroupShift() const
 								{ return fAllocationGroupShift; }
 			disk_super_block& SuperBlock() { return fSuperBlock; }
+			bool			HasInlineData() const
+								{ return (fSuperBlock.Features()
+									& SUPER_BLOCK_FEATURE_INLINE_DATA) != 0; }
 
 			off_t			ToOffset(block_run run) const
 								{ return ToBlock(run) << BlockShift(); }
@@ -115,6 +119,13 @@ public:
 			bool			IsCheckingThread() const
 								{ return find_thread(NULL) == fCheckingThread; }
 
+			// allocation groups changed since the last check
+			bool			HasDirtyGroups() const
+								{ return fSuperBlock.HasDirtyGroups(); }
+			void			SetBlockDirty(off_t block);
+			bool			IsGroupDirty(int32 group) const;
+			void			ResetDirtyGroups();
+
 			// cache access
 			status_t		WriteSuperBlock();
 			status_t		FlushDevice();
@@ -55,6 +55,7 @@ typedef block_run inode_addr;
 
 
 #define BFS_DISK_NAME_LENGTH	32
+#define SUPER_BLOCK_DIRTY_GROUP_WORDS	4
 
 struct disk_super_block {
 	char		name[BFS_DISK_NAME_LENGTH];
@@ -76,7 +77,9 @@ struct disk_super_block {
 	int32		magic3;
 	inode_addr	root_dir;
 	inode_addr	indices;
-	int32		_reserved[8];
+	uint32		features;
+	uint32		dirty_groups[SUPER_BLOCK_DIRTY_GROUP_WORDS];
+	int32		_reserved[3];
 	int32		pad_to_block[87];
 		// this also contains parts of the boot block
 
@@ -97,21 +100,44 @@ struct disk_super_block {
 	int32 Flags() const { return BFS_ENDIAN_TO_HOST_INT32(flags); }
 	off_t LogStart() const { return BFS_ENDIAN_TO_HOST_INT64(log_start); }
 	off_t LogEnd() const { return BFS_ENDIAN_TO_HOST_INT64(log_end); }
+	uint32 Features() const { return BFS_ENDIAN_TO_HOST_INT32(features); }
 
 	// implemented in Volume.cpp:
 	bool IsValid() const;
 	void Initialize(const char *name, off_t numBlocks, uint32 blockSize);
+	bool IsDirty() const;
+	void SetDirty(bool dirty);
+	bool HasDirtyGroups() const;
 } _PACKED;
 
 #define SUPER_BLOCK_FS_LENDIAN		'BIGE'		/* BIGE */
 
 #define SUPER_BLOCK_MAGIC1			'BFS1'		/* BFS1 */
+#define SUPER_BLOCK_FEATURES_MAGIC1	'BFSF'		/* BFSF */
+	// replaces SUPER_BLOCK_MAGIC1 on volumes that use any features
 #define SUPER_BLOCK_MAGIC2			0xdd121031
 #define SUPER_BLOCK_MAGIC3			0x15b6830e
 
 #define SUPER_BLOCK_DISK_CLEAN		'CLEN'		/* CLEN */
 #define SUPER_BLOCK_DISK_DIRTY		'DIRT'		/* DIRT */
 
+// These replace the flags above while the dirty_groups bitmap contains all
+// allocation groups that have been changed since the last complete file
+// system check. Each bit covers the same number of consecutive groups.
+// Drivers that don't know about the bitmap set the flags to one of the
+// values above as soon as they change anything, so it can't become stale.
+#define SUPER_BLOCK_DISK_CLEAN_TRACKED	'CLNT'		/* CLNT */
+#define SUPER_BLOCK_DISK_DIRTY_TRACKED	'DRTT'		/* DRTT */
+#define SUPER_BLOCK_DIRTY_GROUP_BITS	(SUPER_BLOCK_DIRTY_GROUP_WORDS * 32)
+
+// Incompatible on-disk features; a volume that uses a feature not listed
+// in SUPER_BLOCK_KNOWN_FEATURES must not be mounted. Implementations that
+// predate the features field ignore it, but reject the different magic1
+// of volumes that use them.
+#define SUPER_BLOCK_FEATURE_INLINE_DATA	0x00000001
+	// small file contents may be stored in the inode's small_data section
+#define SUPER_BLOCK_KNOWN_FEATURES		SUPER_BLOCK_FEATURE_INLINE_DATA
+
 //**************************************
 
 #define NUM_DIRECT_BLOCKS			12
@@ -171,6 +197,11 @@ struct small_data {
 #define FILE_NAME_NAME			0x13
 #define FILE_NAME_NAME_LENGTH	1
 
+// inline file contents are stored in the small_data section as well
+#define FILE_DATA_TYPE			'RAWT'
+#define FILE_DATA_NAME			0x14
+#define FILE_DATA_NAME_LENGTH	1
+
 
 //**************************************
 
@@ -253,6 +284,7 @@ enum inode_flags {
 	INODE_DELETED			= 0x00000010,
 	INODE_NOT_READY			= 0x00000020,	// used during Inode construction
 	INODE_LONG_SYMLINK		= 0x00000040,	// symlink in data stream
+	INODE_INLINE_DATA		= 0x00000080,	// file data in small_data section
 
 	INODE_PERMANENT_FLAGS	= 0x0000ffff,
 
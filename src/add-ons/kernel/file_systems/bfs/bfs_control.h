@@ -23,6 +23,20 @@
 
 #define BFS_IOCTL_UPDATE_BOOT_BLOCK	14204
 
+/* ioctl to retrieve the statistics of the background trimmer - parameter
+ * is a struct bfs_trim_stats
+ */
+#define BFS_IOCTL_GET_TRIM_STATS	14205
+
+struct bfs_trim_stats {
+	uint64	queued_ranges;		/* freed block ranges queued for trimming */
+	uint64	merged_ranges;		/* ranges merged into adjacent ones */
+	uint64	dropped_ranges;		/* ranges not trimmed as the queue was full */
+	uint64	trim_requests;		/* B_TRIM_DEVICE requests issued */
+	uint64	trimmed_bytes;
+	uint64	reused_bytes;		/* freed, but allocated again before the trim */
+};
+
 struct update_boot_block {
 	uint32			offset;
 	const uint8*	data;
@@ -84,6 +98,20 @@ struct check_control {
 	 */
 #define BFS_FIX_NAME_MISMATCHES	8
 #define BFS_FIX_BPLUSTREES		16
+#define BFS_CHECK_INCREMENTAL	32
+	/* only checks the nodes in allocation groups that have been changed
+	 * since the last complete check; the block bitmap is not rebuilt in
+	 * this mode. If the volume doesn't know which groups have changed,
+	 * the flag is cleared, and the whole volume is checked.
+	 */
+#define BFS_CHECK_THREADS_MASK	0xff000000
+#define BFS_CHECK_THREADS_SHIFT	24
+#define BFS_CHECK_THREADS(count) \
+	(((uint32)(count) << BFS_CHECK_THREADS_SHIFT) & BFS_CHECK_THREADS_MASK)
+	/* the upper bits contain the number of threads that check the files
+	 * of the bitmap pass in parallel; 0 or 1 let the calling thread do all
+	 * the work
+	 */
 
 /* values for the errors field */
 #define BFS_MISSING_BLOCKS		1
@@ -26,6 +26,9 @@
 
 #define BFS_IO_SIZE	65536
 
+// the maximum number of inodes to be read ahead per bfs_read_dir() call
+#define BFS_READ_DIR_PREFETCH_INODES	64
+
 
 struct identify_cookie {
 	disk_super_block super_block;
@@ -107,6 +110,82 @@ iterative_io_finished_hook(void* cookie, io_request* request, status_t status,
 }
 
 
+#ifndef FS_SHELL
+/*!	Serves \a request of the file cache from the file data stored in the
+	inode. Beyond the end of the file, reads return zeros, and writes are
+	ignored.
+	The caller must hold the inode lock, for write requests the write lock,
+	and must have started \a transaction for them.
+*/
+static status_t
+inline_data_io(Transaction& transaction, Inode* inode, io_request* request)
+{
+	off_t offset = io_request_offset(request);
+	size_t length = io_request_length(request);
+
+	size_t bytes = 0;
+	if (offset < inode->Size())
+		bytes = min_c((off_t)length, inode->Size() - offset);
+
+	uint8* buffer = (uint8*)malloc(length);
+	if (buffer == NULL)
+		return B_NO_MEMORY;
+
+	MemoryDeleter bufferDeleter(buffer);
+
+	status_t status;
+	if (io_request_is_write(request)) {
+		status = read_from_io_request(request, buffer, length);
+		if (status == B_OK)
+			status = inode->WriteInlineData(transaction, offset, buffer, &bytes);
+	} else {
+		status = inode->ReadInlineData(offset, buffer, &bytes);
+		if (status == B_OK) {
+			memset(buffer + bytes, 0, length - bytes);
+			status = write_to_io_request(request, buffer, length);
+		}
+	}
+
+	return status;
+}
+#endif
+
+
+static int
+compare_blocks(const void* _a, const void* _b)
+{
+	off_t a = *(const off_t*)_a;
+	off_t b = *(const off_t*)_b;
+
+	if (a < b)
+		return -1;
+	return a > b ? 1 : 0;
+}
+
+
+/*!	Starts reading in the inodes at the given blocks in the background, in
+	ascending order, and with neighbouring inodes combined into a single
+	request.
+*/
+static void
+prefetch_inodes(Volume* volume, off_t* blocks, uint32 count)
+{
+	qsort(blocks, count, sizeof(off_t), &compare_blocks);
+
+	uint32 first = 0;
+	while (first < count) {
+		uint32 last = first;
+		while (last + 1 < count && blocks[last + 1] <= blocks[last] + 1)
+			last++;
+
+		size_t numBlocks = blocks[last] - blocks[first] + 1;
+		block_cache_prefetch(volume->BlockCache(), blocks[first], &numBlocks);
+
+		first = last + 1;
+	}
+}
+
+
 //	#pragma mark - Scanning
 
 
@@ -178,6 +257,18 @@ bfs_mount(fs_volume* _volume, const char* device, uint32 flags,
 	_volume->ops = &gBFSVolumeOps;
 	*_rootID = volume->ToVnode(volume->Root());
 
+#ifndef FS_SHELL
+	// The "notrim" option turns off trimming freed blocks in the background,
+	// for devices that handle trim requests badly
+	void* handle = parse_driver_settings_string(args);
+	bool trim = !get_driver_boolean_parameter(handle, "notrim", false, true);
+	delete_driver_settings(handle);
+
+	// trimming is only an optimization, so we ignore any errors here
+	if (trim)
+		volume->Allocator().StartBackgroundTrim();
+#endif
+
 	INFORM(("mounted \"%s\" (root node at %" B_PRIdINO ", device = %s)\n",
 		volume->Name(), *_rootID, device));
 	return B_OK;
@@ -501,6 +592,51 @@ bfs_io(fs_volume* _volume, fs_vnode* _node, void* _cookie, io_request* request)
 		RETURN_ERROR(B_BAD_VALUE);
 	}
 
+#ifndef FS_SHELL
+	if (inode->HasInlineData()) {
+		// Like everywhere else, the transaction has to be started before
+		// the inode is locked. The page we write back is busy until we are
+		// done, and the thread that holds the journal may be waiting for it,
+		// so we don't wait for the journal; the page just stays modified,
+		// and is written back later (Inode::Sync() starts the transaction
+		// itself first).
+		bool isWrite = io_request_is_write(request);
+		Transaction transaction;
+		if (isWrite) {
+			status_t status = transaction.TryStart(volume,
+				inode->BlockNumber());
+			if (status != B_OK) {
+				notify_io_request(request, status);
+				return status;
+			}
+		}
+
+		if (isWrite)
+			rw_lock_write_lock(&inode->Lock());
+		else
+			rw_lock_read_lock(&inode->Lock());
+
+		// the data might have been moved to a data stream in the meantime
+		status_t status = B_OK;
+		bool isInline = inode->HasInlineData();
+		if (isInline) {
+			status = inline_data_io(transaction, inode, request);
+			if (status == B_OK && isWrite)
+				status = transaction.Done();
+		}
+
+		if (isWrite)
+			rw_lock_write_unlock(&inode->Lock());
+		else
+			rw_lock_read_unlock(&inode->Lock());
+
+		if (isInline) {
+			notify_io_request(request, status);
+			return status;
+		}
+	}
+#endif
+
 	// We lock the node here and will unlock it in the "finished" hook.
 	rw_lock_read_lock(&inode->Lock());
 
@@ -657,6 +793,18 @@ bfs_ioctl(fs_volume* _volume, fs_vnode* _node, void* _cookie, uint32 cmd,
 			uint32 version = 0x10000;
 			return user_memcpy(buffer, &version, sizeof(uint32));
 		}
+		case BFS_IOCTL_GET_TRIM_STATS:
+		{
+			if (bufferLength != sizeof(bfs_trim_stats))
+				return B_BAD_VALUE;
+
+			bfs_trim_stats stats;
+			status_t status = volume->Allocator().GetTrimStats(stats);
+			if (status != B_OK)
+				return status;
+
+			return user_memcpy(buffer, &stats, sizeof(bfs_trim_stats));
+		}
 		case BFS_IOCTL_START_CHECKING:
 		{
 			// start checking
@@ -830,18 +978,28 @@ bfs_write_stat(fs_volume* _volume, fs_vnode* _node, const struct stat* stat,
 			RETURN_ERROR(B_NOT_ALLOWED);
 
 		off_t oldSize = inode->Size();
+		bool wasInline = inode->HasInlineData();
 
 		status_t status = inode->SetFileSize(transaction, stat->st_size);
 		if (status != B_OK)
 			return status;
 
-		// fill the new blocks (if any) with zeros
-		if ((mask & B_STAT_SIZE_INSECURE) == 0) {
+		bool moved = wasInline && !inode->HasInlineData();
+
+		// fill the new blocks (if any) with zeros, and write the data moved
+		// out of the inode to its new block before the transaction is done
+		if ((mask & B_STAT_SIZE_INSECURE) == 0 || moved) {
 			// We must not keep the inode locked during a write operation,
 			// or else we might deadlock.
 			rw_lock_write_unlock(&inode->Lock());
-			inode->FillGapWithZeros(oldSize, inode->Size());
+			if ((mask & B_STAT_SIZE_INSECURE) == 0)
+				inode->FillGapWithZeros(oldSize, inode->Size());
+			if (moved)
+				status = file_cache_sync(inode->FileCache());
 			rw_lock_write_lock(&inode->Lock());
+
+			if (status != B_OK)
+				return status;
 		}
 
 		if (!inode->IsDeleted()) {
@@ -1668,6 +1826,13 @@ bfs_read_dir(fs_volume* _volume, fs_vnode* _node, void* _cookie,
 	uint32 maxCount = *_num;
 	uint32 count = 0;
 
+	// Read ahead the directory, and collect the inodes of the entries, as
+	// they are likely to be read next (ie. by stat())
+	iterator->PrefetchNodes(BFS_IO_SIZE >> volume->BlockShift());
+
+	off_t inodeBlocks[BFS_READ_DIR_PREFETCH_INODES];
+	uint32 inodeCount = 0;
+
 	while (count < maxCount && bufferSize > sizeof(struct dirent)) {
 		ino_t id;
 		uint16 length;
@@ -1695,11 +1860,17 @@ bfs_read_dir(fs_volume* _volume, fs_vnode* _node, void* _cookie,
 		dirent->d_ino = id;
 		dirent->d_reclen = sizeof(struct dirent) + length;
 
+		if (inodeCount < BFS_READ_DIR_PREFETCH_INODES)
+			inodeBlocks[inodeCount++] = volume->VnodeToBlock(id);
+
 		bufferSize -= dirent->d_reclen;
 		dirent = (struct dirent*)((uint8*)dirent + dirent->d_reclen);
 		count++;
 	}
 
+	if (inodeCount > 1)
+		prefetch_inodes(volume, inodeBlocks, inodeCount);
+
 	*_num = count;
 	return B_OK;
 }
@@ -21,7 +21,9 @@
 #include "AttributeDirectoryCookie.h"
 #include "DebugSupport.h"
 #include "Directory.h"
+#include "FileContentTable.h"
 #include "GlobalFactory.h"
+#include "HeapChunkCache.h"
 #include "Query.h"
 #include "PackageFSRoot.h"
 #include "StringConstants.h"
@@ -1124,9 +1126,32 @@ packagefs_std_ops(int32 op, ...)
 				return error;
 			}
 
+			error = HeapChunkCache::CreateDefault();
+			if (error != B_OK) {
+				ERROR("Failed to init HeapChunkCache\n");
+				GlobalFactory::DeleteDefault();
+				StringConstants::Cleanup();
+				StringPool::Cleanup();
+				exit_debugging();
+				return error;
+			}
+
+			error = FileContentTable::CreateDefault();
+			if (error != B_OK) {
+				ERROR("Failed to init FileContentTable\n");
+				HeapChunkCache::DeleteDefault();
+				GlobalFactory::DeleteDefault();
+				StringConstants::Cleanup();
+				StringPool::Cleanup();
+				exit_debugging();
+				return error;
+			}
+
 			error = PackageFSRoot::GlobalInit();
 			if (error != B_OK) {
 				ERROR("Failed to init PackageFSRoot\n");
+				FileContentTable::DeleteDefault();
+				HeapChunkCache::DeleteDefault();
 				GlobalFactory::DeleteDefault();
 				StringConstants::Cleanup();
 				StringPool::Cleanup();
@@ -1141,6 +1166,8 @@ packagefs_std_ops(int32 op, ...)
 		{
 			PRINT("package_std_ops(): B_MODULE_UNINIT\n");
 			PackageFSRoot::GlobalUninit();
+			FileContentTable::DeleteDefault();
+			HeapChunkCache::DeleteDefault();
 			GlobalFactory::DeleteDefault();
 			StringConstants::Cleanup();
 			StringPool::Cleanup();
@@ -52,7 +52,7 @@ read_package_data(const PackageData& data, BDataReader* reader, off_t offset,
 
 
 UnpackingAttributeCookie::UnpackingAttributeCookie(PackageNode* packageNode,
-	PackageNodeAttribute* attribute, int openMode)
+	const PackageNodeAttribute& attribute, int openMode)
 	:
 	fPackageNode(packageNode),
 	fPackage(packageNode->GetPackage()),
@@ -79,12 +79,15 @@ UnpackingAttributeCookie::Open(PackageNode* packageNode, const StringKey& name,
 		return B_ENTRY_NOT_FOUND;
 
 	// get the attribute
-	PackageNodeAttribute* attribute = packageNode->FindAttribute(name);
-	if (attribute == NULL) {
+	PackageNodeAttribute attribute;
+	status_t error = packageNode->FindAttribute(name, attribute);
+	if (error == B_ENTRY_NOT_FOUND) {
 		// We don't know the attribute -- maybe it's an auto-generated one.
 		return AutoPackageAttributes::OpenCookie(packageNode->GetPackage(),
 			name, openMode, _cookie);
 	}
+	if (error != B_OK)
+		RETURN_ERROR(error);
 
 	// allocate the cookie
 	UnpackingAttributeCookie* cookie = new(std::nothrow)
@@ -108,8 +111,8 @@ UnpackingAttributeCookie::ReadAttribute(off_t offset, void* buffer,
 status_t
 UnpackingAttributeCookie::ReadAttributeStat(struct stat* st)
 {
-	st->st_size = fAttribute->Data().UncompressedSize();
-	st->st_type = fAttribute->Type();
+	st->st_size = fAttribute.Data().UncompressedSize();
+	st->st_type = fAttribute.Type();
 
 	return B_OK;
 }
@@ -117,10 +120,10 @@ UnpackingAttributeCookie::ReadAttributeStat(struct stat* st)
 
 /*static*/ status_t
 UnpackingAttributeCookie::ReadAttribute(PackageNode* packageNode,
-	PackageNodeAttribute* attribute, off_t offset, void* buffer,
+	const PackageNodeAttribute& attribute, off_t offset, void* buffer,
 	size_t* bufferSize)
 {
-	const PackageData& data = attribute->Data();
+	const PackageData& data = attribute.Data();
 	if (data.IsEncodedInline()) {
 		// inline data
 		BBufferDataReader dataReader(data.InlineData(),
@@ -154,16 +157,18 @@ UnpackingAttributeCookie::IndexAttribute(PackageNode* packageNode,
 		return B_ENTRY_NOT_FOUND;
 
 	// get the attribute
-	PackageNodeAttribute* attribute = packageNode->FindAttribute(
-		indexer->IndexName());
-	if (attribute == NULL)
-		return B_ENTRY_NOT_FOUND;
+	PackageNodeAttribute attribute;
+	status_t error = packageNode->FindAttribute(indexer->IndexName(),
+		attribute);
+	if (error != B_OK)
+		return error;
 
-	// create the index cookie
+	// create the index cookie -- the attribute is identified by its offset
 	void* data;
 	size_t toRead;
-	status_t error = indexer->CreateCookie(packageNode, attribute,
-		attribute->Type(), attribute->Data().UncompressedSize(), data, toRead);
+	error = indexer->CreateCookie(packageNode,
+		(void*)(addr_t)attribute.Offset(), attribute.Type(),
+		attribute.Data().UncompressedSize(), data, toRead);
 	if (error != B_OK)
 		return error;
 
@@ -185,7 +190,11 @@ UnpackingAttributeCookie::IndexAttribute(PackageNode* packageNode,
 		}
 	}
 
-	attribute->SetIndexCookie(indexer->Cookie());
+	error = packageNode->SetIndexCookie(attribute, indexer->Cookie());
+	if (error != B_OK) {
+		indexer->DeleteCookie();
+		return error;
+	}
 
 	return B_OK;
 }
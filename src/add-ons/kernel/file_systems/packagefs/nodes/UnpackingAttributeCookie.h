@@ -7,20 +7,20 @@
 
 
 #include "AttributeCookie.h"
+#include "PackageNodeAttribute.h"
 #include "StringKey.h"
 
 
 class AttributeIndexer;
 class Package;
 class PackageNode;
-class PackageNodeAttribute;
 
 
 class UnpackingAttributeCookie : public AttributeCookie {
 public:
 								UnpackingAttributeCookie(
 									PackageNode* packageNode,
-									PackageNodeAttribute* attribute,
+									const PackageNodeAttribute& attribute,
 									int openMode);
 	virtual						~UnpackingAttributeCookie();
 
@@ -33,7 +33,7 @@ public:
 	virtual	status_t			ReadAttributeStat(struct stat* st);
 
 	static	status_t			ReadAttribute(PackageNode* packageNode,
-									PackageNodeAttribute* attribute,
+									const PackageNodeAttribute& attribute,
 									off_t offset, void* buffer,
 									size_t* bufferSize);
 	static	status_t			IndexAttribute(PackageNode* packageNode,
@@ -42,7 +42,7 @@ public:
 private:
 			PackageNode*		fPackageNode;
 			Package*			fPackage;
-			PackageNodeAttribute* fAttribute;
+			PackageNodeAttribute fAttribute;
 			int					fOpenMode;
 };
 
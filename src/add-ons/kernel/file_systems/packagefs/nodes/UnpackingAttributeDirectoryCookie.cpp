@@ -15,11 +15,12 @@ UnpackingAttributeDirectoryCookie::UnpackingAttributeDirectoryCookie(
 	:
 	AutoPackageAttributeDirectoryCookie(),
 	fPackageNode(packageNode),
-	fAttribute(NULL)
+	fAttributeCookie(0),
+	fAttributeName()
 {
 	if (fPackageNode != NULL) {
 		fPackageNode->AcquireReference();
-		fAttribute = fPackageNode->Attributes().Head();
+		fPackageNode->GetNextAttributeName(fAttributeCookie, fAttributeName);
 	}
 }
 
@@ -48,8 +49,11 @@ UnpackingAttributeDirectoryCookie::Open(PackageNode* packageNode,
 status_t
 UnpackingAttributeDirectoryCookie::Rewind()
 {
-	if (fPackageNode != NULL)
-		fAttribute = fPackageNode->Attributes().Head();
+	if (fPackageNode != NULL) {
+		fAttributeCookie = 0;
+		fAttributeName = String();
+		fPackageNode->GetNextAttributeName(fAttributeCookie, fAttributeName);
+	}
 
 	return AutoPackageAttributeDirectoryCookie::Rewind();
 }
@@ -58,14 +62,17 @@ UnpackingAttributeDirectoryCookie::Rewind()
 String
 UnpackingAttributeDirectoryCookie::CurrentCustomAttributeName()
 {
-	return fAttribute != NULL ? fAttribute->Name() : String();
+	return fAttributeName;
 }
 
 
 String
 UnpackingAttributeDirectoryCookie::NextCustomAttributeName()
 {
-	if (fAttribute != NULL)
-		fAttribute = fPackageNode->Attributes().GetNext(fAttribute);
-	return fAttribute != NULL ? fAttribute->Name() : String();
+	if (fAttributeName.IsEmpty())
+		return String();
+
+	if (!fPackageNode->GetNextAttributeName(fAttributeCookie, fAttributeName))
+		fAttributeName = String();
+	return fAttributeName;
 }
@@ -10,7 +10,6 @@
 
 
 class PackageNode;
-class PackageNodeAttribute;
 
 
 class UnpackingAttributeDirectoryCookie
@@ -31,7 +30,8 @@ protected:
 
 private:
 			PackageNode*		fPackageNode;
-			PackageNodeAttribute* fAttribute;
+			uint32				fAttributeCookie;
+			String				fAttributeName;
 };
 
 
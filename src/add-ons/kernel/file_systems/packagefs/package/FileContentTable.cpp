@@ -0,0 +1,382 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+#include "FileContentTable.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <new>
+
+#include <fs_cache.h>
+
+#include <AutoDeleter.h>
+#include <package/packagefs.h>
+#include <SHA256.h>
+#include <util/AutoLock.h>
+
+#include "DebugSupport.h"
+
+
+static const uint64 kMaxContentSize = 32 * 1024 * 1024;
+	// larger files are not shared, since they would have to be read
+	// completely to verify them
+static const size_t kVerifyBufferSize = 64 * 1024;
+
+/*static*/ FileContentTable* FileContentTable::sDefaultInstance = NULL;
+
+
+struct FileContentTable::Content {
+	uint8				hash[kHashSize];
+	uint64				size;
+	int32				referenceCount;
+	void*				fileCache;
+		// the cache of a verified file that serves the content, or NULL
+	int32				fileCacheUsers;
+		// the reads of other files in progress through fileCache
+	bool				detaching;
+	Content*			hashNext;
+};
+
+
+struct FileContentTable::ContentHashDefinition {
+	struct Key {
+		const uint8*	hash;
+		uint64			size;
+
+		Key(const uint8* hash, uint64 size)
+			:
+			hash(hash),
+			size(size)
+		{
+		}
+	};
+
+	typedef Key		KeyType;
+	typedef Content	ValueType;
+
+	size_t HashKey(const Key& key) const
+	{
+		// the hash is uniformly distributed already
+		size_t hash;
+		memcpy(&hash, key.hash, sizeof(hash));
+		return hash ^ (size_t)key.size;
+	}
+
+	size_t Hash(const Content* value) const
+	{
+		return HashKey(Key(value->hash, value->size));
+	}
+
+	bool Compare(const Key& key, const Content* value) const
+	{
+		return value->size == key.size
+			&& memcmp(value->hash, key.hash, kHashSize) == 0;
+	}
+
+	Content*& GetLink(Content* value) const
+	{
+		return value->hashNext;
+	}
+};
+
+
+static int
+hex_digit_value(char c)
+{
+	if (c >= '0' && c <= '9')
+		return c - '0';
+	if (c >= 'a' && c <= 'f')
+		return c - 'a' + 10;
+	if (c >= 'A' && c <= 'F')
+		return c - 'A' + 10;
+	return -1;
+}
+
+
+static bool
+parse_hash(const char* string, uint8* hash)
+{
+	for (size_t i = 0; i < FileContentTable::kHashSize; i++) {
+		int high = hex_digit_value(string[2 * i]);
+		if (high < 0)
+			return false;
+		int low = hex_digit_value(string[2 * i + 1]);
+		if (low < 0)
+			return false;
+		hash[i] = (uint8)(high << 4 | low);
+	}
+
+	return string[2 * FileContentTable::kHashSize] == '\0';
+}
+
+
+// #pragma mark - FileContentTable
+
+
+FileContentTable::FileContentTable()
+	:
+	fContents(NULL),
+	fFileCount(0),
+	fDataSize(0),
+	fDeduplicatedSize(0),
+	fSharedReads(0)
+{
+	mutex_init(&fLock, "packagefs file contents");
+	fDetachCondition.Init(this, "packagefs file content detach");
+}
+
+
+FileContentTable::~FileContentTable()
+{
+	// All files must have put their contents by now.
+	delete fContents;
+
+	mutex_destroy(&fLock);
+}
+
+
+/*static*/ status_t
+FileContentTable::CreateDefault()
+{
+	if (sDefaultInstance != NULL)
+		return B_OK;
+
+	FileContentTable* table = new(std::nothrow) FileContentTable;
+	if (table == NULL)
+		return B_NO_MEMORY;
+
+	status_t error = table->_Init();
+	if (error != B_OK) {
+		delete table;
+		return error;
+	}
+
+	sDefaultInstance = table;
+	return B_OK;
+}
+
+
+/*static*/ void
+FileContentTable::DeleteDefault()
+{
+	delete sDefaultInstance;
+	sDefaultInstance = NULL;
+}
+
+
+/*static*/ FileContentTable*
+FileContentTable::Default()
+{
+	return sDefaultInstance;
+}
+
+
+/*!	Returns a reference to the content with the given hex SHA-256 hash and
+	size, creating it, if it doesn't exist yet.
+*/
+FileContentTable::Content*
+FileContentTable::Get(const char* hashString, uint64 size)
+{
+	uint8 hash[kHashSize];
+	if (!parse_hash(hashString, hash))
+		return NULL;
+
+	return Get(hash, size);
+}
+
+
+/*!	Returns a reference to the content with the given binary SHA-256 hash and
+	size, creating it, if it doesn't exist yet.
+*/
+FileContentTable::Content*
+FileContentTable::Get(const uint8* hash, uint64 size)
+{
+	if (size > kMaxContentSize)
+		return NULL;
+
+	MutexLocker locker(fLock);
+
+	Content* content = fContents->Lookup(
+		ContentHashDefinition::Key(hash, size));
+	if (content != NULL) {
+		content->referenceCount++;
+		fDeduplicatedSize += size;
+	} else {
+		content = new(std::nothrow) Content;
+		if (content == NULL)
+			return NULL;
+
+		memcpy(content->hash, hash, kHashSize);
+		content->size = size;
+		content->referenceCount = 1;
+		content->fileCache = NULL;
+		content->fileCacheUsers = 0;
+		content->detaching = false;
+		fContents->Insert(content);
+	}
+
+	fFileCount++;
+	fDataSize += size;
+	return content;
+}
+
+
+void
+FileContentTable::Put(Content* content)
+{
+	MutexLocker locker(fLock);
+
+	fFileCount--;
+	fDataSize -= content->size;
+
+	if (--content->referenceCount > 0) {
+		fDeduplicatedSize -= content->size;
+		return;
+	}
+
+	fContents->Remove(content);
+	delete content;
+}
+
+
+/*static*/ const uint8*
+FileContentTable::HashOf(const Content* content)
+{
+	return content->hash;
+}
+
+
+//!	Returns whether a file currently serves the content.
+bool
+FileContentTable::HasFileCache(Content* content)
+{
+	MutexLocker locker(fLock);
+	return content->fileCache != NULL;
+}
+
+
+/*!	Returns whether the data read through \a fileCache matches the hash of
+	the \a content. This reads the whole file, which also fills the cache
+	that is going to serve it.
+*/
+bool
+FileContentTable::Verify(Content* content, void* fileCache)
+{
+	uint8* buffer = (uint8*)malloc(kVerifyBufferSize);
+	if (buffer == NULL)
+		return false;
+	MemoryDeleter bufferDeleter(buffer);
+
+	SHA256 sha;
+	for (uint64 offset = 0; offset < content->size;) {
+		size_t size = std::min((uint64)kVerifyBufferSize,
+			content->size - offset);
+		if (file_cache_read(fileCache, NULL, offset, buffer, &size) != B_OK
+			|| size == 0) {
+			return false;
+		}
+
+		sha.Update(buffer, size);
+		offset += size;
+	}
+
+	if (memcmp(sha.Digest(), content->hash, kHashSize) != 0) {
+		ERROR("FileContentTable: file data doesn't match its hash\n");
+		return false;
+	}
+
+	return true;
+}
+
+
+/*!	Reads the content through the file cache of the file that currently
+	serves it. If there is none, and the file being read has been \a verified,
+	its \a fileCache takes over; otherwise the file's own cache is used.
+	No lock is held during the read, the reference the read holds to the
+	cache keeps DetachFileCache() waiting.
+*/
+status_t
+FileContentTable::Read(Content* content, void* fileCache, bool verified,
+	off_t offset, void* buffer, size_t* _bufferSize)
+{
+	MutexLocker locker(fLock);
+
+	void* cache = content->fileCache;
+	if (cache == NULL && verified && !content->detaching)
+		cache = content->fileCache = fileCache;
+
+	if (cache == NULL || cache == fileCache) {
+		locker.Unlock();
+		return file_cache_read(fileCache, NULL, offset, buffer, _bufferSize);
+	}
+
+	content->fileCacheUsers++;
+	locker.Unlock();
+
+	atomic_add64(&fSharedReads, 1);
+	status_t error = file_cache_read(cache, NULL, offset, buffer,
+		_bufferSize);
+
+	locker.Lock();
+	if (--content->fileCacheUsers == 0 && content->detaching)
+		fDetachCondition.NotifyAll();
+
+	return error;
+}
+
+
+/*!	Must be called before \a fileCache is deleted. Waits for the reads of
+	other files that use it to finish.
+*/
+void
+FileContentTable::DetachFileCache(Content* content, void* fileCache)
+{
+	MutexLocker locker(fLock);
+
+	if (content->fileCache != fileCache)
+		return;
+
+	// no other file takes over until the reads are done
+	content->fileCache = NULL;
+	content->detaching = true;
+
+	while (content->fileCacheUsers > 0) {
+		ConditionVariableEntry entry;
+		fDetachCondition.Add(&entry);
+
+		locker.Unlock();
+		entry.Wait();
+		locker.Lock();
+	}
+
+	content->detaching = false;
+}
+
+
+void
+FileContentTable::GetStats(PackageFSFileContentStats& stats)
+{
+	MutexLocker locker(fLock);
+
+	stats.fileCount = fFileCount;
+	stats.contentCount = fContents->CountElements();
+	stats.dataSize = fDataSize;
+	stats.deduplicatedSize = fDeduplicatedSize;
+	stats.sharedReads = atomic_get64(&fSharedReads);
+}
+
+
+status_t
+FileContentTable::_Init()
+{
+	fContents = new(std::nothrow) ContentTable;
+	if (fContents == NULL)
+		RETURN_ERROR(B_NO_MEMORY);
+
+	RETURN_ERROR(fContents->Init());
+}
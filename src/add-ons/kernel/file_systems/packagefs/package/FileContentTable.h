@@ -0,0 +1,83 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef FILE_CONTENT_TABLE_H
+#define FILE_CONTENT_TABLE_H
+
+
+#include <condition_variable.h>
+#include <lock.h>
+#include <util/OpenHashTable.h>
+
+
+struct PackageFSFileContentStats;
+
+
+/*!	Global table of the contents of package files, keyed by the data hash
+	stored in the package and the data size.
+
+	All files with the same content share one Content. Reads of any of them
+	go through the file cache of one of the files, so identical files of
+	different packages are kept in the page cache only once. Since the hash
+	comes from the package, a file only serves its cache to others once its
+	data has been verified against the hash. The first verified file that is
+	read serves the content; when its vnode goes away, the next one takes
+	over.
+*/
+class FileContentTable {
+public:
+			struct Content;
+
+	static	const size_t			kHashSize = 32;
+										// SHA-256
+
+private:
+									FileContentTable();
+									~FileContentTable();
+
+public:
+	static	status_t				CreateDefault();
+	static	void					DeleteDefault();
+	static	FileContentTable*		Default();
+
+			Content*				Get(const char* hash, uint64 size);
+			Content*				Get(const uint8* hash, uint64 size);
+										// return NULL, if the hash is
+										// invalid, or the file too large
+			void					Put(Content* content);
+
+	static	const uint8*			HashOf(const Content* content);
+
+			bool					HasFileCache(Content* content);
+			bool					Verify(Content* content, void* fileCache);
+			status_t				Read(Content* content, void* fileCache,
+										bool verified, off_t offset,
+										void* buffer, size_t* _bufferSize);
+			void					DetachFileCache(Content* content,
+										void* fileCache);
+
+			void					GetStats(PackageFSFileContentStats& stats);
+
+private:
+			struct ContentHashDefinition;
+
+			typedef BOpenHashTable<ContentHashDefinition> ContentTable;
+
+private:
+			status_t				_Init();
+
+private:
+	static	FileContentTable*		sDefaultInstance;
+
+			mutex					fLock;
+			ConditionVariable		fDetachCondition;
+			ContentTable*			fContents;
+			uint64					fFileCount;
+			uint64					fDataSize;
+			uint64					fDeduplicatedSize;
+			int64					fSharedReads;
+};
+
+
+#endif	// FILE_CONTENT_TABLE_H
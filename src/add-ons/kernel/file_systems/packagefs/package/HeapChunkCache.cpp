@@ -0,0 +1,558 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+#include "HeapChunkCache.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <new>
+
+#include <DataIO.h>
+
+#include <low_resource_manager.h>
+#include <package/packagefs.h>
+#include <util/AutoLock.h>
+#include <vm/vm_page.h>
+
+#include "DebugSupport.h"
+
+
+static const size_t kMaxCacheSize = 16 * 1024 * 1024;
+static const size_t kMinCacheSize = 1024 * 1024;
+
+/*static*/ HeapChunkCache* HeapChunkCache::sDefaultInstance = NULL;
+
+
+struct HeapChunkCache::Chunk : DoublyLinkedListLinkImpl<Chunk> {
+	File*				file;
+	uint32				index;
+	int32				referenceCount;
+	bool				cached;
+	size_t				size;
+	Chunk*				hashNext;
+	DoublyLinkedListLink<Chunk> fileLink;
+	uint8				data[0];
+};
+
+
+typedef DoublyLinkedList<HeapChunkCache::Chunk,
+	DoublyLinkedListMemberGetLink<HeapChunkCache::Chunk,
+		&HeapChunkCache::Chunk::fileLink> > FileChunkList;
+
+
+struct HeapChunkCache::File {
+	dev_t				deviceID;
+	ino_t				nodeID;
+	int32				referenceCount;
+	File*				hashNext;
+	FileChunkList		chunks;
+};
+
+
+struct HeapChunkCache::ChunkHashDefinition {
+	struct Key {
+		const File*	file;
+		uint32		index;
+
+		Key(const File* file, uint32 index)
+			:
+			file(file),
+			index(index)
+		{
+		}
+	};
+
+	typedef Key		KeyType;
+	typedef Chunk	ValueType;
+
+	size_t HashKey(const Key& key) const
+	{
+		return (size_t)((addr_t)key.file >> 4) ^ (key.index * 2654435761U);
+	}
+
+	size_t Hash(const Chunk* value) const
+	{
+		return HashKey(Key(value->file, value->index));
+	}
+
+	bool Compare(const Key& key, const Chunk* value) const
+	{
+		return value->file == key.file && value->index == key.index;
+	}
+
+	Chunk*& GetLink(Chunk* value) const
+	{
+		return value->hashNext;
+	}
+};
+
+
+struct HeapChunkCache::FileHashDefinition {
+	struct Key {
+		dev_t	deviceID;
+		ino_t	nodeID;
+
+		Key(dev_t deviceID, ino_t nodeID)
+			:
+			deviceID(deviceID),
+			nodeID(nodeID)
+		{
+		}
+	};
+
+	typedef Key		KeyType;
+	typedef File	ValueType;
+
+	size_t HashKey(const Key& key) const
+	{
+		return (size_t)key.deviceID ^ (size_t)key.nodeID
+			^ (size_t)(key.nodeID >> 32);
+	}
+
+	size_t Hash(const File* value) const
+	{
+		return HashKey(Key(value->deviceID, value->nodeID));
+	}
+
+	bool Compare(const Key& key, const File* value) const
+	{
+		return value->deviceID == key.deviceID && value->nodeID == key.nodeID;
+	}
+
+	File*& GetLink(File* value) const
+	{
+		return value->hashNext;
+	}
+};
+
+
+// #pragma mark - HeapChunkCache
+
+
+HeapChunkCache::HeapChunkCache()
+	:
+	fChunks(NULL),
+	fFiles(NULL),
+	fSize(0),
+	fMaxSize(0),
+	fHits(0),
+	fMisses(0),
+	fEvictions(0),
+	fLowResourceHandlerRegistered(false)
+{
+	mutex_init(&fLock, "packagefs heap chunk cache");
+}
+
+
+HeapChunkCache::~HeapChunkCache()
+{
+	if (fLowResourceHandlerRegistered)
+		unregister_low_resource_handler(&_LowResourceHandler, this);
+
+	// All files must have been put by now, so there are no chunks left.
+	delete fChunks;
+	delete fFiles;
+
+	mutex_destroy(&fLock);
+}
+
+
+/*static*/ status_t
+HeapChunkCache::CreateDefault()
+{
+	if (sDefaultInstance != NULL)
+		return B_OK;
+
+	HeapChunkCache* cache = new(std::nothrow) HeapChunkCache;
+	if (cache == NULL)
+		return B_NO_MEMORY;
+
+	status_t error = cache->_Init();
+	if (error != B_OK) {
+		delete cache;
+		return error;
+	}
+
+	sDefaultInstance = cache;
+	return B_OK;
+}
+
+
+/*static*/ void
+HeapChunkCache::DeleteDefault()
+{
+	delete sDefaultInstance;
+	sDefaultInstance = NULL;
+}
+
+
+/*static*/ HeapChunkCache*
+HeapChunkCache::Default()
+{
+	return sDefaultInstance;
+}
+
+
+/*!	Returns a reference to the cache entry for the given package file. The
+	chunks of a file are dropped when its last reference is put, so a later
+	file reusing the node ID won't see stale data.
+*/
+HeapChunkCache::File*
+HeapChunkCache::GetFile(dev_t deviceID, ino_t nodeID)
+{
+	MutexLocker locker(fLock);
+
+	File* file = fFiles->Lookup(FileHashDefinition::Key(deviceID, nodeID));
+	if (file != NULL) {
+		file->referenceCount++;
+		return file;
+	}
+
+	file = new(std::nothrow) File;
+	if (file == NULL)
+		return NULL;
+
+	file->deviceID = deviceID;
+	file->nodeID = nodeID;
+	file->referenceCount = 1;
+	fFiles->Insert(file);
+	return file;
+}
+
+
+void
+HeapChunkCache::PutFile(File* file)
+{
+	MutexLocker locker(fLock);
+
+	if (--file->referenceCount > 0)
+		return;
+
+	while (Chunk* chunk = file->chunks.Head())
+		_RemoveChunk(chunk);
+
+	fFiles->Remove(file);
+	delete file;
+}
+
+
+/*!	Looks up a chunk and returns a reference to it, or \c NULL, if it isn't
+	cached.
+*/
+HeapChunkCache::Chunk*
+HeapChunkCache::GetChunk(File* file, uint32 index)
+{
+	MutexLocker locker(fLock);
+
+	Chunk* chunk = fChunks->Lookup(ChunkHashDefinition::Key(file, index));
+	if (chunk == NULL) {
+		fMisses++;
+		return NULL;
+	}
+
+	fHits++;
+	chunk->referenceCount++;
+
+	// move to the end of the LRU list
+	fChunkLRU.Remove(chunk);
+	fChunkLRU.Add(chunk);
+
+	return chunk;
+}
+
+
+status_t
+HeapChunkCache::CreateChunk(File* file, uint32 index, size_t size,
+	Chunk*& _chunk)
+{
+	if (size > fMaxSize)
+		return B_BAD_VALUE;
+
+	Chunk* chunk = (Chunk*)malloc(sizeof(Chunk) + size);
+	if (chunk == NULL)
+		return B_NO_MEMORY;
+
+	new(chunk) Chunk;
+	chunk->file = file;
+	chunk->index = index;
+	chunk->referenceCount = 1;
+	chunk->cached = false;
+	chunk->size = size;
+
+	_chunk = chunk;
+	return B_OK;
+}
+
+
+/*!	Adds a chunk created by CreateChunk() to the cache. If another thread has
+	inserted the same chunk in the meantime, the given one is left alone and
+	will be freed when its reference is put.
+*/
+void
+HeapChunkCache::InsertChunk(Chunk* chunk)
+{
+	MutexLocker locker(fLock);
+
+	if (fChunks->Lookup(ChunkHashDefinition::Key(chunk->file, chunk->index))
+			!= NULL) {
+		return;
+	}
+
+	_EvictChunks(fMaxSize - std::min(fMaxSize, chunk->size));
+
+	chunk->cached = true;
+	fChunks->Insert(chunk);
+	fChunkLRU.Add(chunk);
+	chunk->file->chunks.Add(chunk);
+	fSize += chunk->size;
+}
+
+
+void
+HeapChunkCache::PutChunk(Chunk* chunk)
+{
+	MutexLocker locker(fLock);
+
+	if (--chunk->referenceCount > 0 || chunk->cached)
+		return;
+
+	locker.Unlock();
+
+	chunk->~Chunk();
+	free(chunk);
+}
+
+
+void
+HeapChunkCache::GetStats(PackageFSChunkCacheStats& stats)
+{
+	MutexLocker locker(fLock);
+
+	stats.hits = fHits;
+	stats.misses = fMisses;
+	stats.evictions = fEvictions;
+	stats.size = fSize;
+	stats.maxSize = fMaxSize;
+	stats.chunkCount = fChunks->CountElements();
+}
+
+
+status_t
+HeapChunkCache::_Init()
+{
+	fChunks = new(std::nothrow) ChunkTable;
+	if (fChunks == NULL)
+		RETURN_ERROR(B_NO_MEMORY);
+
+	status_t error = fChunks->Init();
+	if (error != B_OK)
+		RETURN_ERROR(error);
+
+	fFiles = new(std::nothrow) FileTable;
+	if (fFiles == NULL)
+		RETURN_ERROR(B_NO_MEMORY);
+
+	error = fFiles->Init();
+	if (error != B_OK)
+		RETURN_ERROR(error);
+
+	// use up to 1/128 of the memory
+	fMaxSize = (size_t)std::min((uint64)kMaxCacheSize,
+		(uint64)vm_page_num_pages() * B_PAGE_SIZE / 128);
+	fMaxSize = std::max(fMaxSize, kMinCacheSize);
+
+	error = register_low_resource_handler(&_LowResourceHandler, this,
+		B_KERNEL_RESOURCE_PAGES | B_KERNEL_RESOURCE_MEMORY, 0);
+	if (error != B_OK)
+		RETURN_ERROR(error);
+	fLowResourceHandlerRegistered = true;
+
+	return B_OK;
+}
+
+
+/*!	Removes a chunk from the cache. Referenced chunks are freed when their
+	last reference is put. The caller must hold the lock.
+*/
+void
+HeapChunkCache::_RemoveChunk(Chunk* chunk)
+{
+	fChunks->Remove(chunk);
+	fChunkLRU.Remove(chunk);
+	chunk->file->chunks.Remove(chunk);
+	fSize -= chunk->size;
+	chunk->cached = false;
+
+	if (chunk->referenceCount == 0) {
+		chunk->~Chunk();
+		free(chunk);
+	}
+}
+
+
+/*!	Evicts the least recently used chunks until the cache size is at most
+	\a targetSize. The caller must hold the lock.
+*/
+void
+HeapChunkCache::_EvictChunks(size_t targetSize)
+{
+	while (fSize > targetSize) {
+		Chunk* chunk = fChunkLRU.Head();
+		if (chunk == NULL)
+			break;
+
+		_RemoveChunk(chunk);
+		fEvictions++;
+	}
+}
+
+
+/*static*/ void
+HeapChunkCache::_LowResourceHandler(void* data, uint32 resources, int32 level)
+{
+	HeapChunkCache* cache = (HeapChunkCache*)data;
+
+	MutexLocker locker(cache->fLock);
+
+	switch (level) {
+		case B_NO_LOW_RESOURCE:
+			return;
+		case B_LOW_RESOURCE_NOTE:
+			cache->_EvictChunks(cache->fSize / 2);
+			break;
+		case B_LOW_RESOURCE_WARNING:
+			cache->_EvictChunks(cache->fSize / 8);
+			break;
+		case B_LOW_RESOURCE_CRITICAL:
+			cache->_EvictChunks(0);
+			break;
+	}
+}
+
+
+// #pragma mark - HeapChunkCacheReader
+
+
+struct HeapChunkCacheReader::BufferOutput : public BDataIO {
+	BufferOutput(void* buffer, size_t size)
+		:
+		fBuffer((uint8*)buffer),
+		fSize(size)
+	{
+	}
+
+	virtual ssize_t Write(const void* buffer, size_t size)
+	{
+		if (size > fSize)
+			return B_BAD_VALUE;
+
+		memcpy(fBuffer, buffer, size);
+		fBuffer += size;
+		fSize -= size;
+		return size;
+	}
+
+private:
+	uint8*	fBuffer;
+	size_t	fSize;
+};
+
+
+HeapChunkCacheReader::HeapChunkCacheReader()
+	:
+	fReader(NULL),
+	fFile(NULL),
+	fSize(0),
+	fChunkSize(0)
+{
+}
+
+
+HeapChunkCacheReader::~HeapChunkCacheReader()
+{
+	if (fFile != NULL)
+		HeapChunkCache::Default()->PutFile(fFile);
+}
+
+
+status_t
+HeapChunkCacheReader::Init(BAbstractBufferedDataReader* reader, uint64 size,
+	size_t chunkSize, dev_t deviceID, ino_t nodeID)
+{
+	HeapChunkCache* cache = HeapChunkCache::Default();
+	if (cache == NULL)
+		return B_NOT_INITIALIZED;
+
+	fFile = cache->GetFile(deviceID, nodeID);
+	if (fFile == NULL)
+		return B_NO_MEMORY;
+
+	fReader = reader;
+	fSize = size;
+	fChunkSize = chunkSize;
+	return B_OK;
+}
+
+
+status_t
+HeapChunkCacheReader::ReadDataToOutput(off_t offset, size_t size,
+	BDataIO* output)
+{
+	if (size == 0)
+		return B_OK;
+
+	if (offset < 0 || (uint64)offset > fSize || size > fSize - offset)
+		return B_BAD_VALUE;
+
+	HeapChunkCache* cache = HeapChunkCache::Default();
+
+	while (size > 0) {
+		uint32 index = (uint32)(offset / fChunkSize);
+		off_t chunkOffset = (off_t)index * fChunkSize;
+		size_t inChunkOffset = offset - chunkOffset;
+		size_t toWrite = std::min(size, fChunkSize - inChunkOffset);
+
+		HeapChunkCache::Chunk* chunk = cache->GetChunk(fFile, index);
+		if (chunk == NULL) {
+			size_t chunkSize = (size_t)std::min((uint64)fChunkSize,
+				fSize - chunkOffset);
+			if (cache->CreateChunk(fFile, index, chunkSize, chunk) != B_OK) {
+				// no memory for the chunk -- bypass the cache
+				status_t error = fReader->ReadDataToOutput(offset, toWrite,
+					output);
+				if (error != B_OK)
+					return error;
+
+				offset += toWrite;
+				size -= toWrite;
+				continue;
+			}
+
+			BufferOutput chunkOutput(chunk->data, chunkSize);
+			status_t error = fReader->ReadDataToOutput(chunkOffset, chunkSize,
+				&chunkOutput);
+			if (error != B_OK) {
+				cache->PutChunk(chunk);
+				return error;
+			}
+
+			cache->InsertChunk(chunk);
+		}
+
+		status_t error = output->WriteExactly(chunk->data + inChunkOffset,
+			toWrite);
+		cache->PutChunk(chunk);
+		if (error != B_OK)
+			return error;
+
+		offset += toWrite;
+		size -= toWrite;
+	}
+
+	return B_OK;
+}
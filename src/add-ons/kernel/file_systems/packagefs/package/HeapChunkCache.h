@@ -0,0 +1,115 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef HEAP_CHUNK_CACHE_H
+#define HEAP_CHUNK_CACHE_H
+
+
+#include <package/hpkg/DataReader.h>
+
+#include <lock.h>
+#include <util/DoublyLinkedList.h>
+#include <util/OpenHashTable.h>
+
+
+using BPackageKit::BHPKG::BAbstractBufferedDataReader;
+
+struct PackageFSChunkCacheStats;
+
+
+/*!	Global, size-bounded cache of decompressed package heap chunks.
+
+	The chunks are shared by all packages of all volumes and are keyed by the
+	node_ref of the package file and the chunk index. The least recently used
+	chunks are evicted when the cache is full or when the low resource manager
+	reports memory pressure.
+*/
+class HeapChunkCache {
+public:
+			struct File;
+			struct Chunk;
+
+private:
+								HeapChunkCache();
+								~HeapChunkCache();
+
+public:
+	static	status_t			CreateDefault();
+	static	void				DeleteDefault();
+	static	HeapChunkCache*		Default();
+
+			File*				GetFile(dev_t deviceID, ino_t nodeID);
+			void				PutFile(File* file);
+
+			Chunk*				GetChunk(File* file, uint32 index);
+			status_t			CreateChunk(File* file, uint32 index,
+									size_t size, Chunk*& _chunk);
+									// returns a referenced chunk that is not
+									// yet in the cache
+			void				InsertChunk(Chunk* chunk);
+			void				PutChunk(Chunk* chunk);
+
+			void				GetStats(PackageFSChunkCacheStats& stats);
+
+private:
+			struct ChunkHashDefinition;
+			struct FileHashDefinition;
+
+			typedef BOpenHashTable<ChunkHashDefinition> ChunkTable;
+			typedef BOpenHashTable<FileHashDefinition> FileTable;
+			typedef DoublyLinkedList<Chunk> ChunkList;
+
+private:
+			status_t			_Init();
+
+			void				_RemoveChunk(Chunk* chunk);
+			void				_EvictChunks(size_t targetSize);
+
+	static	void				_LowResourceHandler(void* data,
+									uint32 resources, int32 level);
+
+private:
+	static	HeapChunkCache*		sDefaultInstance;
+
+			mutex				fLock;
+			ChunkTable*			fChunks;
+			FileTable*			fFiles;
+			ChunkList			fChunkLRU;
+									// LRU order, least recently used first
+			size_t				fSize;
+			size_t				fMaxSize;
+			uint64				fHits;
+			uint64				fMisses;
+			uint64				fEvictions;
+			bool				fLowResourceHandlerRegistered;
+};
+
+
+/*!	Heap reader wrapper that serves whole chunks from the HeapChunkCache and
+	reads and inserts the missing ones through the wrapped reader.
+*/
+class HeapChunkCacheReader : public BAbstractBufferedDataReader {
+public:
+								HeapChunkCacheReader();
+	virtual						~HeapChunkCacheReader();
+
+			status_t			Init(BAbstractBufferedDataReader* reader,
+									uint64 size, size_t chunkSize,
+									dev_t deviceID, ino_t nodeID);
+
+	virtual	status_t			ReadDataToOutput(off_t offset, size_t size,
+									BDataIO* output);
+
+private:
+			struct BufferOutput;
+
+private:
+			BAbstractBufferedDataReader* fReader;
+			HeapChunkCache::File* fFile;
+			uint64				fSize;
+			size_t				fChunkSize;
+};
+
+
+#endif	// HEAP_CHUNK_CACHE_H
@@ -29,8 +29,11 @@
 #include "CachedDataReader.h"
 #include "DebugSupport.h"
 #include "GlobalFactory.h"
+#include "HeapChunkCache.h"
+#include "MountStateCache.h"
 #include "PackageDirectory.h"
 #include "PackageFile.h"
+#include "PackageNodeArena.h"
 #include "PackagesDirectory.h"
 #include "PackageSettings.h"
 #include "PackageSymlink.h"
@@ -50,6 +53,7 @@ using BPackageKit::BHPKG::BPrivate::PackageFileHeapReader;
 typedef BPackageKit::BHPKG::BPackageContentHandler BPackageContentHandler;
 typedef BPackageKit::BHPKG::BPackageEntry BPackageEntry;
 typedef BPackageKit::BHPKG::BPackageEntryAttribute BPackageEntryAttribute;
+typedef BPackageKit::BHPKG::BPrivate::PackageEntryImpl PackageEntryImpl;
 typedef BPackageKit::BHPKG::BPrivate::PackageReaderImpl PackageReaderImpl;
 
 // format version V1 types
@@ -147,16 +151,20 @@ struct Package::LoaderContentHandler : BPackageContentHandler {
 		PackageNode* node;
 		if (S_ISREG(mode)) {
 			// file
-			node = new(std::nothrow) PackageFile(fPackage, mode,
+			PackageFile* file = new(fPackage) PackageFile(fPackage, mode,
 				PackageData(entry->Data()));
+			const char* hash = PackageEntryImpl::DataHashOf(entry);
+			if (file != NULL && hash != NULL)
+				file->SetDataHash(hash);
+			node = file;
 		} else if (S_ISLNK(mode)) {
 			// symlink
 			String path;
 			if (!path.SetTo(entry->SymlinkPath()))
 				RETURN_ERROR(B_NO_MEMORY);
 
-			PackageSymlink* symlink = new(std::nothrow) PackageSymlink(
-				fPackage, mode);
+			PackageSymlink* symlink = new(fPackage) PackageSymlink(fPackage,
+				mode);
 			if (symlink == NULL)
 				RETURN_ERROR(B_NO_MEMORY);
 
@@ -164,7 +172,7 @@ struct Package::LoaderContentHandler : BPackageContentHandler {
 			node = symlink;
 		} else if (S_ISDIR(mode)) {
 			// directory
-			node = new(std::nothrow) PackageDirectory(fPackage, mode);
+			node = new(fPackage) PackageDirectory(fPackage, mode);
 		} else
 			RETURN_ERROR(B_BAD_DATA);
 
@@ -208,14 +216,10 @@ struct Package::LoaderContentHandler : BPackageContentHandler {
 		if (!name.SetTo(attribute->Name()))
 			RETURN_ERROR(B_NO_MEMORY);
 
-		PackageNodeAttribute* nodeAttribute = new(std::nothrow)
-			PackageNodeAttribute(attribute->Type(),
+		status_t error = node->AddAttribute(name, attribute->Type(),
 			PackageData(attribute->Data()));
-		if (nodeAttribute == NULL)
-			RETURN_ERROR(B_NO_MEMORY)
-
-		nodeAttribute->Init(name);
-		node->AddAttribute(nodeAttribute);
+		if (error != B_OK)
+			RETURN_ERROR(error);
 
 		return B_OK;
 	}
@@ -413,16 +417,19 @@ struct Package::LoaderContentHandlerV1 : BPackageContentHandlerV1 {
 		PackageNode* node;
 		if (S_ISREG(mode)) {
 			// file
-			node = new(std::nothrow) PackageFile(fPackage, mode,
-				PackageData(entry->Data()));
+			PackageData data(entry->Data());
+			if (data.InitCheck() != B_OK)
+				RETURN_ERROR(data.InitCheck());
+
+			node = new(fPackage) PackageFile(fPackage, mode, data);
 		} else if (S_ISLNK(mode)) {
 			// symlink
 			String path;
 			if (!path.SetTo(entry->SymlinkPath()))
 				RETURN_ERROR(B_NO_MEMORY);
 
-			PackageSymlink* symlink = new(std::nothrow) PackageSymlink(
-				fPackage, mode);
+			PackageSymlink* symlink = new(fPackage) PackageSymlink(fPackage,
+				mode);
 			if (symlink == NULL)
 				RETURN_ERROR(B_NO_MEMORY);
 
@@ -430,7 +437,7 @@ struct Package::LoaderContentHandlerV1 : BPackageContentHandlerV1 {
 			node = symlink;
 		} else if (S_ISDIR(mode)) {
 			// directory
-			node = new(std::nothrow) PackageDirectory(fPackage, mode);
+			node = new(fPackage) PackageDirectory(fPackage, mode);
 		} else
 			RETURN_ERROR(B_BAD_DATA);
 
@@ -471,14 +478,13 @@ struct Package::LoaderContentHandlerV1 : BPackageContentHandlerV1 {
 		if (!name.SetTo(attribute->Name()))
 			RETURN_ERROR(B_NO_MEMORY);
 
-		PackageNodeAttribute* nodeAttribute = new(std::nothrow)
-			PackageNodeAttribute(attribute->Type(),
-			PackageData(attribute->Data()));
-		if (nodeAttribute == NULL)
-			RETURN_ERROR(B_NO_MEMORY)
+		PackageData data(attribute->Data());
+		if (data.InitCheck() != B_OK)
+			RETURN_ERROR(data.InitCheck());
 
-		nodeAttribute->Init(name);
-		node->AddAttribute(nodeAttribute);
+		status_t error = node->AddAttribute(name, attribute->Type(), data);
+		if (error != B_OK)
+			RETURN_ERROR(error);
 
 		return B_OK;
 	}
@@ -701,7 +707,8 @@ public:
 		delete fHeapReader;
 	}
 
-	status_t Init(const PackageFileHeapReader* heapReader, int fd)
+	status_t Init(const PackageFileHeapReader* heapReader, int fd,
+		dev_t deviceID, ino_t nodeID)
 	{
 		fHeapReader = heapReader->Clone();
 		if (fHeapReader == NULL)
@@ -712,7 +719,18 @@ public:
 		fHeapReader->SetErrorOutput(this);
 		fHeapReader->SetFile(this);
 
-		status_t error = CachedDataReader::Init(fHeapReader,
+		// Unless the heap is stored uncompressed, read through the shared
+		// cache of decompressed chunks.
+		BAbstractBufferedDataReader* reader = fHeapReader;
+		if ((uint64)fHeapReader->CompressedHeapSize()
+				!= fHeapReader->UncompressedHeapSize()
+			&& fChunkCacheReader.Init(fHeapReader,
+				fHeapReader->UncompressedHeapSize(), fHeapReader->ChunkSize(),
+				deviceID, nodeID) == B_OK) {
+			reader = &fChunkCacheReader;
+		}
+
+		status_t error = CachedDataReader::Init(reader,
 			fHeapReader->UncompressedHeapSize());
 		if (error != B_OK)
 			return error;
@@ -742,6 +760,7 @@ private:
 
 private:
 	PackageFileHeapReader*	fHeapReader;
+	HeapChunkCacheReader	fChunkCacheReader;
 };
 
 
@@ -749,9 +768,10 @@ private:
 
 
 struct Package::CachingPackageReader : public PackageReaderImpl {
-	CachingPackageReader(BErrorOutput* errorOutput)
+	CachingPackageReader(BErrorOutput* errorOutput, Package* package)
 		:
 		PackageReaderImpl(errorOutput),
+		fPackage(package),
 		fCachedHeapReader(NULL),
 		fFD(-1)
 	{
@@ -775,7 +795,8 @@ struct Package::CachingPackageReader : public PackageReaderImpl {
 		if (fCachedHeapReader == NULL)
 			RETURN_ERROR(B_NO_MEMORY);
 
-		status_t error = fCachedHeapReader->Init(rawHeapReader, fFD);
+		status_t error = fCachedHeapReader->Init(rawHeapReader, fFD,
+			fPackage->DeviceID(), fPackage->NodeID());
 		if (error != B_OK)
 			RETURN_ERROR(error);
 
@@ -798,6 +819,7 @@ struct Package::CachingPackageReader : public PackageReaderImpl {
 	}
 
 private:
+	Package*		fPackage;
 	HeapReaderV2*	fCachedHeapReader;
 	int				fFD;
 };
@@ -817,12 +839,14 @@ Package::Package(::Volume* volume, PackagesDirectory* directory, dev_t deviceID,
 	fVersionedName(),
 	fVersion(NULL),
 	fArchitecture(B_PACKAGE_ARCHITECTURE_ENUM_COUNT),
+	fFormatVersion(0),
 	fLinkDirectory(NULL),
 	fFD(-1),
 	fOpenCount(0),
 	fHeapReader(NULL),
 	fNodeID(nodeID),
-	fDeviceID(deviceID)
+	fDeviceID(deviceID),
+	fNodeArena(NULL)
 {
 	mutex_init(&fLock, "packagefs package");
 
@@ -832,18 +856,7 @@ Package::Package(::Volume* volume, PackagesDirectory* directory, dev_t deviceID,
 
 Package::~Package()
 {
-	delete fHeapReader;
-
-	while (PackageNode* node = fNodes.RemoveHead())
-		node->ReleaseReference();
-
-	while (Resolvable* resolvable = fResolvables.RemoveHead())
-		delete resolvable;
-
-	while (Dependency* dependency = fDependencies.RemoveHead())
-		delete dependency;
-
-	delete fVersion;
+	_Unload();
 
 	fPackagesDirectory->ReleaseReference();
 
@@ -864,13 +877,46 @@ Package::Init(const char* fileName)
 status_t
 Package::Load(const PackageSettings& settings)
 {
-	status_t error = _Load(settings);
+	status_t error = _InitNodeArena();
+	if (error != B_OK)
+		RETURN_ERROR(error);
+
+	error = _Load(settings);
 	if (error != B_OK)
 		return error;
 
 	if (!_InitVersionedName())
 		RETURN_ERROR(B_NO_MEMORY);
 
+	fNodeArena->FinishLoading();
+	return B_OK;
+}
+
+
+/*!	Loads the package from the given mount state cache instead of parsing the
+	package file's TOC. \a st must be the stat data of the package file.
+	Returns \c B_ENTRY_NOT_FOUND, if the cache has no up-to-date record for the
+	package or \a settings apply to it. On error the package is left unloaded,
+	so Load() can be used instead.
+*/
+status_t
+Package::LoadFromCache(MountStateCache& cache, const struct stat& st,
+	const PackageSettings& settings)
+{
+	status_t error = _InitNodeArena();
+	if (error == B_OK)
+		error = cache.ReadPackage(this, st, settings);
+	if (error == B_OK)
+		error = _InitCachedHeapReader();
+	if (error == B_OK && !_InitVersionedName())
+		error = B_NO_MEMORY;
+
+	if (error != B_OK) {
+		_Unload();
+		return error;
+	}
+
+	fNodeArena->FinishLoading();
 	return B_OK;
 }
 
@@ -1003,6 +1049,17 @@ Package::CreateDataReader(const PackageData& data,
 }
 
 
+status_t
+Package::_InitNodeArena()
+{
+	fNodeArena = new(std::nothrow) PackageNodeArena(this);
+	if (fNodeArena == NULL)
+		RETURN_ERROR(B_NO_MEMORY);
+
+	return B_OK;
+}
+
+
 status_t
 Package::_Load(const PackageSettings& settings)
 {
@@ -1017,7 +1074,7 @@ Package::_Load(const PackageSettings& settings)
 
 	// try current package file format version
 	{
-		CachingPackageReader packageReader(&errorOutput);
+		CachingPackageReader packageReader(&errorOutput, this);
 		status_t error = packageReader.Init(fd, false,
 			BHPKG::B_HPKG_READER_DONT_PRINT_VERSION_MISMATCH_MESSAGE);
 		if (error == B_OK) {
@@ -1033,6 +1090,7 @@ Package::_Load(const PackageSettings& settings)
 
 			// get the heap reader
 			fHeapReader = packageReader.DetachCachedHeapReader();
+			fFormatVersion = 2;
 			return B_OK;
 		}
 
@@ -1061,6 +1119,32 @@ Package::_Load(const PackageSettings& settings)
 	if (fHeapReader == NULL)
 		RETURN_ERROR(B_NO_MEMORY);
 
+	fFormatVersion = 1;
+	return B_OK;
+}
+
+
+/*!	Creates the heap reader for a package whose content has been loaded from
+	the mount state cache. Initializing the package reader only reads the
+	header and the heap's chunk size table, the TOC is left alone.
+*/
+status_t
+Package::_InitCachedHeapReader()
+{
+	int fd = Open();
+	if (fd < 0)
+		RETURN_ERROR(fd);
+	PackageCloser packageCloser(this);
+
+	LoaderErrorOutput errorOutput(this);
+	CachingPackageReader packageReader(&errorOutput, this);
+	status_t error = packageReader.Init(fd, false,
+		BHPKG::B_HPKG_READER_DONT_PRINT_VERSION_MISMATCH_MESSAGE);
+	if (error != B_OK)
+		RETURN_ERROR(error);
+
+	fHeapReader = packageReader.DetachCachedHeapReader();
+	fFormatVersion = 2;
 	return B_OK;
 }
 
@@ -1091,3 +1175,35 @@ Package::_InitVersionedName()
 
 	return fVersionedName.SetTo(name);
 }
+
+
+void
+Package::_Unload()
+{
+	delete fHeapReader;
+	fHeapReader = NULL;
+
+	while (PackageNode* node = fNodes.RemoveHead())
+		node->ReleaseReference();
+
+	// nodes still in use keep the arena alive
+	if (fNodeArena != NULL) {
+		fNodeArena->ReleaseReference();
+		fNodeArena = NULL;
+	}
+
+	while (Resolvable* resolvable = fResolvables.RemoveHead())
+		delete resolvable;
+
+	while (Dependency* dependency = fDependencies.RemoveHead())
+		delete dependency;
+
+	delete fVersion;
+	fVersion = NULL;
+
+	fName = String();
+	fInstallPath = String();
+	fVersionedName = String();
+	fArchitecture = B_PACKAGE_ARCHITECTURE_ENUM_COUNT;
+	fFormatVersion = 0;
+}
@@ -27,7 +27,9 @@ using BPackageKit::BPackageArchitecture;
 using BPackageKit::BHPKG::BAbstractBufferedDataReader;
 
 
+class MountStateCache;
 class PackageLinkDirectory;
+class PackageNodeArena;
 class PackagesDirectory;
 class PackageSettings;
 class Volume;
@@ -44,6 +46,10 @@ public:
 
 			status_t			Init(const char* fileName);
 			status_t			Load(const PackageSettings& settings);
+			status_t			LoadFromCache(MountStateCache& cache,
+									const struct stat& st,
+									const PackageSettings& settings);
+									// B_ENTRY_NOT_FOUND, if not cached
 
 			::Volume*			Volume() const		{ return fVolume; }
 			const String&		FileName() const	{ return fFileName; }
@@ -76,6 +82,9 @@ public:
 									{ return fArchitecture; }
 			const char*			ArchitectureName() const;
 
+			uint8				FormatVersion() const
+									{ return fFormatVersion; }
+
 			void				SetLinkDirectory(
 									PackageLinkDirectory* linkDirectory)
 									{ fLinkDirectory = linkDirectory; }
@@ -85,6 +94,8 @@ public:
 			Package*&			FileNameHashTableNext()
 									{ return fFileNameHashTableNext; }
 
+			PackageNodeArena*	NodeArena() const	{ return fNodeArena; }
+
 			void				AddNode(PackageNode* node);
 			void				AddResolvable(Resolvable* resolvable);
 			void				AddDependency(Dependency* dependency);
@@ -111,8 +122,11 @@ private:
 			struct CachingPackageReader;
 
 private:
+			status_t			_InitNodeArena();
 			status_t			_Load(const PackageSettings& settings);
+			status_t			_InitCachedHeapReader();
 			bool				_InitVersionedName();
+			void				_Unload();
 
 private:
 			mutex				fLock;
@@ -124,6 +138,7 @@ private:
 			String				fVersionedName;
 			::Version*			fVersion;
 			BPackageArchitecture fArchitecture;
+			uint8				fFormatVersion;
 			PackageLinkDirectory* fLinkDirectory;
 			int					fFD;
 			uint32				fOpenCount;
@@ -131,6 +146,7 @@ private:
 			Package*			fFileNameHashTableNext;
 			ino_t				fNodeID;
 			dev_t				fDeviceID;
+			PackageNodeArena*	fNodeArena;
 			PackageNodeList		fNodes;
 			ResolvableList		fResolvables;
 			DependencyList		fDependencies;
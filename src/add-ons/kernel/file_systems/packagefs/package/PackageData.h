@@ -9,17 +9,34 @@
 #include <package/hpkg/PackageData.h>
 #include <package/hpkg/v1/PackageData.h>
 
+#include <new>
+
 #include <string.h>
 
+#include <OS.h>
+
 
 typedef BPackageKit::BHPKG::BPackageData PackageDataV2;
 typedef BPackageKit::BHPKG::V1::BPackageData PackageDataV1;
 
 
+/*!	The data of a package file or attribute.
+
+	Since there is one object per file and attribute, it is kept small: the
+	version 2 data are stored inline, the larger data of the obsolete version
+	1 format are allocated separately and shared between copies.
+*/
 class PackageData {
 public:
+								PackageData();
 	explicit					PackageData(const PackageDataV1& data);
 	explicit					PackageData(const PackageDataV2& data);
+								PackageData(const PackageData& other);
+								~PackageData();
+
+			PackageData&		operator=(const PackageData& other);
+
+			status_t			InitCheck() const;
 
 			uint8				Version() const	{ return fVersion; }
 			const PackageDataV1& DataV1() const;
@@ -32,26 +49,45 @@ public:
 			const uint8*		InlineData() const;
 
 private:
-	static	const size_t		kDataSize = sizeof(PackageDataV1)
-										> sizeof(PackageDataV2)
-									? sizeof(PackageDataV1)
-									: sizeof(PackageDataV2);
+			struct SharedDataV1 {
+				int32			referenceCount;
+				PackageDataV1	data;
+			};
+
+private:
+			void				_AcquireDataV1() const;
+			void				_ReleaseDataV1();
 
 private:
 			union {
-				char			fData[kDataSize];
+				char			fData[sizeof(PackageDataV2)];
+				SharedDataV1*	fDataV1;
 				uint64			fAlignmentDummy;
 			};
 			uint8				fVersion;
 };
 
 
+inline
+PackageData::PackageData()
+	:
+	fVersion(2)
+{
+	PackageDataV2 data;
+	memcpy(&fData, &data, sizeof(data));
+}
+
+
 inline
 PackageData::PackageData(const PackageDataV1& data)
 	:
 	fVersion(1)
 {
-	memcpy(&fData, &data, sizeof(data));
+	fDataV1 = new(std::nothrow) SharedDataV1;
+	if (fDataV1 != NULL) {
+		fDataV1->referenceCount = 1;
+		memcpy(&fDataV1->data, &data, sizeof(data));
+	}
 }
 
 
@@ -64,10 +100,49 @@ PackageData::PackageData(const PackageDataV2& data)
 }
 
 
+inline
+PackageData::PackageData(const PackageData& other)
+	:
+	fVersion(other.fVersion)
+{
+	memcpy(&fData, &other.fData, sizeof(fData));
+	_AcquireDataV1();
+}
+
+
+inline
+PackageData::~PackageData()
+{
+	_ReleaseDataV1();
+}
+
+
+inline PackageData&
+PackageData::operator=(const PackageData& other)
+{
+	if (this != &other) {
+		other._AcquireDataV1();
+		_ReleaseDataV1();
+		memcpy(&fData, &other.fData, sizeof(fData));
+		fVersion = other.fVersion;
+	}
+	return *this;
+}
+
+
+/*!	Returns \c B_NO_MEMORY, if the version 1 data could not be allocated.
+*/
+inline status_t
+PackageData::InitCheck() const
+{
+	return fVersion == 1 && fDataV1 == NULL ? B_NO_MEMORY : B_OK;
+}
+
+
 inline const PackageDataV1&
 PackageData::DataV1() const
 {
-	return *(PackageDataV1*)&fData;
+	return fDataV1->data;
 }
 
 
@@ -114,4 +189,22 @@ PackageData::InlineData() const
 }
 
 
+inline void
+PackageData::_AcquireDataV1() const
+{
+	if (fVersion == 1 && fDataV1 != NULL)
+		atomic_add(&fDataV1->referenceCount, 1);
+}
+
+
+inline void
+PackageData::_ReleaseDataV1()
+{
+	if (fVersion == 1 && fDataV1 != NULL
+		&& atomic_add(&fDataV1->referenceCount, -1) == 1) {
+		delete fDataV1;
+	}
+}
+
+
 #endif	// PACKAGE_DATA_H
@@ -49,10 +49,13 @@ private:
 
 
 struct PackageFile::DataAccessor {
-	DataAccessor(Package* package, PackageData* data)
+	DataAccessor(Package* package, PackageData* data,
+		FileContentTable::Content* content)
 		:
 		fPackage(package),
 		fData(data),
+		fContent(content),
+		fContentState(CONTENT_UNVERIFIED),
 		fReader(NULL),
 		fFileCache(NULL)
 	{
@@ -61,6 +64,10 @@ struct PackageFile::DataAccessor {
 
 	~DataAccessor()
 	{
+		if (fContent != NULL && fFileCache != NULL) {
+			FileContentTable::Default()->DetachFileCache(fContent,
+				fFileCache);
+		}
 		file_cache_delete(fFileCache);
 		delete fReader;
 		mutex_destroy(&fLock);
@@ -90,6 +97,23 @@ struct PackageFile::DataAccessor {
 		*bufferSize = std::min((uint64)*bufferSize,
 			fData->UncompressedSize() - offset);
 
+		// files with the same content share one file cache, but only files
+		// whose data matches the hash serve theirs to the others
+		if (fContent != NULL && fContentState != CONTENT_MISMATCH) {
+			FileContentTable* table = FileContentTable::Default();
+			if (fContentState == CONTENT_UNVERIFIED
+				&& !table->HasFileCache(fContent)) {
+				fContentState = table->Verify(fContent, fFileCache)
+					? CONTENT_VERIFIED : CONTENT_MISMATCH;
+			}
+
+			if (fContentState != CONTENT_MISMATCH) {
+				return table->Read(fContent, fFileCache,
+					fContentState == CONTENT_VERIFIED, offset, buffer,
+					bufferSize);
+			}
+		}
+
 		return file_cache_read(fFileCache, NULL, offset, buffer, bufferSize);
 	}
 
@@ -116,10 +140,19 @@ struct PackageFile::DataAccessor {
 		return B_OK;
 	}
 
+private:
+	enum {
+		CONTENT_UNVERIFIED,
+		CONTENT_VERIFIED,
+		CONTENT_MISMATCH
+	};
+
 private:
 	mutex							fLock;
 	Package*						fPackage;
 	PackageData*					fData;
+	FileContentTable::Content*		fContent;
+	int32							fContentState;
 	BAbstractBufferedDataReader*	fReader;
 	void*							fFileCache;
 };
@@ -132,13 +165,49 @@ PackageFile::PackageFile(Package* package, mode_t mode, const PackageData& data)
 	:
 	PackageLeafNode(package, mode),
 	fData(data),
-	fDataAccessor(NULL)
+	fDataAccessor(NULL),
+	fContent(NULL)
 {
 }
 
 
 PackageFile::~PackageFile()
 {
+	if (fContent != NULL)
+		FileContentTable::Default()->Put(fContent);
+}
+
+
+/*!	Sets the hex SHA-256 hash of the file's data, so that the file can share
+	its cache with other files with the same content. Must be called before
+	the node is published. Invalid hashes are ignored.
+*/
+void
+PackageFile::SetDataHash(const char* hash)
+{
+	if (fContent != NULL)
+		FileContentTable::Default()->Put(fContent);
+	fContent = FileContentTable::Default()->Get(hash,
+		fData.UncompressedSize());
+}
+
+
+//!	Like SetDataHash(const char*), but takes the binary hash.
+void
+PackageFile::SetDataHash(const uint8* hash)
+{
+	if (fContent != NULL)
+		FileContentTable::Default()->Put(fContent);
+	fContent = FileContentTable::Default()->Get(hash,
+		fData.UncompressedSize());
+}
+
+
+//!	Returns the binary SHA-256 hash of the file's data, or \c NULL.
+const uint8*
+PackageFile::DataHash() const
+{
+	return fContent != NULL ? FileContentTable::HashOf(fContent) : NULL;
 }
 
 
@@ -153,13 +222,14 @@ PackageFile::VFSInit(dev_t deviceID, ino_t nodeID)
 
 	// open the package -- that's already done by PackageNode::VFSInit(), so it
 	// shouldn't fail here. We only need to do it again, since we need the FD.
-	int fd = fPackage->Open();
+	int fd = GetPackage()->Open();
 	if (fd < 0)
 		RETURN_ERROR(fd);
-	PackageCloser packageCloser(fPackage);
+	PackageCloser packageCloser(GetPackage());
 
 	// create the data accessor
-	fDataAccessor = new(std::nothrow) DataAccessor(GetPackage(), &fData);
+	fDataAccessor = new(std::nothrow) DataAccessor(GetPackage(), &fData,
+		fContent);
 	if (fDataAccessor == NULL)
 		RETURN_ERROR(B_NO_MEMORY);
 
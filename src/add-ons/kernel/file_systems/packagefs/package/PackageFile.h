@@ -6,6 +6,7 @@
 #define PACKAGE_FILE_H
 
 
+#include "FileContentTable.h"
 #include "PackageData.h"
 #include "PackageLeafNode.h"
 
@@ -16,6 +17,12 @@ public:
 									const PackageData& data);
 	virtual						~PackageFile();
 
+			const PackageData&	Data() const	{ return fData; }
+
+			void				SetDataHash(const char* hash);
+			void				SetDataHash(const uint8* hash);
+			const uint8*		DataHash() const;
+
 	virtual	status_t			VFSInit(dev_t deviceID, ino_t nodeID);
 	virtual	void				VFSUninit();
 
@@ -32,6 +39,7 @@ private:
 private:
 			PackageData			fData;
 			DataAccessor*		fDataAccessor;
+			FileContentTable::Content* fContent;
 };
 
 
@@ -15,20 +15,40 @@
 
 PackageNode::PackageNode(Package* package, mode_t mode)
 	:
-	fPackage(package),
+	fArena(package->NodeArena()),
 	fParent(NULL),
 	fName(),
 	fMode(mode),
 	fUserID(0),
-	fGroupID(0)
+	fGroupID(0),
+	fAttributes(PackageNodeArena::kNoAttribute)
 {
+	fArena->AcquireReference();
 }
 
 
 PackageNode::~PackageNode()
 {
-	while (PackageNodeAttribute* attribute = fAttributes.RemoveHead())
-		delete attribute;
+}
+
+
+void*
+PackageNode::operator new(size_t size, Package* package) throw()
+{
+	return package->NodeArena()->AllocateNode(size);
+}
+
+
+void
+PackageNode::operator delete(void* block)
+{
+	// the memory belongs to the arena
+}
+
+
+void
+PackageNode::operator delete(void* block, Package* package)
+{
 }
 
 
@@ -45,11 +65,12 @@ status_t
 PackageNode::VFSInit(dev_t deviceID, ino_t nodeID)
 {
 	// open the package
-	int fd = fPackage->Open();
+	Package* package = GetPackage();
+	int fd = package->Open();
 	if (fd < 0)
 		RETURN_ERROR(fd);
 
-	fPackage->AcquireReference();
+	package->AcquireReference();
 	return B_OK;
 }
 
@@ -57,8 +78,9 @@ PackageNode::VFSInit(dev_t deviceID, ino_t nodeID)
 void
 PackageNode::VFSUninit()
 {
-	fPackage->Close();
-	fPackage->ReleaseReference();
+	Package* package = GetPackage();
+	package->Close();
+	package->ReleaseReference();
 }
 
 
@@ -69,35 +91,85 @@ PackageNode::FileSize() const
 }
 
 
-void
-PackageNode::AddAttribute(PackageNodeAttribute* attribute)
+/*!	Adds an attribute to the node. Only allowed while the package is being
+	loaded.
+*/
+status_t
+PackageNode::AddAttribute(const String& name, uint32 type,
+	const PackageData& data)
 {
-	fAttributes.Add(attribute);
+	return fArena->AddAttribute(fAttributes, name, type, data);
 }
 
 
-void
-PackageNode::RemoveAttribute(PackageNodeAttribute* attribute)
+uint32
+PackageNode::CountAttributes() const
 {
-	fAttributes.Remove(attribute);
+	return fArena->CountAttributes(fAttributes);
 }
 
 
-PackageNodeAttribute*
-PackageNode::FindAttribute(const StringKey& name) const
+/*!	Decodes the next attribute of the node.  cookie must be 0 initially.
+	Returns \c B_ENTRY_NOT_FOUND, if there are no more attributes.
+*/
+status_t
+PackageNode::GetNextAttribute(uint32& cookie,
+	PackageNodeAttribute& _attribute) const
 {
-	for (PackageNodeAttributeList::ConstIterator it = fAttributes.GetIterator();
-			PackageNodeAttribute* attribute = it.Next();) {
-		if (name == attribute->Name())
-			return attribute;
-	}
+	if (cookie == 0)
+		cookie = fAttributes;
+	return fArena->GetNextAttribute(cookie, _attribute);
+}
 
-	return NULL;
+
+/*!	Like GetNextAttribute(), but only returns the name of the attribute.
+*/
+bool
+PackageNode::GetNextAttributeName(uint32& cookie, String& _name) const
+{
+	if (cookie == 0)
+		cookie = fAttributes;
+	return fArena->GetNextAttributeName(cookie, _name);
+}
+
+
+status_t
+PackageNode::FindAttribute(const StringKey& name,
+	PackageNodeAttribute& _attribute) const
+{
+	uint32 offset = fArena->FindAttribute(fAttributes, name);
+	if (offset == PackageNodeArena::kNoAttribute)
+		return B_ENTRY_NOT_FOUND;
+
+	return fArena->GetNextAttribute(offset, _attribute);
+}
+
+
+/*!	Sets the index cookie of the given attribute of the node. The attribute
+	cookie passed to the index is the attribute's offset.
+*/
+status_t
+PackageNode::SetIndexCookie(const PackageNodeAttribute& attribute,
+	void* cookie)
+{
+	return fArena->SetIndexCookieAt(attribute.Offset(), cookie);
 }
 
 
 void
 PackageNode::UnsetIndexCookie(void* attributeCookie)
 {
-	((PackageNodeAttribute*)attributeCookie)->SetIndexCookie(NULL);
+	fArena->SetIndexCookieAt((addr_t)attributeCookie, NULL);
+}
+
+
+/*!	Destroys the node, but leaves its memory to the arena, which is released
+	afterwards.
+*/
+void
+PackageNode::LastReferenceReleased()
+{
+	PackageNodeArena* arena = fArena;
+	delete this;
+	arena->ReleaseReference();
 }
@@ -13,6 +13,7 @@
 #include <util/SinglyLinkedList.h>
 
 #include "IndexedAttributeOwner.h"
+#include "PackageNodeArena.h"
 #include "PackageNodeAttribute.h"
 #include "StringKey.h"
 
@@ -22,13 +23,26 @@ class Package;
 class PackageDirectory;
 
 
+/*!	A node of a package.
+
+	The nodes are allocated from the arena of their package, using the
+	placement new operator that takes the package. They keep their arena
+	alive, which also stores their attributes.
+*/
 class PackageNode : public BReferenceable, public IndexedAttributeOwner,
 	public SinglyLinkedListLinkImpl<PackageNode> {
 public:
 								PackageNode(Package* package, mode_t mode);
 	virtual						~PackageNode();
 
-			Package*			GetPackage() const	{ return fPackage; }
+	static	void*				operator new(size_t size, Package* package)
+									throw();
+	static	void				operator delete(void* block);
+	static	void				operator delete(void* block,
+									Package* package);
+
+			Package*			GetPackage() const
+									{ return fArena->GetPackage(); }
 									// Since PackageNode does only hold a
 									// reference to the package between
 									// VFSInit() and VFSUninit(), the caller
@@ -59,15 +73,20 @@ public:
 
 	virtual	off_t				FileSize() const;
 
-			void				AddAttribute(PackageNodeAttribute* attribute);
-			void				RemoveAttribute(
-									PackageNodeAttribute* attribute);
-
-			const PackageNodeAttributeList& Attributes() const
-									{ return fAttributes; }
+			status_t			AddAttribute(const String& name, uint32 type,
+									const PackageData& data);
 
-			PackageNodeAttribute* FindAttribute(const StringKey& name) const;
+			uint32				CountAttributes() const;
+			status_t			GetNextAttribute(uint32& cookie,
+									PackageNodeAttribute& _attribute) const;
+			bool				GetNextAttributeName(uint32& cookie,
+									String& _name) const;
+			status_t			FindAttribute(const StringKey& name,
+									PackageNodeAttribute& _attribute) const;
 
+			status_t			SetIndexCookie(
+									const PackageNodeAttribute& attribute,
+									void* cookie);
 	virtual	void				UnsetIndexCookie(void* attributeCookie);
 
 	inline	void*				IndexCookieForAttribute(const StringKey& name)
@@ -81,22 +100,26 @@ public:
 									// with MethodDeleter
 
 protected:
-			Package*			fPackage;
+	virtual	void				LastReferenceReleased();
+
+protected:
+			PackageNodeArena*	fArena;
 			PackageDirectory*	fParent;
 			String				fName;
 			mode_t				fMode;
 			uid_t				fUserID;
 			gid_t				fGroupID;
+			uint32				fAttributes;
 			timespec			fModifiedTime;
-			PackageNodeAttributeList fAttributes;
 };
 
 
 void*
 PackageNode::IndexCookieForAttribute(const StringKey& name) const
 {
-	PackageNodeAttribute* attribute = FindAttribute(name);
-	return attribute != NULL ? attribute->IndexCookie() : NULL;
+	uint32 offset = fArena->FindAttribute(fAttributes, name);
+	return offset != PackageNodeArena::kNoAttribute
+		? fArena->IndexCookieAt(offset) : NULL;
 }
 
 
@@ -0,0 +1,543 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+#include "PackageNodeArena.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <new>
+
+#include "DebugSupport.h"
+#include "PackageNodeAttribute.h"
+#include "StringKey.h"
+
+
+static const size_t kMinChunkSize = 512;
+static const size_t kMaxChunkSize = 8192;
+	// the largest size the kernel's block allocator serves from its slabs
+static const uint32 kMinAttributesCapacity = 256;
+
+// formats of an attribute's data
+enum {
+	ATTRIBUTE_DATA_HEAP		= 0,
+		// size and heap offset
+	ATTRIBUTE_DATA_INLINE	= 1,
+		// size and the inline data
+	ATTRIBUTE_DATA_V1		= 2
+		// the PackageDataV1 as is
+};
+
+static const size_t kMaxRecordSize = 5 + 20 + sizeof(PackageDataV1);
+	// an upper bound: the header, and 20 bytes for the heap format, 9 for
+	// the inline format, or the version 1 data
+
+
+struct PackageNodeArena::Chunk {
+	Chunk*	next;
+	size_t	size;
+	size_t	used;
+};
+
+
+struct PackageNodeArena::AttributeKind {
+	String	name;
+	uint32	type;
+};
+
+
+struct PackageNodeArena::IndexCookie {
+	uint32			offset;
+	void*			cookie;
+	IndexCookie*	hashNext;
+};
+
+
+struct PackageNodeArena::IndexCookieHashDefinition {
+	typedef uint32		KeyType;
+	typedef IndexCookie	ValueType;
+
+	size_t HashKey(uint32 key) const
+	{
+		return key;
+	}
+
+	size_t Hash(const IndexCookie* value) const
+	{
+		return value->offset;
+	}
+
+	bool Compare(uint32 key, const IndexCookie* value) const
+	{
+		return value->offset == key;
+	}
+
+	IndexCookie*& GetLink(IndexCookie* value) const
+	{
+		return value->hashNext;
+	}
+};
+
+
+static uint8*
+write_uleb128(uint8* buffer, uint64 value)
+{
+	do {
+		uint8 byte = value & 0x7f;
+		value >>= 7;
+		*buffer++ = byte | (value != 0 ? 0x80 : 0);
+	} while (value != 0);
+
+	return buffer;
+}
+
+
+static const uint8*
+read_uleb128(const uint8* buffer, uint64& _value)
+{
+	uint64 value = 0;
+	int shift = 0;
+	uint8 byte;
+	do {
+		byte = *buffer++;
+		value |= (uint64)(byte & 0x7f) << shift;
+		shift += 7;
+	} while ((byte & 0x80) != 0);
+
+	_value = value;
+	return buffer;
+}
+
+
+// #pragma mark - PackageNodeArena
+
+
+PackageNodeArena::PackageNodeArena(Package* package)
+	:
+	fPackage(package),
+	fChunks(NULL),
+	fNodeMemorySize(0),
+	fNodeCount(0),
+	fAttributes(NULL),
+	fAttributesSize(0),
+	fAttributesCapacity(0),
+	fLastAttributes(kNoAttribute),
+	fAttributeCount(0),
+	fKinds(NULL),
+	fKindCount(0),
+	fKindCapacity(0),
+	fIndexCookies(NULL)
+{
+}
+
+
+PackageNodeArena::~PackageNodeArena()
+{
+	// All nodes have been destroyed by now.
+	while (Chunk* chunk = fChunks) {
+		fChunks = chunk->next;
+		free(chunk);
+	}
+
+	free(fAttributes);
+	delete[] fKinds;
+
+	if (fIndexCookies != NULL) {
+		IndexCookie* cookie = fIndexCookies->Clear(true);
+		while (cookie != NULL) {
+			IndexCookie* next = cookie->hashNext;
+			delete cookie;
+			cookie = next;
+		}
+		delete fIndexCookies;
+	}
+}
+
+
+/*!	Allocates the memory for a node. It is only freed together with the
+	arena.
+*/
+void*
+PackageNodeArena::AllocateNode(size_t size)
+{
+	const size_t headerSize = (sizeof(Chunk) + 7) & ~(size_t)7;
+	size = (size + 7) & ~(size_t)7;
+
+	Chunk* chunk = fChunks;
+	if (chunk == NULL || chunk->size - chunk->used < size) {
+		size_t chunkSize = chunk != NULL
+			? std::min(chunk->size * 2, kMaxChunkSize) : kMinChunkSize;
+		chunkSize = std::max(chunkSize, headerSize + size);
+
+		chunk = (Chunk*)malloc(chunkSize);
+		if (chunk == NULL)
+			return NULL;
+
+		chunk->next = fChunks;
+		chunk->size = chunkSize;
+		chunk->used = headerSize;
+		fChunks = chunk;
+		fNodeMemorySize += chunkSize;
+	}
+
+	void* node = (uint8*)chunk + chunk->used;
+	chunk->used += size;
+	fNodeCount++;
+	return node;
+}
+
+
+/*!	Adds an attribute to the records of a node. \a attributes is the offset
+	of the node's records, it is updated, if they have to be moved.
+	If the node's records are not the last ones, because the attributes of
+	several nodes interleave, they are copied to the end first.
+*/
+status_t
+PackageNodeArena::AddAttribute(uint32& attributes, const String& name,
+	uint32 type, const PackageData& data)
+{
+	uint32 kind;
+	status_t error = _GetKind(name, type, kind);
+	if (error != B_OK)
+		RETURN_ERROR(error);
+
+	uint32 recordsSize = 0;
+	if (attributes != kNoAttribute && attributes != fLastAttributes) {
+		uint32 offset = attributes;
+		uint32 dummyKind;
+		while (_ReadRecord(offset, dummyKind, NULL) == B_OK) {
+		}
+		recordsSize = offset - attributes;
+	}
+
+	error = _ReserveAttributes(recordsSize + kMaxRecordSize + 1);
+	if (error != B_OK)
+		RETURN_ERROR(error);
+
+	uint32 start;
+	if (attributes == kNoAttribute) {
+		start = fAttributesSize;
+	} else if (attributes == fLastAttributes) {
+		// overwrite the terminator
+		start = attributes;
+		fAttributesSize--;
+	} else {
+		start = fAttributesSize;
+		memcpy(fAttributes + start, fAttributes + attributes, recordsSize);
+		fAttributesSize += recordsSize;
+	}
+
+	uint8* buffer = fAttributes + fAttributesSize;
+	if (data.Version() == 1) {
+		buffer = write_uleb128(buffer,
+			(uint64)(kind + 1) << 2 | ATTRIBUTE_DATA_V1);
+		memcpy(buffer, &data.DataV1(), sizeof(PackageDataV1));
+		buffer += sizeof(PackageDataV1);
+	} else if (data.IsEncodedInline()) {
+		uint8 size = (uint8)data.DataV2().Size();
+		buffer = write_uleb128(buffer,
+			(uint64)(kind + 1) << 2 | ATTRIBUTE_DATA_INLINE);
+		*buffer++ = size;
+		memcpy(buffer, data.InlineData(), size);
+		buffer += size;
+	} else {
+		buffer = write_uleb128(buffer,
+			(uint64)(kind + 1) << 2 | ATTRIBUTE_DATA_HEAP);
+		buffer = write_uleb128(buffer, data.DataV2().Size());
+		buffer = write_uleb128(buffer, data.DataV2().Offset());
+	}
+	*buffer++ = 0;
+
+	fAttributesSize = buffer - fAttributes;
+	attributes = start;
+	fLastAttributes = start;
+	fAttributeCount++;
+	return B_OK;
+}
+
+
+/*!	Frees the memory that was reserved for adding attributes. No attributes
+	can be added afterwards.
+*/
+void
+PackageNodeArena::FinishLoading()
+{
+	if (fAttributesSize < fAttributesCapacity) {
+		uint8* attributes = (uint8*)realloc(fAttributes, fAttributesSize);
+		if (attributes != NULL) {
+			fAttributes = attributes;
+			fAttributesCapacity = fAttributesSize;
+		}
+	}
+
+	if (fKindCount < fKindCapacity) {
+		AttributeKind* kinds = new(std::nothrow) AttributeKind[fKindCount];
+		if (kinds != NULL) {
+			for (uint32 i = 0; i < fKindCount; i++)
+				kinds[i] = fKinds[i];
+			delete[] fKinds;
+			fKinds = kinds;
+			fKindCapacity = fKindCount;
+		}
+	}
+
+	fLastAttributes = kNoAttribute;
+}
+
+
+uint32
+PackageNodeArena::CountAttributes(uint32 offset) const
+{
+	uint32 count = 0;
+	uint32 kind;
+	while (_ReadRecord(offset, kind, NULL) == B_OK)
+		count++;
+	return count;
+}
+
+
+/*!	Decodes the attribute at \a offset and advances \a offset to the next
+	one. Returns \c B_ENTRY_NOT_FOUND, if there are no more attributes.
+*/
+status_t
+PackageNodeArena::GetNextAttribute(uint32& offset,
+	PackageNodeAttribute& _attribute) const
+{
+	uint32 attributeOffset = offset;
+	uint32 kind;
+	PackageData data;
+	status_t error = _ReadRecord(offset, kind, &data);
+	if (error != B_OK)
+		return error;
+
+	_attribute.SetTo(fKinds[kind].name, fKinds[kind].type, data,
+		attributeOffset);
+	return B_OK;
+}
+
+
+/*!	Like GetNextAttribute(), but only returns the attribute's name, without
+	decoding its data.
+*/
+bool
+PackageNodeArena::GetNextAttributeName(uint32& offset, String& _name) const
+{
+	uint32 kind;
+	if (_ReadRecord(offset, kind, NULL) != B_OK)
+		return false;
+
+	_name = fKinds[kind].name;
+	return true;
+}
+
+
+/*!	Returns the offset of the attribute with the given name among the ones
+	starting at \a offset, or \c kNoAttribute, if there is none.
+*/
+uint32
+PackageNodeArena::FindAttribute(uint32 offset, const StringKey& name) const
+{
+	uint32 attributeOffset = offset;
+	uint32 kind;
+	while (_ReadRecord(offset, kind, NULL) == B_OK) {
+		if (name == fKinds[kind].name)
+			return attributeOffset;
+		attributeOffset = offset;
+	}
+
+	return kNoAttribute;
+}
+
+
+/*!	Returns the index cookie of the attribute at \a offset.
+	The caller must hold the volume's lock.
+*/
+void*
+PackageNodeArena::IndexCookieAt(uint32 offset) const
+{
+	if (fIndexCookies == NULL)
+		return NULL;
+
+	IndexCookie* cookie = fIndexCookies->Lookup(offset);
+	return cookie != NULL ? cookie->cookie : NULL;
+}
+
+
+/*!	Sets the index cookie of the attribute at \a offset. Since only few
+	attributes are indexed, the cookies are kept in a table rather than in
+	the records. A \c NULL \a cookie unsets it, which cannot fail.
+	The caller must hold the volume's write lock.
+*/
+status_t
+PackageNodeArena::SetIndexCookieAt(uint32 offset, void* cookie)
+{
+	if (cookie == NULL) {
+		if (fIndexCookies == NULL)
+			return B_OK;
+
+		IndexCookie* indexCookie = fIndexCookies->Lookup(offset);
+		if (indexCookie != NULL) {
+			fIndexCookies->RemoveUnchecked(indexCookie);
+			delete indexCookie;
+		}
+		return B_OK;
+	}
+
+	if (fIndexCookies == NULL) {
+		IndexCookieTable* table = new(std::nothrow) IndexCookieTable;
+		if (table == NULL)
+			RETURN_ERROR(B_NO_MEMORY);
+
+		status_t error = table->Init();
+		if (error != B_OK) {
+			delete table;
+			RETURN_ERROR(error);
+		}
+
+		fIndexCookies = table;
+	}
+
+	IndexCookie* indexCookie = fIndexCookies->Lookup(offset);
+	if (indexCookie == NULL) {
+		indexCookie = new(std::nothrow) IndexCookie;
+		if (indexCookie == NULL)
+			RETURN_ERROR(B_NO_MEMORY);
+
+		indexCookie->offset = offset;
+		fIndexCookies->InsertUnchecked(indexCookie);
+	}
+
+	indexCookie->cookie = cookie;
+	return B_OK;
+}
+
+
+size_t
+PackageNodeArena::AttributeMemorySize() const
+{
+	return fAttributesCapacity + fKindCapacity * sizeof(AttributeKind);
+}
+
+
+status_t
+PackageNodeArena::_GetKind(const String& name, uint32 type, uint32& _index)
+{
+	for (uint32 i = 0; i < fKindCount; i++) {
+		if (fKinds[i].type == type && fKinds[i].name == name) {
+			_index = i;
+			return B_OK;
+		}
+	}
+
+	if (fKindCount == fKindCapacity) {
+		uint32 capacity = std::max(fKindCapacity * 2, (uint32)8);
+		AttributeKind* kinds = new(std::nothrow) AttributeKind[capacity];
+		if (kinds == NULL)
+			RETURN_ERROR(B_NO_MEMORY);
+
+		for (uint32 i = 0; i < fKindCount; i++)
+			kinds[i] = fKinds[i];
+		delete[] fKinds;
+		fKinds = kinds;
+		fKindCapacity = capacity;
+	}
+
+	fKinds[fKindCount].name = name;
+	fKinds[fKindCount].type = type;
+	_index = fKindCount++;
+	return B_OK;
+}
+
+
+status_t
+PackageNodeArena::_ReserveAttributes(size_t size)
+{
+	if (fAttributes == NULL) {
+		// Offset 0 is the terminator nodes without attributes refer to.
+		size++;
+	}
+
+	if (fAttributesSize + size <= fAttributesCapacity)
+		return B_OK;
+
+	size_t capacity = std::max((size_t)fAttributesCapacity * 2,
+		fAttributesSize + size);
+	capacity = std::max(capacity, (size_t)kMinAttributesCapacity);
+
+	uint8* attributes = (uint8*)realloc(fAttributes, capacity);
+	if (attributes == NULL)
+		RETURN_ERROR(B_NO_MEMORY);
+
+	if (fAttributes == NULL)
+		attributes[fAttributesSize++] = 0;
+
+	fAttributes = attributes;
+	fAttributesCapacity = capacity;
+	return B_OK;
+}
+
+
+/*!	Decodes the record at \a offset and advances \a offset to the next one.
+	If \a _data is \c NULL, the data are only skipped. Returns
+	\c B_ENTRY_NOT_FOUND at the end of a node's records.
+*/
+status_t
+PackageNodeArena::_ReadRecord(uint32& offset, uint32& _kind,
+	PackageData* _data) const
+{
+	if (offset == kNoAttribute || fAttributes[offset] == 0)
+		return B_ENTRY_NOT_FOUND;
+
+	const uint8* buffer = fAttributes + offset;
+	uint64 header;
+	buffer = read_uleb128(buffer, header);
+	_kind = (uint32)(header >> 2) - 1;
+
+	switch (header & 3) {
+		case ATTRIBUTE_DATA_HEAP:
+		{
+			uint64 size;
+			uint64 heapOffset;
+			buffer = read_uleb128(buffer, size);
+			buffer = read_uleb128(buffer, heapOffset);
+			if (_data != NULL) {
+				PackageDataV2 data;
+				data.SetData(size, heapOffset);
+				*_data = PackageData(data);
+			}
+			break;
+		}
+
+		case ATTRIBUTE_DATA_INLINE:
+		{
+			uint8 size = *buffer++;
+			if (_data != NULL) {
+				PackageDataV2 data;
+				data.SetData(size, buffer);
+				*_data = PackageData(data);
+			}
+			buffer += size;
+			break;
+		}
+
+		case ATTRIBUTE_DATA_V1:
+		{
+			if (_data != NULL) {
+				PackageDataV1 data;
+				memcpy(&data, buffer, sizeof(data));
+				*_data = PackageData(data);
+				if (_data->InitCheck() != B_OK)
+					RETURN_ERROR(_data->InitCheck());
+			}
+			buffer += sizeof(PackageDataV1);
+			break;
+		}
+	}
+
+	offset = buffer - fAttributes;
+	return B_OK;
+}
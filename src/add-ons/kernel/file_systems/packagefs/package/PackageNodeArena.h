@@ -0,0 +1,109 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef PACKAGE_NODE_ARENA_H
+#define PACKAGE_NODE_ARENA_H
+
+
+#include <Referenceable.h>
+
+#include <util/OpenHashTable.h>
+
+#include "PackageData.h"
+#include "String.h"
+
+
+class Package;
+class PackageNodeAttribute;
+class StringKey;
+
+
+/*!	Holds the nodes of a package and their attributes in a compact form.
+
+	The nodes are allocated from chunks that are freed all at once, when
+	neither the package nor any of its nodes need the arena anymore; every
+	node holds a reference to it.
+
+	The attributes of all nodes are encoded into a single array, similar to
+	the way they are stored in the package's TOC: a record refers to the
+	name and type it shares with other attributes by an index into the
+	kinds array, followed by the size and location of its data. The records
+	of a node follow each other and are terminated by a null byte; a node
+	only knows the offset of its first record. The attributes are decoded
+	only when they are accessed.
+
+	Nodes and attributes can only be added while the package is being
+	loaded, which happens in a single thread.
+*/
+class PackageNodeArena : public BReferenceable {
+public:
+								PackageNodeArena(Package* package);
+	virtual						~PackageNodeArena();
+
+			Package*			GetPackage() const	{ return fPackage; }
+
+			void*				AllocateNode(size_t size);
+
+			status_t			AddAttribute(uint32& attributes,
+									const String& name, uint32 type,
+									const PackageData& data);
+			void				FinishLoading();
+
+			uint32				CountAttributes(uint32 offset) const;
+			status_t			GetNextAttribute(uint32& offset,
+									PackageNodeAttribute& _attribute) const;
+			bool				GetNextAttributeName(uint32& offset,
+									String& _name) const;
+			uint32				FindAttribute(uint32 offset,
+									const StringKey& name) const;
+
+			void*				IndexCookieAt(uint32 offset) const;
+			status_t			SetIndexCookieAt(uint32 offset, void* cookie);
+
+			uint32				NodeCount() const	{ return fNodeCount; }
+			uint32				AttributeCount() const
+									{ return fAttributeCount; }
+			size_t				NodeMemorySize() const
+									{ return fNodeMemorySize; }
+			size_t				AttributeMemorySize() const;
+
+	static	const uint32		kNoAttribute = 0;
+
+private:
+			struct Chunk;
+			struct AttributeKind;
+			struct IndexCookie;
+			struct IndexCookieHashDefinition;
+
+			typedef BOpenHashTable<IndexCookieHashDefinition> IndexCookieTable;
+
+private:
+			status_t			_GetKind(const String& name, uint32 type,
+									uint32& _index);
+			status_t			_ReserveAttributes(size_t size);
+			status_t			_ReadRecord(uint32& offset, uint32& _kind,
+									PackageData* _data) const;
+
+private:
+			Package*			fPackage;
+
+			Chunk*				fChunks;
+			size_t				fNodeMemorySize;
+			uint32				fNodeCount;
+
+			uint8*				fAttributes;
+			uint32				fAttributesSize;
+			uint32				fAttributesCapacity;
+			uint32				fLastAttributes;
+			uint32				fAttributeCount;
+
+			AttributeKind*		fKinds;
+			uint32				fKindCount;
+			uint32				fKindCapacity;
+
+			IndexCookieTable*	fIndexCookies;
+};
+
+
+#endif	// PACKAGE_NODE_ARENA_H
@@ -10,13 +10,12 @@
 #include <string.h>
 
 
-PackageNodeAttribute::PackageNodeAttribute(uint32 type,
-	const PackageData& data)
+PackageNodeAttribute::PackageNodeAttribute()
 	:
-	fData(data),
+	fData(),
 	fName(),
-	fIndexCookie(NULL),
-	fType(type)
+	fType(0),
+	fOffset(0)
 {
 }
 
@@ -27,7 +26,11 @@ PackageNodeAttribute::~PackageNodeAttribute()
 
 
 void
-PackageNodeAttribute::Init(const String& name)
+PackageNodeAttribute::SetTo(const String& name, uint32 type,
+	const PackageData& data, uint32 offset)
 {
 	fName = name;
+	fType = type;
+	fData = data;
+	fOffset = offset;
 }
@@ -6,43 +6,33 @@
 #define PACKAGE_NODE_ATTRIBUTE_H
 
 
-#include <util/DoublyLinkedList.h>
-
 #include "PackageData.h"
 
 #include "String.h"
 
 
-class PackageNode;
-
-
-class PackageNodeAttribute
-	: public DoublyLinkedListLinkImpl<PackageNodeAttribute> {
+/*!	An attribute of a PackageNode, as decoded from the node's arena.
+	The offset identifies the attribute within the arena.
+*/
+class PackageNodeAttribute {
 public:
-								PackageNodeAttribute(uint32 type,
-									const PackageData& data);
+								PackageNodeAttribute();
 								~PackageNodeAttribute();
 
 			const String&		Name() const	{ return fName; }
 			uint32				Type() const	{ return fType; }
 			const PackageData&	Data() const	{ return fData; }
+			uint32				Offset() const	{ return fOffset; }
 
-			void				Init(const String& name);
-
-			void				SetIndexCookie(void* cookie)
-									{ fIndexCookie = cookie; }
-			void*				IndexCookie() const
-									{ return fIndexCookie; }
+			void				SetTo(const String& name, uint32 type,
+									const PackageData& data, uint32 offset);
 
 protected:
 			PackageData			fData;
 			String				fName;
-			void*				fIndexCookie;
 			uint32				fType;
+			uint32				fOffset;
 };
 
 
-typedef DoublyLinkedList<PackageNodeAttribute> PackageNodeAttributeList;
-
-
 #endif	// PACKAGE_NODE_ATTRIBUTE_H
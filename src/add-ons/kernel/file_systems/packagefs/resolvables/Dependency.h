@@ -36,6 +36,10 @@ public:
 									Version* version);
 									// version is optional; object takes over
 									// ownership
+			BPackageResolvableOperator VersionOperator() const
+									{ return fVersionOperator; }
+			Version*			RequiredVersion() const
+									{ return fVersion; }
 
 			::Package*			Package() const
 									{ return fPackage; }
@@ -36,6 +36,12 @@ public:
 									// returns how big the buffer should have
 									// been (excluding the terminating null)
 
+			const String&		Major() const		{ return fMajor; }
+			const String&		Minor() const		{ return fMinor; }
+			const String&		Micro() const		{ return fMicro; }
+			const String&		PreRelease() const	{ return fPreRelease; }
+			uint32				Revision() const	{ return fRevision; }
+
 private:
 			String				fMajor;
 			String				fMinor;
@@ -0,0 +1,1096 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+#include "MountStateCache.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <new>
+
+#include <zlib.h>
+
+#include <AutoDeleter.h>
+#include <PackagesDirectoryDefs.h>
+
+#include "DebugSupport.h"
+#include "PackageDirectory.h"
+#include "PackageFile.h"
+#include "PackagesDirectory.h"
+#include "PackageSettings.h"
+#include "PackageSymlink.h"
+#include "Version.h"
+
+
+using BPackageKit::BHPKG::B_HPKG_MAX_INLINE_DATA_SIZE;
+
+
+static const char* const kCacheFilePath
+	= PACKAGES_DIRECTORY_ADMIN_DIRECTORY "/packagefs-cache";
+
+static const uint32 kCacheMagic			= 'pfmc';
+static const uint32 kCacheVersion		= 2;
+
+// sanity limits
+static const size_t kMaxCacheFileSize	= 64 * 1024 * 1024;
+static const uint32 kMaxNodeDepth		= 256;
+
+
+struct mount_state_cache_header {
+	uint32	magic;
+	uint32	version;
+	uint32	record_count;
+	uint32	payload_crc;
+	uint64	payload_size;
+};
+
+
+// #pragma mark - Record
+
+
+struct MountStateCache::Record {
+	const char*	fileName;
+	ino_t		nodeID;
+	off_t		size;
+	int64		modifiedSeconds;
+	int64		modifiedNanoSeconds;
+	const uint8* data;
+	size_t		dataSize;
+};
+
+
+// #pragma mark - Reader
+
+
+struct MountStateCache::Reader {
+	Reader(const uint8* data, size_t size)
+		:
+		fData(data),
+		fEnd(data + size)
+	{
+	}
+
+	bool Read(void* buffer, size_t size)
+	{
+		if ((size_t)(fEnd - fData) < size)
+			return false;
+
+		memcpy(buffer, fData, size);
+		fData += size;
+		return true;
+	}
+
+	template<typename Type>
+	bool Read(Type& value)
+	{
+		return Read(&value, sizeof(value));
+	}
+
+	/*!	Strings are stored with their length and null-terminated, so they
+		can be used in place.
+	*/
+	bool ReadString(const char*& _string, size_t& _length)
+	{
+		uint32 length;
+		if (!Read(length) || (size_t)(fEnd - fData) <= length
+			|| fData[length] != '\0') {
+			return false;
+		}
+
+		_string = (const char*)fData;
+		_length = length;
+		fData += length + 1;
+		return true;
+	}
+
+	bool ReadString(const char*& _string)
+	{
+		size_t length;
+		return ReadString(_string, length);
+	}
+
+	bool ReadString(String& _string)
+	{
+		const char* string;
+		size_t length;
+		return ReadString(string, length)
+			&& _string.SetToExactLength(string, length);
+	}
+
+	bool Skip(size_t size)
+	{
+		if ((size_t)(fEnd - fData) < size)
+			return false;
+
+		fData += size;
+		return true;
+	}
+
+	const uint8* Position() const
+	{
+		return fData;
+	}
+
+	bool IsAtEnd() const
+	{
+		return fData == fEnd;
+	}
+
+private:
+	const uint8*	fData;
+	const uint8*	fEnd;
+};
+
+
+// #pragma mark - Writer
+
+
+struct MountStateCache::Writer {
+	Writer()
+		:
+		fBuffer(NULL),
+		fSize(0),
+		fCapacity(0)
+	{
+	}
+
+	~Writer()
+	{
+		free(fBuffer);
+	}
+
+	status_t Write(const void* data, size_t size)
+	{
+		if (fSize + size > fCapacity) {
+			size_t capacity = fCapacity > 0 ? fCapacity : 4096;
+			while (capacity < fSize + size)
+				capacity *= 2;
+
+			uint8* buffer = (uint8*)realloc(fBuffer, capacity);
+			if (buffer == NULL)
+				return B_NO_MEMORY;
+
+			fBuffer = buffer;
+			fCapacity = capacity;
+		}
+
+		memcpy(fBuffer + fSize, data, size);
+		fSize += size;
+		return B_OK;
+	}
+
+	template<typename Type>
+	status_t Write(const Type& value)
+	{
+		return Write(&value, sizeof(value));
+	}
+
+	status_t WriteString(const char* string)
+	{
+		uint32 length = strlen(string);
+		status_t error = Write(length);
+		if (error != B_OK)
+			return error;
+
+		return Write(string, length + 1);
+	}
+
+	void Reset()
+	{
+		fSize = 0;
+	}
+
+	const uint8* Data() const
+	{
+		return fBuffer;
+	}
+
+	size_t Size() const
+	{
+		return fSize;
+	}
+
+private:
+	uint8*			fBuffer;
+	size_t			fSize;
+	size_t			fCapacity;
+};
+
+
+// #pragma mark - MountStateCache
+
+
+MountStateCache::MountStateCache()
+	:
+	fPackagesDirectory(NULL),
+	fData(NULL),
+	fDataSize(0),
+	fRecords(NULL),
+	fRecordCount(0),
+	fHitCount(0)
+{
+}
+
+
+MountStateCache::~MountStateCache()
+{
+	free(fRecords);
+	free(fData);
+
+	if (fPackagesDirectory != NULL)
+		fPackagesDirectory->ReleaseReference();
+}
+
+
+status_t
+MountStateCache::Init(PackagesDirectory* directory)
+{
+	fPackagesDirectory = directory;
+	fPackagesDirectory->AcquireReference();
+
+	int fd = openat(directory->DirectoryFD(), kCacheFilePath, O_RDONLY);
+	if (fd < 0)
+		return B_OK;
+	FileDescriptorCloser fdCloser(fd);
+
+	status_t error = _ReadFile(fd);
+	if (error == B_OK)
+		error = _IndexRecords();
+
+	if (error != B_OK) {
+		INFORM("Ignoring invalid packagefs cache file: %s\n", strerror(error));
+
+		free(fRecords);
+		fRecords = NULL;
+		fRecordCount = 0;
+		free(fData);
+		fData = NULL;
+		fDataSize = 0;
+
+		// only memory shortage is a serious problem
+		if (error == B_NO_MEMORY)
+			return error;
+	}
+
+	return B_OK;
+}
+
+
+/*!	Adds the cached attributes and nodes of \a package to it.
+	\a st must be the stat data of the package file. Returns
+	\c B_ENTRY_NOT_FOUND, if the cache doesn't contain a matching record or
+	\a settings apply to the package, since the cached node tree is unfiltered.
+	In either error case the package may have been partially populated.
+*/
+status_t
+MountStateCache::ReadPackage(Package* package, const struct stat& st,
+	const PackageSettings& settings)
+{
+	Record* record = _FindRecord(package->FileName());
+	if (record == NULL || record->nodeID != st.st_ino
+		|| record->size != st.st_size
+		|| record->modifiedSeconds != (int64)st.st_mtim.tv_sec
+		|| record->modifiedNanoSeconds != (int64)st.st_mtim.tv_nsec) {
+		return B_ENTRY_NOT_FOUND;
+	}
+
+	Reader reader(record->data, record->dataSize);
+
+	// package attributes
+	String name;
+	String installPath;
+	uint32 architecture;
+	uint8 hasVersion;
+	if (!reader.ReadString(name) || !reader.ReadString(installPath)
+		|| !reader.Read(architecture) || !reader.Read(hasVersion)
+		|| architecture >= B_PACKAGE_ARCHITECTURE_ENUM_COUNT) {
+		RETURN_ERROR(B_BAD_DATA);
+	}
+
+	if (settings.PackageItemFor(name) != NULL)
+		return B_ENTRY_NOT_FOUND;
+
+	package->SetName(name);
+	package->SetInstallPath(installPath);
+	package->SetArchitecture((BPackageArchitecture)architecture);
+
+	if (hasVersion != 0) {
+		::Version* version;
+		status_t error = _ReadVersion(reader, version);
+		if (error != B_OK)
+			RETURN_ERROR(error);
+		package->SetVersion(version);
+	}
+
+	// resolvables
+	uint32 count;
+	if (!reader.Read(count))
+		RETURN_ERROR(B_BAD_DATA);
+
+	for (uint32 i = 0; i < count; i++) {
+		const char* resolvableName;
+		uint8 flags;
+		if (!reader.ReadString(resolvableName) || !reader.Read(flags))
+			RETURN_ERROR(B_BAD_DATA);
+
+		::Version* version = NULL;
+		if ((flags & 0x1) != 0) {
+			status_t error = _ReadVersion(reader, version);
+			if (error != B_OK)
+				RETURN_ERROR(error);
+		}
+		ObjectDeleter< ::Version> versionDeleter(version);
+
+		::Version* compatibleVersion = NULL;
+		if ((flags & 0x2) != 0) {
+			status_t error = _ReadVersion(reader, compatibleVersion);
+			if (error != B_OK)
+				RETURN_ERROR(error);
+		}
+		ObjectDeleter< ::Version> compatibleVersionDeleter(compatibleVersion);
+
+		Resolvable* resolvable = new(std::nothrow) Resolvable(package);
+		if (resolvable == NULL)
+			RETURN_ERROR(B_NO_MEMORY);
+		ObjectDeleter<Resolvable> resolvableDeleter(resolvable);
+
+		status_t error = resolvable->Init(resolvableName,
+			versionDeleter.Detach(), compatibleVersionDeleter.Detach());
+		if (error != B_OK)
+			RETURN_ERROR(error);
+
+		package->AddResolvable(resolvableDeleter.Detach());
+	}
+
+	// dependencies
+	if (!reader.Read(count))
+		RETURN_ERROR(B_BAD_DATA);
+
+	for (uint32 i = 0; i < count; i++) {
+		const char* dependencyName;
+		uint8 hasOpAndVersion;
+		if (!reader.ReadString(dependencyName) || !reader.Read(hasOpAndVersion))
+			RETURN_ERROR(B_BAD_DATA);
+
+		Dependency* dependency = new(std::nothrow) Dependency(package);
+		if (dependency == NULL)
+			RETURN_ERROR(B_NO_MEMORY);
+		ObjectDeleter<Dependency> dependencyDeleter(dependency);
+
+		status_t error = dependency->Init(dependencyName);
+		if (error != B_OK)
+			RETURN_ERROR(error);
+
+		if (hasOpAndVersion != 0) {
+			uint32 op;
+			if (!reader.Read(op) || op >= B_PACKAGE_RESOLVABLE_OP_ENUM_COUNT)
+				RETURN_ERROR(B_BAD_DATA);
+
+			::Version* version;
+			error = _ReadVersion(reader, version);
+			if (error != B_OK)
+				RETURN_ERROR(error);
+
+			dependency->SetVersionRequirement((BPackageResolvableOperator)op,
+				version);
+		}
+
+		package->AddDependency(dependencyDeleter.Detach());
+	}
+
+	// nodes
+	if (!reader.Read(count))
+		RETURN_ERROR(B_BAD_DATA);
+
+	status_t error = _ReadNodes(reader, package, count);
+	if (error != B_OK)
+		RETURN_ERROR(error);
+
+	if (!reader.IsAtEnd())
+		RETURN_ERROR(B_BAD_DATA);
+
+	atomic_add(&fHitCount, 1);
+	return B_OK;
+}
+
+
+/*!	Writes the cache file for the given packages, unless all cacheable
+	packages have been loaded from the cache and the cache doesn't contain
+	any stale records.
+*/
+status_t
+MountStateCache::Write(const PackageFileNameHashTable& packages,
+	const PackageSettings& settings)
+{
+	// count the packages we can cache
+	int32 cacheableCount = 0;
+	for (PackageFileNameHashTable::Iterator it = packages.GetIterator();
+		Package* package = it.Next();) {
+		if (package->Directory() == fPackagesDirectory
+			&& package->FormatVersion() == 2
+			&& settings.PackageItemFor(package->Name()) == NULL) {
+			cacheableCount++;
+		}
+	}
+
+	if (cacheableCount == fHitCount && fHitCount == fRecordCount)
+		return B_OK;
+
+	int fd = openat(fPackagesDirectory->DirectoryFD(), kCacheFilePath,
+		O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
+	if (fd < 0)
+		RETURN_ERROR(errno);
+	FileDescriptorCloser fdCloser(fd);
+
+	// Write a header that doesn't validate first and the correct one after
+	// all records have been written, so that a torn file will be ignored.
+	mount_state_cache_header header;
+	memset(&header, 0, sizeof(header));
+	if (write(fd, &header, sizeof(header)) != (ssize_t)sizeof(header))
+		RETURN_ERROR(errno);
+
+	Writer writer;
+	uint32 crc = crc32(0, NULL, 0);
+	uint64 payloadSize = 0;
+	uint32 recordCount = 0;
+
+	for (PackageFileNameHashTable::Iterator it = packages.GetIterator();
+		Package* package = it.Next();) {
+		if (package->Directory() != fPackagesDirectory
+			|| package->FormatVersion() != 2
+			|| settings.PackageItemFor(package->Name()) != NULL) {
+			continue;
+		}
+
+		// make sure the file is still the one we've loaded
+		struct stat st;
+		if (fstatat(fPackagesDirectory->DirectoryFD(), package->FileName(),
+				&st, 0) != 0
+			|| st.st_ino != package->NodeID()) {
+			continue;
+		}
+
+		writer.Reset();
+		status_t error = _WritePackage(writer, package, st);
+		if (error != B_OK)
+			RETURN_ERROR(error);
+
+		uint32 recordSize = writer.Size();
+		if (write(fd, &recordSize, sizeof(recordSize))
+				!= (ssize_t)sizeof(recordSize)
+			|| write(fd, writer.Data(), recordSize) != (ssize_t)recordSize) {
+			RETURN_ERROR(errno);
+		}
+
+		crc = crc32(crc, (const Bytef*)&recordSize, sizeof(recordSize));
+		crc = crc32(crc, writer.Data(), recordSize);
+		payloadSize += sizeof(recordSize) + recordSize;
+		recordCount++;
+	}
+
+	header.magic = kCacheMagic;
+	header.version = kCacheVersion;
+	header.record_count = recordCount;
+	header.payload_crc = crc;
+	header.payload_size = payloadSize;
+	if (pwrite(fd, &header, sizeof(header), 0) != (ssize_t)sizeof(header))
+		RETURN_ERROR(errno);
+
+	return B_OK;
+}
+
+
+status_t
+MountStateCache::_ReadFile(int fd)
+{
+	struct stat st;
+	if (fstat(fd, &st) != 0)
+		RETURN_ERROR(errno);
+
+	if (st.st_size < (off_t)sizeof(mount_state_cache_header)
+		|| st.st_size > (off_t)kMaxCacheFileSize) {
+		RETURN_ERROR(B_BAD_DATA);
+	}
+
+	fData = (uint8*)malloc(st.st_size);
+	if (fData == NULL)
+		RETURN_ERROR(B_NO_MEMORY);
+	fDataSize = st.st_size;
+
+	ssize_t bytesRead = read(fd, fData, fDataSize);
+	if (bytesRead < 0)
+		RETURN_ERROR(errno);
+	if ((size_t)bytesRead != fDataSize)
+		RETURN_ERROR(B_BAD_DATA);
+
+	// check the header and the payload checksum
+	mount_state_cache_header header;
+	memcpy(&header, fData, sizeof(header));
+	if (header.magic != kCacheMagic || header.version != kCacheVersion
+		|| header.payload_size != fDataSize - sizeof(header)) {
+		RETURN_ERROR(B_BAD_DATA);
+	}
+
+	const uint8* payload = fData + sizeof(header);
+	if (crc32(crc32(0, NULL, 0), payload, header.payload_size)
+			!= header.payload_crc) {
+		RETURN_ERROR(B_BAD_DATA);
+	}
+
+	fRecordCount = header.record_count;
+	return B_OK;
+}
+
+
+status_t
+MountStateCache::_IndexRecords()
+{
+	size_t payloadSize = fDataSize - sizeof(mount_state_cache_header);
+	if ((size_t)fRecordCount > payloadSize / sizeof(uint32))
+		RETURN_ERROR(B_BAD_DATA);
+
+	if (fRecordCount == 0)
+		return B_OK;
+
+	fRecords = (Record*)malloc(sizeof(Record) * fRecordCount);
+	if (fRecords == NULL)
+		RETURN_ERROR(B_NO_MEMORY);
+
+	Reader reader(fData + sizeof(mount_state_cache_header), payloadSize);
+	for (int32 i = 0; i < fRecordCount; i++) {
+		uint32 recordSize;
+		if (!reader.Read(recordSize))
+			RETURN_ERROR(B_BAD_DATA);
+
+		const uint8* recordData = reader.Position();
+		if (!reader.Skip(recordSize))
+			RETURN_ERROR(B_BAD_DATA);
+
+		Record& record = fRecords[i];
+		Reader recordReader(recordData, recordSize);
+		int64 nodeID;
+		int64 size;
+		if (!recordReader.ReadString(record.fileName)
+			|| !recordReader.Read(nodeID) || !recordReader.Read(size)
+			|| !recordReader.Read(record.modifiedSeconds)
+			|| !recordReader.Read(record.modifiedNanoSeconds)) {
+			RETURN_ERROR(B_BAD_DATA);
+		}
+
+		record.nodeID = nodeID;
+		record.size = size;
+		record.data = recordReader.Position();
+		record.dataSize = recordData + recordSize - record.data;
+	}
+
+	if (!reader.IsAtEnd())
+		RETURN_ERROR(B_BAD_DATA);
+
+	qsort(fRecords, fRecordCount, sizeof(Record), &_CompareRecords);
+	return B_OK;
+}
+
+
+MountStateCache::Record*
+MountStateCache::_FindRecord(const char* fileName) const
+{
+	int32 lower = 0;
+	int32 upper = fRecordCount;
+	while (lower < upper) {
+		int32 mid = (lower + upper) / 2;
+		int compare = strcmp(fileName, fRecords[mid].fileName);
+		if (compare == 0)
+			return &fRecords[mid];
+		if (compare < 0)
+			upper = mid;
+		else
+			lower = mid + 1;
+	}
+
+	return NULL;
+}
+
+
+status_t
+MountStateCache::_ReadVersion(Reader& reader, ::Version*& _version)
+{
+	const char* major;
+	const char* minor;
+	const char* micro;
+	const char* preRelease;
+	uint32 revision;
+	if (!reader.ReadString(major) || !reader.ReadString(minor)
+		|| !reader.ReadString(micro) || !reader.ReadString(preRelease)
+		|| !reader.Read(revision)) {
+		RETURN_ERROR(B_BAD_DATA);
+	}
+
+	return Version::Create(major, minor, micro, preRelease, revision,
+		_version);
+}
+
+
+status_t
+MountStateCache::_ReadData(Reader& reader, PackageDataV2& data)
+{
+	uint8 encodedInline;
+	uint64 size;
+	if (!reader.Read(encodedInline) || !reader.Read(size))
+		RETURN_ERROR(B_BAD_DATA);
+
+	if (encodedInline != 0) {
+		uint8 inlineData[B_HPKG_MAX_INLINE_DATA_SIZE];
+		if (size > B_HPKG_MAX_INLINE_DATA_SIZE
+			|| !reader.Read(inlineData, size)) {
+			RETURN_ERROR(B_BAD_DATA);
+		}
+		data.SetData((uint8)size, inlineData);
+	} else {
+		uint64 offset;
+		if (!reader.Read(offset))
+			RETURN_ERROR(B_BAD_DATA);
+		data.SetData(size, offset);
+	}
+
+	return B_OK;
+}
+
+
+/*!	Reads \a count root nodes of \a package, and their descendents. The
+	directories whose children are still to be read are kept on an explicit
+	stack, so that deep hierarchies don't use up the kernel stack.
+*/
+status_t
+MountStateCache::_ReadNodes(Reader& reader, Package* package, uint32 count)
+{
+	struct level {
+		PackageDirectory*	directory;
+		uint32				remaining;
+	};
+
+	level* levels = (level*)malloc(sizeof(level) * kMaxNodeDepth);
+	if (levels == NULL)
+		RETURN_ERROR(B_NO_MEMORY);
+	MemoryDeleter levelsDeleter(levels);
+
+	PackageDirectory* parent = NULL;
+	uint32 remaining = count;
+	uint32 depth = 0;
+
+	while (true) {
+		if (remaining == 0) {
+			if (depth == 0)
+				return B_OK;
+
+			depth--;
+			parent = levels[depth].directory;
+			remaining = levels[depth].remaining;
+			continue;
+		}
+
+		remaining--;
+
+		PackageDirectory* directory;
+		uint32 childCount;
+		status_t error = _ReadNode(reader, package, parent, directory,
+			childCount);
+		if (error != B_OK)
+			RETURN_ERROR(error);
+
+		if (childCount == 0)
+			continue;
+
+		// continue with the children
+		if (depth == kMaxNodeDepth)
+			RETURN_ERROR(B_BAD_DATA);
+
+		levels[depth].directory = parent;
+		levels[depth].remaining = remaining;
+		depth++;
+
+		parent = directory;
+		remaining = childCount;
+	}
+}
+
+
+/*!	Reads a node and adds it to \a parent or, if \c NULL, as a root node to
+	\a package. If the node is a directory, it is returned in \a _directory,
+	and the number of its children, which follow it, in \a _childCount.
+*/
+status_t
+MountStateCache::_ReadNode(Reader& reader, Package* package,
+	PackageDirectory* parent, PackageDirectory*& _directory,
+	uint32& _childCount)
+{
+	_directory = NULL;
+	_childCount = 0;
+
+	uint32 mode;
+	String name;
+	timespec modifiedTime;
+	int64 seconds;
+	int64 nanoSeconds;
+	if (!reader.Read(mode) || !reader.ReadString(name)
+		|| !reader.Read(seconds) || !reader.Read(nanoSeconds)) {
+		RETURN_ERROR(B_BAD_DATA);
+	}
+	modifiedTime.tv_sec = seconds;
+	modifiedTime.tv_nsec = nanoSeconds;
+
+	// create the package node
+	PackageNode* node;
+	if (S_ISREG(mode)) {
+		PackageDataV2 data;
+		status_t error = _ReadData(reader, data);
+		if (error != B_OK)
+			RETURN_ERROR(error);
+
+		uint8 hasHash;
+		uint8 hash[FileContentTable::kHashSize];
+		if (!reader.Read(hasHash)
+			|| (hasHash != 0 && !reader.Read(hash, sizeof(hash)))) {
+			RETURN_ERROR(B_BAD_DATA);
+		}
+
+		PackageFile* file = new(package) PackageFile(package, mode,
+			PackageData(data));
+		if (file != NULL && hasHash != 0)
+			file->SetDataHash(hash);
+		node = file;
+	} else if (S_ISLNK(mode)) {
+		String path;
+		if (!reader.ReadString(path))
+			RETURN_ERROR(B_BAD_DATA);
+
+		PackageSymlink* symlink = new(package) PackageSymlink(package, mode);
+		if (symlink == NULL)
+			RETURN_ERROR(B_NO_MEMORY);
+
+		symlink->SetSymlinkPath(path);
+		node = symlink;
+	} else if (S_ISDIR(mode)) {
+		node = new(package) PackageDirectory(package, mode);
+	} else
+		RETURN_ERROR(B_BAD_DATA);
+
+	if (node == NULL)
+		RETURN_ERROR(B_NO_MEMORY);
+	BReference<PackageNode> nodeReference(node, true);
+
+	status_t error = node->Init(parent, name);
+	if (error != B_OK)
+		RETURN_ERROR(error);
+
+	node->SetModifiedTime(modifiedTime);
+
+	// attributes
+	uint32 count;
+	if (!reader.Read(count))
+		RETURN_ERROR(B_BAD_DATA);
+
+	for (uint32 i = 0; i < count; i++) {
+		String attributeName;
+		uint32 type;
+		PackageDataV2 data;
+		if (!reader.ReadString(attributeName) || !reader.Read(type))
+			RETURN_ERROR(B_BAD_DATA);
+
+		error = _ReadData(reader, data);
+		if (error != B_OK)
+			RETURN_ERROR(error);
+
+		error = node->AddAttribute(attributeName, type, PackageData(data));
+		if (error != B_OK)
+			RETURN_ERROR(error);
+	}
+
+	// add it to the parent directory
+	if (parent != NULL)
+		parent->AddChild(node);
+	else
+		package->AddNode(node);
+
+	// the number of children
+	if (PackageDirectory* directory = dynamic_cast<PackageDirectory*>(node)) {
+		if (!reader.Read(_childCount))
+			RETURN_ERROR(B_BAD_DATA);
+
+		_directory = directory;
+	}
+
+	return B_OK;
+}
+
+
+status_t
+MountStateCache::_WritePackage(Writer& writer, Package* package,
+	const struct stat& st)
+{
+	// key
+	status_t error;
+	if ((error = writer.WriteString(package->FileName())) != B_OK
+		|| (error = writer.Write((int64)st.st_ino)) != B_OK
+		|| (error = writer.Write((int64)st.st_size)) != B_OK
+		|| (error = writer.Write((int64)st.st_mtim.tv_sec)) != B_OK
+		|| (error = writer.Write((int64)st.st_mtim.tv_nsec)) != B_OK) {
+		RETURN_ERROR(error);
+	}
+
+	// package attributes
+	uint8 hasVersion = package->Version() != NULL ? 1 : 0;
+	if ((error = writer.WriteString(package->Name())) != B_OK
+		|| (error = writer.WriteString(package->InstallPath())) != B_OK
+		|| (error = writer.Write((uint32)package->Architecture())) != B_OK
+		|| (error = writer.Write(hasVersion)) != B_OK
+		|| (hasVersion != 0
+			&& (error = _WriteVersion(writer, package->Version())) != B_OK)) {
+		RETURN_ERROR(error);
+	}
+
+	// resolvables
+	const ResolvableList& resolvables = package->Resolvables();
+	if ((error = writer.Write((uint32)resolvables.Count())) != B_OK)
+		RETURN_ERROR(error);
+
+	for (ResolvableList::ConstIterator it = resolvables.GetIterator();
+		Resolvable* resolvable = it.Next();) {
+		uint8 flags = (resolvable->Version() != NULL ? 0x1 : 0)
+			| (resolvable->CompatibleVersion() != NULL ? 0x2 : 0);
+		if ((error = writer.WriteString(resolvable->Name())) != B_OK
+			|| (error = writer.Write(flags)) != B_OK
+			|| (resolvable->Version() != NULL
+				&& (error = _WriteVersion(writer, resolvable->Version()))
+					!= B_OK)
+			|| (resolvable->CompatibleVersion() != NULL
+				&& (error = _WriteVersion(writer,
+					resolvable->CompatibleVersion())) != B_OK)) {
+			RETURN_ERROR(error);
+		}
+	}
+
+	// dependencies
+	const DependencyList& dependencies = package->Dependencies();
+	if ((error = writer.Write((uint32)dependencies.Count())) != B_OK)
+		RETURN_ERROR(error);
+
+	for (DependencyList::ConstIterator it = dependencies.GetIterator();
+		Dependency* dependency = it.Next();) {
+		::Version* version = dependency->RequiredVersion();
+		uint8 hasOpAndVersion = version != NULL ? 1 : 0;
+		if ((error = writer.WriteString(dependency->Name())) != B_OK
+			|| (error = writer.Write(hasOpAndVersion)) != B_OK
+			|| (version != NULL
+				&& ((error = writer.Write(
+						(uint32)dependency->VersionOperator())) != B_OK
+					|| (error = _WriteVersion(writer, version)) != B_OK))) {
+			RETURN_ERROR(error);
+		}
+	}
+
+	// nodes
+	return _WriteNodes(writer, package->Nodes());
+}
+
+
+status_t
+MountStateCache::_WriteVersion(Writer& writer, const ::Version* version)
+{
+	status_t error;
+	if ((error = writer.WriteString(version->Major())) != B_OK
+		|| (error = writer.WriteString(version->Minor())) != B_OK
+		|| (error = writer.WriteString(version->Micro())) != B_OK
+		|| (error = writer.WriteString(version->PreRelease())) != B_OK
+		|| (error = writer.Write(version->Revision())) != B_OK) {
+		RETURN_ERROR(error);
+	}
+
+	return B_OK;
+}
+
+
+status_t
+MountStateCache::_WriteData(Writer& writer, const PackageData& data)
+{
+	if (data.Version() != 2)
+		RETURN_ERROR(B_BAD_VALUE);
+
+	const PackageDataV2& dataV2 = data.DataV2();
+	uint8 encodedInline = dataV2.IsEncodedInline() ? 1 : 0;
+	status_t error;
+	if ((error = writer.Write(encodedInline)) != B_OK
+		|| (error = writer.Write(dataV2.Size())) != B_OK) {
+		RETURN_ERROR(error);
+	}
+
+	if (encodedInline != 0)
+		error = writer.Write(dataV2.InlineData(), dataV2.Size());
+	else
+		error = writer.Write(dataV2.Offset());
+
+	return error;
+}
+
+
+/*!	Writes the nodes of \a list and their descendents, depth first. Like
+	_ReadNodes(), it uses an explicit stack, and refuses hierarchies that
+	would be too deep to be read again.
+*/
+status_t
+MountStateCache::_WriteNodes(Writer& writer, const PackageNodeList& list)
+{
+	struct level {
+		PackageNode**	nodes;
+		uint32			count;
+		uint32			index;
+	};
+
+	level* levels = (level*)malloc(sizeof(level) * (kMaxNodeDepth + 2));
+	if (levels == NULL)
+		RETURN_ERROR(B_NO_MEMORY);
+	MemoryDeleter levelsDeleter(levels);
+
+	uint32 depth = 0;
+	levels[0].index = 0;
+	status_t error = _WriteNodeList(writer, list, levels[0].nodes,
+		levels[0].count);
+	if (error != B_OK)
+		RETURN_ERROR(error);
+
+	while (true) {
+		level& current = levels[depth];
+		if (current.index == current.count) {
+			free(current.nodes);
+			if (depth == 0)
+				return B_OK;
+
+			depth--;
+			continue;
+		}
+
+		const PackageNode* node = current.nodes[current.index++];
+		error = _WriteNode(writer, node);
+		if (error != B_OK)
+			break;
+
+		const PackageDirectory* directory
+			= dynamic_cast<const PackageDirectory*>(node);
+		if (directory == NULL)
+			continue;
+
+		if (depth == kMaxNodeDepth && !directory->Children().IsEmpty()) {
+			// _ReadNodes() would refuse it
+			error = B_BAD_VALUE;
+			break;
+		}
+
+		depth++;
+		levels[depth].index = 0;
+		error = _WriteNodeList(writer, directory->Children(),
+			levels[depth].nodes, levels[depth].count);
+		if (error != B_OK) {
+			depth--;
+			break;
+		}
+	}
+
+	for (uint32 i = 0; i <= depth; i++)
+		free(levels[i].nodes);
+
+	RETURN_ERROR(error);
+}
+
+
+/*!	Writes the number of nodes in \a list, and returns them in reverse order
+	in \a _nodes, which the caller has to free. Nodes are prepended to the
+	lists when being added, so the order is restored when reading them.
+*/
+status_t
+MountStateCache::_WriteNodeList(Writer& writer, const PackageNodeList& list,
+	PackageNode**& _nodes, uint32& _count)
+{
+	uint32 count = list.Size();
+	status_t error = writer.Write(count);
+	if (error != B_OK)
+		RETURN_ERROR(error);
+
+	PackageNode** nodes = NULL;
+	if (count > 0) {
+		nodes = (PackageNode**)malloc(sizeof(PackageNode*) * count);
+		if (nodes == NULL)
+			RETURN_ERROR(B_NO_MEMORY);
+	}
+
+	uint32 index = count;
+	for (PackageNodeList::Iterator it = list.GetIterator();
+		PackageNode* node = it.Next();) {
+		nodes[--index] = node;
+	}
+
+	_nodes = nodes;
+	_count = count;
+	return B_OK;
+}
+
+
+status_t
+MountStateCache::_WriteNode(Writer& writer, const PackageNode* node)
+{
+	const timespec& modifiedTime = node->ModifiedTime();
+	status_t error;
+	if ((error = writer.Write((uint32)node->Mode())) != B_OK
+		|| (error = writer.WriteString(node->Name())) != B_OK
+		|| (error = writer.Write((int64)modifiedTime.tv_sec)) != B_OK
+		|| (error = writer.Write((int64)modifiedTime.tv_nsec)) != B_OK) {
+		RETURN_ERROR(error);
+	}
+
+	if (const PackageFile* file = dynamic_cast<const PackageFile*>(node)) {
+		const uint8* hash = file->DataHash();
+		uint8 hasHash = hash != NULL ? 1 : 0;
+		if ((error = _WriteData(writer, file->Data())) == B_OK
+			&& (error = writer.Write(hasHash)) == B_OK && hash != NULL) {
+			error = writer.Write(hash, FileContentTable::kHashSize);
+		}
+	} else if (const PackageSymlink* symlink
+			= dynamic_cast<const PackageSymlink*>(node)) {
+		error = writer.WriteString(symlink->SymlinkPath());
+	} else if (dynamic_cast<const PackageDirectory*>(node) == NULL)
+		error = B_BAD_VALUE;
+	if (error != B_OK)
+		RETURN_ERROR(error);
+
+	// attributes
+	if ((error = writer.Write(node->CountAttributes())) != B_OK)
+		RETURN_ERROR(error);
+
+	uint32 cookie = 0;
+	PackageNodeAttribute attribute;
+	while ((error = node->GetNextAttribute(cookie, attribute)) == B_OK) {
+		if ((error = writer.WriteString(attribute.Name())) != B_OK
+			|| (error = writer.Write(attribute.Type())) != B_OK
+			|| (error = _WriteData(writer, attribute.Data())) != B_OK) {
+			RETURN_ERROR(error);
+		}
+	}
+	if (error != B_ENTRY_NOT_FOUND)
+		RETURN_ERROR(error);
+
+	// the children are written by _WriteNodes()
+	return B_OK;
+}
+
+
+/*static*/ int
+MountStateCache::_CompareRecords(const void* _a, const void* _b)
+{
+	const Record* a = (const Record*)_a;
+	const Record* b = (const Record*)_b;
+	return strcmp(a->fileName, b->fileName);
+}
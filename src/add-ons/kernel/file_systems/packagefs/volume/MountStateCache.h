@@ -0,0 +1,98 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef MOUNT_STATE_CACHE_H
+#define MOUNT_STATE_CACHE_H
+
+
+#include <sys/stat.h>
+
+#include "Package.h"
+
+
+class PackageSettings;
+class PackagesDirectory;
+class Version;
+
+
+/*!	Persistent cache of the contents of the packages of a packages directory.
+
+	For each cached package the file stores the package attributes and the
+	complete node tree as read from the package's TOC, keyed by the package's
+	file name, node ID, size, and modification time. A package whose key
+	still matches can be loaded without parsing its TOC.
+
+	Only version 2 packages without package settings (i.e. without
+	blacklisted entries) are cached, so that the cached tree is always the
+	complete one.
+*/
+class MountStateCache {
+public:
+								MountStateCache();
+								~MountStateCache();
+
+			status_t			Init(PackagesDirectory* directory);
+									// a missing or invalid cache file isn't
+									// an error
+
+			status_t			ReadPackage(Package* package,
+									const struct stat& st,
+									const PackageSettings& settings);
+									// B_ENTRY_NOT_FOUND, if not cached
+
+			status_t			Write(const PackageFileNameHashTable& packages,
+									const PackageSettings& settings);
+									// no-op, if nothing changed
+
+			int32				HitCount() const	{ return fHitCount; }
+			int32				RecordCount() const	{ return fRecordCount; }
+
+private:
+			struct Record;
+			struct Reader;
+			struct Writer;
+
+private:
+			status_t			_ReadFile(int fd);
+			status_t			_IndexRecords();
+			Record*				_FindRecord(const char* fileName) const;
+
+			status_t			_ReadVersion(Reader& reader,
+									::Version*& _version);
+			status_t			_ReadData(Reader& reader,
+									PackageDataV2& data);
+			status_t			_ReadNodes(Reader& reader, Package* package,
+									uint32 count);
+			status_t			_ReadNode(Reader& reader, Package* package,
+									PackageDirectory* parent,
+									PackageDirectory*& _directory,
+									uint32& _childCount);
+
+			status_t			_WritePackage(Writer& writer, Package* package,
+									const struct stat& st);
+			status_t			_WriteVersion(Writer& writer,
+									const ::Version* version);
+			status_t			_WriteData(Writer& writer,
+									const PackageData& data);
+			status_t			_WriteNodes(Writer& writer,
+									const PackageNodeList& list);
+			status_t			_WriteNodeList(Writer& writer,
+									const PackageNodeList& list,
+									PackageNode**& _nodes, uint32& _count);
+			status_t			_WriteNode(Writer& writer,
+									const PackageNode* node);
+
+	static	int					_CompareRecords(const void* a, const void* b);
+
+private:
+			PackagesDirectory*	fPackagesDirectory;
+			uint8*				fData;
+			size_t				fDataSize;
+			Record*				fRecords;
+			int32				fRecordCount;
+			int32				fHitCount;
+};
+
+
+#endif	// MOUNT_STATE_CACHE_H
@@ -24,17 +24,22 @@
 #include <AutoDeleter.h>
 #include <PackagesDirectoryDefs.h>
 
+#include <smp.h>
 #include <vfs.h>
 
 #include "AttributeIndex.h"
 #include "DebugSupport.h"
+#include "FileContentTable.h"
+#include "HeapChunkCache.h"
 #include "kernel_interface.h"
 #include "LastModifiedIndex.h"
+#include "MountStateCache.h"
 #include "NameIndex.h"
 #include "OldUnpackingNodeAttributes.h"
 #include "PackageFSRoot.h"
 #include "PackageLinkDirectory.h"
 #include "PackageLinksDirectory.h"
+#include "PackageNodeArena.h"
 #include "Resolvable.h"
 #include "SizeIndex.h"
 #include "UnpackingLeafNode.h"
@@ -61,6 +66,9 @@ const size_t kMaxActivationRequestSize = 10 * 1024 * 1024;
 // sanity limit for activation file size
 const size_t kMaxActivationFileSize = 10 * 1024 * 1024;
 
+// maximum number of threads loading the initial packages
+static const int32 kMaxPackageLoaderThreads = 8;
+
 static const char* const kAdministrativeDirectoryName
 	= PACKAGES_DIRECTORY_ADMIN_DIRECTORY;
 static const char* const kActivationFileName
@@ -159,6 +167,143 @@ private:
 };
 
 
+// #pragma mark - InitialPackageLoader
+
+
+/*!	Loads a list of packages in parallel. Reading and parsing the packages is
+	independent of the volume state, only adding them to the volume has to
+	happen serially, which is left to the caller.
+*/
+struct Volume::InitialPackageLoader {
+public:
+	InitialPackageLoader(Volume* volume, PackagesDirectory* packagesDirectory)
+		:
+		fVolume(volume),
+		fPackagesDirectory(packagesDirectory),
+		fJobs(NULL),
+		fJobCount(0),
+		fJobCapacity(0),
+		fNextJob(0)
+	{
+	}
+
+	~InitialPackageLoader()
+	{
+		for (int32 i = 0; i < fJobCount; i++) {
+			free(fJobs[i].name);
+			if (fJobs[i].package != NULL)
+				fJobs[i].package->ReleaseReference();
+		}
+
+		free(fJobs);
+	}
+
+	status_t AddPackage(const char* name)
+	{
+		if (fJobCount == fJobCapacity) {
+			int32 capacity = fJobCapacity > 0 ? fJobCapacity * 2 : 64;
+			Job* jobs = (Job*)realloc(fJobs, sizeof(Job) * capacity);
+			if (jobs == NULL)
+				RETURN_ERROR(B_NO_MEMORY);
+
+			fJobs = jobs;
+			fJobCapacity = capacity;
+		}
+
+		Job& job = fJobs[fJobCount];
+		job.name = strdup(name);
+		if (job.name == NULL)
+			RETURN_ERROR(B_NO_MEMORY);
+		job.package = NULL;
+		job.error = B_NO_INIT;
+
+		fJobCount++;
+		return B_OK;
+	}
+
+	/*!	Loads all packages. The calling thread helps out, so if no threads
+		can be spawned, the packages are simply loaded one after another.
+	*/
+	void Load()
+	{
+		thread_id threads[kMaxPackageLoaderThreads];
+		int32 threadCount = min_c(min_c(smp_get_num_cpus(),
+			kMaxPackageLoaderThreads), fJobCount) - 1;
+		for (int32 i = 0; i < threadCount; i++) {
+			threads[i] = spawn_kernel_thread(&_LoaderThread,
+				"packagefs package loader", B_NORMAL_PRIORITY, this);
+			if (threads[i] < 0) {
+				threadCount = i;
+				break;
+			}
+			resume_thread(threads[i]);
+		}
+
+		_LoadPackages();
+
+		for (int32 i = 0; i < threadCount; i++)
+			wait_for_thread(threads[i], NULL);
+	}
+
+	int32 CountPackages() const
+	{
+		return fJobCount;
+	}
+
+	const char* NameAt(int32 index) const
+	{
+		return fJobs[index].name;
+	}
+
+	status_t ErrorAt(int32 index) const
+	{
+		return fJobs[index].error;
+	}
+
+	Package* PackageAt(int32 index) const
+	{
+		return fJobs[index].package;
+	}
+
+private:
+	struct Job {
+		char*		name;
+		Package*	package;
+		status_t	error;
+	};
+
+private:
+	void _LoadPackages()
+	{
+		for (;;) {
+			int32 index = atomic_add(&fNextJob, 1);
+			if (index >= fJobCount)
+				break;
+
+			Job& job = fJobs[index];
+			job.error = fVolume->_LoadPackage(fPackagesDirectory, job.name,
+				job.package);
+			if (job.error != B_OK)
+				job.package = NULL;
+		}
+	}
+
+	static status_t _LoaderThread(void* _self)
+	{
+		((InitialPackageLoader*)_self)->_LoadPackages();
+		return B_OK;
+	}
+
+private:
+	Volume*				fVolume;
+	PackagesDirectory*	fPackagesDirectory;
+	Job*				fJobs;
+	int32				fJobCount;
+	int32				fJobCapacity;
+	int32				fNextJob;
+};
+
+
 // #pragma mark - Volume
 
 
@@ -171,6 +316,7 @@ Volume::Volume(fs_volume* fsVolume)
 	fPackagesDirectories(),
 	fPackagesDirectoriesByNodeRef(),
 	fPackageSettings(),
+	fMountStateCache(NULL),
 	fNextNodeID(kRootDirectoryID + 1)
 {
 	rw_lock_init(&fLock, "packagefs volume");
@@ -558,6 +704,42 @@ Volume::IOCtl(Node* node, uint32 operation, void* buffer, size_t size)
 			return _ChangeActivation(request);
 		}
 
+		case PACKAGE_FS_OPERATION_GET_CHUNK_CACHE_STATS:
+		{
+			if (size < sizeof(PackageFSChunkCacheStats))
+				RETURN_ERROR(B_BAD_VALUE);
+
+			PackageFSChunkCacheStats stats;
+			HeapChunkCache::Default()->GetStats(stats);
+
+			RETURN_ERROR(user_memcpy(buffer, &stats, sizeof(stats)));
+		}
+
+		case PACKAGE_FS_OPERATION_GET_FILE_CONTENT_STATS:
+		{
+			if (size < sizeof(PackageFSFileContentStats))
+				RETURN_ERROR(B_BAD_VALUE);
+
+			PackageFSFileContentStats stats;
+			FileContentTable::Default()->GetStats(stats);
+
+			RETURN_ERROR(user_memcpy(buffer, &stats, sizeof(stats)));
+		}
+
+		case PACKAGE_FS_OPERATION_GET_NODE_MEMORY_STATS:
+		{
+			if (size < sizeof(PackageFSNodeMemoryStats))
+				RETURN_ERROR(B_BAD_VALUE);
+
+			PackageFSNodeMemoryStats stats;
+			{
+				VolumeReadLocker volumeReadLocker(this);
+				_GetNodeMemoryStats(stats);
+			}
+
+			RETURN_ERROR(user_memcpy(buffer, &stats, sizeof(stats)));
+		}
+
 		default:
 			return B_BAD_VALUE;
 	}
@@ -742,6 +924,63 @@ Volume::_LoadOldPackagesStates(const char* packagesState)
 
 status_t
 Volume::_AddInitialPackages()
+{
+	bigtime_t startTime = system_time();
+
+	// The packages of the latest state can be loaded from the mount state
+	// cache instead of parsing their TOCs.
+	MountStateCache mountStateCache;
+	status_t error = mountStateCache.Init(fPackagesDirectory);
+	if (error != B_OK)
+		RETURN_ERROR(error);
+
+	fMountStateCache = &mountStateCache;
+	error = _LoadInitialPackages();
+	fMountStateCache = NULL;
+	if (error != B_OK)
+		RETURN_ERROR(error);
+
+	INFORM("Loaded %" B_PRIuSIZE " packages (%" B_PRId32 " from cache) in %"
+		B_PRIdBIGTIME " ms\n", fPackages.CountElements(),
+		mountStateCache.HitCount(), (system_time() - startTime) / 1000);
+
+	PackageFSNodeMemoryStats stats;
+	_GetNodeMemoryStats(stats);
+	INFORM("%" B_PRIu64 " package nodes use %" B_PRIu64 " KiB, their %"
+		B_PRIu64 " attributes %" B_PRIu64 " KiB\n", stats.nodeCount,
+		stats.nodeMemory / 1024, stats.attributeCount,
+		stats.attributeMemory / 1024);
+
+	// update the cache -- failing to do so, e.g. on a read-only volume, is
+	// not a problem
+	error = mountStateCache.Write(fPackages, fPackageSettings);
+	if (error != B_OK) {
+		INFORM("Failed to write the packagefs cache: %s\n",
+			strerror(error));
+	}
+
+	// add the packages to the node tree
+	VolumeWriteLocker systemVolumeLocker(_SystemVolumeIfNotSelf());
+	VolumeWriteLocker volumeLocker(this);
+	for (PackageFileNameHashTable::Iterator it = fPackages.GetIterator();
+		Package* package = it.Next();) {
+		error = _AddPackageContent(package, false);
+		if (error != B_OK) {
+			for (it.Rewind(); Package* activePackage = it.Next();) {
+				if (activePackage == package)
+					break;
+				_RemovePackageContent(activePackage, NULL, false);
+			}
+			RETURN_ERROR(error);
+		}
+	}
+
+	return B_OK;
+}
+
+
+status_t
+Volume::_LoadInitialPackages()
 {
 	PackagesDirectory* packagesDirectory = fPackagesDirectories.Last();
 	INFORM("Adding packages from \"%s\"\n", packagesDirectory->Path());
@@ -785,22 +1024,6 @@ Volume::_AddInitialPackages()
 			RETURN_ERROR(error);
 	}
 
-	// add the packages to the node tree
-	VolumeWriteLocker systemVolumeLocker(_SystemVolumeIfNotSelf());
-	VolumeWriteLocker volumeLocker(this);
-	for (PackageFileNameHashTable::Iterator it = fPackages.GetIterator();
-		Package* package = it.Next();) {
-		error = _AddPackageContent(package, false);
-		if (error != B_OK) {
-			for (it.Rewind(); Package* activePackage = it.Next();) {
-				if (activePackage == package)
-					break;
-				_RemovePackageContent(activePackage, NULL, false);
-			}
-			RETURN_ERROR(error);
-		}
-	}
-
 	return B_OK;
 }
 
@@ -854,6 +1077,7 @@ Volume::_AddInitialPackagesFromActivationFile(
 	fileContent[st.st_size] = '\0';
 
 	// parse the file and add the respective packages
+	InitialPackageLoader loader(this, packagesDirectory);
 	const char* packageName = fileContent;
 	char* const fileContentEnd = fileContent + st.st_size;
 	while (packageName < fileContentEnd) {
@@ -873,15 +1097,14 @@ Volume::_AddInitialPackagesFromActivationFile(
 			RETURN_ERROR(B_BAD_DATA);
 		}
 
-		status_t error = _LoadAndAddInitialPackage(packagesDirectory,
-			packageName);
+		status_t error = loader.AddPackage(packageName);
 		if (error != B_OK)
 			RETURN_ERROR(error);
 
 		packageName = packageNameEnd + 1;
 	}
 
-	return B_OK;
+	return _LoadAndAddInitialPackages(loader, true);
 }
 
 
@@ -903,6 +1126,7 @@ Volume::_AddInitialPackagesFromDirectory()
 	}
 	CObjectDeleter<DIR, int> dirCloser(dir, closedir);
 
+	InitialPackageLoader loader(this, fPackagesDirectory);
 	while (dirent* entry = readdir(dir)) {
 		// skip "." and ".."
 		if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0)
@@ -915,28 +1139,41 @@ Volume::_AddInitialPackagesFromDirectory()
 			continue;
 		}
 
-		_LoadAndAddInitialPackage(fPackagesDirectory, entry->d_name);
+		status_t error = loader.AddPackage(entry->d_name);
+		if (error != B_OK)
+			RETURN_ERROR(error);
 	}
 
-	return B_OK;
+	return _LoadAndAddInitialPackages(loader, false);
 }
 
 
+/*!	Loads the packages of \a loader in parallel and adds them to the volume
+	in the order they have been added to the loader. If \a stopOnError is
+	\c true, the first package that failed to load ends the operation.
+*/
 status_t
-Volume::_LoadAndAddInitialPackage(PackagesDirectory* packagesDirectory,
-	const char* name)
+Volume::_LoadAndAddInitialPackages(InitialPackageLoader& loader,
+	bool stopOnError)
 {
-	Package* package;
-	status_t error = _LoadPackage(packagesDirectory, name, package);
-	if (error != B_OK) {
-		ERROR("Failed to load package \"%s\": %s\n", name, strerror(error));
-		RETURN_ERROR(error);
-	}
-	BReference<Package> packageReference(package, true);
+	loader.Load();
 
 	VolumeWriteLocker systemVolumeLocker(_SystemVolumeIfNotSelf());
 	VolumeWriteLocker volumeLocker(this);
-	_AddPackage(package);
+
+	int32 count = loader.CountPackages();
+	for (int32 i = 0; i < count; i++) {
+		status_t error = loader.ErrorAt(i);
+		if (error != B_OK) {
+			ERROR("Failed to load package \"%s\": %s\n", loader.NameAt(i),
+				strerror(error));
+			if (stopOnError)
+				RETURN_ERROR(error);
+			continue;
+		}
+
+		_AddPackage(loader.PackageAt(i));
+	}
 
 	return B_OK;
 }
@@ -970,6 +1207,29 @@ Volume::_RemoveAllPackages()
 }
 
 
+/*!	Sums up the memory used by the nodes of all packages.
+	The caller must hold the volume's lock.
+*/
+void
+Volume::_GetNodeMemoryStats(PackageFSNodeMemoryStats& stats)
+{
+	memset(&stats, 0, sizeof(stats));
+
+	for (PackageFileNameHashTable::Iterator it = fPackages.GetIterator();
+			Package* package = it.Next();) {
+		PackageNodeArena* arena = package->NodeArena();
+		if (arena == NULL)
+			continue;
+
+		stats.packageCount++;
+		stats.nodeCount += arena->NodeCount();
+		stats.attributeCount += arena->AttributeCount();
+		stats.nodeMemory += arena->NodeMemorySize();
+		stats.attributeMemory += arena->AttributeMemorySize();
+	}
+}
+
+
 inline Package*
 Volume::_FindPackage(const char* fileName) const
 {
@@ -1485,7 +1745,19 @@ Volume::_LoadPackage(PackagesDirectory* packagesDirectory, const char* name,
 	if (error != B_OK)
 		return error;
 
-	error = package->Load(fPackageSettings);
+	// try the mount state cache first
+	error = B_ENTRY_NOT_FOUND;
+	if (fMountStateCache != NULL && packagesDirectory == fPackagesDirectory) {
+		error = package->LoadFromCache(*fMountStateCache, st,
+			fPackageSettings);
+		if (error != B_OK && error != B_ENTRY_NOT_FOUND) {
+			WARN("Failed to load package \"%s\" from cache: %s\n", name,
+				strerror(error));
+		}
+	}
+
+	if (error != B_OK)
+		error = package->Load(fPackageSettings);
 	if (error != B_OK)
 		return error;
 
@@ -27,6 +27,7 @@
 
 
 class Directory;
+class MountStateCache;
 class PackageFSRoot;
 class PackagesDirectory;
 class UnpackingNode;
@@ -108,22 +109,26 @@ private:
 private:
 			struct ShineThroughDirectory;
 			struct ActivationChangeRequest;
+			struct InitialPackageLoader;
 
 private:
 			status_t			_LoadOldPackagesStates(
 									const char* packagesState);
 
 			status_t			_AddInitialPackages();
+			status_t			_LoadInitialPackages();
 			status_t			_AddInitialPackagesFromActivationFile(
 									PackagesDirectory* packagesDirectory);
 			status_t			_AddInitialPackagesFromDirectory();
-			status_t			_LoadAndAddInitialPackage(
-									PackagesDirectory* packagesDirectory,
-									const char* name);
+			status_t			_LoadAndAddInitialPackages(
+									InitialPackageLoader& loader,
+									bool stopOnError);
 
 	inline	void				_AddPackage(Package* package);
 	inline	void				_RemovePackage(Package* package);
 			void				_RemoveAllPackages();
+			void				_GetNodeMemoryStats(
+									PackageFSNodeMemoryStats& stats);
 	inline	Package*			_FindPackage(const char* fileName) const;
 
 			status_t			_AddPackageContent(Package* package,
@@ -189,6 +194,9 @@ private:
 			PackagesDirectoryList fPackagesDirectories;
 			PackagesDirectoryHashTable fPackagesDirectoriesByNodeRef;
 			PackageSettings		fPackageSettings;
+			MountStateCache*	fMountStateCache;
+									// only set while adding the initial
+									// packages
 
 			struct {
 				dev_t			deviceID;
@@ -604,6 +604,8 @@ net_device_module_info sDialUpModule = {
 	dialup_set_media,
 	dialup_add_multicast,
 	dialup_remove_multicast,
+	NULL, // receive_queue_count
+	NULL, // receive_queue_data
 };
 
 module_info* modules[] = {
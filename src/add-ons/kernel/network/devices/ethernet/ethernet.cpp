@@ -481,6 +481,8 @@ net_device_module_info sEthernetModule = {
 	ethernet_set_media,
 	ethernet_add_multicast,
 	ethernet_remove_multicast,
+	NULL, // receive_queue_count
+	NULL, // receive_queue_data
 };
 
 module_info *modules[] = {
@@ -185,6 +185,8 @@ net_device_module_info sLoopbackModule = {
 	loopback_set_media,
 	loopback_add_multicast,
 	loopback_remove_multicast,
+	NULL, // receive_queue_count
+	NULL, // receive_queue_data
 };
 
 module_info *modules[] = {
@@ -1325,8 +1325,10 @@ ipv6_send_routed_data(net_protocol* _protocol, struct net_route* route,
 	ip6_sprintf(&destination.sin6_addr, addrbuf);
 	TRACE_SK(protocol, "  SendRoutedData(): destination: %s", addrbuf);
 
+	// buffers with a segment size are cut into segments that fit the MTU
+	// by the datalink layer
 	uint32 mtu = route->mtu ? route->mtu : interface->mtu;
-	if (buffer->size > mtu) {
+	if (buffer->size > mtu && buffer->segment_size == 0) {
 		// we need to fragment the packet
 		return send_fragments(protocol, route, buffer, mtu);
 	}
@@ -0,0 +1,310 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+#include "BBRCongestionControl.h"
+
+#include <string.h>
+
+#include <KernelExport.h>
+
+
+static const uint32 kStartupGain = 2885;
+	// 2 / ln(2), doubles the window each round
+static const uint32 kDrainGain = 1000 * 1000 / kStartupGain;
+static const uint32 kCycleGains[] = {
+	1250, 750, 1000, 1000, 1000, 1000, 1000, 1000
+};
+static const uint32 kCycleLength = sizeof(kCycleGains) / sizeof(uint32);
+
+static const uint32 kFullBandwidthRounds = 3;
+static const uint32 kMinWindowSegments = 4;
+static const bigtime_t kMinRoundTripTimeWindow = 10000000;
+static const bigtime_t kProbeRoundTripTimeDuration = 200000;
+
+
+BBRCongestionControl::BBRCongestionControl()
+{
+	Init(0, 0, 0);
+}
+
+
+const char*
+BBRCongestionControl::Name() const
+{
+	return "bbr";
+}
+
+
+void
+BBRCongestionControl::Init(uint32 maxSegmentSize, uint32 congestionWindow,
+	uint32 slowStartThreshold)
+{
+	CongestionControl::Init(maxSegmentSize, congestionWindow,
+		slowStartThreshold);
+
+	fState = STATE_STARTUP;
+	fGain = kStartupGain;
+	fCycleIndex = 0;
+
+	memset(fBandwidth, 0, sizeof(fBandwidth));
+	fRound = 0;
+	fDelivered = 0;
+	fRoundEnd = 0;
+	fRoundStartDelivered = 0;
+	fRoundStart = 0;
+
+	fFullBandwidth = 0;
+	fFullBandwidthRounds = 0;
+	fFullPipe = false;
+
+	fMinRoundTripTime = 0;
+	fMinRoundTripTimeStamp = 0;
+	fProbeRoundTripTimeEnd = 0;
+	fPriorWindow = 0;
+}
+
+
+void
+BBRCongestionControl::Acknowledged(const tcp_congestion_sample& sample)
+{
+	fDelivered += sample.delivered;
+
+	bool minExpired = false;
+	if (sample.round_trip_time > 0)
+		minExpired = _UpdateRoundTripTime(sample.round_trip_time, sample.now);
+
+	bool roundEnded = _UpdateBandwidth(sample);
+	_UpdateState(sample, roundEnded, minExpired);
+	_UpdateWindow(sample);
+}
+
+
+/*!	Losses are no congestion signal to the model, the window is kept. As
+	long as there is no model, the window is reduced like in Reno, though.
+*/
+void
+BBRCongestionControl::LossDetected(uint32 flightSize)
+{
+	if (_BandwidthDelayProduct() == 0) {
+		CongestionControl::LossDetected(flightSize);
+		return;
+	}
+
+	fSlowStartThreshold = fCongestionWindow;
+}
+
+
+void
+BBRCongestionControl::RecoveryFinished()
+{
+	if (_BandwidthDelayProduct() == 0)
+		CongestionControl::RecoveryFinished();
+}
+
+
+void
+BBRCongestionControl::RetransmitTimeout(uint32 flightSize)
+{
+	fSlowStartThreshold = fCongestionWindow;
+	fCongestionWindow = fMaxSegmentSize;
+}
+
+
+void
+BBRCongestionControl::Dump() const
+{
+	static const char* const kStates[] = {
+		"startup", "drain", "probe bandwidth", "probe round trip time"
+	};
+
+	CongestionControl::Dump();
+
+	kprintf("    state: %s, gain %" B_PRIu32 "/1000, full pipe: %d\n",
+		kStates[fState], fGain, fFullPipe);
+	kprintf("    bandwidth: %" B_PRIu64 " bytes/s, round %" B_PRIu32 "\n",
+		_MaxBandwidth(), fRound);
+	kprintf("    min round trip time: %" B_PRId64 "\n", fMinRoundTripTime);
+	kprintf("    bandwidth delay product: %" B_PRIu32 "\n",
+		_BandwidthDelayProduct());
+}
+
+
+/*!	Returns \c true if the minimum round trip time hasn't been seen for too
+	long; the minimum is replaced with the current sample then.
+*/
+bool
+BBRCongestionControl::_UpdateRoundTripTime(bigtime_t roundTripTime,
+	bigtime_t now)
+{
+	bool expired = fMinRoundTripTimeStamp != 0
+		&& now - fMinRoundTripTimeStamp > kMinRoundTripTimeWindow;
+
+	if (fMinRoundTripTime == 0 || roundTripTime <= fMinRoundTripTime
+		|| expired) {
+		fMinRoundTripTime = roundTripTime;
+		fMinRoundTripTimeStamp = now;
+	}
+
+	return expired;
+}
+
+
+/*!	A round ends when everything that was in flight at its start has been
+	delivered. The data delivered during the round is a bandwidth sample.
+	As the data in flight is only known after an acknowledgement, a round
+	lasts at least a round trip as well.
+	Returns \c true if a round has ended.
+*/
+bool
+BBRCongestionControl::_UpdateBandwidth(const tcp_congestion_sample& sample)
+{
+	if (fDelivered < fRoundEnd
+		|| sample.now - fRoundStart < fMinRoundTripTime)
+		return false;
+
+	bool roundEnded = false;
+	bigtime_t duration = sample.now - fRoundStart;
+	if (fRoundStart != 0 && duration > 0) {
+		fRound++;
+		fBandwidth[fRound % BBR_BANDWIDTH_ROUNDS]
+			= (fDelivered - fRoundStartDelivered) * 1000000 / duration;
+		roundEnded = true;
+	}
+
+	fRoundStart = sample.now;
+	fRoundStartDelivered = fDelivered;
+	fRoundEnd = fDelivered + sample.in_flight;
+	return roundEnded;
+}
+
+
+void
+BBRCongestionControl::_UpdateState(const tcp_congestion_sample& sample,
+	bool roundEnded, bool minExpired)
+{
+	if (roundEnded) {
+		if (!fFullPipe) {
+			// the pipe is full when the bandwidth stops growing by a quarter
+			uint64 bandwidth = _MaxBandwidth();
+			if (bandwidth >= fFullBandwidth * 5 / 4) {
+				fFullBandwidth = bandwidth;
+				fFullBandwidthRounds = 0;
+			} else if (++fFullBandwidthRounds >= kFullBandwidthRounds)
+				fFullPipe = true;
+		}
+
+		if (fState == STATE_STARTUP && fFullPipe)
+			_SetState(STATE_DRAIN);
+		else if (fState == STATE_PROBE_BANDWIDTH) {
+			fCycleIndex = (fCycleIndex + 1) % kCycleLength;
+			fGain = kCycleGains[fCycleIndex];
+		}
+	}
+
+	if (fState == STATE_DRAIN && sample.in_flight <= _BandwidthDelayProduct())
+		_SetState(STATE_PROBE_BANDWIDTH);
+
+	if (minExpired && fState != STATE_PROBE_ROUND_TRIP_TIME) {
+		// empty the queue for a moment to see the real minimum
+		fPriorWindow = fCongestionWindow;
+		fProbeRoundTripTimeEnd = 0;
+		_SetState(STATE_PROBE_ROUND_TRIP_TIME);
+	}
+
+	if (fState == STATE_PROBE_ROUND_TRIP_TIME) {
+		if (fProbeRoundTripTimeEnd == 0) {
+			if (sample.in_flight <= kMinWindowSegments * fMaxSegmentSize) {
+				fProbeRoundTripTimeEnd = sample.now
+					+ kProbeRoundTripTimeDuration;
+			}
+		} else if (sample.now >= fProbeRoundTripTimeEnd) {
+			fMinRoundTripTimeStamp = sample.now;
+			if (fCongestionWindow < fPriorWindow)
+				fCongestionWindow = fPriorWindow;
+			_SetState(fFullPipe ? STATE_PROBE_BANDWIDTH : STATE_STARTUP);
+		}
+	}
+}
+
+
+void
+BBRCongestionControl::_UpdateWindow(const tcp_congestion_sample& sample)
+{
+	uint32 minWindow = kMinWindowSegments * fMaxSegmentSize;
+
+	if (fState == STATE_PROBE_ROUND_TRIP_TIME) {
+		fCongestionWindow = min_c(fCongestionWindow, minWindow);
+		return;
+	}
+
+	uint32 bandwidthDelayProduct = _BandwidthDelayProduct();
+	if (bandwidthDelayProduct == 0) {
+		// no model yet, grow like Reno
+		if (fCongestionWindow < fSlowStartThreshold || fCongestionWindow == 0)
+			fCongestionWindow += sample.delivered;
+		else {
+			fCongestionWindow += max_c((uint64)sample.delivered
+				* fMaxSegmentSize / fCongestionWindow, 1);
+		}
+		return;
+	}
+
+	uint32 target = (uint64)bandwidthDelayProduct * fGain / 1000;
+	if (sample.in_recovery) {
+		// don't send more than what left the network
+		target = min_c(target, sample.in_flight + sample.delivered);
+	}
+	target = max_c(target, minWindow);
+
+	fCongestionWindow = min_c(fCongestionWindow + sample.delivered, target);
+}
+
+
+void
+BBRCongestionControl::_SetState(int32 state)
+{
+	fState = state;
+
+	switch (state) {
+		case STATE_STARTUP:
+			fGain = kStartupGain;
+			break;
+		case STATE_DRAIN:
+			fGain = kDrainGain;
+			break;
+		case STATE_PROBE_BANDWIDTH:
+			fCycleIndex = 0;
+			fGain = kCycleGains[0];
+			break;
+		case STATE_PROBE_ROUND_TRIP_TIME:
+			fGain = 1000;
+			break;
+	}
+}
+
+
+uint64
+BBRCongestionControl::_MaxBandwidth() const
+{
+	uint64 bandwidth = 0;
+	for (int32 i = 0; i < BBR_BANDWIDTH_ROUNDS; i++) {
+		if (fBandwidth[i] > bandwidth)
+			bandwidth = fBandwidth[i];
+	}
+
+	return bandwidth;
+}
+
+
+uint32
+BBRCongestionControl::_BandwidthDelayProduct() const
+{
+	uint64 product = _MaxBandwidth() * fMinRoundTripTime / 1000000;
+	if (product > UINT32_MAX)
+		return UINT32_MAX;
+
+	return (uint32)product;
+}
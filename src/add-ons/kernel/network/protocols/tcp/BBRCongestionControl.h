@@ -0,0 +1,90 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef BBR_CONGESTION_CONTROL_H
+#define BBR_CONGESTION_CONTROL_H
+
+
+#include "CongestionControl.h"
+
+
+#define BBR_BANDWIDTH_ROUNDS	10
+
+
+/*!	A model based algorithm after BBR: instead of reacting to losses, it
+	measures the bottleneck bandwidth and the minimum round trip time, and
+	keeps about their product in flight. This leaves the queue at the
+	bottleneck empty, where loss based algorithms fill it.
+
+	The stack doesn't pace its segments, so the model only limits the
+	congestion window; the gains of the probing cycle are applied to it.
+	Until there is a model, the window behaves like in Reno.
+*/
+class BBRCongestionControl : public CongestionControl {
+public:
+								BBRCongestionControl();
+
+	virtual	const char*			Name() const;
+
+	virtual	void				Init(uint32 maxSegmentSize,
+									uint32 congestionWindow,
+									uint32 slowStartThreshold);
+
+	virtual	void				Acknowledged(
+									const tcp_congestion_sample& sample);
+	virtual	void				LossDetected(uint32 flightSize);
+	virtual	void				RecoveryFinished();
+	virtual	void				RetransmitTimeout(uint32 flightSize);
+
+	virtual	void				Dump() const;
+
+private:
+			enum {
+				STATE_STARTUP,
+				STATE_DRAIN,
+				STATE_PROBE_BANDWIDTH,
+				STATE_PROBE_ROUND_TRIP_TIME
+			};
+
+private:
+			bool				_UpdateRoundTripTime(bigtime_t roundTripTime,
+									bigtime_t now);
+			bool				_UpdateBandwidth(
+									const tcp_congestion_sample& sample);
+			void				_UpdateState(
+									const tcp_congestion_sample& sample,
+									bool roundEnded, bool minExpired);
+			void				_UpdateWindow(
+									const tcp_congestion_sample& sample);
+			void				_SetState(int32 state);
+
+			uint64				_MaxBandwidth() const;
+			uint32				_BandwidthDelayProduct() const;
+
+private:
+			int32				fState;
+			uint32				fGain;
+									// in 1/1000
+			uint32				fCycleIndex;
+
+			uint64				fBandwidth[BBR_BANDWIDTH_ROUNDS];
+									// bytes per second, for each round
+			uint32				fRound;
+			uint64				fDelivered;
+			uint64				fRoundEnd;
+			uint64				fRoundStartDelivered;
+			bigtime_t			fRoundStart;
+
+			uint64				fFullBandwidth;
+			uint32				fFullBandwidthRounds;
+			bool				fFullPipe;
+
+			bigtime_t			fMinRoundTripTime;
+			bigtime_t			fMinRoundTripTimeStamp;
+			bigtime_t			fProbeRoundTripTimeEnd;
+			uint32				fPriorWindow;
+};
+
+
+#endif	// BBR_CONGESTION_CONTROL_H
@@ -9,6 +9,8 @@
 
 #include "BufferQueue.h"
 
+#include <string.h>
+
 #include <KernelExport.h>
 
 
@@ -436,6 +438,65 @@ BufferQueue::SetPushPointer()
 		fPushPointer = fList.Tail()->sequence + fList.Tail()->size;
 }
 
+
+/*!	Fills \a sacks with the ranges of data that have been received after a
+	gap, in network byte order as they are sent in the SACK option (RFC 2018).
+	The range containing \a first, the most recently received segment, is
+	reported first, the others follow in sequence order.
+	Returns the number of ranges stored.
+*/
+int32
+BufferQueue::GetSackBlocks(tcp_sack* sacks, int32 maxCount,
+	tcp_sequence first) const
+{
+	int32 count = 0;
+	bool haveFirst = false;
+	tcp_sequence next = NextSequence();
+	tcp_sequence start = 0;
+	tcp_sequence end = 0;
+
+	SegmentList::ConstIterator iterator = fList.GetIterator();
+	while (true) {
+		net_buffer* buffer = iterator.Next();
+		if (buffer != NULL) {
+			tcp_sequence bufferEnd = buffer->sequence + buffer->size;
+			if (bufferEnd <= next)
+				continue;
+
+			if (start != end && buffer->sequence <= end) {
+				// the range continues
+				if (bufferEnd > end)
+					end = bufferEnd;
+				continue;
+			}
+		}
+
+		if (start != end) {
+			// add the range we just completed
+			tcp_sack sack;
+			sack.left_edge = htonl(start.Number());
+			sack.right_edge = htonl(end.Number());
+
+			if (!haveFirst && first >= start && first < end) {
+				int32 moveCount = min_c(count, maxCount - 1);
+				memmove(sacks + 1, sacks, moveCount * sizeof(tcp_sack));
+				sacks[0] = sack;
+				count = moveCount + 1;
+				haveFirst = true;
+			} else if (count < maxCount)
+				sacks[count++] = sack;
+		}
+
+		if (buffer == NULL)
+			break;
+
+		start = buffer->sequence;
+		end = buffer->sequence + buffer->size;
+	}
+
+	return count;
+}
+
 #if DEBUG_BUFFER_QUEUE
 
 /*!	Perform a sanity check of the whole queue.
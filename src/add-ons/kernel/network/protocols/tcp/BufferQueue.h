@@ -36,6 +36,8 @@ public:
 									size_t bytes);
 			status_t			Get(size_t bytes, bool remove,
 									net_buffer** _buffer);
+			int32				GetSackBlocks(tcp_sack* sacks,
+									int32 maxCount, tcp_sequence first) const;
 
 			size_t				Available() const { return fContiguousBytes; }
 			size_t				Available(tcp_sequence sequence) const;
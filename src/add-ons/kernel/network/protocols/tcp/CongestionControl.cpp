@@ -0,0 +1,152 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+#include "CongestionControl.h"
+
+#include <string.h>
+
+#include <new>
+
+#include <KernelExport.h>
+
+#include "BBRCongestionControl.h"
+#include "CubicCongestionControl.h"
+#include "NewRenoCongestionControl.h"
+
+
+template<typename Algorithm>
+static CongestionControl*
+create_algorithm()
+{
+	return new(std::nothrow) Algorithm;
+}
+
+
+static const struct {
+	const char*			name;
+	CongestionControl*	(*create)();
+} kAlgorithms[] = {
+	{"newreno", create_algorithm<NewRenoCongestionControl>},
+	{"cubic", create_algorithm<CubicCongestionControl>},
+	{"bbr", create_algorithm<BBRCongestionControl>},
+};
+static const int32 kAlgorithmCount
+	= sizeof(kAlgorithms) / sizeof(kAlgorithms[0]);
+
+static int32 sDefaultAlgorithm = 0;
+
+
+static int32
+find_algorithm(const char* name)
+{
+	for (int32 i = 0; i < kAlgorithmCount; i++) {
+		if (strcmp(kAlgorithms[i].name, name) == 0)
+			return i;
+	}
+
+	return -1;
+}
+
+
+// #pragma mark -
+
+
+CongestionControl::CongestionControl()
+	:
+	fMaxSegmentSize(0),
+	fCongestionWindow(0),
+	fSlowStartThreshold(0)
+{
+}
+
+
+CongestionControl::~CongestionControl()
+{
+}
+
+
+/*!	Creates an instance of the algorithm with the given \a name, or of the
+	default algorithm if \a name is \c NULL.
+	Returns \c NULL if there is no such algorithm, or not enough memory.
+*/
+/*static*/ CongestionControl*
+CongestionControl::Create(const char* name)
+{
+	int32 index = name != NULL ? find_algorithm(name) : sDefaultAlgorithm;
+	if (index < 0)
+		return NULL;
+
+	return kAlgorithms[index].create();
+}
+
+
+/*static*/ status_t
+CongestionControl::SetDefault(const char* name)
+{
+	int32 index = find_algorithm(name);
+	if (index < 0)
+		return B_NAME_NOT_FOUND;
+
+	sDefaultAlgorithm = index;
+	return B_OK;
+}
+
+
+/*static*/ const char*
+CongestionControl::Default()
+{
+	return kAlgorithms[sDefaultAlgorithm].name;
+}
+
+
+/*!	Called when the connection is established, and when the algorithm
+	replaces another one.
+*/
+void
+CongestionControl::Init(uint32 maxSegmentSize, uint32 congestionWindow,
+	uint32 slowStartThreshold)
+{
+	fMaxSegmentSize = maxSegmentSize;
+	fCongestionWindow = congestionWindow;
+	fSlowStartThreshold = slowStartThreshold;
+}
+
+
+/*!	A segment has been lost, and the endpoint starts to retransmit. The
+	window is reduced once per window of data, the endpoint doesn't call
+	this method again until RecoveryFinished().
+*/
+void
+CongestionControl::LossDetected(uint32 flightSize)
+{
+	fSlowStartThreshold = max_c(flightSize / 2, 2 * fMaxSegmentSize);
+	fCongestionWindow = fSlowStartThreshold;
+}
+
+
+void
+CongestionControl::RecoveryFinished()
+{
+	if (fCongestionWindow > fSlowStartThreshold)
+		fCongestionWindow = fSlowStartThreshold;
+}
+
+
+void
+CongestionControl::RetransmitTimeout(uint32 flightSize)
+{
+	fSlowStartThreshold = max_c(flightSize / 2, 2 * fMaxSegmentSize);
+	fCongestionWindow = fMaxSegmentSize;
+}
+
+
+void
+CongestionControl::Dump() const
+{
+	kprintf("  congestion control: %s\n", Name());
+	kprintf("  congestion window: %" B_PRIu32 "\n", fCongestionWindow);
+	kprintf("  slow start threshold: %" B_PRIu32 "\n", fSlowStartThreshold);
+}
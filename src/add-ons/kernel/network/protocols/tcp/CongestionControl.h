@@ -0,0 +1,70 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef CONGESTION_CONTROL_H
+#define CONGESTION_CONTROL_H
+
+
+#include <OS.h>
+
+
+struct tcp_congestion_sample {
+	bigtime_t	now;
+	uint32		acknowledged;
+		// bytes newly acknowledged cumulatively
+	uint32		delivered;
+		// bytes newly known to have arrived, including SACKed ones
+	uint32		in_flight;
+	bigtime_t	round_trip_time;
+		// 0 if this acknowledgement doesn't provide a sample
+	bool		in_recovery;
+};
+
+
+/*!	Base class of the congestion control algorithms. The endpoint reports
+	the events of the connection, and sends no more than CongestionWindow()
+	bytes before they are acknowledged.
+
+	The base class implements the reactions of RFC 5681 to losses, which
+	subclasses may change.
+*/
+class CongestionControl {
+public:
+								CongestionControl();
+	virtual						~CongestionControl();
+
+	static	CongestionControl*	Create(const char* name = NULL);
+	static	status_t			SetDefault(const char* name);
+	static	const char*			Default();
+
+	virtual	const char*			Name() const = 0;
+
+	virtual	void				Init(uint32 maxSegmentSize,
+									uint32 congestionWindow,
+									uint32 slowStartThreshold);
+
+	virtual	void				Acknowledged(
+									const tcp_congestion_sample& sample) = 0;
+	virtual	void				LossDetected(uint32 flightSize);
+	virtual	void				RecoveryFinished();
+	virtual	void				RetransmitTimeout(uint32 flightSize);
+
+			void				InflateWindow(uint32 bytes)
+									{ fCongestionWindow += bytes; }
+
+			uint32				CongestionWindow() const
+									{ return fCongestionWindow; }
+			uint32				SlowStartThreshold() const
+									{ return fSlowStartThreshold; }
+
+	virtual	void				Dump() const;
+
+protected:
+			uint32				fMaxSegmentSize;
+			uint32				fCongestionWindow;
+			uint32				fSlowStartThreshold;
+};
+
+
+#endif	// CONGESTION_CONTROL_H
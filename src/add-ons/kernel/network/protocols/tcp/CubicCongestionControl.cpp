@@ -0,0 +1,185 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+#include "CubicCongestionControl.h"
+
+#include <KernelExport.h>
+
+
+// The window is reduced to 7/10 on a loss, and grows by
+// 0.4 * (t - K)^3 segments, with t in seconds.
+static const uint32 kBetaNumerator = 7;
+static const uint32 kBetaDenominator = 10;
+static const int64 kMaxCubicTime = 100000;
+	// in milliseconds, keeps the cube in range
+
+
+static uint64
+cube_root(uint64 value)
+{
+	uint64 low = 0;
+	uint64 high = 1 << 21;
+	while (low < high) {
+		uint64 middle = (low + high + 1) / 2;
+		if (middle * middle * middle <= value)
+			low = middle;
+		else
+			high = middle - 1;
+	}
+
+	return low;
+}
+
+
+CubicCongestionControl::CubicCongestionControl()
+	:
+	fMaxWindow(0),
+	fOriginWindow(0),
+	fRenoWindow(0),
+	fEpochStart(0),
+	fTimeToOrigin(0),
+	fMinRoundTripTime(0)
+{
+}
+
+
+const char*
+CubicCongestionControl::Name() const
+{
+	return "cubic";
+}
+
+
+void
+CubicCongestionControl::Init(uint32 maxSegmentSize, uint32 congestionWindow,
+	uint32 slowStartThreshold)
+{
+	CongestionControl::Init(maxSegmentSize, congestionWindow,
+		slowStartThreshold);
+
+	fMaxWindow = 0;
+	fEpochStart = 0;
+}
+
+
+void
+CubicCongestionControl::Acknowledged(const tcp_congestion_sample& sample)
+{
+	if (sample.round_trip_time > 0 && (fMinRoundTripTime == 0
+			|| sample.round_trip_time < fMinRoundTripTime))
+		fMinRoundTripTime = sample.round_trip_time;
+
+	if (sample.acknowledged == 0)
+		return;
+
+	if (fCongestionWindow < fSlowStartThreshold) {
+		fCongestionWindow += min_c(sample.acknowledged, fMaxSegmentSize);
+		return;
+	}
+
+	if (sample.in_recovery)
+		return;
+
+	if (fEpochStart == 0) {
+		// the first congestion avoidance step after a reduction
+		fEpochStart = sample.now;
+		fRenoWindow = fCongestionWindow;
+
+		if (fCongestionWindow < fMaxWindow) {
+			uint64 segments1000 = (uint64)(fMaxWindow - fCongestionWindow)
+				* 1000 / fMaxSegmentSize;
+			fTimeToOrigin = cube_root(segments1000 * 2500000);
+			fOriginWindow = fMaxWindow;
+		} else {
+			fTimeToOrigin = 0;
+			fOriginWindow = fCongestionWindow;
+		}
+	}
+
+	// Reno grows by 3 * (1 - beta) / (1 + beta) = 9/17 segments per round
+	// trip with this beta
+	fRenoWindow += (uint64)9 * sample.acknowledged * fMaxSegmentSize
+		/ (17 * (uint64)fCongestionWindow);
+
+	uint32 target = _CubicWindow(sample.now + fMinRoundTripTime);
+	if (target < fRenoWindow)
+		target = fRenoWindow;
+	if (target > fCongestionWindow + fCongestionWindow / 2)
+		target = fCongestionWindow + fCongestionWindow / 2;
+
+	if (target > fCongestionWindow) {
+		fCongestionWindow += (uint64)(target - fCongestionWindow)
+			* sample.acknowledged / fCongestionWindow;
+	}
+}
+
+
+void
+CubicCongestionControl::LossDetected(uint32 flightSize)
+{
+	_Reduce();
+	fCongestionWindow = fSlowStartThreshold;
+}
+
+
+void
+CubicCongestionControl::RetransmitTimeout(uint32 flightSize)
+{
+	_Reduce();
+	fCongestionWindow = fMaxSegmentSize;
+}
+
+
+void
+CubicCongestionControl::Dump() const
+{
+	CongestionControl::Dump();
+
+	kprintf("    max window: %" B_PRIu32 "\n", fMaxWindow);
+	kprintf("    epoch start: %" B_PRId64 ", K: %" B_PRId64 " ms\n",
+		fEpochStart, fTimeToOrigin);
+	kprintf("    reno window: %" B_PRIu32 "\n", fRenoWindow);
+	kprintf("    min round trip time: %" B_PRId64 "\n", fMinRoundTripTime);
+}
+
+
+void
+CubicCongestionControl::_Reduce()
+{
+	fEpochStart = 0;
+
+	// Fast convergence: if the window didn't even reach the previous
+	// maximum, another flow probably joined, and we leave it some room.
+	if (fCongestionWindow < fMaxWindow) {
+		fMaxWindow = (uint64)fCongestionWindow
+			* (kBetaDenominator + kBetaNumerator) / (2 * kBetaDenominator);
+	} else
+		fMaxWindow = fCongestionWindow;
+
+	fSlowStartThreshold = max_c((uint64)fCongestionWindow * kBetaNumerator
+		/ kBetaDenominator, 2 * fMaxSegmentSize);
+}
+
+
+//!	Returns the window the cubic function wants at \a time.
+uint32
+CubicCongestionControl::_CubicWindow(bigtime_t time) const
+{
+	int64 offset = (time - fEpochStart) / 1000 - fTimeToOrigin;
+	if (offset > kMaxCubicTime)
+		offset = kMaxCubicTime;
+	else if (offset < -kMaxCubicTime)
+		offset = -kMaxCubicTime;
+
+	int64 window = fOriginWindow
+		+ offset * offset * offset / 10000 * 4 * fMaxSegmentSize / 1000000;
+	if (window < 2 * (int64)fMaxSegmentSize)
+		return 2 * fMaxSegmentSize;
+	if (window > UINT32_MAX)
+		return UINT32_MAX;
+
+	return (uint32)window;
+}
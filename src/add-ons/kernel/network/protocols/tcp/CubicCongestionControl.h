@@ -0,0 +1,51 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef CUBIC_CONGESTION_CONTROL_H
+#define CUBIC_CONGESTION_CONTROL_H
+
+
+#include "CongestionControl.h"
+
+
+/*!	CUBIC (RFC 9438): after a loss, the window grows along a cubic curve
+	that returns quickly to the window the loss happened at, stays there for
+	a while, and then probes for more bandwidth. The growth doesn't depend
+	on the round trip time, which lets it use long fat pipes.
+*/
+class CubicCongestionControl : public CongestionControl {
+public:
+								CubicCongestionControl();
+
+	virtual	const char*			Name() const;
+
+	virtual	void				Init(uint32 maxSegmentSize,
+									uint32 congestionWindow,
+									uint32 slowStartThreshold);
+
+	virtual	void				Acknowledged(
+									const tcp_congestion_sample& sample);
+	virtual	void				LossDetected(uint32 flightSize);
+	virtual	void				RetransmitTimeout(uint32 flightSize);
+
+	virtual	void				Dump() const;
+
+private:
+			void				_Reduce();
+			uint32				_CubicWindow(bigtime_t time) const;
+
+private:
+			uint32				fMaxWindow;
+									// the window before the last reduction
+			uint32				fOriginWindow;
+			uint32				fRenoWindow;
+									// what Reno would have reached
+			bigtime_t			fEpochStart;
+			bigtime_t			fTimeToOrigin;
+									// the "K" of the RFC, in milliseconds
+			bigtime_t			fMinRoundTripTime;
+};
+
+
+#endif	// CUBIC_CONGESTION_CONTROL_H
@@ -214,18 +214,40 @@ EndpointHashDefinition::GetLink(TCPEndpoint* endpoint) const
 //	#pragma mark -
 
 
+EndpointManager::ConnectionShard::ConnectionShard(EndpointManager* manager)
+	:
+	table(manager)
+{
+	rw_lock_init(&lock, "TCP connections");
+}
+
+
+EndpointManager::ConnectionShard::~ConnectionShard()
+{
+	rw_lock_destroy(&lock);
+}
+
+
+//	#pragma mark -
+
+
 EndpointManager::EndpointManager(net_domain* domain)
 	:
 	fDomain(domain),
-	fConnectionHash(this),
 	fLastPort(kFirstEphemeralPort)
 {
 	rw_lock_init(&fLock, "TCP endpoint manager");
+
+	for (uint32 i = 0; i < kShardCount; i++)
+		fConnectionShards[i] = NULL;
 }
 
 
 EndpointManager::~EndpointManager()
 {
+	for (uint32 i = 0; i < kShardCount; i++)
+		delete fConnectionShards[i];
+
 	rw_lock_destroy(&fLock);
 }
 
@@ -233,25 +255,58 @@ EndpointManager::~EndpointManager()
 status_t
 EndpointManager::Init()
 {
-	status_t status = fConnectionHash.Init();
-	if (status == B_OK)
-		status = fEndpointHash.Init();
+	for (uint32 i = 0; i < kShardCount; i++) {
+		fConnectionShards[i] = new(std::nothrow) ConnectionShard(this);
+		if (fConnectionShards[i] == NULL)
+			return B_NO_MEMORY;
 
-	return status;
+		status_t status = fConnectionShards[i]->table.Init();
+		if (status != B_OK)
+			return status;
+	}
+
+	return fEndpointHash.Init();
 }
 
 
 //	#pragma mark - connections
 
 
-/*!	Returns the endpoint matching the connection.
-	You must hold the manager's lock when calling this method (either read or
-	write).
+/*!	Returns the shard a connection between \a local and \a peer belongs
+	to. Its lock must be held to access the table.
+*/
+EndpointManager::ConnectionShard&
+EndpointManager::_ShardFor(const sockaddr* local, const sockaddr* peer) const
+{
+	uint32 hash = ConstSocketAddress(AddressModule(), local).HashPair(peer);
+
+	// The tables use the lower bits of the hash, so we pick the shard
+	// with the upper bits of a multiplicative hash.
+	return *fConnectionShards[(hash * 2654435761U) >> (32 - kShardBits)];
+}
+
+
+EndpointManager::ConnectionShard&
+EndpointManager::_ShardFor(TCPEndpoint* endpoint) const
+{
+	return _ShardFor(*endpoint->LocalAddress(), *endpoint->PeerAddress());
+}
+
+
+/*!	Returns the endpoint matching the connection with a reference to its
+	socket, or \c NULL.
 */
 TCPEndpoint*
-EndpointManager::_LookupConnection(const sockaddr* local, const sockaddr* peer)
+EndpointManager::_FindConnection(const sockaddr* local, const sockaddr* peer)
 {
-	return fConnectionHash.Lookup(std::make_pair(local, peer));
+	ConnectionShard& shard = _ShardFor(local, peer);
+	ReadLocker _(shard.lock);
+
+	TCPEndpoint* endpoint = shard.table.Lookup(std::make_pair(local, peer));
+	if (endpoint != NULL && gSocketModule->acquire_socket(endpoint->socket))
+		return endpoint;
+
+	return NULL;
 }
 
 
@@ -261,7 +316,8 @@ EndpointManager::SetConnection(TCPEndpoint* endpoint, const sockaddr* _local,
 {
 	TRACE(("EndpointManager::SetConnection(%p)\n", endpoint));
 
-	WriteLocker _(fLock);
+	// the local address of a bound endpoint is about to change
+	ReadLocker _(fLock);
 
 	SocketAddressStorage local(AddressModule());
 	local.SetTo(_local);
@@ -272,14 +328,17 @@ EndpointManager::SetConnection(TCPEndpoint* endpoint, const sockaddr* _local,
 		local.SetPort(port);
 	}
 
-	if (_LookupConnection(*local, peer) != NULL)
+	ConnectionShard& shard = _ShardFor(*local, peer);
+	WriteLocker shardLocker(shard.lock);
+
+	if (shard.table.Lookup(std::make_pair(*local, peer)) != NULL)
 		return EADDRINUSE;
 
 	endpoint->LocalAddress().SetTo(*local);
 	endpoint->PeerAddress().SetTo(peer);
 	T(Connect(endpoint));
 
-	fConnectionHash.Insert(endpoint);
+	shard.table.Insert(endpoint);
 	return B_OK;
 }
 
@@ -302,26 +361,30 @@ EndpointManager::SetPassive(TCPEndpoint* endpoint)
 	SocketAddressStorage passive(AddressModule());
 	passive.SetToEmpty();
 
-	if (_LookupConnection(*endpoint->LocalAddress(), *passive))
+	ConnectionShard& shard = _ShardFor(*endpoint->LocalAddress(), *passive);
+	WriteLocker shardLocker(shard.lock);
+
+	if (shard.table.Lookup(std::make_pair(*endpoint->LocalAddress(),
+			*passive)) != NULL)
 		return EADDRINUSE;
 
 	endpoint->PeerAddress().SetTo(*passive);
-	fConnectionHash.Insert(endpoint);
+	shard.table.Insert(endpoint);
 	return B_OK;
 }
 
 
+/*!	Finds the endpoint an incoming segment belongs to. Only the shards
+	that are looked at are locked, and only for reading.
+*/
 TCPEndpoint*
 EndpointManager::FindConnection(sockaddr* local, sockaddr* peer)
 {
-	ReadLocker _(fLock);
-
-	TCPEndpoint *endpoint = _LookupConnection(local, peer);
+	TCPEndpoint *endpoint = _FindConnection(local, peer);
 	if (endpoint != NULL) {
 		TRACE(("TCP: Received packet corresponds to explicit endpoint %p\n",
 			endpoint));
-		if (gSocketModule->acquire_socket(endpoint->socket))
-			return endpoint;
+		return endpoint;
 	}
 
 	// no explicit endpoint exists, check for wildcard endpoints
@@ -329,24 +392,22 @@ EndpointManager::FindConnection(sockaddr* local, sockaddr* peer)
 	SocketAddressStorage wildcard(AddressModule());
 	wildcard.SetToEmpty();
 
-	endpoint = _LookupConnection(local, *wildcard);
+	endpoint = _FindConnection(local, *wildcard);
 	if (endpoint != NULL) {
 		TRACE(("TCP: Received packet corresponds to wildcard endpoint %p\n",
 			endpoint));
-		if (gSocketModule->acquire_socket(endpoint->socket))
-			return endpoint;
+		return endpoint;
 	}
 
 	SocketAddressStorage localWildcard(AddressModule());
 	localWildcard.SetToEmpty();
 	localWildcard.SetPort(AddressModule()->get_port(local));
 
-	endpoint = _LookupConnection(*localWildcard, *wildcard);
+	endpoint = _FindConnection(*localWildcard, *wildcard);
 	if (endpoint != NULL) {
 		TRACE(("TCP: Received packet corresponds to local wildcard endpoint "
 			"%p\n", endpoint));
-		if (gSocketModule->acquire_socket(endpoint->socket))
-			return endpoint;
+		return endpoint;
 	}
 
 	// no matching endpoint exists
@@ -520,7 +581,9 @@ EndpointManager::Unbind(TCPEndpoint* endpoint)
 	if (!fEndpointHash.Remove(endpoint))
 		panic("bound endpoint %p not in hash!", endpoint);
 
-	fConnectionHash.Remove(endpoint);
+	ConnectionShard& shard = _ShardFor(endpoint);
+	WriteLocker shardLocker(shard.lock);
+	shard.table.Remove(endpoint);
 
 	(*endpoint->LocalAddress())->sa_len = 0;
 
@@ -573,18 +636,23 @@ EndpointManager::Dump() const
 	kprintf("%10s %21s %21s %8s %8s %12s\n", "address", "local", "peer",
 		"recv-q", "send-q", "state");
 
-	ConnectionTable::Iterator iterator = fConnectionHash.GetIterator();
+	for (uint32 i = 0; i < kShardCount; i++) {
+		ConnectionTable::Iterator iterator
+			= fConnectionShards[i]->table.GetIterator();
 
-	while (iterator.HasNext()) {
-		TCPEndpoint *endpoint = iterator.Next();
+		while (iterator.HasNext()) {
+			TCPEndpoint *endpoint = iterator.Next();
 
-		char localBuf[64], peerBuf[64];
-		endpoint->LocalAddress().AsString(localBuf, sizeof(localBuf), true);
-		endpoint->PeerAddress().AsString(peerBuf, sizeof(peerBuf), true);
+			char localBuf[64], peerBuf[64];
+			endpoint->LocalAddress().AsString(localBuf, sizeof(localBuf),
+				true);
+			endpoint->PeerAddress().AsString(peerBuf, sizeof(peerBuf), true);
 
-		kprintf("%p %21s %21s %8lu %8lu %12s\n", endpoint, localBuf, peerBuf,
-			endpoint->fReceiveQueue.Available(), endpoint->fSendQueue.Used(),
-			name_for_state(endpoint->State()));
+			kprintf("%p %21s %21s %8lu %8lu %12s\n", endpoint, localBuf,
+				peerBuf, endpoint->fReceiveQueue.Available(),
+				endpoint->fSendQueue.Used(),
+				name_for_state(endpoint->State()));
+		}
 	}
 }
 
@@ -95,7 +95,28 @@ public:
 			void			Dump() const;
 
 private:
-			TCPEndpoint*	_LookupConnection(const sockaddr* local,
+	typedef BOpenHashTable<ConnectionHashDefinition> ConnectionTable;
+	typedef MultiHashTable<EndpointHashDefinition> EndpointTable;
+
+	/*!	The connections are spread over several tables with their own
+		locks, so that connections being established or closed only hold
+		up the lookups of incoming segments in one of them.
+	*/
+	struct ConnectionShard {
+							ConnectionShard(EndpointManager* manager);
+							~ConnectionShard();
+
+		rw_lock				lock;
+		ConnectionTable		table;
+	};
+
+	static	const uint32	kShardBits = 4;
+	static	const uint32	kShardCount = 1 << kShardBits;
+
+			ConnectionShard& _ShardFor(const sockaddr* local,
+								const sockaddr* peer) const;
+			ConnectionShard& _ShardFor(TCPEndpoint* endpoint) const;
+			TCPEndpoint*	_FindConnection(const sockaddr* local,
 								const sockaddr* peer);
 			status_t		_Bind(TCPEndpoint* endpoint,
 								const sockaddr* address);
@@ -104,12 +125,10 @@ private:
 			status_t		_BindToEphemeral(TCPEndpoint* endpoint,
 								const sockaddr* address);
 
-	typedef BOpenHashTable<ConnectionHashDefinition> ConnectionTable;
-	typedef MultiHashTable<EndpointHashDefinition> EndpointTable;
-
 	rw_lock					fLock;
+		// protects the endpoint hash and fLastPort
 	net_domain*				fDomain;
-	ConnectionTable			fConnectionHash;
+	ConnectionShard*		fConnectionShards[kShardCount];
 	EndpointTable			fEndpointHash;
 	uint16					fLastPort;
 };
@@ -0,0 +1,37 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+#include "NewRenoCongestionControl.h"
+
+
+const char*
+NewRenoCongestionControl::Name() const
+{
+	return "newreno";
+}
+
+
+void
+NewRenoCongestionControl::Acknowledged(const tcp_congestion_sample& sample)
+{
+	if (sample.acknowledged == 0)
+		return;
+
+	if (fCongestionWindow < fSlowStartThreshold)
+		fCongestionWindow += fMaxSegmentSize;
+
+	if (fCongestionWindow >= fSlowStartThreshold && !sample.in_recovery) {
+		// grow by about one segment per round trip
+		uint32 increment = fMaxSegmentSize * fMaxSegmentSize;
+
+		if (increment < fCongestionWindow)
+			increment = 1;
+		else
+			increment /= fCongestionWindow;
+
+		fCongestionWindow += increment;
+	}
+}
@@ -0,0 +1,22 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef NEW_RENO_CONGESTION_CONTROL_H
+#define NEW_RENO_CONGESTION_CONTROL_H
+
+
+#include "CongestionControl.h"
+
+
+//!	Slow start and congestion avoidance as in RFC 5681.
+class NewRenoCongestionControl : public CongestionControl {
+public:
+	virtual	const char*			Name() const;
+
+	virtual	void				Acknowledged(
+									const tcp_congestion_sample& sample);
+};
+
+
+#endif	// NEW_RENO_CONGESTION_CONTROL_H
@@ -0,0 +1,375 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+#include "SackScoreboard.h"
+
+#include <new>
+
+#include <KernelExport.h>
+
+
+SackScoreboard::SackScoreboard()
+	:
+	fInFlight(0),
+	fDelivered(0),
+	fMinRoundTripTime(B_INFINITE_TIMEOUT),
+	fRackSent(0),
+	fRackEnd(0),
+	fRackRoundTripTime(0)
+{
+}
+
+
+SackScoreboard::~SackScoreboard()
+{
+	Clear();
+}
+
+
+/*!	Records that the data between \a start and \a end has been sent. Data
+	that was sent before is considered retransmitted.
+	\a now must not be earlier than in previous calls.
+*/
+void
+SackScoreboard::SegmentSent(tcp_sequence start, tcp_sequence end,
+	bigtime_t now)
+{
+	Segment* last = fSegments.Tail();
+	if (last != NULL && start < last->end) {
+		Segment* segment;
+		Segment* next;
+		status_t status = _SplitAt(start, segment);
+		if (status == B_OK)
+			status = _SplitAt(end, next);
+
+		// If splitting failed, the segments are only partially covered by
+		// the retransmission, and stay lost, so that all of their data is
+		// sent again.
+		while (segment != NULL && segment->start < end) {
+			if (segment->start >= start
+				&& (status == B_OK || segment->end <= end)) {
+				segment->sent = now;
+				_SetFlags(segment,
+					(segment->flags | SEGMENT_RETRANSMITTED) & ~SEGMENT_LOST);
+			}
+			segment = fSegments.GetNext(segment);
+		}
+
+		last = fSegments.Tail();
+		if (end <= last->end)
+			return;
+
+		start = last->end;
+	}
+
+	if (start >= end)
+		return;
+
+	Segment* segment = new(std::nothrow) Segment;
+	if (segment == NULL) {
+		// track the data as part of the previous segment
+		if (last == NULL)
+			return;
+
+		if (last->InFlight()) {
+			fInFlight += (end - last->end).Number();
+			fSentSegments.Remove(last);
+			fSentSegments.Add(last);
+		}
+		last->end = end;
+		last->sent = now;
+		return;
+	}
+
+	segment->start = start;
+	segment->end = end;
+	segment->sent = now;
+	segment->flags = 0;
+
+	fSegments.Add(segment);
+	fSegmentTree.Insert(segment);
+	fSentSegments.Add(segment);
+	fInFlight += segment->Size();
+}
+
+
+//!	Removes everything before \a sequence, the peer has received it.
+void
+SackScoreboard::Acknowledge(tcp_sequence sequence, bigtime_t now)
+{
+	while (Segment* segment = fSegments.Head()) {
+		if (segment->start >= sequence)
+			break;
+
+		if (segment->end > sequence) {
+			// partially acknowledged
+			if ((segment->flags & SEGMENT_SACKED) == 0)
+				fDelivered += (sequence - segment->start).Number();
+			if (segment->InFlight())
+				fInFlight -= (sequence - segment->start).Number();
+			segment->start = sequence;
+			break;
+		}
+
+		if ((segment->flags & SEGMENT_SACKED) == 0)
+			_Delivered(segment, now);
+
+		_SetFlags(segment, SEGMENT_SACKED);
+		_Remove(segment);
+	}
+}
+
+
+//!	Marks the range reported in a SACK block as received.
+void
+SackScoreboard::SelectiveAcknowledge(tcp_sequence start, tcp_sequence end,
+	bigtime_t now)
+{
+	if (start >= end)
+		return;
+
+	Segment* segment;
+	Segment* next;
+	if (_SplitAt(start, segment) == B_OK)
+		_SplitAt(end, next);
+
+	// If splitting failed, the segments are only partially covered by the
+	// block, and are left alone.
+	while (segment != NULL && segment->end <= end) {
+		if (segment->start >= start
+			&& (segment->flags & SEGMENT_SACKED) == 0) {
+			_Delivered(segment, now);
+			_SetFlags(segment,
+				(segment->flags | SEGMENT_SACKED) & ~SEGMENT_LOST);
+		}
+		segment = fSegments.GetNext(segment);
+	}
+}
+
+
+/*!	Marks the segments as lost that were sent before the most recently sent
+	segment that has been delivered, if more than the round trip time of that
+	segment plus a reordering window has passed since.
+	Returns the number of newly lost segments. \a _timeout is set to the time
+	after which the next segment will be lost, if it's not delivered until
+	then, or 0 if there is no such segment.
+*/
+uint32
+SackScoreboard::DetectLosses(bigtime_t now, bigtime_t& _timeout)
+{
+	_timeout = 0;
+	if (fRackSent == 0)
+		return 0;
+
+	// RFC 8985 proposes a quarter of the minimum round trip time
+	bigtime_t reorderWindow = fMinRoundTripTime != B_INFINITE_TIMEOUT
+		? fMinRoundTripTime / 4 : 0;
+
+	uint32 count = 0;
+
+	// All segments after the first one that isn't lost yet were sent later,
+	// and won't be lost earlier either.
+	while (Segment* segment = fSentSegments.Head()) {
+		if (segment->sent > fRackSent
+			|| (segment->sent == fRackSent && segment->end >= fRackEnd))
+			break;
+
+		bigtime_t remaining = segment->sent + fRackRoundTripTime
+			+ reorderWindow - now;
+		if (remaining > 0) {
+			_timeout = remaining;
+			break;
+		}
+
+		// this removes it from the list
+		_SetFlags(segment, segment->flags | SEGMENT_LOST);
+		count++;
+	}
+
+	return count;
+}
+
+
+/*!	Called when the retransmission timer fires; everything in flight is
+	considered lost. The SACK information is dropped as well, as the peer is
+	allowed to discard data it reported (RFC 2018).
+*/
+void
+SackScoreboard::MarkAllLost()
+{
+	SegmentList::Iterator iterator = fSegments.GetIterator();
+	while (Segment* segment = iterator.Next()) {
+		_SetFlags(segment,
+			(segment->flags & ~SEGMENT_SACKED) | SEGMENT_LOST);
+	}
+}
+
+
+//!	Returns the range of the first segment that needs to be retransmitted.
+bool
+SackScoreboard::GetLost(tcp_sequence& _start, tcp_sequence& _end) const
+{
+	LostSegmentTree::ConstIterator iterator = fLostSegments.GetIterator();
+	const Segment* segment = iterator.Next();
+	if (segment == NULL)
+		return false;
+
+	_start = segment->start;
+	_end = segment->end;
+	return true;
+}
+
+
+void
+SackScoreboard::Clear()
+{
+	while (Segment* segment = fSegments.Head())
+		_Remove(segment);
+
+	fInFlight = 0;
+	fRackSent = 0;
+	fRackEnd = 0;
+	fRackRoundTripTime = 0;
+}
+
+
+void
+SackScoreboard::Dump() const
+{
+	int32 count = 0;
+	int32 sacked = 0;
+	int32 lost = 0;
+
+	SegmentList::ConstIterator iterator = fSegments.GetIterator();
+	while (Segment* segment = iterator.Next()) {
+		count++;
+		if ((segment->flags & SEGMENT_SACKED) != 0)
+			sacked++;
+		if ((segment->flags & SEGMENT_LOST) != 0)
+			lost++;
+	}
+
+	kprintf("    scoreboard: %" B_PRId32 " segments, %" B_PRId32 " sacked, %"
+		B_PRId32 " lost\n", count, sacked, lost);
+	kprintf("    in flight: %" B_PRIu32 ", delivered: %" B_PRIu64 "\n",
+		fInFlight, fDelivered);
+	kprintf("    rack: sent %" B_PRId64 ", end %" B_PRIu32 ", rtt %" B_PRId64
+		", min rtt %" B_PRId64 "\n", fRackSent, fRackEnd.Number(),
+		fRackRoundTripTime, fMinRoundTripTime);
+}
+
+
+/*!	Makes sure a segment starts at \a sequence, and sets \a _segment to it,
+	or to \c NULL if there is no data after \a sequence.
+	If the segment containing \a sequence could not be split, \c B_NO_MEMORY
+	is returned, and \a _segment is set to that segment instead.
+*/
+status_t
+SackScoreboard::_SplitAt(tcp_sequence sequence, Segment*& _segment)
+{
+	Segment* segment = fSegmentTree.FindClosest(sequence, true);
+	if (segment == NULL) {
+		_segment = fSegments.Head();
+		return B_OK;
+	}
+	if (segment->end <= sequence) {
+		_segment = fSegments.GetNext(segment);
+		return B_OK;
+	}
+	if (segment->start == sequence) {
+		_segment = segment;
+		return B_OK;
+	}
+
+	Segment* second = new(std::nothrow) Segment;
+	if (second == NULL) {
+		_segment = segment;
+		return B_NO_MEMORY;
+	}
+
+	second->start = sequence;
+	second->end = segment->end;
+	second->sent = segment->sent;
+	second->flags = segment->flags;
+	segment->end = sequence;
+
+	fSegments.InsertAfter(segment, second);
+	fSegmentTree.Insert(second);
+	if ((second->flags & SEGMENT_LOST) != 0)
+		fLostSegments.Insert(second);
+	if (second->InFlight())
+		fSentSegments.InsertAfter(segment, second);
+
+	_segment = second;
+	return B_OK;
+}
+
+
+void
+SackScoreboard::_Remove(Segment* segment)
+{
+	if ((segment->flags & SEGMENT_LOST) != 0)
+		fLostSegments.Remove(segment);
+	if (segment->InFlight())
+		fSentSegments.Remove(segment);
+	fSegmentTree.Remove(segment);
+	fSegments.Remove(segment);
+	delete segment;
+}
+
+
+/*!	Changes the flags of \a segment, and updates the data in flight, and the
+	lost segments. A segment that stays or becomes in flight is moved to the
+	end of the send order, so \a segment->sent must be updated first, if
+	needed.
+*/
+void
+SackScoreboard::_SetFlags(Segment* segment, uint32 flags)
+{
+	if (segment->InFlight()) {
+		fInFlight -= segment->Size();
+		fSentSegments.Remove(segment);
+	}
+
+	if ((flags & SEGMENT_LOST) != (segment->flags & SEGMENT_LOST)) {
+		if ((flags & SEGMENT_LOST) != 0)
+			fLostSegments.Insert(segment);
+		else
+			fLostSegments.Remove(segment);
+	}
+
+	segment->flags = flags;
+
+	if (segment->InFlight()) {
+		fInFlight += segment->Size();
+		fSentSegments.Add(segment);
+	}
+}
+
+
+//!	Updates the RACK state for a segment the peer has received.
+void
+SackScoreboard::_Delivered(Segment* segment, bigtime_t now)
+{
+	fDelivered += segment->Size();
+
+	bigtime_t roundTripTime = now - segment->sent;
+
+	if ((segment->flags & SEGMENT_RETRANSMITTED) != 0) {
+		// An acknowledgement faster than the path allows is for the
+		// original transmission, and says nothing about the retransmission.
+		if (roundTripTime < fMinRoundTripTime)
+			return;
+	} else if (roundTripTime < fMinRoundTripTime)
+		fMinRoundTripTime = roundTripTime;
+
+	if (segment->sent > fRackSent
+		|| (segment->sent == fRackSent && segment->end > fRackEnd)) {
+		fRackSent = segment->sent;
+		fRackEnd = segment->end;
+		fRackRoundTripTime = roundTripTime;
+	}
+}
@@ -0,0 +1,142 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef SACK_SCOREBOARD_H
+#define SACK_SCOREBOARD_H
+
+
+#include "tcp.h"
+
+#include <util/AVLTree.h>
+#include <util/DoublyLinkedList.h>
+
+
+/*!	Keeps track of the segments in flight when selective acknowledgements
+	(RFC 2018) are used, and of what the peer reported to have received.
+
+	Segments are declared lost the RACK way (RFC 8985): a segment is lost
+	when one sent after it was delivered, and a reordering window has passed
+	since. This works for retransmissions and at the tail of a transfer,
+	where counting duplicate acknowledgements does not.
+
+	The segments are kept in a list in sequence order, and in a tree to find
+	the one containing a sequence number. The lost segments are in a second
+	tree, so that the first one to retransmit is found quickly, too. Like
+	RACK's time ordered list, the segments in flight are also kept in the
+	order they were sent, so that loss detection only has to look at the
+	segments it declares lost.
+*/
+class SackScoreboard {
+public:
+								SackScoreboard();
+								~SackScoreboard();
+
+			void				SegmentSent(tcp_sequence start,
+									tcp_sequence end, bigtime_t now);
+			void				Acknowledge(tcp_sequence sequence,
+									bigtime_t now);
+			void				SelectiveAcknowledge(tcp_sequence start,
+									tcp_sequence end, bigtime_t now);
+
+			uint32				DetectLosses(bigtime_t now,
+									bigtime_t& _timeout);
+			void				MarkAllLost();
+			bool				GetLost(tcp_sequence& _start,
+									tcp_sequence& _end) const;
+
+			void				Clear();
+
+			bool				IsEmpty() const
+									{ return fSegments.IsEmpty(); }
+			uint32				InFlight() const { return fInFlight; }
+									// the "pipe" of RFC 6675
+			uint64				Delivered() const { return fDelivered; }
+									// bytes acknowledged or SACKed so far
+
+			void				Dump() const;
+
+private:
+			enum {
+				SEGMENT_SACKED			= 0x01,
+				SEGMENT_LOST			= 0x02,
+				SEGMENT_RETRANSMITTED	= 0x04,
+			};
+
+			struct Segment : DoublyLinkedListLinkImpl<Segment> {
+				DoublyLinkedListLink<Segment> sent_link;
+				AVLTreeNode		tree_node;
+				AVLTreeNode		lost_node;
+				tcp_sequence	start;
+				tcp_sequence	end;
+				bigtime_t		sent;
+				uint32			flags;
+
+				uint32 Size() const { return (end - start).Number(); }
+				bool InFlight() const
+					{ return (flags & (SEGMENT_SACKED | SEGMENT_LOST)) == 0; }
+			};
+
+			template<size_t kNodeOffset>
+			struct SegmentTreeDefinition {
+				typedef tcp_sequence	Key;
+				typedef Segment			Value;
+
+				AVLTreeNode* GetAVLTreeNode(Value* value) const
+				{
+					return (AVLTreeNode*)((uint8*)value + kNodeOffset);
+				}
+
+				Value* GetValue(AVLTreeNode* node) const
+				{
+					return (Value*)((uint8*)node - kNodeOffset);
+				}
+
+				int Compare(const Key& a, const Value* b) const
+				{
+					if (a == b->start)
+						return 0;
+					return a < b->start ? -1 : 1;
+				}
+
+				int Compare(const Value* a, const Value* b) const
+				{
+					return Compare(a->start, b);
+				}
+			};
+
+			typedef DoublyLinkedList<Segment> SegmentList;
+			typedef DoublyLinkedList<Segment,
+				DoublyLinkedListMemberGetLink<Segment, &Segment::sent_link> >
+					SentSegmentList;
+			typedef AVLTree<SegmentTreeDefinition<
+				offsetof(Segment, tree_node)> > SegmentTree;
+			typedef AVLTree<SegmentTreeDefinition<
+				offsetof(Segment, lost_node)> > LostSegmentTree;
+
+private:
+			status_t			_SplitAt(tcp_sequence sequence,
+									Segment*& _segment);
+			void				_Remove(Segment* segment);
+			void				_SetFlags(Segment* segment, uint32 flags);
+			void				_Delivered(Segment* segment, bigtime_t now);
+
+private:
+			SegmentList			fSegments;
+			SegmentTree			fSegmentTree;
+			LostSegmentTree		fLostSegments;
+			SentSegmentList		fSentSegments;
+									// the segments in flight, by send time
+			uint32				fInFlight;
+			uint64				fDelivered;
+
+			bigtime_t			fMinRoundTripTime;
+			bigtime_t			fRackSent;
+			tcp_sequence		fRackEnd;
+			bigtime_t			fRackRoundTripTime;
+									// of the most recently sent segment
+									// that was delivered
+};
+
+
+#endif	// SACK_SCOREBOARD_H
@@ -41,6 +41,9 @@
 //  - RFC 793 - Transmission Control Protocol
 //  - RFC 813 - Window and Acknowledgement Strategy in TCP
 //	- RFC 1337 - TIME_WAIT Assassination Hazards in TCP
+//	- RFC 2018 - TCP Selective Acknowledgment Options
+//	- RFC 6675 - A Conservative Loss Recovery Algorithm Based on SACK
+//	- RFC 8985 - The RACK-TLP Loss Detection Algorithm for TCP
 //
 // Things this implementation currently doesn't implement:
 //	- TCP Slow Start, Congestion Avoidance, Fast Retransmit, and Fast Recovery,
@@ -49,7 +52,7 @@
 //	- Explicit Congestion Notification (ECN), RFC 3168
 //	- SYN-Cache
 //	- TCP Extensions for High Performance, RFC 1323
-//	- SACK, Selective Acknowledgment - RFC 2018, RFC 2883, RFC 3517
+//	- D-SACK, RFC 2883, and Tail Loss Probes, RFC 8985
 //	- Forward RTO-Recovery, RFC 4138
 //	- Time-Wait hash instead of keeping sockets alive
 
@@ -73,7 +76,8 @@
 	dprintf("TCP PROBE %llu %s %s %ld snxt %lu suna %lu cw %lu sst %lu win %lu swin %lu smax-suna %lu savail %lu sqused %lu rto %llu\n", \
 		system_time(), PrintAddress(buffer->source), \
 		PrintAddress(buffer->destination), buffer->size, fSendNext.Number(), \
-		fSendUnacknowledged.Number(), fCongestionWindow, fSlowStartThreshold, \
+		fSendUnacknowledged.Number(), fCongestionControl->CongestionWindow(), \
+		fCongestionControl->SlowStartThreshold(), \
 		window, fSendWindow, (fSendMax - fSendUnacknowledged).Number(), \
 		fSendQueue.Available(fSendNext), fSendQueue.Used(), fRetransmitTimeout)
 #else
@@ -265,12 +269,21 @@ enum {
 	FLAG_NO_RECEIVE				= 0x04,
 	FLAG_CLOSED					= 0x08,
 	FLAG_DELETE_ON_CLOSE		= 0x10,
-	FLAG_LOCAL					= 0x20
+	FLAG_LOCAL					= 0x20,
+	FLAG_OPTION_SACK_PERMITTED	= 0x40,
+	FLAG_RECOVERY				= 0x80,
+		// lost segments are being retransmitted, the congestion window
+		// doesn't grow until fRecoveryPoint is acknowledged
+	FLAG_REORDER_TIMER			= 0x100
+		// fRetransmitTimer waits for the reordering window of a segment
 };
 
 
 static const int kTimestampFactor = 1024;
 
+static const uint32 kMaxSegmentationSize = IP_MAXPACKET - 2 * 60;
+	// leaves room for the IP and TCP headers with options
+
 
 static inline bigtime_t
 absolute_timeout(bigtime_t timeout)
@@ -429,20 +442,24 @@ TCPEndpoint::TCPEndpoint(net_socket* socket)
 	fSendQueue(socket->send.buffer_size),
 	fInitialSendSequence(0),
 	fDuplicateAcknowledgeCount(0),
+	fRecoveryPoint(0),
 	fRoute(NULL),
 	fReceiveNext(0),
 	fReceiveMaxAdvertised(0),
 	fReceiveWindow(socket->receive.buffer_size),
 	fReceiveMaxSegmentSize(TCP_DEFAULT_MAX_SEGMENT_SIZE),
 	fReceiveQueue(socket->receive.buffer_size),
+	fLastOutOfOrderSequence(0),
 	fRoundTripTime(TCP_INITIAL_RTT / kTimestampFactor),
 	fRoundTripDeviation(TCP_INITIAL_RTT / kTimestampFactor),
 	fRetransmitTimeout(TCP_INITIAL_RTT),
+	fRoundTripSequence(0),
+	fRoundTripStart(0),
 	fReceivedTimestamp(0),
-	fCongestionWindow(0),
-	fSlowStartThreshold(0),
+	fCongestionControl(CongestionControl::Create()),
 	fState(CLOSED),
-	fFlags(FLAG_OPTION_WINDOW_SCALE | FLAG_OPTION_TIMESTAMP)
+	fFlags(FLAG_OPTION_WINDOW_SCALE | FLAG_OPTION_TIMESTAMP
+		| FLAG_OPTION_SACK_PERMITTED)
 {
 	// TODO: to be replaced with a real read/write locking strategy!
 	mutex_init(&fLock, "tcp lock");
@@ -478,6 +495,8 @@ TCPEndpoint::~TCPEndpoint()
 	gStackModule->wait_for_timer(&fTimeWaitTimer);
 
 	gDatalinkModule->put_route(Domain(), fRoute);
+
+	delete fCongestionControl;
 }
 
 
@@ -490,6 +509,9 @@ TCPEndpoint::InitCheck() const
 	if (fSendList.InitCheck() < B_OK)
 		return fSendList.InitCheck();
 
+	if (fCongestionControl == NULL)
+		return B_NO_MEMORY;
+
 	return B_OK;
 }
 
@@ -1018,6 +1040,16 @@ TCPEndpoint::SetReceiveBufferSize(size_t length)
 status_t
 TCPEndpoint::GetOption(int option, void* _value, int* _length)
 {
+	if (option == TCP_CONGESTION) {
+		if (*_length <= 0)
+			return B_BAD_VALUE;
+
+		MutexLocker _(fLock);
+		strlcpy((char*)_value, fCongestionControl->Name(), *_length);
+		*_length = min_c(*_length, (int)strlen((char*)_value) + 1);
+		return B_OK;
+	}
+
 	if (*_length != sizeof(int))
 		return B_BAD_VALUE;
 
@@ -1044,6 +1076,21 @@ TCPEndpoint::GetOption(int option, void* _value, int* _length)
 status_t
 TCPEndpoint::SetOption(int option, const void* _value, int length)
 {
+	if (option == TCP_CONGESTION) {
+		if (length <= 0)
+			return B_BAD_VALUE;
+
+		// the name does not need to be null terminated
+		char name[TCP_CA_NAME_MAX];
+		size_t nameLength = min_c(strnlen((const char*)_value, length),
+			sizeof(name) - 1);
+		memcpy(name, _value, nameLength);
+		name[nameLength] = '\0';
+
+		MutexLocker _(fLock);
+		return _SetCongestionControl(name);
+	}
+
 	if (option != TCP_NODELAY)
 		return B_BAD_VALUE;
 
@@ -1244,17 +1291,83 @@ TCPEndpoint::_DuplicateAcknowledge(tcp_segment_header &segment)
 		return;
 
 	if (fDuplicateAcknowledgeCount == 3) {
-		_ResetSlowStart();
-		fCongestionWindow = fSlowStartThreshold + 3
-			* fSendMaxSegmentSize;
+		fCongestionControl->LossDetected(
+			(fSendMax - fSendUnacknowledged).Number());
+		fCongestionControl->InflateWindow(3 * fSendMaxSegmentSize);
 		fSendNext = segment.acknowledge;
 	} else if (fDuplicateAcknowledgeCount > 3)
-		fCongestionWindow += fSendMaxSegmentSize;
+		fCongestionControl->InflateWindow(fSendMaxSegmentSize);
 
 	_SendQueued();
 }
 
 
+/*!	Feeds the acknowledgement and the SACK blocks of \a segment into the
+	scoreboard, and starts or ends loss recovery.
+*/
+void
+TCPEndpoint::_UpdateScoreboard(tcp_segment_header& segment)
+{
+	bigtime_t now = system_time();
+	fScoreboard.Acknowledge(segment.acknowledge, now);
+
+	for (int32 i = 0; i < segment.sack_count; i++) {
+		tcp_sequence start = ntohl(segment.sacks[i].left_edge);
+		tcp_sequence end = ntohl(segment.sacks[i].right_edge);
+
+		// ignore blocks for data we didn't send, or that is acknowledged
+		// already (D-SACK, RFC 2883)
+		if (start < end && start >= fSendUnacknowledged && end <= fSendMax)
+			fScoreboard.SelectiveAcknowledge(start, end, now);
+	}
+
+	if ((fFlags & FLAG_RECOVERY) != 0
+		&& segment.acknowledge >= fRecoveryPoint) {
+		// everything that was in flight when the loss was detected arrived
+		fFlags &= ~FLAG_RECOVERY;
+		fCongestionControl->RecoveryFinished();
+	}
+
+	_DetectLosses(now);
+}
+
+
+/*!	Marks the segments as lost that the scoreboard thinks are, enters
+	recovery if there are any, and arms the reordering timer for those
+	that might still arrive.
+*/
+void
+TCPEndpoint::_DetectLosses(bigtime_t now)
+{
+	bigtime_t timeout;
+	if (fScoreboard.DetectLosses(now, timeout) > 0)
+		_EnterRecovery();
+
+	if (timeout > 0) {
+		fFlags |= FLAG_REORDER_TIMER;
+		gStackModule->set_timer(&fRetransmitTimer, timeout);
+	} else if ((fFlags & FLAG_REORDER_TIMER) != 0) {
+		fFlags &= ~FLAG_REORDER_TIMER;
+		gStackModule->set_timer(&fRetransmitTimer, fRetransmitTimeout);
+	}
+}
+
+
+//!	Reduces the congestion window once per window of data (RFC 6675).
+void
+TCPEndpoint::_EnterRecovery()
+{
+	if ((fFlags & FLAG_RECOVERY) != 0)
+		return;
+
+	fCongestionControl->LossDetected(
+		(fSendMax - fSendUnacknowledged).Number());
+
+	fFlags |= FLAG_RECOVERY;
+	fRecoveryPoint = fSendMax;
+}
+
+
 void
 TCPEndpoint::_UpdateTimestamps(tcp_segment_header& segment,
 	size_t segmentLength)
@@ -1306,6 +1419,9 @@ TCPEndpoint::_AddData(tcp_segment_header& segment, net_buffer* buffer)
 		fFinishReceivedAt = segment.sequence + buffer->size;
 	}
 
+	if (segment.sequence > fReceiveNext)
+		fLastOutOfOrderSequence = segment.sequence;
+
 	fReceiveQueue.Add(buffer, segment.sequence);
 	fReceiveNext = fReceiveQueue.NextSequence();
 
@@ -1358,8 +1474,12 @@ TCPEndpoint::_PrepareReceivePath(tcp_segment_header& segment)
 			fFlags &= ~FLAG_OPTION_TIMESTAMP;
 	}
 
-	fCongestionWindow = 2 * fSendMaxSegmentSize;
-	fSlowStartThreshold = (uint32)segment.advertised_window << fSendWindowShift;
+	if ((fOptions & TCP_NOOPT) != 0
+		|| (segment.options & TCP_SACK_PERMITTED) == 0)
+		fFlags &= ~FLAG_OPTION_SACK_PERMITTED;
+
+	fCongestionControl->Init(fSendMaxSegmentSize, 2 * fSendMaxSegmentSize,
+		(uint32)segment.advertised_window << fSendWindowShift);
 }
 
 
@@ -1406,6 +1526,11 @@ TCPEndpoint::_Spawn(TCPEndpoint* parent, tcp_segment_header& segment,
 	fOptions = parent->fOptions;
 	fAcceptSemaphore = parent->fAcceptSemaphore;
 
+	if (_SetCongestionControl(parent->fCongestionControl->Name()) != B_OK) {
+		T(Error(this, "congestion control failed", __LINE__));
+		return DROP;
+	}
+
 	_PrepareReceivePath(segment);
 
 	// send SYN+ACK
@@ -1644,7 +1769,8 @@ TCPEndpoint::_Receive(tcp_segment_header& segment, net_buffer* buffer)
 
 		if (segment.acknowledge < fSendUnacknowledged) {
 			if (buffer->size == 0 && advertisedWindow == fSendWindow
-				&& (segment.flags & TCP_FLAG_FINISH) == 0) {
+				&& (segment.flags & TCP_FLAG_FINISH) == 0
+				&& (fFlags & FLAG_OPTION_SACK_PERMITTED) == 0) {
 				TRACE("Receive(): duplicate ack!");
 
 				_DuplicateAcknowledge(segment);
@@ -1656,7 +1782,7 @@ TCPEndpoint::_Receive(tcp_segment_header& segment, net_buffer* buffer)
 
 			if (fDuplicateAcknowledgeCount >= 3) {
 				// deflate the window.
-				fCongestionWindow = fSlowStartThreshold;
+				fCongestionControl->RecoveryFinished();
 			}
 
 			fDuplicateAcknowledgeCount = 0;
@@ -1708,9 +1834,14 @@ TCPEndpoint::_Receive(tcp_segment_header& segment, net_buffer* buffer)
 	uint32 bufferSize = buffer->size;
 
 	if ((bufferSize > 0 || (segment.flags & TCP_FLAG_FINISH) != 0)
-		&& _ShouldReceive())
+		&& _ShouldReceive()) {
+		// Out of order data, and data that fills a gap, is acknowledged
+		// immediately, so that the sender learns about it (RFC 5681).
+		if (fReceiveNext != segment.sequence || !fReceiveQueue.IsContiguous())
+			action |= IMMEDIATE_ACKNOWLEDGE;
+
 		notify = _AddData(segment, buffer);
-	else {
+	} else {
 		if ((fFlags & FLAG_NO_RECEIVE) != 0)
 			fReceiveNext += buffer->size;
 
@@ -1764,6 +1895,10 @@ TCPEndpoint::_Receive(tcp_segment_header& segment, net_buffer* buffer)
 	if (bufferSize > 0 || (segment.flags & TCP_FLAG_SYNCHRONIZE) != 0)
 		action |= ACKNOWLEDGE;
 
+	// coalesced segments count as many segments
+	if (bufferSize >= 2 * fReceiveMaxSegmentSize)
+		action |= IMMEDIATE_ACKNOWLEDGE;
+
 	_UpdateTimestamps(segment, segmentLength);
 
 	TRACE("Receive() Action %ld", action);
@@ -1870,7 +2005,7 @@ TCPEndpoint::_ShouldSendSegment(tcp_segment_header& segment, uint32 length,
 		// - the buffer is at least larger than half of the maximum send window,
 		//   or
 		// - we're retransmitting data
-		if (length == segmentMaxSize
+		if (length >= segmentMaxSize
 			|| (fOptions & TCP_NODELAY) != 0
 			|| tcp_sequence(fSendNext + length) == fSendQueue.LastSequence()
 			|| (fSendMaxWindow > 0 && length >= fSendMaxWindow / 2))
@@ -1940,9 +2075,20 @@ TCPEndpoint::_SendQueued(bool force, uint32 sendWindow)
 				segment.options |= TCP_HAS_WINDOW_SCALE;
 				segment.window_shift = fReceiveWindowShift;
 			}
+			if ((fFlags & FLAG_OPTION_SACK_PERMITTED) != 0)
+				segment.options |= TCP_SACK_PERMITTED;
 		}
 	}
 
+	tcp_sack sacks[TCP_MAX_SACK_BLOCKS];
+	if ((fFlags & FLAG_OPTION_SACK_PERMITTED) != 0
+		&& !fReceiveQueue.IsContiguous()) {
+		// tell the peer which data after the gap we have
+		segment.sacks = sacks;
+		segment.sack_count = fReceiveQueue.GetSackBlocks(sacks,
+			TCP_MAX_SACK_BLOCKS, fLastOutOfOrderSequence);
+	}
+
 	size_t availableBytes = fReceiveQueue.Free();
 	if (fFlags & FLAG_OPTION_WINDOW_SCALE)
 		segment.advertised_window = availableBytes >> fReceiveWindowShift;
@@ -1962,8 +2108,18 @@ TCPEndpoint::_SendQueued(bool force, uint32 sendWindow)
 		segment.urgent_offset = 0;
 	}
 
-	if (fCongestionWindow > 0 && fCongestionWindow < sendWindow)
-		sendWindow = fCongestionWindow;
+	bool selectiveAcknowledge = (fFlags & FLAG_OPTION_SACK_PERMITTED) != 0
+		&& fCongestionControl->CongestionWindow() > 0;
+	if (selectiveAcknowledge) {
+		// lost segments go first
+		status_t status = _RetransmitLost(segment);
+		if (status != B_OK)
+			return status;
+	} else {
+		uint32 congestionWindow = fCongestionControl->CongestionWindow();
+		if (congestionWindow > 0 && congestionWindow < sendWindow)
+			sendWindow = congestionWindow;
+	}
 
 	// fSendUnacknowledged
 	//  |    fSendNext      fSendMax
@@ -1988,6 +2144,17 @@ TCPEndpoint::_SendQueued(bool force, uint32 sendWindow)
 	} else
 		sendWindow -= consumedWindow;
 
+	if (selectiveAcknowledge) {
+		// The congestion window only limits the data that is actually in
+		// flight; that excludes what the peer reported, and what was lost.
+		uint32 inFlight = fScoreboard.InFlight();
+		uint32 congestionWindow = fCongestionControl->CongestionWindow();
+		congestionWindow = congestionWindow > inFlight
+			? congestionWindow - inFlight : 0;
+		if (congestionWindow < sendWindow)
+			sendWindow = congestionWindow;
+	}
+
 	if (force && sendWindow == 0 && fSendNext <= fSendQueue.LastSequence()) {
 		// send one byte of data to ask for a window update
 		// (triggered by the persist timer)
@@ -1998,10 +2165,22 @@ TCPEndpoint::_SendQueued(bool force, uint32 sendWindow)
 	tcp_sequence previousSendNext = fSendNext;
 
 	do {
-		uint32 segmentMaxSize = fSendMaxSegmentSize
-			- tcp_options_length(segment);
+		// the peer's MSS may be larger than what our link can carry
+		uint32 segmentMaxSize = min_c(fSendMaxSegmentSize,
+			fReceiveMaxSegmentSize) - tcp_options_length(segment);
 		uint32 segmentLength = min_c(length, segmentMaxSize);
 
+		if (length > segmentMaxSize && (segment.flags
+				& (TCP_FLAG_SYNCHRONIZE | TCP_FLAG_URGENT)) == 0) {
+			// Send a larger buffer that is only cut into segments right
+			// before it reaches the device; a smaller segment may only
+			// follow at the end of the queue
+			segmentLength = min_c(length,
+				kMaxSegmentationSize / segmentMaxSize * segmentMaxSize);
+			if (fSendNext + segmentLength != fSendQueue.LastSequence())
+				segmentLength -= segmentLength % segmentMaxSize;
+		}
+
 		if (fSendNext + segmentLength == fSendQueue.LastSequence()) {
 			if (state_needs_finish(fState))
 				segment.flags |= TCP_FLAG_FINISH;
@@ -2034,6 +2213,9 @@ TCPEndpoint::_SendQueued(bool force, uint32 sendWindow)
 		LocalAddress().CopyTo(buffer->source);
 		PeerAddress().CopyTo(buffer->destination);
 
+		if (segmentLength > segmentMaxSize)
+			buffer->segment_size = segmentMaxSize;
+
 		uint32 size = buffer->size;
 		segment.sequence = fSendNext.Number();
 
@@ -2043,7 +2225,8 @@ TCPEndpoint::_SendQueued(bool force, uint32 sendWindow)
 			buffer, buffer->size, PrintAddress(buffer->source),
 			PrintAddress(buffer->destination), segment.flags, segment.sequence,
 			segment.acknowledge, segment.advertised_window,
-			fCongestionWindow, fSlowStartThreshold, segmentLength,
+			fCongestionControl->CongestionWindow(),
+			fCongestionControl->SlowStartThreshold(), segmentLength,
 			fSendQueue.FirstSequence().Number(),
 			fSendQueue.LastSequence().Number());
 		T(Send(this, segment, buffer, fSendQueue.FirstSequence(),
@@ -2062,7 +2245,7 @@ TCPEndpoint::_SendQueued(bool force, uint32 sendWindow)
 		// for local connections as the answer is directly handled
 
 		if (segment.flags & TCP_FLAG_SYNCHRONIZE) {
-			segment.options &= ~TCP_HAS_WINDOW_SCALE;
+			segment.options &= ~(TCP_HAS_WINDOW_SCALE | TCP_SACK_PERMITTED);
 			segment.max_segment_size = 0;
 			size++;
 		}
@@ -2070,6 +2253,19 @@ TCPEndpoint::_SendQueued(bool force, uint32 sendWindow)
 		if (segment.flags & TCP_FLAG_FINISH)
 			size++;
 
+		if (selectiveAcknowledge && size > 0
+			&& (segment.flags & TCP_FLAG_SYNCHRONIZE) == 0)
+			fScoreboard.SegmentSent(fSendNext, fSendNext + size, system_time());
+
+		if (fSendNext < fSendMax) {
+			// retransmitted data gives no round trip time (Karn)
+			fRoundTripStart = 0;
+		} else if (size > 0 && fRoundTripStart == 0
+			&& (fFlags & FLAG_OPTION_TIMESTAMP) == 0) {
+			fRoundTripStart = system_time();
+			fRoundTripSequence = fSendNext + size;
+		}
+
 		uint32 sendMax = fSendMax.Number();
 		fSendNext += size;
 		if (fSendMax < fSendNext)
@@ -2084,6 +2280,7 @@ TCPEndpoint::_SendQueued(bool force, uint32 sendWindow)
 
 			fSendNext = segment.sequence;
 			fSendMax = sendMax;
+			fRoundTripStart = 0;
 				// restore send status
 			return status;
 		}
@@ -2110,6 +2307,90 @@ TCPEndpoint::_SendQueued(bool force, uint32 sendWindow)
 }
 
 
+/*!	Retransmits the segments the scoreboard considers lost, as far as the
+	congestion window allows.
+*/
+status_t
+TCPEndpoint::_RetransmitLost(tcp_segment_header& segment)
+{
+	uint32 segmentMaxSize = min_c(fSendMaxSegmentSize, fReceiveMaxSegmentSize)
+		- tcp_options_length(segment);
+	bool sent = false;
+
+	tcp_sequence start;
+	tcp_sequence end;
+	while (fScoreboard.InFlight() < fCongestionControl->CongestionWindow()
+		&& fScoreboard.GetLost(start, end)) {
+		if ((end - start).Number() > segmentMaxSize)
+			end = start + segmentMaxSize;
+
+		status_t status = _RetransmitSegment(segment, start, end);
+		if (status != B_OK)
+			return status;
+
+		sent = true;
+	}
+
+	if (sent && !gStackModule->is_timer_active(&fRetransmitTimer))
+		gStackModule->set_timer(&fRetransmitTimer, fRetransmitTimeout);
+
+	return B_OK;
+}
+
+
+//!	Sends the data between \a start and \a end again.
+status_t
+TCPEndpoint::_RetransmitSegment(const tcp_segment_header& header,
+	tcp_sequence start, tcp_sequence end)
+{
+	tcp_segment_header segment = header;
+	segment.sequence = start.Number();
+
+	tcp_sequence dataEnd = end;
+	if (end > fSendQueue.LastSequence()) {
+		// the FIN follows the data
+		segment.flags |= TCP_FLAG_FINISH;
+		dataEnd = fSendQueue.LastSequence();
+	}
+
+	net_buffer* buffer = gBufferModule->create(256);
+	if (buffer == NULL)
+		return B_NO_MEMORY;
+
+	status_t status = B_OK;
+	if (dataEnd > start)
+		status = fSendQueue.Get(buffer, start, (dataEnd - start).Number());
+	if (status == B_OK) {
+		LocalAddress().CopyTo(buffer->source);
+		PeerAddress().CopyTo(buffer->destination);
+
+		T(Send(this, segment, buffer, fSendQueue.FirstSequence(),
+			fSendQueue.LastSequence()));
+
+		status = add_tcp_header(AddressModule(), segment, buffer);
+	}
+	if (status != B_OK) {
+		gBufferModule->free(buffer);
+		return status;
+	}
+
+	// like in _SendQueued(), the state must be updated before sending
+	fScoreboard.SegmentSent(start, end, system_time());
+	fRoundTripStart = 0;
+
+	status = next->module->send_routed_data(next, fRoute, buffer);
+	if (status != B_OK) {
+		gBufferModule->free(buffer);
+		return status;
+	}
+
+	if ((segment.flags & TCP_FLAG_ACKNOWLEDGE) != 0)
+		fLastAcknowledgeSent = segment.acknowledge;
+
+	return B_OK;
+}
+
+
 int
 TCPEndpoint::_MaxSegmentSize(const sockaddr* address) const
 {
@@ -2162,6 +2443,7 @@ void
 TCPEndpoint::_Acknowledged(tcp_segment_header& segment)
 {
 	size_t previouslyUsed = fSendQueue.Used();
+	uint64 previouslyDelivered = fScoreboard.Delivered();
 
 	fSendQueue.RemoveUntil(segment.acknowledge);
 	fSendUnacknowledged = segment.acknowledge;
@@ -2169,16 +2451,40 @@ TCPEndpoint::_Acknowledged(tcp_segment_header& segment)
 	if (fSendNext < fSendUnacknowledged)
 		fSendNext = fSendUnacknowledged;
 
-	if (fSendUnacknowledged == fSendMax)
+	if (fSendUnacknowledged == fSendMax) {
 		gStackModule->cancel_timer(&fRetransmitTimer);
+		fFlags &= ~FLAG_REORDER_TIMER;
+	}
+
+	tcp_congestion_sample sample;
+	sample.now = system_time();
+	sample.acknowledged = previouslyUsed - fSendQueue.Used();
+	sample.round_trip_time = 0;
+
+	if ((fFlags & FLAG_OPTION_SACK_PERMITTED) != 0) {
+		_UpdateScoreboard(segment);
+
+		sample.delivered = fScoreboard.Delivered() - previouslyDelivered;
+		sample.in_flight = fScoreboard.InFlight();
+	} else {
+		sample.delivered = sample.acknowledged;
+		sample.in_flight = (fSendMax - fSendUnacknowledged).Number();
+	}
 
 	if (fSendQueue.Used() < previouslyUsed) {
 		// this ACK acknowledged data
 
-		if (segment.options & TCP_HAS_TIMESTAMPS)
-			_UpdateRoundTripTime(tcp_diff_timestamp(segment.timestamp_reply));
-		else {
-			// TODO: Fallback to RFC 793 type estimation
+		if (segment.options & TCP_HAS_TIMESTAMPS) {
+			int32 roundTripTime = tcp_diff_timestamp(segment.timestamp_reply);
+			_UpdateRoundTripTime(roundTripTime);
+			sample.round_trip_time = (bigtime_t)roundTripTime
+				* kTimestampFactor;
+		} else if (fRoundTripStart != 0
+			&& fSendUnacknowledged >= fRoundTripSequence) {
+			// the timed segment arrived without being retransmitted
+			sample.round_trip_time = sample.now - fRoundTripStart;
+			_UpdateRoundTripTime(sample.round_trip_time / kTimestampFactor);
+			fRoundTripStart = 0;
 		}
 
 		if (is_writable(fState)) {
@@ -2186,21 +2492,12 @@ TCPEndpoint::_Acknowledged(tcp_segment_header& segment)
 			fSendList.Signal();
 			gSocketModule->notify(socket, B_SELECT_WRITE, fSendQueue.Used());
 		}
-
-		if (fCongestionWindow < fSlowStartThreshold)
-			fCongestionWindow += fSendMaxSegmentSize;
 	}
 
-	if (fCongestionWindow >= fSlowStartThreshold) {
-		uint32 increment = fSendMaxSegmentSize * fSendMaxSegmentSize;
-
-		if (increment < fCongestionWindow)
-			increment = 1;
-		else
-			increment /= fCongestionWindow;
-
-		fCongestionWindow += increment;
-	}
+	sample.in_recovery = (fFlags & FLAG_RECOVERY) != 0
+		|| fDuplicateAcknowledgeCount >= 3;
+	if (sample.acknowledged > 0 || sample.delivered > 0)
+		fCongestionControl->Acknowledged(sample);
 
 	// if there is data left to be send, send it now
 	if (fSendQueue.Used() > 0)
@@ -2212,8 +2509,30 @@ void
 TCPEndpoint::_Retransmit()
 {
 	TRACE("Retransmit()");
-	_ResetSlowStart();
-	fSendNext = fSendUnacknowledged;
+
+	if ((fFlags & FLAG_REORDER_TIMER) != 0) {
+		// the reordering window of a segment in flight has passed
+		fFlags &= ~FLAG_REORDER_TIMER;
+		gStackModule->set_timer(&fRetransmitTimer, fRetransmitTimeout);
+
+		_DetectLosses(system_time());
+		_SendQueued();
+		return;
+	}
+
+	fCongestionControl->RetransmitTimeout(
+		(fSendMax - fSendUnacknowledged).Number());
+
+	if ((fFlags & FLAG_OPTION_SACK_PERMITTED) != 0 && !fScoreboard.IsEmpty()) {
+		// Only retransmit what is lost. As nothing arrived for a while, that's
+		// everything in flight, but the window will open faster when the
+		// peer reports data it already has.
+		fScoreboard.MarkAllLost();
+		fFlags |= FLAG_RECOVERY;
+		fRecoveryPoint = fSendMax;
+	} else
+		fSendNext = fSendUnacknowledged;
+
 	_SendQueued();
 }
 
@@ -2239,12 +2558,26 @@ TCPEndpoint::_UpdateRoundTripTime(int32 roundTripTime)
 }
 
 
-void
-TCPEndpoint::_ResetSlowStart()
+/*!	Replaces the congestion control algorithm with the one called \a name.
+	The new algorithm continues with the window of the previous one.
+*/
+status_t
+TCPEndpoint::_SetCongestionControl(const char* name)
 {
-	fSlowStartThreshold = max_c((fSendMax - fSendUnacknowledged).Number() / 2,
-		2 * fSendMaxSegmentSize);
-	fCongestionWindow = fSendMaxSegmentSize;
+	if (strcmp(name, fCongestionControl->Name()) == 0)
+		return B_OK;
+
+	CongestionControl* congestionControl = CongestionControl::Create(name);
+	if (congestionControl == NULL)
+		return B_BAD_VALUE;
+
+	congestionControl->Init(fSendMaxSegmentSize,
+		fCongestionControl->CongestionWindow(),
+		fCongestionControl->SlowStartThreshold());
+
+	delete fCongestionControl;
+	fCongestionControl = congestionControl;
+	return B_OK;
 }
 
 
@@ -2354,6 +2687,11 @@ TCPEndpoint::Dump() const
 		fLastAcknowledgeSent.Number());
 	kprintf("    initial sequence: %" B_PRIu32 "\n",
 		fInitialSendSequence.Number());
+	if ((fFlags & FLAG_OPTION_SACK_PERMITTED) != 0) {
+		fScoreboard.Dump();
+		kprintf("    recovery point: %" B_PRIu32 "\n",
+			fRecoveryPoint.Number());
+	}
 	kprintf("  receive\n");
 	kprintf("    window shift: %u\n", fReceiveWindowShift);
 	kprintf("    next: %" B_PRIu32 "\n", fReceiveNext.Number());
@@ -2373,7 +2711,6 @@ TCPEndpoint::Dump() const
 	kprintf("  round trip time: %" B_PRId32 " (deviation %" B_PRId32 ")\n",
 		fRoundTripTime, fRoundTripDeviation);
 	kprintf("  retransmit timeout: %" B_PRId64 "\n", fRetransmitTimeout);
-	kprintf("  congestion window: %" B_PRIu32 "\n", fCongestionWindow);
-	kprintf("  slow start threshold: %" B_PRIu32 "\n", fSlowStartThreshold);
+	fCongestionControl->Dump();
 }
 
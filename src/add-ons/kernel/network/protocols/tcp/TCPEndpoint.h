@@ -12,7 +12,9 @@
 
 
 #include "BufferQueue.h"
+#include "CongestionControl.h"
 #include "EndpointManager.h"
+#include "SackScoreboard.h"
 #include "tcp.h"
 
 #include <ProtocolUtilities.h>
@@ -95,6 +97,10 @@ private:
 							uint32 flightSize);
 			status_t	_SendQueued(bool force = false);
 			status_t	_SendQueued(bool force, uint32 sendWindow);
+			status_t	_RetransmitLost(tcp_segment_header& segment);
+			status_t	_RetransmitSegment(
+							const tcp_segment_header& header,
+							tcp_sequence start, tcp_sequence end);
 			int			_MaxSegmentSize(const struct sockaddr* address) const;
 			status_t	_Disconnect(bool closing);
 			ssize_t		_AvailableData() const;
@@ -123,8 +129,11 @@ private:
 			void		_Acknowledged(tcp_segment_header& segment);
 			void		_Retransmit();
 			void		_UpdateRoundTripTime(int32 roundTripTime);
-			void		_ResetSlowStart();
+			status_t	_SetCongestionControl(const char* name);
 			void		_DuplicateAcknowledge(tcp_segment_header& segment);
+			void		_UpdateScoreboard(tcp_segment_header& segment);
+			void		_DetectLosses(bigtime_t now);
+			void		_EnterRecovery();
 
 	static	void		_TimeWaitTimer(net_timer* timer, void* _endpoint);
 	static	void		_RetransmitTimer(net_timer* timer, void* _endpoint);
@@ -160,6 +169,8 @@ private:
 	tcp_sequence	fLastAcknowledgeSent;
 	tcp_sequence	fInitialSendSequence;
 	uint32			fDuplicateAcknowledgeCount;
+	SackScoreboard	fScoreboard;
+	tcp_sequence	fRecoveryPoint;
 
 	net_route 		*fRoute;
 		// TODO: don't use a net_route, but a net_route_info!!!
@@ -173,16 +184,19 @@ private:
 	bool			fFinishReceived;
 	tcp_sequence	fFinishReceivedAt;
 	tcp_sequence	fInitialReceiveSequence;
+	tcp_sequence	fLastOutOfOrderSequence;
 
 	// round trip time and retransmit timeout computation
 	int32			fRoundTripTime;
 	int32			fRoundTripDeviation;
 	bigtime_t		fRetransmitTimeout;
+	tcp_sequence	fRoundTripSequence;
+	bigtime_t		fRoundTripStart;
+		// the segment timed without timestamps, 0 if there is none
 
 	uint32			fReceivedTimestamp;
 
-	uint32			fCongestionWindow;
-	uint32			fSlowStartThreshold;
+	CongestionControl* fCongestionControl;
 
 	tcp_state		fState;
 	uint32			fFlags;
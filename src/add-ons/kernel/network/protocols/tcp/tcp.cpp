@@ -15,6 +15,7 @@
 #include <net_protocol.h>
 #include <net_stat.h>
 
+#include <driver_settings.h>
 #include <KernelExport.h>
 #include <util/list.h>
 
@@ -54,8 +55,8 @@ static EndpointManager* sEndpointManagers[AF_MAX];
 static rw_lock sEndpointManagersLock;
 
 
-// The TCP header length is at most 64 bytes.
-static const int kMaxOptionSize = 64 - sizeof(tcp_header);
+// The TCP header length is at most 60 bytes.
+static const int kMaxOptionSize = 60 - sizeof(tcp_header);
 
 
 /*!	Returns an endpoint manager for the specified domain, if any.
@@ -219,6 +220,21 @@ process_options(tcp_segment_header &segment, net_buffer *buffer, size_t size)
 				if (option->length == 2 && size >= 2)
 					segment.options |= TCP_SACK_PERMITTED;
 				break;
+			case TCP_OPTION_SACK:
+			{
+				// the option might be in a temporary buffer, so the blocks
+				// are copied to the storage the caller provided
+				int32 count = ((int32)option->length - 2)
+					/ (int32)sizeof(tcp_sack);
+				if (segment.sacks == NULL || count <= 0
+					|| option->length > size)
+					break;
+
+				segment.sack_count = min_c(count, TCP_MAX_SACK_BLOCKS);
+				memcpy(segment.sacks, option->sack,
+					segment.sack_count * sizeof(tcp_sack));
+				break;
+			}
 		}
 
 		if (length < 0) {
@@ -409,8 +425,11 @@ add_tcp_header(net_address_module_info* addressModule,
 		"win %u\n", buffer, segment.flags, segment.sequence,
 		segment.acknowledge, segment.urgent_offset, segment.advertised_window));
 
-	*TCPChecksumField(buffer) = Checksum::PseudoHeader(addressModule,
-		gBufferModule, buffer, IPPROTO_TCP);
+	// a buffer that is cut into segments gets their checksums instead
+	if (buffer->segment_size == 0) {
+		*TCPChecksumField(buffer) = Checksum::PseudoHeader(addressModule,
+			gBufferModule, buffer, IPPROTO_TCP);
+	}
 
 	return B_OK;
 }
@@ -678,7 +697,8 @@ tcp_receive_data(net_buffer* buffer)
 	if (headerLength < sizeof(tcp_header))
 		return B_BAD_DATA;
 
-	if (Checksum::PseudoHeader(addressModule, gBufferModule, buffer,
+	if ((buffer->offload_flags & NET_BUFFER_CHECKSUM_VALID) == 0
+		&& Checksum::PseudoHeader(addressModule, gBufferModule, buffer,
 			IPPROTO_TCP) != 0)
 		return B_BAD_DATA;
 
@@ -691,11 +711,13 @@ tcp_receive_data(net_buffer* buffer)
 	//dump_tcp_header(header);
 	//gBufferModule->dump(buffer);
 
+	tcp_sack sacks[TCP_MAX_SACK_BLOCKS];
 	tcp_segment_header segment(header.flags);
 	segment.sequence = header.Sequence();
 	segment.acknowledge = header.Acknowledge();
 	segment.advertised_window = header.AdvertisedWindow();
 	segment.urgent_offset = header.UrgentOffset();
+	segment.sacks = sacks;
 	process_options(segment, buffer, headerLength - sizeof(tcp_header));
 
 	bufferHeader.Remove(headerLength);
@@ -790,6 +812,17 @@ tcp_init()
 	if (status < B_OK)
 		return status;
 
+	// the default congestion control can be chosen in the "tcp" settings
+	void* settings = load_driver_settings("tcp");
+	if (settings != NULL) {
+		const char* name = get_driver_parameter(settings,
+			"congestion_control", NULL, NULL);
+		if (name != NULL && CongestionControl::SetDefault(name) != B_OK)
+			dprintf("tcp: unknown congestion control \"%s\"\n", name);
+
+		unload_driver_settings(settings);
+	}
+
 	add_debugger_command("tcp_endpoints", dump_endpoints,
 		"lists all open TCP endpoints");
 	add_debugger_command("tcp_endpoint", dump_endpoint,
@@ -27,6 +27,7 @@
 #include <algorithm>
 #include <netinet/in.h>
 #include <netinet/ip.h>
+#include <netinet/udp.h>
 #include <new>
 #include <stdlib.h>
 #include <string.h>
@@ -90,6 +91,16 @@ public:
 			ssize_t				BytesAvailable();
 			status_t			FetchData(size_t numBytes, uint32 flags,
 									net_buffer** _buffer);
+			status_t			FetchMultipleData(uint32 flags,
+									bigtime_t deadline, net_buffer** _buffers,
+									size_t* _count);
+			void				ReturnData(net_buffer** buffers,
+									size_t count);
+
+			status_t			GetOption(int option, void* value,
+									int* _length);
+			status_t			SetOption(int option, const void* value,
+									int length);
 
 			status_t			StoreData(net_buffer* buffer);
 			status_t			DeliverData(net_buffer* buffer);
@@ -105,6 +116,7 @@ public:
 
 private:
 			UdpDomainSupport*	fManager;
+			uint16				fSegmentSize;
 			bool				fActive;
 									// an active UdpEndpoint is part of the
 									// endpoint hash (and it is bound and
@@ -796,7 +808,8 @@ UdpEndpointManager::Deframe(net_buffer* buffer)
 	if (buffer->size > udpLength)
 		gBufferModule->trim(buffer, udpLength);
 
-	if (header.udp_checksum != 0) {
+	if (header.udp_checksum != 0
+		&& (buffer->offload_flags & NET_BUFFER_CHECKSUM_VALID) == 0) {
 		// check UDP-checksum (simulating a so-called "pseudo-header"):
 		uint16 sum = Checksum::PseudoHeader(addressModule, gBufferModule,
 			buffer, IPPROTO_UDP);
@@ -910,6 +923,7 @@ UdpEndpointManager::_GetDomainSupport(net_buffer* buffer)
 UdpEndpoint::UdpEndpoint(net_socket *socket)
 	:
 	DatagramSocket<>("udp endpoint", socket),
+	fSegmentSize(0),
 	fActive(false)
 {
 }
@@ -991,6 +1005,16 @@ UdpEndpoint::SendRoutedData(net_buffer *buffer, net_route *route)
 	if (buffer->size > (0xffff - sizeof(udp_header)))
 		return EMSGSIZE;
 
+	if (fSegmentSize != 0 && buffer->size > fSegmentSize) {
+		// the datalink layer cuts the buffer into datagrams, and computes
+		// their checksums
+		if (fSegmentSize + sizeof(udp_header)
+				> next->module->get_mtu(next, buffer->destination))
+			return EMSGSIZE;
+
+		buffer->segment_size = fSegmentSize;
+	}
+
 	buffer->protocol = IPPROTO_UDP;
 
 	// add and fill UDP-specific header:
@@ -1006,6 +1030,9 @@ UdpEndpoint::SendRoutedData(net_buffer *buffer, net_route *route)
 
 	header.Sync();
 
+	if (buffer->segment_size != 0)
+		return next->module->send_routed_data(next, route, buffer);
+
 	uint16 calculatedChecksum = Checksum::PseudoHeader(AddressModule(),
 		gBufferModule, buffer, IPPROTO_UDP);
 	if (calculatedChecksum == 0)
@@ -1053,6 +1080,25 @@ UdpEndpoint::FetchData(size_t numBytes, uint32 flags, net_buffer **_buffer)
 }
 
 
+status_t
+UdpEndpoint::FetchMultipleData(uint32 flags, bigtime_t deadline,
+	net_buffer** _buffers, size_t* _count)
+{
+	TRACE_EP("FetchMultipleData(%lu, 0x%lx)", *_count, flags);
+
+	return DequeueMultiple(flags, deadline, _buffers, _count);
+}
+
+
+void
+UdpEndpoint::ReturnData(net_buffer** buffers, size_t count)
+{
+	TRACE_EP("ReturnData(%lu)", count);
+
+	Requeue(buffers, count);
+}
+
+
 status_t
 UdpEndpoint::StoreData(net_buffer *buffer)
 {
@@ -1081,6 +1127,35 @@ UdpEndpoint::DeliverData(net_buffer *_buffer)
 }
 
 
+// #pragma mark - options
+
+
+status_t
+UdpEndpoint::GetOption(int option, void* _value, int* _length)
+{
+	if (option != UDP_SEGMENT || *_length != sizeof(int))
+		return B_BAD_VALUE;
+
+	*(int*)_value = fSegmentSize;
+	return B_OK;
+}
+
+
+status_t
+UdpEndpoint::SetOption(int option, const void* _value, int length)
+{
+	if (option != UDP_SEGMENT || length != sizeof(int))
+		return B_BAD_VALUE;
+
+	int value = *(const int*)_value;
+	if (value < 0 || value > int(0xffff - sizeof(udp_header)))
+		return B_BAD_VALUE;
+
+	fSegmentSize = value;
+	return B_OK;
+}
+
+
 void
 UdpEndpoint::Dump() const
 {
@@ -1167,6 +1242,9 @@ status_t
 udp_getsockopt(net_protocol *protocol, int level, int option, void *value,
 	int *length)
 {
+	if (level == IPPROTO_UDP)
+		return ((UdpEndpoint *)protocol)->GetOption(option, value, length);
+
 	return protocol->next->module->getsockopt(protocol->next, level, option,
 		value, length);
 }
@@ -1176,6 +1254,9 @@ status_t
 udp_setsockopt(net_protocol *protocol, int level, int option,
 	const void *value, int length)
 {
+	if (level == IPPROTO_UDP)
+		return ((UdpEndpoint *)protocol)->SetOption(option, value, length);
+
 	return protocol->next->module->setsockopt(protocol->next, level, option,
 		value, length);
 }
@@ -1239,6 +1320,22 @@ udp_read_data(net_protocol *protocol, size_t numBytes, uint32 flags,
 }
 
 
+status_t
+udp_read_data_multiple(net_protocol *protocol, uint32 flags,
+	bigtime_t deadline, net_buffer **_buffers, size_t *_count)
+{
+	return ((UdpEndpoint *)protocol)->FetchMultipleData(flags, deadline,
+		_buffers, _count);
+}
+
+
+void
+udp_unread_data(net_protocol *protocol, net_buffer **buffers, size_t count)
+{
+	((UdpEndpoint *)protocol)->ReturnData(buffers, count);
+}
+
+
 ssize_t
 udp_read_avail(net_protocol *protocol)
 {
@@ -1462,7 +1559,9 @@ net_protocol_module_info sUDPModule = {
 	NULL,		// process_ancillary_data()
 	udp_process_ancillary_data_no_container,
 	NULL,		// send_data_no_buffer()
-	NULL		// read_data_no_buffer()
+	NULL,		// read_data_no_buffer()
+	udp_read_data_multiple,
+	udp_unread_data
 };
 
 module_dependency module_dependencies[] = {
@@ -12,6 +12,7 @@
 #include <net/if_dl.h>
 #include <net/if_media.h>
 #include <net/route.h>
+#include <netinet/in.h>
 #include <new>
 #include <stdlib.h>
 #include <stdio.h>
@@ -27,6 +28,7 @@
 #include "device_interfaces.h"
 #include "domains.h"
 #include "interfaces.h"
+#include "offload.h"
 #include "routes.h"
 #include "stack_private.h"
 #include "utility.h"
@@ -345,6 +347,36 @@ datalink_control(net_domain* _domain, int32 option, void* value,
 }
 
 
+/*!	Passes \a buffer on to the datalink protocols of \a address, or, if
+	\a local is true, back to its domain.
+*/
+static status_t
+send_buffer(InterfaceAddress* address, bool local, net_buffer* buffer)
+{
+	Interface* interface = (Interface*)address->interface;
+
+	if (local) {
+		// We set the interface address here, so the buffer is delivered
+		// directly to the domain in interfaces.cpp:device_consumer_thread()
+		address->AcquireReference();
+		set_interface_address(buffer->interface_address, address);
+
+		// the data never left memory, there is no need to check it
+		buffer->offload_flags |= NET_BUFFER_CHECKSUM_VALID;
+
+		// this one goes back to the domain directly
+		return device_interface_enqueue_buffer(interface->DeviceInterface(),
+			buffer);
+	}
+
+	// this goes out to the datalink protocols
+	domain_datalink* datalink
+		= interface->DomainDatalink(address->domain->family);
+
+	return datalink->first_info->send_data(datalink->first_protocol, buffer);
+}
+
+
 static status_t
 datalink_send_routed_data(struct net_route* route, net_buffer* buffer)
 {
@@ -361,20 +393,10 @@ datalink_send_routed_data(struct net_route* route, net_buffer* buffer)
 		return ENETUNREACH;
 	}
 
-	if ((route->flags & RTF_LOCAL) != 0) {
+	bool local = (route->flags & RTF_LOCAL) != 0;
+	if (local) {
 		TRACE("  local route\n");
-
-		// We set the interface address here, so the buffer is delivered
-		// directly to the domain in interfaces.cpp:device_consumer_thread()
-		address->AcquireReference();
-		set_interface_address(buffer->interface_address, address);
-
-		// this one goes back to the domain directly
-		return fifo_enqueue_buffer(
-			&interface->DeviceInterface()->receive_queue, buffer);
-	}
-
-	if ((route->flags & RTF_GATEWAY) != 0) {
+	} else if ((route->flags & RTF_GATEWAY) != 0) {
 		TRACE("  gateway route\n");
 
 		// This route involves a gateway, we need to use the gateway address
@@ -384,10 +406,39 @@ datalink_send_routed_data(struct net_route* route, net_buffer* buffer)
 		memcpy(buffer->destination, route->gateway, route->gateway->sa_len);
 	}
 
-	// this goes out to the datalink protocols
-	domain_datalink* datalink
-		= interface->DomainDatalink(address->domain->family);
-	return datalink->first_info->send_data(datalink->first_protocol, buffer);
+	if (buffer->segment_size == 0)
+		return send_buffer(address, local, buffer);
+
+	uint32 mtu = route->mtu != 0 ? route->mtu : interface->mtu;
+
+	if (!local && buffer->protocol == IPPROTO_TCP
+		&& (interface->device->offload
+			& NET_DEVICE_SEGMENTATION_OFFLOAD) != 0) {
+		status_t status = limit_segment_size(buffer, mtu);
+		if (status != B_OK)
+			return status;
+
+		return send_buffer(address, local, buffer);
+	}
+
+	// cut the buffer into segments the device can send, or, for local
+	// routes, into the datagrams the receiver expects
+	struct list segments;
+	status_t status = segment_buffer(buffer, mtu, &segments);
+
+	while (net_buffer* segment
+			= (net_buffer*)list_remove_head_item(&segments)) {
+		if (status == B_OK) {
+			status = send_buffer(address, local, segment);
+			if (status == B_OK)
+				continue;
+		}
+		gNetBufferModule.free(segment);
+	}
+
+	if (status == B_OK)
+		gNetBufferModule.free(buffer);
+	return status;
 }
 
 
@@ -417,6 +468,9 @@ datalink_send_data(net_protocol* protocol, net_domain* domain,
 		&& protocol->socket->bound_to_device != 0) {
 		status = get_device_route(domain, protocol->socket->bound_to_device,
 			&route);
+	} else if (protocol != NULL && protocol->socket != NULL) {
+		status = get_cached_buffer_route(domain,
+			get_socket_route_cache(protocol->socket), buffer, &route);
 	} else
 		status = get_buffer_route(domain, buffer, &route);
 
@@ -10,12 +10,14 @@
 #include "device_interfaces.h"
 #include "domains.h"
 #include "interfaces.h"
+#include "offload.h"
 #include "stack_private.h"
 #include "utility.h"
 
 #include <net_device.h>
 
 #include <lock.h>
+#include <smp.h>
 #include <util/AutoLock.h>
 
 #include <KernelExport.h>
@@ -36,25 +38,102 @@
 #endif
 
 
+static const int32 kMaxCoalescedSegments = 64;
+
 static mutex sLock;
 static DeviceInterfaceList sInterfaces;
 static uint32 sDeviceIndex;
 
 
-/*!	A service thread for each device interface. It just reads as many packets
-	as availabe, deframes them, and puts them into the receive queue of the
-	device interface.
+static inline uint32
+hash_flow_words(uint32 hash, const uint8* data, size_t length)
+{
+	for (size_t i = 0; i + 4 <= length; i += 4) {
+		uint32 word;
+		memcpy(&word, data + i, sizeof(word));
+		hash = (hash ^ word) * 2654435761U;
+	}
+
+	return hash;
+}
+
+
+/*!	Computes a hash of the addresses, protocol, and ports of the IP packet in
+	\a buffer. Fragments only use the addresses and the protocol, as only the
+	first one contains the ports.
+	Returns 0 if the buffer doesn't contain an IP packet.
+*/
+static uint32
+flow_hash(net_buffer* buffer)
+{
+	uint8 copy[64];
+	size_t length = min_c(buffer->size, sizeof(copy));
+	if (length < 20)
+		return 0;
+
+	uint8* header;
+	if (gNetBufferModule.direct_access(buffer, 0, length, (void**)&header)
+			!= B_OK) {
+		if (gNetBufferModule.read(buffer, 0, copy, length) != B_OK)
+			return 0;
+		header = copy;
+	}
+
+	uint32 hash = 0;
+	uint8 protocol;
+	size_t portOffset;
+
+	switch (header[0] >> 4) {
+		case 4:
+			protocol = header[9];
+			hash = hash_flow_words(hash, header + 12, 8);
+			portOffset = (header[0] & 0xf) * 4;
+			if ((header[6] & 0x3f) != 0 || header[7] != 0) {
+				// a fragment
+				portOffset = length;
+			}
+			break;
+
+		case 6:
+			if (length < 40)
+				return 0;
+			protocol = header[6];
+			hash = hash_flow_words(hash, header + 8, 32);
+			portOffset = 40;
+			break;
+
+		default:
+			return 0;
+	}
+
+	if ((protocol == IPPROTO_TCP || protocol == IPPROTO_UDP)
+		&& portOffset + 4 <= length)
+		hash = hash_flow_words(hash, header + portOffset, 4);
+
+	hash = (hash ^ protocol) * 2654435761U;
+	return hash ^ (hash >> 16);
+}
+
+
+/*!	A service thread for each receive queue of the device. It just reads as
+	many packets as available, deframes them, and puts them into the receive
+	queues of the device interface.
 */
 static status_t
-device_reader_thread(void* _interface)
+device_reader_thread(void* _queue)
 {
-	net_device_interface* interface = (net_device_interface*)_interface;
+	net_receive_queue* queue = (net_receive_queue*)_queue;
+	net_device_interface* interface = queue->interface;
 	net_device* device = interface->device;
 	status_t status = B_OK;
 
 	while ((device->flags & IFF_UP) != 0) {
 		net_buffer* buffer;
-		status = device->module->receive_data(device, &buffer);
+		if (device->module->receive_queue_data != NULL) {
+			status = device->module->receive_queue_data(device, queue->index,
+				&buffer);
+		} else
+			status = device->module->receive_data(device, &buffer);
 		if (status == B_OK) {
 			// feed device monitors
 			if (atomic_get(&interface->monitor_count) > 0)
@@ -67,9 +146,12 @@ device_reader_thread(void* _interface)
 				continue;
 			}
 
-			fifo_enqueue_buffer(&interface->receive_queue, buffer);
+			device_interface_enqueue_buffer(interface, buffer);
 		} else if (status == B_DEVICE_NOT_FOUND) {
-				device_removed(device);
+			// the first reader takes care of the removal
+			if (queue->index != 0)
+				break;
+			device_removed(device);
 		} else {
 			// In case of error, give the other threads some
 			// time to run since this is a high priority time thread.
@@ -82,19 +164,40 @@ device_reader_thread(void* _interface)
 
 
 static status_t
-device_consumer_thread(void* _interface)
+device_consumer_thread(void* _queue)
 {
-	net_device_interface* interface = (net_device_interface*)_interface;
+	net_receive_queue* queue = (net_receive_queue*)_queue;
+	net_device_interface* interface = queue->interface;
 	net_device* device = interface->device;
 	net_buffer* buffer;
+	net_buffer* next = NULL;
 
 	while (true) {
-		ssize_t status = fifo_dequeue_buffer(&interface->receive_queue, 0,
-			B_INFINITE_TIMEOUT, &buffer);
-		if (status != B_OK) {
-			if (status == B_INTERRUPTED)
-				continue;
-			break;
+		if (next != NULL) {
+			buffer = next;
+			next = NULL;
+		} else {
+			ssize_t status = fifo_dequeue_buffer(&queue->fifo, 0,
+				B_INFINITE_TIMEOUT, &buffer);
+			if (status != B_OK) {
+				if (status == B_INTERRUPTED)
+					continue;
+				break;
+			}
+		}
+
+		// Coalesce the segments of a TCP flow that are already waiting;
+		// the first one that doesn't fit is processed next.
+		if ((device->offload & NET_DEVICE_RECEIVE_OFFLOAD) == 0) {
+			for (int32 count = 1; count < kMaxCoalescedSegments; count++) {
+				if (fifo_dequeue_buffer(&queue->fifo, 0, 0, &next) != B_OK) {
+					next = NULL;
+					break;
+				}
+				if (!coalesce_buffers(buffer, next))
+					break;
+				next = NULL;
+			}
 		}
 
 		if (buffer->interface_address != NULL) {
@@ -113,7 +216,7 @@ device_consumer_thread(void* _interface)
 
 			// Find handler for this packet
 
-			RecursiveLocker locker(interface->receive_lock);
+			ReadLocker locker(interface->receive_funcs_lock);
 
 			DeviceHandlerList::Iterator iterator
 				= interface->receive_funcs.GetIterator();
@@ -163,6 +266,46 @@ find_device_interface(const char* name)
 }
 
 
+static status_t
+init_receive_queue(net_device_interface* interface, uint32 index)
+{
+	net_receive_queue* queue = &interface->receive_queues[index];
+
+	char name[128];
+	snprintf(name, sizeof(name), "%s receive queue %" B_PRIu32,
+		interface->device->name, index);
+
+	// the queues share the 16 MB a device may have queued
+	status_t status = init_fifo(&queue->fifo, name,
+		16 * 1024 * 1024 / interface->receive_queue_count);
+	if (status != B_OK)
+		return status;
+
+	snprintf(name, sizeof(name), "%s consumer %" B_PRIu32,
+		interface->device->name, index);
+
+	queue->consumer_thread = spawn_kernel_thread(device_consumer_thread,
+		name, B_DISPLAY_PRIORITY, queue);
+	if (queue->consumer_thread < B_OK) {
+		uninit_fifo(&queue->fifo);
+		return queue->consumer_thread;
+	}
+
+	resume_thread(queue->consumer_thread);
+	return B_OK;
+}
+
+
+static void
+uninit_receive_queue(net_receive_queue* queue)
+{
+	uninit_fifo(&queue->fifo);
+
+	status_t status;
+	wait_for_thread(queue->consumer_thread, &status);
+}
+
+
 static net_device_interface*
 allocate_device_interface(net_device* device, net_device_module_info* module)
 {
@@ -172,28 +315,34 @@ allocate_device_interface(net_device* device, net_device_module_info* module)
 
 	recursive_lock_init(&interface->receive_lock, "device interface receive");
 	recursive_lock_init(&interface->monitor_lock, "device interface monitors");
-
-	char name[128];
-	snprintf(name, sizeof(name), "%s receive queue", device->name);
-
-	if (init_fifo(&interface->receive_queue, name, 16 * 1024 * 1024) < B_OK)
-		goto error1;
+	rw_lock_init(&interface->receive_funcs_lock,
+		"device interface receive funcs");
 
 	interface->device = device;
+	interface->reader_count = 0;
 	interface->up_count = 0;
 	interface->ref_count = 1;
 	interface->monitor_count = 0;
 	interface->deframe_func = NULL;
 	interface->deframe_ref_count = 0;
 
-	snprintf(name, sizeof(name), "%s consumer", device->name);
+	for (uint32 i = 0; i < kMaxReceiveQueues; i++) {
+		interface->receive_queues[i].interface = interface;
+		interface->receive_queues[i].index = i;
+		interface->receive_queues[i].reader_thread = -1;
+	}
 
-	interface->reader_thread   = -1;
-	interface->consumer_thread = spawn_kernel_thread(device_consumer_thread,
-		name, B_DISPLAY_PRIORITY, interface);
-	if (interface->consumer_thread < B_OK)
-		goto error2;
-	resume_thread(interface->consumer_thread);
+	// use one consumer thread per CPU
+	interface->receive_queue_count = min_c((uint32)smp_get_num_cpus(),
+		kMaxReceiveQueues);
+
+	for (uint32 i = 0; i < interface->receive_queue_count; i++) {
+		if (init_receive_queue(interface, i) != B_OK) {
+			while (i-- > 0)
+				uninit_receive_queue(&interface->receive_queues[i]);
+			goto error;
+		}
+	}
 
 	// TODO: proper interface index allocation
 	device->index = ++sDeviceIndex;
@@ -202,9 +351,8 @@ allocate_device_interface(net_device* device, net_device_module_info* module)
 	sInterfaces.Add(interface);
 	return interface;
 
-error2:
-	uninit_fifo(&interface->receive_queue);
-error1:
+error:
+	rw_lock_destroy(&interface->receive_funcs_lock);
 	recursive_lock_destroy(&interface->receive_lock);
 	recursive_lock_destroy(&interface->monitor_lock);
 	delete interface;
@@ -242,12 +390,11 @@ dump_device_interface(int argc, char** argv)
 		= (net_device_interface*)parse_expression(argv[1]);
 
 	kprintf("device:            %p\n", interface->device);
-	kprintf("reader_thread:     %" B_PRId32 "\n", interface->reader_thread);
+	kprintf("reader_count:      %" B_PRIu32 "\n", interface->reader_count);
 	kprintf("up_count:          %" B_PRIu32 "\n", interface->up_count);
 	kprintf("ref_count:         %" B_PRId32 "\n", interface->ref_count);
 	kprintf("deframe_func:      %p\n", interface->deframe_func);
 	kprintf("deframe_ref_count: %" B_PRId32 "\n", interface->ref_count);
-	kprintf("consumer_thread:   %" B_PRId32 "\n", interface->consumer_thread);
 
 	kprintf("monitor_count:     %" B_PRId32 "\n", interface->monitor_count);
 	kprintf("monitor_lock:      %p\n", &interface->monitor_lock);
@@ -258,13 +405,21 @@ dump_device_interface(int argc, char** argv)
 		kprintf("  %p\n", monitorIterator.Next());
 
 	kprintf("receive_lock:      %p\n", &interface->receive_lock);
-	kprintf("receive_queue:     %p\n", &interface->receive_queue);
 	kprintf("receive_funcs:\n");
 	DeviceHandlerList::Iterator handlerIterator
 		= interface->receive_funcs.GetIterator();
 	while (handlerIterator.HasNext())
 		kprintf("  %p\n", handlerIterator.Next());
 
+	kprintf("receive_queues:\n");
+	for (uint32 i = 0; i < interface->receive_queue_count; i++) {
+		net_receive_queue& queue = interface->receive_queues[i];
+		kprintf("  %p  reader %" B_PRId32 ", consumer %" B_PRId32 ", %"
+			B_PRIuSIZE " bytes\n", &queue.fifo,
+			i < interface->reader_count ? queue.reader_thread : -1,
+			queue.consumer_thread, queue.fifo.current_bytes);
+	}
+
 	return 0;
 }
 
@@ -382,9 +537,8 @@ put_device_interface(struct net_device_interface* interface)
 	sInterfaces.Remove(interface);
 	locker.Unlock();
 
-	uninit_fifo(&interface->receive_queue);
-	status_t status;
-	wait_for_thread(interface->consumer_thread, &status);
+	for (uint32 i = 0; i < interface->receive_queue_count; i++)
+		uninit_receive_queue(&interface->receive_queues[i]);
 
 	net_device* device = interface->device;
 	const char* moduleName = device->module->info.name;
@@ -392,6 +546,7 @@ put_device_interface(struct net_device_interface* interface)
 	device->module->uninit_device(device);
 	put_module(moduleName);
 
+	rw_lock_destroy(&interface->receive_funcs_lock);
 	recursive_lock_destroy(&interface->monitor_lock);
 	recursive_lock_destroy(&interface->receive_lock);
 	delete interface;
@@ -489,6 +644,47 @@ device_interface_monitor_receive(net_device_interface* interface,
 }
 
 
+/*!	Puts the \a buffer into one of the receive queues of the \a interface.
+	The packets of a flow always go into the same queue, so that they are
+	processed in order, while different flows are spread over the consumer
+	threads of all queues.
+*/
+status_t
+device_interface_enqueue_buffer(net_device_interface* interface,
+	net_buffer* buffer)
+{
+	uint32 index = 0;
+	if (interface->receive_queue_count > 1
+		&& (buffer->interface_address != NULL
+			|| (interface->device->flags & IFF_LOOPBACK) != 0
+			|| buffer->type == B_NET_FRAME_TYPE_IPV4
+			|| buffer->type == B_NET_FRAME_TYPE_IPV6))
+		index = flow_hash(buffer) % interface->receive_queue_count;
+
+	net_fifo* fifo = &interface->receive_queues[index].fifo;
+
+	if (has_external_data(buffer)) {
+		// The buffer is delivered locally, and may wait in a receive queue
+		// for long; it must not keep the memory of a zero copy send pinned
+		// until then.
+		net_buffer* copy = gNetBufferModule.duplicate(buffer);
+		if (copy == NULL)
+			return B_NO_MEMORY;
+
+		status_t status = fifo_enqueue_buffer(fifo, copy);
+		if (status != B_OK) {
+			gNetBufferModule.free(copy);
+			return status;
+		}
+
+		gNetBufferModule.free(buffer);
+		return B_OK;
+	}
+
+	return fifo_enqueue_buffer(fifo, buffer);
+}
+
+
 status_t
 up_device_interface(net_device_interface* interface)
 {
@@ -505,21 +701,45 @@ up_device_interface(net_device_interface* interface)
 	if (status != B_OK)
 		return status;
 
-	if (device->module->receive_data != NULL) {
+	// start a reader thread for each receive queue of the device
+	uint32 readerCount = 0;
+	if (device->module->receive_queue_data != NULL) {
+		readerCount = min_c(device->module->receive_queue_count(device),
+			kMaxReceiveQueues);
+	} else if (device->module->receive_data != NULL)
+		readerCount = 1;
+
+	for (uint32 i = 0; i < readerCount; i++) {
+		net_receive_queue& queue = interface->receive_queues[i];
+
 		// give the thread a nice name
 		char name[B_OS_NAME_LENGTH];
-		snprintf(name, sizeof(name), "%s reader", device->name);
+		snprintf(name, sizeof(name), "%s reader %" B_PRIu32, device->name, i);
+
+		queue.reader_thread = spawn_kernel_thread(device_reader_thread,
+			name, B_REAL_TIME_DISPLAY_PRIORITY - 10, &queue);
+		if (queue.reader_thread < B_OK) {
+			status = queue.reader_thread;
+
+			// the threads that were already created quit right away, as
+			// the device is not up
+			while (i-- > 0) {
+				thread_id thread = interface->receive_queues[i].reader_thread;
+				resume_thread(thread);
 
-		interface->reader_thread = spawn_kernel_thread(device_reader_thread,
-			name, B_REAL_TIME_DISPLAY_PRIORITY - 10, interface);
-		if (interface->reader_thread < B_OK)
-			return interface->reader_thread;
+				status_t exitStatus;
+				wait_for_thread(thread, &exitStatus);
+			}
+			device->module->down(device);
+			return status;
+		}
 	}
 
 	device->flags |= IFF_UP;
 
-	if (device->module->receive_data != NULL)
-		resume_thread(interface->reader_thread);
+	interface->reader_count = readerCount;
+	for (uint32 i = 0; i < readerCount; i++)
+		resume_thread(interface->receive_queues[i].reader_thread);
 
 	interface->up_count = 1;
 	return B_OK;
@@ -549,13 +769,12 @@ down_device_interface(net_device_interface* interface)
 
 	notify_device_monitors(interface, B_DEVICE_GOING_DOWN);
 
-	if (device->module->receive_data != NULL) {
-		thread_id readerThread = interface->reader_thread;
-
-		// make sure the reader thread is gone before shutting down the interface
+	// make sure the reader threads are gone before shutting down the interface
+	for (uint32 i = 0; i < interface->reader_count; i++) {
 		status_t status;
-		wait_for_thread(readerThread, &status);
+		wait_for_thread(interface->receive_queues[i].reader_thread, &status);
 	}
+	interface->reader_count = 0;
 }
 
 
@@ -657,6 +876,8 @@ register_device_handler(struct net_device* device, int32 type,
 	handler->func = receiveFunc;
 	handler->type = type;
 	handler->cookie = cookie;
+
+	WriteLocker handlerLocker(interface->receive_funcs_lock);
 	interface->receive_funcs.Add(handler);
 	return B_OK;
 }
@@ -682,7 +903,9 @@ unregister_device_handler(struct net_device* device, int32 type)
 	while (net_device_handler* handler = iterator.Next()) {
 		if (handler->type == type) {
 			// found it
+			WriteLocker handlerLocker(interface->receive_funcs_lock);
 			iterator.Remove();
+			handlerLocker.Unlock();
 			delete handler;
 			return B_OK;
 		}
@@ -750,6 +973,9 @@ unregister_device_monitor(net_device* device, net_device_monitor* monitor)
 status_t
 device_link_changed(net_device* device)
 {
+	// routes to devices without a link are only used as a last resort
+	invalidate_route_caches();
+
 	notify_link_changed(device);
 	return B_OK;
 }
@@ -796,7 +1022,7 @@ device_enqueue_buffer(net_device* device, net_buffer* buffer)
 	if (interface == NULL)
 		return B_DEVICE_NOT_FOUND;
 
-	status_t status = fifo_enqueue_buffer(&interface->receive_queue, buffer);
+	status_t status = device_interface_enqueue_buffer(interface, buffer);
 
 	put_device_interface(interface);
 	return status;
@@ -26,9 +26,20 @@ typedef DoublyLinkedList<net_device_handler> DeviceHandlerList;
 typedef DoublyLinkedList<net_device_monitor,
 	DoublyLinkedListCLink<net_device_monitor> > DeviceMonitorList;
 
+static const uint32 kMaxReceiveQueues = 16;
+
+struct net_receive_queue {
+	struct net_device_interface* interface;
+	uint32				index;
+	thread_id			reader_thread;
+		// reads the hardware queue with the same index, if any
+	thread_id			consumer_thread;
+	net_fifo			fifo;
+};
+
 struct net_device_interface : DoublyLinkedListLinkImpl<net_device_interface> {
 	struct net_device*	device;
-	thread_id			reader_thread;
+	uint32				reader_count;
 	uint32				up_count;
 		// a device can be brought up by more than one interface
 	int32				ref_count;
@@ -41,10 +52,12 @@ struct net_device_interface : DoublyLinkedListLinkImpl<net_device_interface> {
 	DeviceMonitorList	monitor_funcs;
 
 	DeviceHandlerList	receive_funcs;
+	rw_lock				receive_funcs_lock;
 	recursive_lock		receive_lock;
 
-	thread_id			consumer_thread;
-	net_fifo			receive_queue;
+	uint32				receive_queue_count;
+	net_receive_queue	receive_queues[kMaxReceiveQueues];
+		// one consumer thread per CPU, see device_interface_enqueue_buffer()
 };
 
 typedef DoublyLinkedList<net_device_interface> DeviceInterfaceList;
@@ -62,6 +75,8 @@ struct net_device_interface* get_device_interface(const char* name,
 	bool create = true);
 void device_interface_monitor_receive(net_device_interface* interface,
 	net_buffer* buffer);
+status_t device_interface_enqueue_buffer(net_device_interface* interface,
+	net_buffer* buffer);
 status_t up_device_interface(net_device_interface* interface);
 void down_device_interface(net_device_interface* interface);
 
@@ -9,6 +9,7 @@
 
 #include "domains.h"
 #include "interfaces.h"
+#include "route_table.h"
 #include "utility.h"
 #include "stack_private.h"
 
@@ -133,6 +134,8 @@ register_domain(int family, const char* name,
 		return B_NO_MEMORY;
 
 	recursive_lock_init(&domain->lock, name);
+	rw_lock_init(&domain->route_table_lock, name);
+	domain->route_table = NULL;
 
 	domain->family = family;
 	domain->name = name;
@@ -157,6 +160,8 @@ unregister_domain(net_domain* _domain)
 
 	sDomains.Remove(domain);
 
+	delete domain->route_table;
+	rw_lock_destroy(&domain->route_table_lock);
 	recursive_lock_destroy(&domain->lock);
 	delete domain;
 	return B_OK;
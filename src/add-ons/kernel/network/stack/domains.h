@@ -17,6 +17,7 @@
 
 
 struct net_device_interface;
+class RouteTable;
 
 
 struct net_domain_private : net_domain,
@@ -25,6 +26,10 @@ struct net_domain_private : net_domain,
 
 	RouteList			routes;
 	RouteInfoList		route_infos;
+
+	rw_lock				route_table_lock;
+	RouteTable*			route_table;
+		// built from the routes on demand, and deleted when they change
 };
 
 
@@ -70,6 +70,21 @@ struct data_header {
 	uint8*			data_end;
 	header_space	space;
 	uint16			tail_space;
+	uint16			checksum_length;
+	uint8*			checksum_start;
+	uint16			checksum;
+		// the one's complement sum of the checksum_length bytes at
+		// checksum_start, computed when they were copied in
+	void			(*release_external)(void* cookie);
+	void*			external_cookie;
+		// set for headers that refer to memory the buffer doesn't own
+
+	void InvalidateChecksum(const uint8* start, size_t size)
+	{
+		if (checksum_length != 0 && start < checksum_start + checksum_length
+			&& start + size > checksum_start)
+			checksum_length = 0;
+	}
 };
 
 struct data_node {
@@ -161,6 +176,8 @@ static status_t remove_header(net_buffer* _buffer, size_t bytes);
 static status_t remove_trailer(net_buffer* _buffer, size_t bytes);
 static status_t append_cloned_data(net_buffer* _buffer, net_buffer* _source,
 					uint32 offset, size_t bytes);
+static status_t append_external_data(net_buffer* _buffer, const void* data,
+					size_t bytes, void (*release)(void* cookie), void* cookie);
 static status_t read_data(net_buffer* _buffer, size_t offset, void* data,
 					size_t size);
 
@@ -813,6 +830,9 @@ create_data_header(size_t headerSpace)
 	header->tail_space = (uint8*)header + BUFFER_SIZE - header->data_end
 		- headerSpace;
 	header->first_free = NULL;
+	header->checksum_length = 0;
+	header->release_external = NULL;
+	header->external_cookie = NULL;
 
 	TRACE(("%ld:   create new data header %p\n", find_thread(NULL), header));
 	T2(CreateDataHeader(header));
@@ -829,6 +849,9 @@ release_data_header(data_header* header)
 		return;
 
 	TRACE(("%ld:   free header %p\n", find_thread(NULL), header));
+	if (header->release_external != NULL)
+		header->release_external(header->external_cookie);
+
 	free_data_header(header);
 }
 
@@ -995,6 +1018,7 @@ remove_data_node(data_node* node)
 	// Move all used and tail space to the header space, which is useful in case
 	// this is the first node of a buffer (i.e. the header is an allocation
 	// header).
+	node->header->InvalidateChecksum(node->start, node->used);
 	node->FreeSpace();
 
 	if (located != node->header)
@@ -1080,10 +1104,31 @@ copy_metadata(net_buffer* destination, const net_buffer* source)
 
 	destination->offset = source->offset;
 	destination->protocol = source->protocol;
+	destination->offload_flags = source->offload_flags;
+	destination->segment_size = source->segment_size;
 	destination->type = source->type;
 }
 
 
+/*!	Returns whether the \a buffer refers to memory it doesn't own, that has
+	been added with append_external_data().
+*/
+bool
+has_external_data(net_buffer* _buffer)
+{
+	net_buffer_private* buffer = (net_buffer_private*)_buffer;
+
+	data_node* node = (data_node*)list_get_first_item(&buffer->buffers);
+	for (; node != NULL;
+			node = (data_node*)list_get_next_item(&buffer->buffers, node)) {
+		if (node->header->release_external != NULL)
+			return true;
+	}
+
+	return false;
+}
+
+
 //	#pragma mark - module API
 
 
@@ -1128,6 +1173,8 @@ create_buffer(size_t headerSpace)
 	buffer->offset = 0;
 	buffer->flags = 0;
 	buffer->size = 0;
+	buffer->offload_flags = 0;
+	buffer->segment_size = 0;
 
 	CHECK_BUFFER(buffer);
 	CREATE_PARANOIA_CHECK_SET(buffer, "net_buffer");
@@ -1483,6 +1530,7 @@ write_data(net_buffer* _buffer, size_t offset, const void* data, size_t size)
 
 	while (true) {
 		size_t written = min_c(size, node->used - offset);
+		node->header->InvalidateChecksum(node->start + offset, written);
 		if (IS_USER_ADDRESS(data)) {
 			if (user_memcpy(node->start + offset, data, written) != B_OK)
 				return B_BAD_ADDRESS;
@@ -1776,9 +1824,48 @@ append_size(net_buffer* _buffer, size_t size, void** _contiguousBuffer)
 }
 
 
+/*!	Copies \a size bytes of \a data to the freshly appended space at
+	\a target in \a node, and remembers their checksum in the node's header,
+	so that checksum_data() doesn't have to read them again.
+*/
+static status_t
+copy_appended_data(data_node* node, uint8* target, const void* data,
+	size_t size)
+{
+	uint16 sum;
+	if (IS_USER_ADDRESS(data)) {
+		if (user_memcpy(target, data, size) != B_OK)
+			return B_BAD_ADDRESS;
+
+		// user_memcpy() must handle page faults, so we can only sum up the
+		// data right after it has been copied, while it's still cached
+		sum = compute_checksum(target, size);
+	} else
+		sum = copy_and_compute_checksum(target, (const uint8*)data, size);
+
+	data_header* header = node->header;
+	if (header->checksum_length != 0
+		&& header->checksum_start + header->checksum_length == target) {
+		// extend the range we know the checksum of
+		if ((header->checksum_length & 1) != 0)
+			sum = __swap_int16(sum);
+		uint32 newSum = (uint32)header->checksum + sum;
+		header->checksum = (newSum & 0xffff) + (newSum >> 16);
+		header->checksum_length += size;
+	} else {
+		header->checksum_start = target;
+		header->checksum_length = size;
+		header->checksum = sum;
+	}
+
+	return B_OK;
+}
+
+
 static status_t
-append_data(net_buffer* buffer, const void* data, size_t size)
+append_data(net_buffer* _buffer, const void* data, size_t size)
 {
+	net_buffer_private* buffer = (net_buffer_private*)_buffer;
 	size_t used = buffer->size;
 
 	void* contiguousBuffer;
@@ -1787,13 +1874,35 @@ append_data(net_buffer* buffer, const void* data, size_t size)
 		return status;
 
 	if (contiguousBuffer) {
-		if (IS_USER_ADDRESS(data)) {
-			if (user_memcpy(contiguousBuffer, data, size) != B_OK)
-				return B_BAD_ADDRESS;
-		} else
-			memcpy(contiguousBuffer, data, size);
-	} else
-		write_data(buffer, used, data, size);
+		return copy_appended_data(
+			(data_node*)list_get_last_item(&buffer->buffers),
+			(uint8*)contiguousBuffer, data, size);
+	}
+
+	data_node* node = get_node_at_offset(buffer, used);
+	if (node == NULL)
+		return B_BAD_VALUE;
+
+	size_t offset = used - node->offset;
+
+	while (true) {
+		size_t written = min_c(size, node->used - offset);
+		status = copy_appended_data(node, node->start + offset, data,
+			written);
+		if (status != B_OK)
+			return status;
+
+		size -= written;
+		if (size == 0)
+			break;
+
+		offset = 0;
+		data = (const uint8*)data + written;
+
+		node = (data_node*)list_get_next_item(&buffer->buffers, node);
+		if (node == NULL)
+			return B_BAD_VALUE;
+	}
 
 	return B_OK;
 }
@@ -1844,6 +1953,7 @@ remove_header(net_buffer* _buffer, size_t bytes)
 
 	if (node != NULL) {
 		size_t cut = min_c(node->used, left);
+		node->header->InvalidateChecksum(node->start, cut);
 		node->offset = 0;
 		node->start += cut;
 		if ((node->flags & DATA_NODE_STORED_HEADER) != 0)
@@ -1908,6 +2018,7 @@ trim_data(net_buffer* _buffer, size_t newSize)
 	}
 
 	int32 diff = node->used + node->offset - newSize;
+	node->header->InvalidateChecksum(node->start + node->used - diff, diff);
 	node->SetTailSpace(node->TailSpace() + diff);
 	node->used -= diff;
 
@@ -1934,6 +2045,63 @@ trim_data(net_buffer* _buffer, size_t newSize)
 }
 
 
+/*!	Appends \a bytes of memory at \a data to the buffer without copying it.
+	The memory must remain valid and unchanged until \a release is called
+	with \a cookie, which happens once no buffer refers to it anymore, and
+	also if this function fails.
+*/
+static status_t
+append_external_data(net_buffer* _buffer, const void* data, size_t bytes,
+	void (*release)(void* cookie), void* cookie)
+{
+	net_buffer_private* buffer = (net_buffer_private*)_buffer;
+
+	data_header* header = create_data_header(0);
+	if (header == NULL) {
+		release(cookie);
+		return B_NO_MEMORY;
+	}
+
+	header->tail_space = 0;
+	header->release_external = release;
+	header->external_cookie = cookie;
+
+	ParanoiaChecker _(buffer);
+
+	status_t status = B_OK;
+	size_t sizeAppended = 0;
+
+	while (sizeAppended < bytes) {
+		data_node* node = add_data_node(buffer, header);
+		if (node == NULL) {
+			remove_trailer(buffer, sizeAppended);
+			status = ENOBUFS;
+			break;
+		}
+
+		// The node size is limited to 16 bit
+		node->offset = buffer->size;
+		node->start = (uint8*)data + sizeAppended;
+		node->used = min_c(bytes - sizeAppended, 32768);
+		node->flags = DATA_NODE_READ_ONLY;
+
+		list_add_item(&buffer->buffers, node);
+
+		buffer->size += node->used;
+		sizeAppended += node->used;
+	}
+
+	// the nodes hold their own references now
+	release_data_header(header);
+
+	CHECK_BUFFER(buffer);
+	SET_PARANOIA_CHECK(PARANOIA_SUSPICIOUS, buffer, &buffer->size,
+		sizeof(buffer->size));
+
+	return status;
+}
+
+
 /*!	Appends data coming from buffer \a source to the buffer \a buffer. It only
 	clones the data, though, that is the data is not copied, just referenced.
 */
@@ -2203,11 +2371,45 @@ direct_access(net_buffer* _buffer, uint32 offset, size_t size,
 	if (size > node->used - offset)
 		return B_ERROR;
 
+	// the caller may change the data
+	node->header->InvalidateChecksum(node->start + offset, size);
+
 	*_contiguousBuffer = node->start + offset;
 	return B_OK;
 }
 
 
+/*!	Returns the one's complement sum of the \a size bytes at \a start of
+	\a node. If they contain the data the checksum of which is known, only
+	the rest of them is read.
+*/
+static uint16
+node_checksum(data_node* node, uint8* start, size_t size)
+{
+	data_header* header = node->header;
+	uint8* known = header->checksum_start;
+	size_t knownLength = header->checksum_length;
+	if (knownLength == 0 || known < start
+		|| known + knownLength > start + size)
+		return compute_checksum(start, size);
+
+	size_t before = known - start;
+	size_t after = start + size - (known + knownLength);
+
+	uint32 sum = compute_checksum(start, before);
+	uint16 knownSum = header->checksum;
+	sum += (before & 1) != 0 ? __swap_int16(knownSum) : knownSum;
+	uint16 afterSum = compute_checksum(known + knownLength, after);
+	sum += ((before + knownLength) & 1) != 0
+		? __swap_int16(afterSum) : afterSum;
+
+	while (sum >> 16)
+		sum = (sum & 0xffff) + (sum >> 16);
+
+	return sum;
+}
+
+
 static int32
 checksum_data(net_buffer* _buffer, uint32 offset, size_t size, bool finalize)
 {
@@ -2232,9 +2434,10 @@ checksum_data(net_buffer* _buffer, uint32 offset, size_t size, bool finalize)
 		size_t bytes = min_c(size, node->used - offset);
 		if ((offset + node->offset) & 1) {
 			// if we're at an uneven offset, we have to swap the checksum
-			sum += __swap_int16(compute_checksum(node->start + offset, bytes));
+			sum += __swap_int16(node_checksum(node, node->start + offset,
+				bytes));
 		} else
-			sum += compute_checksum(node->start + offset, bytes);
+			sum += node_checksum(node, node->start + offset, bytes);
 
 		size -= bytes;
 		if (size == 0)
@@ -2377,6 +2580,7 @@ net_buffer_module_info gNetBufferModule = {
 	remove_trailer,
 	trim_data,
 	append_cloned_data,
+	append_external_data,
 
 	NULL,	// associate_data
 
@@ -24,16 +24,21 @@
 #include <team.h>
 #include <util/AutoLock.h>
 #include <util/list.h>
+#include <util/SinglyLinkedList.h>
 #include <WeakReferenceable.h>
 
 #include <fs/select_sync_pool.h>
 #include <kernel.h>
+#include <vm/vm.h>
+#include <vm/VMAddressSpace.h>
 
 #include <net_protocol.h>
 #include <net_stack.h>
 #include <net_stat.h>
 
 #include "ancillary_data.h"
+#include "dma_resources.h"
+#include "routes.h"
 #include "utility.h"
 
 
@@ -48,6 +53,33 @@
 struct net_socket_private;
 typedef DoublyLinkedList<net_socket_private> SocketList;
 
+struct zerocopy_mapping : SinglyLinkedListLinkImpl<zerocopy_mapping> {
+	const uint8*	user_data;
+	size_t			size;
+	uint8*			data;
+		// where the user data is mapped into the kernel
+	area_id			area;
+		// shares the memory with the team, but doesn't depend on it
+};
+
+typedef SinglyLinkedList<zerocopy_mapping> ZeroCopyMappingList;
+
+/*!	A send with MSG_ZEROCOPY: it is complete when the buffers no longer
+	refer to the user memory, and then queued to the socket as notification.
+*/
+struct zerocopy_send : DoublyLinkedListLinkImpl<zerocopy_send> {
+	BWeakReference<net_socket_private> socket;
+	team_id				team;
+	ZeroCopyMappingList	mappings;
+	int32				ref_count;
+	uint32				first;
+	uint32				last;
+	bool				copied;
+	bool				aborted;
+};
+
+typedef DoublyLinkedList<zerocopy_send> ZeroCopySendList;
+
 struct net_socket_private : net_socket,
 		DoublyLinkedListLinkImpl<net_socket_private>,
 		BWeakReferenceable {
@@ -66,6 +98,13 @@ struct net_socket_private : net_socket,
 	struct select_sync_pool*	select_pool;
 	mutex						lock;
 
+	ZeroCopySendList			zerocopy_notifications;
+	uint32						zerocopy_next;
+	uint32						zerocopy_count;
+		// the sends that are in progress, or have a notification queued
+
+	net_route_cache				route_cache;
+
 	bool						is_connected;
 	bool						is_in_socket_list;
 };
@@ -77,6 +116,13 @@ int socket_setsockopt(net_socket* socket, int level, int option,
 	const void* value, int length);
 ssize_t socket_read_avail(net_socket* socket);
 
+static const size_t kMinZeroCopySize = 16 * 1024;
+	// copying less data is cheaper than mapping it
+static const size_t kMaxZeroCopyMappingSize = 1024 * 1024;
+static const uint32 kMaxZeroCopySends = 1024;
+	// limits the notifications that can pile up for a socket
+static const size_t kMaxReceiveBatch = 32;
+
 static SocketList sSocketList;
 static mutex sSocketLock;
 
@@ -87,6 +133,8 @@ net_socket_private::net_socket_private()
 	max_backlog(0),
 	child_count(0),
 	select_pool(NULL),
+	zerocopy_next(0),
+	zerocopy_count(0),
 	is_connected(false),
 	is_in_socket_list(false)
 {
@@ -101,6 +149,7 @@ net_socket_private::net_socket_private()
 	peer.ss_len = 0;
 
 	mutex_init(&lock, "socket");
+	init_route_cache(&route_cache);
 
 	// set defaults (may be overridden by the protocols)
 	send.buffer_size = 65535;
@@ -134,8 +183,12 @@ net_socket_private::~net_socket_private()
 		child->RemoveFromParent();
 	}
 
+	while (zerocopy_send* send = zerocopy_notifications.RemoveHead())
+		delete send;
+
 	mutex_unlock(&lock);
 
+	uninit_route_cache(&route_cache);
 	put_domain_protocols(this);
 
 	mutex_destroy(&lock);
@@ -334,6 +387,218 @@ socket_receive_no_buffer(net_socket* socket, msghdr* header, void* data,
 }
 
 
+//	#pragma mark - zero copy sends
+
+
+static zerocopy_send*
+zerocopy_create(net_socket_private* socket)
+{
+	MutexLocker locker(socket->lock);
+	if (socket->zerocopy_count >= kMaxZeroCopySends)
+		return NULL;
+
+	zerocopy_send* send = new(std::nothrow) zerocopy_send;
+	if (send == NULL)
+		return NULL;
+
+	socket->zerocopy_count++;
+	locker.Unlock();
+
+	send->socket.SetTo(socket);
+	send->team = team_get_current_team_id();
+	send->ref_count = 1;
+	send->first = send->last = 0;
+	send->copied = false;
+	send->aborted = false;
+	return send;
+}
+
+
+/*!	Releases a reference to the \a _send; the last one unmaps the user
+	memory, and queues the notification to the socket.
+*/
+static void
+zerocopy_release(void* _send)
+{
+	zerocopy_send* send = (zerocopy_send*)_send;
+	if (atomic_add(&send->ref_count, -1) != 1)
+		return;
+
+	while (zerocopy_mapping* mapping = send->mappings.RemoveHead()) {
+		unlock_memory_etc(VMAddressSpace::KernelID(), mapping->data,
+			mapping->size, 0);
+		delete_area(mapping->area);
+		delete mapping;
+	}
+
+	BReference<net_socket_private> socket = send->socket.GetReference();
+	send->socket.Unset();
+	if (socket.Get() == NULL) {
+		delete send;
+		return;
+	}
+
+	MutexLocker locker(socket->lock);
+
+	if (send->aborted) {
+		socket->zerocopy_count--;
+		delete send;
+		return;
+	}
+
+	zerocopy_send* last = socket->zerocopy_notifications.Tail();
+	if (last != NULL && last->last + 1 == send->first
+		&& last->copied == send->copied) {
+		last->last = send->last;
+		socket->zerocopy_count--;
+		delete send;
+	} else
+		socket->zerocopy_notifications.Add(send);
+
+	if (socket->select_pool != NULL)
+		notify_select_event_pool(socket->select_pool, B_SELECT_ERROR);
+}
+
+
+/*!	Maps up to \a size bytes of user memory at \a data into the kernel, and
+	wires them there. The range ends early at the end of the user area.
+	Since the kernel area shares the memory with the team instead of wiring
+	the team's area, the team may free it, fork, or exit, before the data
+	has been sent. The memory is wired for writing, as vm_map_user_memory()
+	requires, but the kernel only ever reads from it.
+*/
+static status_t
+zerocopy_map(zerocopy_send* send, const uint8* data, size_t size)
+{
+	zerocopy_mapping* mapping = new(std::nothrow) zerocopy_mapping;
+	if (mapping == NULL)
+		return B_NO_MEMORY;
+
+	ObjectDeleter<zerocopy_mapping> mappingDeleter(mapping);
+
+	void* address;
+	mapping->area = vm_map_user_memory(send->team, (addr_t)data, size,
+		"zero copy send", &address, &mapping->size);
+	if (mapping->area < 0)
+		return mapping->area;
+
+	status_t status = lock_memory_etc(VMAddressSpace::KernelID(), address,
+		mapping->size, 0);
+	if (status != B_OK) {
+		delete_area(mapping->area);
+		return status;
+	}
+
+	mapping->user_data = data;
+	mapping->data = (uint8*)address;
+	send->mappings.Add(mappingDeleter.Detach());
+	return B_OK;
+}
+
+
+/*!	Appends \a bytes of user memory at \a data to the \a buffer without
+	copying it. \a available is the size of the user buffer from \a data on,
+	which is mapped in larger parts, so that the next buffers can use them, too.
+*/
+static status_t
+zerocopy_append(zerocopy_send* send, net_buffer* buffer, const uint8* data,
+	size_t bytes, size_t available)
+{
+	while (bytes > 0) {
+		zerocopy_mapping* mapping = send->mappings.Head();
+		if (mapping == NULL || data < mapping->user_data
+			|| data >= mapping->user_data + mapping->size) {
+			status_t status = zerocopy_map(send, data,
+				min_c(available, kMaxZeroCopyMappingSize));
+			if (status != B_OK) {
+				// the memory cannot be shared, copy it instead
+				send->copied = true;
+				return gNetBufferModule.append(buffer, data, bytes);
+			}
+
+			mapping = send->mappings.Head();
+		}
+
+		size_t offset = data - mapping->user_data;
+		size_t size = min_c(bytes, mapping->size - offset);
+
+		atomic_add(&send->ref_count, 1);
+		status_t status = gNetBufferModule.append_external(buffer,
+			mapping->data + offset, size, &zerocopy_release, send);
+		if (status != B_OK)
+			return status;
+
+		data += size;
+		bytes -= size;
+		available -= size;
+	}
+
+	return B_OK;
+}
+
+
+/*!	Numbers the \a send if it sent anything, and releases the reference the
+	sender had to it.
+*/
+static void
+zerocopy_finish(net_socket_private* socket, zerocopy_send* send,
+	ssize_t bytesSent)
+{
+	if (bytesSent > 0) {
+		MutexLocker _(socket->lock);
+		send->first = send->last = socket->zerocopy_next++;
+	} else
+		send->aborted = true;
+
+	zerocopy_release(send);
+}
+
+
+//!	Receives the oldest zero copy notification as SCM_ZEROCOPY message.
+static ssize_t
+socket_receive_zerocopy_notification(net_socket_private* socket,
+	msghdr* header)
+{
+	if (header == NULL || header->msg_control == NULL)
+		return B_BAD_VALUE;
+
+	MutexLocker locker(socket->lock);
+	zerocopy_send* send = socket->zerocopy_notifications.Head();
+	if (send == NULL)
+		return B_WOULD_BLOCK;
+
+	header->msg_namelen = 0;
+	header->msg_flags = 0;
+
+	zerocopy_notification notification;
+	if (header->msg_controllen < CMSG_SPACE(sizeof(notification))) {
+		// the notification stays queued for a call with enough space
+		header->msg_controllen = 0;
+		header->msg_flags = MSG_CTRUNC;
+		return 0;
+	}
+
+	notification.zc_first = send->first;
+	notification.zc_last = send->last;
+	notification.zc_flags = send->copied ? ZEROCOPY_COPIED : 0;
+
+	socket->zerocopy_notifications.Remove(send);
+	socket->zerocopy_count--;
+	locker.Unlock();
+
+	delete send;
+
+	cmsghdr* control = (cmsghdr*)header->msg_control;
+	control->cmsg_len = CMSG_LEN(sizeof(notification));
+	control->cmsg_level = SOL_SOCKET;
+	control->cmsg_type = SCM_ZEROCOPY;
+	memcpy(CMSG_DATA(control), &notification, sizeof(notification));
+	header->msg_controllen = CMSG_SPACE(sizeof(notification));
+
+	return 0;
+}
+
+
 #if ENABLE_DEBUGGER_COMMANDS
 
 
@@ -423,6 +688,13 @@ dump_sockets(int argc, char** argv)
 //	#pragma mark -
 
 
+net_route_cache*
+get_socket_route_cache(net_socket* socket)
+{
+	return &((net_socket_private*)socket)->route_cache;
+}
+
+
 status_t
 socket_open(int family, int type, int protocol, net_socket** _socket)
 {
@@ -905,8 +1177,13 @@ socket_request_notification(net_socket* _socket, uint8 event, selectsync* sync)
 			break;
 		}
 		case B_SELECT_ERROR:
-			// TODO: B_SELECT_ERROR condition!
+		{
+			// TODO: report pending socket errors as well!
+			MutexLocker _(socket->lock);
+			if (!socket->zerocopy_notifications.IsEmpty())
+				notify_select_event(sync, event);
 			break;
+		}
 	}
 
 	return B_OK;
@@ -1149,6 +1426,7 @@ socket_get_option(net_socket* socket, int level, int option, void* value,
 		case SO_REUSEADDR:
 		case SO_REUSEPORT:
 		case SO_USELOOPBACK:
+		case SO_ZEROCOPY:
 		{
 			int32* _set = (int32*)value;
 			*_set = (socket->options & option) != 0;
@@ -1205,33 +1483,16 @@ socket_listen(net_socket* socket, int backlog)
 }
 
 
-ssize_t
-socket_receive(net_socket* socket, msghdr* header, void* data, size_t length,
-	int flags)
+/*!	Copies the data, the source address, and the ancillary data of the
+	received \a buffer into \a header, and \a data. The \a buffer is freed.
+*/
+static ssize_t
+socket_receive_buffer(net_socket* socket, net_buffer* buffer, msghdr* header,
+	void* data, size_t length, int flags)
 {
-	// If the protocol sports read_data_no_buffer() we use it.
-	if (socket->first_info->read_data_no_buffer != NULL)
-		return socket_receive_no_buffer(socket, header, data, length, flags);
-
-	size_t totalLength = length;
-	net_buffer* buffer;
+	status_t status;
 	int i;
 
-	// the convention to this function is that have header been
-	// present, { data, length } would have been iovec[0] and is
-	// always considered like that
-
-	if (header) {
-		// calculate the length considering all of the extra buffers
-		for (i = 1; i < header->msg_iovlen; i++)
-			totalLength += header->msg_iov[i].iov_len;
-	}
-
-	status_t status = socket->first_info->read_data(
-		socket->first_protocol, totalLength, flags, &buffer);
-	if (status != B_OK)
-		return status;
-
 	// process ancillary data
 	if (header != NULL) {
 		if (buffer != NULL && header->msg_control != NULL) {
@@ -1312,8 +1573,127 @@ socket_receive(net_socket* socket, msghdr* header, void* data, size_t length,
 
 
 ssize_t
-socket_send(net_socket* socket, msghdr* header, const void* data, size_t length,
+socket_receive(net_socket* socket, msghdr* header, void* data, size_t length,
 	int flags)
+{
+	if ((flags & MSG_ERRQUEUE) != 0) {
+		return socket_receive_zerocopy_notification(
+			(net_socket_private*)socket, header);
+	}
+
+	// If the protocol sports read_data_no_buffer() we use it.
+	if (socket->first_info->read_data_no_buffer != NULL)
+		return socket_receive_no_buffer(socket, header, data, length, flags);
+
+	size_t totalLength = length;
+	net_buffer* buffer;
+	int i;
+
+	// the convention to this function is that have header been
+	// present, { data, length } would have been iovec[0] and is
+	// always considered like that
+
+	if (header) {
+		// calculate the length considering all of the extra buffers
+		for (i = 1; i < header->msg_iovlen; i++)
+			totalLength += header->msg_iov[i].iov_len;
+	}
+
+	status_t status = socket->first_info->read_data(
+		socket->first_protocol, totalLength, flags, &buffer);
+	if (status != B_OK)
+		return status;
+
+	return socket_receive_buffer(socket, buffer, header, data, length, flags);
+}
+
+
+/*!	Receives up to \a count messages at once. Protocols that implement
+	read_data_multiple() hand out all messages that are already queued at
+	once, and do not wait beyond the \a deadline for them. Only the first
+	message is waited for if \a flags contains MSG_WAITFORONE, and no further
+	messages are received after the \a deadline has passed.
+	Returns the number of messages received, or an error if there were none.
+*/
+ssize_t
+socket_receive_multiple(net_socket* socket, mmsghdr* messages, uint32 count,
+	int flags, bigtime_t deadline)
+{
+	bool batched = (flags & MSG_ERRQUEUE) == 0
+		&& socket->first_info->read_data_no_buffer == NULL
+		&& socket->first_info->read_data_multiple != NULL;
+	uint32 received = 0;
+	status_t status = B_OK;
+
+	while (received < count) {
+		if (received > 0) {
+			if ((flags & MSG_WAITFORONE) != 0)
+				flags |= MSG_DONTWAIT;
+			if (deadline != B_INFINITE_TIMEOUT && system_time() >= deadline)
+				break;
+		}
+
+		if (!batched) {
+			msghdr& header = messages[received].msg_hdr;
+			iovec vec = { NULL, 0 };
+			if (header.msg_iovlen > 0)
+				vec = header.msg_iov[0];
+
+			ssize_t bytesReceived = socket_receive(socket, &header,
+				vec.iov_base, vec.iov_len, flags);
+			if (bytesReceived < 0) {
+				status = bytesReceived;
+				break;
+			}
+
+			messages[received++].msg_len = bytesReceived;
+			continue;
+		}
+
+		net_buffer* buffers[kMaxReceiveBatch];
+		size_t bufferCount = min_c(count - received, kMaxReceiveBatch);
+		status = socket->first_info->read_data_multiple(
+			socket->first_protocol, flags, deadline, buffers, &bufferCount);
+		if (status != B_OK)
+			break;
+
+		for (size_t i = 0; i < bufferCount; i++) {
+			msghdr& header = messages[received].msg_hdr;
+			iovec vec = { NULL, 0 };
+			if (header.msg_iovlen > 0)
+				vec = header.msg_iov[0];
+
+			ssize_t bytesReceived = socket_receive_buffer(socket, buffers[i],
+				&header, vec.iov_base, vec.iov_len, flags);
+			if (bytesReceived < 0) {
+				// leave the messages that follow to the next call
+				status = bytesReceived;
+				if (socket->first_info->unread_data != NULL) {
+					socket->first_info->unread_data(socket->first_protocol,
+						buffers + i + 1, bufferCount - i - 1);
+				} else {
+					for (size_t j = i + 1; j < bufferCount; j++)
+						gNetBufferModule.free(buffers[j]);
+				}
+				break;
+			}
+
+			messages[received++].msg_len = bytesReceived;
+		}
+		if (status != B_OK)
+			break;
+	}
+
+	if (received == 0)
+		return status;
+
+	return received;
+}
+
+
+static ssize_t
+socket_send_buffers(net_socket* socket, msghdr* header, const void* data,
+	size_t length, int flags, zerocopy_send* zeroCopy)
 {
 	const sockaddr* address = NULL;
 	socklen_t addressLength = 0;
@@ -1376,6 +1756,9 @@ socket_send(net_socket* socket, msghdr* header, const void* data, size_t length,
 
 	// If the protocol has a send_data_no_buffer() hook, we use that one.
 	if (socket->first_info->send_data_no_buffer != NULL) {
+		if (zeroCopy != NULL)
+			zeroCopy->copied = true;
+
 		iovec stackVec = { (void*)data, length };
 		iovec* vecs = header ? header->msg_iov : &stackVec;
 		int vecCount = header ? header->msg_iovlen : 1;
@@ -1430,7 +1813,17 @@ socket_send(net_socket* socket, msghdr* header, const void* data, size_t length,
 			if (buffer->size + bytes > socket->send.buffer_size)
 				bytes = socket->send.buffer_size - buffer->size;
 
-			if (gNetBufferModule.append(buffer, data, bytes) < B_OK) {
+			status_t status;
+			if (zeroCopy != NULL && length >= kMinZeroCopySize
+				&& IS_USER_ADDRESS(data)) {
+				status = zerocopy_append(zeroCopy, buffer, (const uint8*)data,
+					bytes, length);
+			} else {
+				if (zeroCopy != NULL)
+					zeroCopy->copied = true;
+				status = gNetBufferModule.append(buffer, data, bytes);
+			}
+			if (status < B_OK) {
 				gNetBufferModule.free(buffer);
 				return ENOBUFS;
 			}
@@ -1488,6 +1881,26 @@ socket_send(net_socket* socket, msghdr* header, const void* data, size_t length,
 }
 
 
+ssize_t
+socket_send(net_socket* socket, msghdr* header, const void* data, size_t length,
+	int flags)
+{
+	if ((flags & MSG_ZEROCOPY) == 0 || (socket->options & SO_ZEROCOPY) == 0)
+		return socket_send_buffers(socket, header, data, length, flags, NULL);
+
+	net_socket_private* privateSocket = (net_socket_private*)socket;
+	zerocopy_send* zeroCopy = zerocopy_create(privateSocket);
+	if (zeroCopy == NULL)
+		return ENOBUFS;
+
+	ssize_t bytesSent = socket_send_buffers(socket, header, data, length,
+		flags, zeroCopy);
+	zerocopy_finish(privateSocket, zeroCopy, bytesSent);
+
+	return bytesSent;
+}
+
+
 status_t
 socket_set_option(net_socket* socket, int level, int option, const void* value,
 	int length)
@@ -1582,6 +1995,7 @@ socket_set_option(net_socket* socket, int level, int option, const void* value,
 		case SO_REUSEADDR:
 		case SO_REUSEPORT:
 		case SO_USELOOPBACK:
+		case SO_ZEROCOPY:
 			if (length != sizeof(int32))
 				return B_BAD_VALUE;
 
@@ -1764,6 +2178,7 @@ net_socket_module_info gNetSocketModule = {
 	socket_getsockopt,
 	socket_listen,
 	socket_receive,
+	socket_receive_multiple,
 	socket_send,
 	socket_setsockopt,
 	socket_shutdown,
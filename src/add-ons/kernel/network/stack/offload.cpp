@@ -0,0 +1,442 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	Software segmentation and receive offload for TCP: the protocols may pass
+	one large segment through the stack that is only cut into segments the
+	link can carry right before it reaches the device, and consecutive
+	segments of a flow are coalesced again before they enter the protocols.
+	UDP uses the same to send many datagrams of equal size at once.
+*/
+
+
+#include "offload.h"
+
+#include <netinet/in.h>
+#include <netinet/ip.h>
+#include <netinet/ip6.h>
+#include <netinet/tcp.h>
+#include <netinet/udp.h>
+#include <string.h>
+
+#include <KernelExport.h>
+
+#include <util/list.h>
+
+#include "interfaces.h"
+#include "stack_private.h"
+#include "utility.h"
+
+
+static const uint8 kTCPFlagFinish = 0x01;
+static const uint8 kTCPFlagPush = 0x08;
+static const uint8 kTCPFlagAcknowledge = 0x10;
+static const uint8 kTCPFlagCongestionWindowReduced = 0x80;
+
+static const size_t kMaxHeadersLength = 60 + 60;
+	// IPv4 header with options, and TCP header with options
+static const uint32 kMaxPacketSize = IP_MAXPACKET;
+
+
+struct offload_packet {
+	uint8		headers[kMaxHeadersLength];
+	uint8		version;
+	uint8		protocol;
+	size_t		ip_length;
+	size_t		length;
+		// of the IP and transport headers
+	uint32		data_length;
+
+	ip&			IPv4() { return *(ip*)headers; }
+	ip6_hdr&	IPv6() { return *(ip6_hdr*)headers; }
+	tcphdr&		TCP() { return *(tcphdr*)(headers + ip_length); }
+	udphdr&		UDP() { return *(udphdr*)(headers + ip_length); }
+};
+
+
+/*!	Reads the IP and transport headers of \a buffer into \a packet.
+	Returns \c false if the buffer doesn't contain a TCP segment or UDP
+	datagram in either an IPv4 packet that is not fragmented, or an IPv6
+	packet without extension headers.
+*/
+static bool
+read_headers(net_buffer* buffer, offload_packet& packet)
+{
+	size_t length = min_c(buffer->size, sizeof(packet.headers));
+	if (length < sizeof(ip) + sizeof(udphdr)
+		|| gNetBufferModule.read(buffer, 0, packet.headers, length) != B_OK)
+		return false;
+
+	packet.version = packet.headers[0] >> 4;
+
+	if (packet.version == 4) {
+		ip& header = packet.IPv4();
+		packet.ip_length = (packet.headers[0] & 0xf) * 4;
+		packet.protocol = header.ip_p;
+		if (packet.ip_length < sizeof(ip)
+			|| (ntohs(header.ip_off) & (IP_MF | IP_OFFMASK)) != 0
+			|| ntohs(header.ip_len) != buffer->size)
+			return false;
+	} else if (packet.version == 6) {
+		ip6_hdr& header = packet.IPv6();
+		packet.ip_length = sizeof(ip6_hdr);
+		packet.protocol = header.ip6_nxt;
+		if (ntohs(header.ip6_plen) + sizeof(ip6_hdr) != buffer->size)
+			return false;
+	} else
+		return false;
+
+	size_t transportLength;
+	if (packet.protocol == IPPROTO_TCP) {
+		if (packet.ip_length + sizeof(tcphdr) > length)
+			return false;
+
+		transportLength = (packet.headers[packet.ip_length + 12] >> 4) * 4;
+		if (transportLength < sizeof(tcphdr))
+			return false;
+	} else if (packet.protocol == IPPROTO_UDP)
+		transportLength = sizeof(udphdr);
+	else
+		return false;
+
+	packet.length = packet.ip_length + transportLength;
+	if (packet.length > length)
+		return false;
+
+	packet.data_length = buffer->size - packet.length;
+	return true;
+}
+
+
+static inline uint32
+add_words(uint32 sum, const void* data, size_t length)
+{
+	const uint16* words = (const uint16*)data;
+	for (size_t i = 0; i < length / 2; i++)
+		sum += words[i];
+
+	return sum;
+}
+
+
+/*!	Returns the one's complement sum of the pseudo header, and the transport
+	header in \a packet; the data of the segment is not included.
+*/
+static uint32
+sum_headers(offload_packet& packet)
+{
+	uint32 sum = 0;
+	if (packet.version == 4) {
+		ip& header = packet.IPv4();
+		sum = add_words(sum, &header.ip_src, sizeof(in_addr));
+		sum = add_words(sum, &header.ip_dst, sizeof(in_addr));
+	} else {
+		ip6_hdr& header = packet.IPv6();
+		sum = add_words(sum, &header.ip6_src, sizeof(in6_addr));
+		sum = add_words(sum, &header.ip6_dst, sizeof(in6_addr));
+	}
+
+	sum += htons(packet.protocol);
+	sum += htons(packet.length - packet.ip_length + packet.data_length);
+
+	return add_words(sum, packet.headers + packet.ip_length,
+		packet.length - packet.ip_length);
+}
+
+
+static inline uint16
+fold_checksum(uint32 sum)
+{
+	while ((sum >> 16) != 0)
+		sum = (sum & 0xffff) + (sum >> 16);
+
+	return (uint16)sum;
+}
+
+
+//!	Verifies the TCP checksum of \a buffer.
+static bool
+checksum_valid(net_buffer* buffer, offload_packet& packet)
+{
+	if ((buffer->offload_flags & NET_BUFFER_CHECKSUM_VALID) != 0)
+		return true;
+
+	uint32 sum = sum_headers(packet);
+	if (packet.data_length > 0) {
+		sum += (uint16)gNetBufferModule.checksum(buffer, packet.length,
+			packet.data_length, false);
+	}
+
+	return fold_checksum(sum) == 0xffff;
+}
+
+
+//!	Adjusts the length fields of the IP header to the packet's size.
+static void
+update_ip_header(offload_packet& packet)
+{
+	uint32 size = packet.length + packet.data_length;
+
+	if (packet.version == 4) {
+		ip& header = packet.IPv4();
+		header.ip_len = htons(size);
+		header.ip_sum = 0;
+		header.ip_sum = checksum(packet.headers, packet.ip_length);
+	} else
+		packet.IPv6().ip6_plen = htons(size - sizeof(ip6_hdr));
+}
+
+
+/*!	Returns the segment size that lets the segments of \a packet fit into
+	\a mtu in \a _segmentSize. TCP segments may be cut smaller than the
+	sender asked for, but datagrams and packets that must not be fragmented
+	cannot; for those, \c EMSGSIZE is returned, as for any other packet that
+	is too large for the link.
+*/
+static status_t
+fit_segment_size(net_buffer* buffer, offload_packet& packet, uint32 mtu,
+	uint32& _segmentSize)
+{
+	if (mtu <= packet.length)
+		return EMSGSIZE;
+
+	_segmentSize = buffer->segment_size;
+	if (packet.length + _segmentSize <= mtu)
+		return B_OK;
+
+	if (packet.protocol != IPPROTO_TCP || (packet.version == 4
+			&& (ntohs(packet.IPv4().ip_off) & IP_DF) != 0))
+		return EMSGSIZE;
+
+	_segmentSize = mtu - packet.length;
+	return B_OK;
+}
+
+
+static void
+copy_metadata(net_buffer* destination, const net_buffer* source)
+{
+	memcpy(destination->source, source->source,
+		min_c(source->source->sa_len, sizeof(sockaddr_storage)));
+	memcpy(destination->destination, source->destination,
+		min_c(source->destination->sa_len, sizeof(sockaddr_storage)));
+
+	destination->flags = source->flags;
+	destination->interface_address = source->interface_address;
+	if (destination->interface_address != NULL)
+		((InterfaceAddress*)destination->interface_address)->AcquireReference();
+
+	destination->protocol = source->protocol;
+	destination->type = source->type;
+}
+
+
+//	#pragma mark -
+
+
+/*!	Lowers the net_buffer::segment_size of \a buffer, so that its segments
+	fit into \a mtu. This is needed when the device cuts the buffer into
+	segments itself.
+*/
+status_t
+limit_segment_size(net_buffer* buffer, uint32 mtu)
+{
+	offload_packet packet;
+	if (buffer->segment_size == 0 || !read_headers(buffer, packet))
+		return B_BAD_DATA;
+
+	uint32 segmentSize;
+	status_t status = fit_segment_size(buffer, packet, mtu, segmentSize);
+	if (status != B_OK)
+		return status;
+
+	buffer->segment_size = segmentSize;
+	return B_OK;
+}
+
+
+/*!	Cuts the TCP segment, or UDP datagram in \a buffer into segments or
+	datagrams with at most net_buffer::segment_size bytes of data, and puts
+	them into the list \a segments. TCP segments are cut smaller, if they
+	would not fit into \a mtu otherwise.
+	The segments refer to the data of the \a buffer instead of copying it;
+	the \a buffer itself is left unchanged.
+*/
+status_t
+segment_buffer(net_buffer* buffer, uint32 mtu, struct list* segments)
+{
+	list_init(segments);
+
+	offload_packet packet;
+	if (buffer->segment_size == 0 || !read_headers(buffer, packet))
+		return B_BAD_DATA;
+
+	uint32 segmentSize;
+	status_t status = fit_segment_size(buffer, packet, mtu, segmentSize);
+	if (status != B_OK)
+		return status;
+
+	bool tcp = packet.protocol == IPPROTO_TCP;
+	uint32 dataLength = packet.data_length;
+	uint32 sequence = tcp ? ntohl(packet.TCP().th_seq) : 0;
+	uint8 flags = tcp ? packet.TCP().th_flags : 0;
+	uint16 id = packet.version == 4 ? ntohs(packet.IPv4().ip_id) : 0;
+
+	for (uint32 offset = 0; offset < dataLength; offset += segmentSize) {
+		packet.data_length = min_c(dataLength - offset, segmentSize);
+		bool last = offset + packet.data_length == dataLength;
+
+		net_buffer* segment = gNetBufferModule.create(256);
+		if (segment == NULL)
+			goto error;
+
+		list_add_item(segments, segment);
+		copy_metadata(segment, buffer);
+
+		if (gNetBufferModule.append_cloned(segment, buffer,
+				packet.length + offset, packet.data_length) != B_OK)
+			goto error;
+
+		// adjust the headers for this segment
+
+		if (packet.version == 4)
+			packet.IPv4().ip_id = htons(id++);
+		update_ip_header(packet);
+
+		if (tcp) {
+			tcphdr& header = packet.TCP();
+			header.th_seq = htonl(sequence + offset);
+			header.th_flags = flags;
+			if (offset > 0)
+				header.th_flags &= ~kTCPFlagCongestionWindowReduced;
+			if (!last)
+				header.th_flags &= ~(kTCPFlagFinish | kTCPFlagPush);
+			header.th_sum = 0;
+		} else {
+			udphdr& header = packet.UDP();
+			header.uh_ulen = htons(sizeof(udphdr) + packet.data_length);
+			header.uh_sum = 0;
+		}
+
+		uint32 sum = sum_headers(packet) + (uint16)gNetBufferModule.checksum(
+			segment, 0, packet.data_length, false);
+		uint16 segmentChecksum = ~fold_checksum(sum);
+		if (tcp)
+			packet.TCP().th_sum = segmentChecksum;
+		else {
+			// a zero UDP checksum means that there is none
+			packet.UDP().uh_sum = segmentChecksum != 0
+				? segmentChecksum : 0xffff;
+		}
+
+		if (gNetBufferModule.prepend(segment, packet.headers, packet.length)
+				!= B_OK)
+			goto error;
+	}
+
+	return B_OK;
+
+error:
+	while (net_buffer* segment = (net_buffer*)list_remove_head_item(segments))
+		gNetBufferModule.free(segment);
+
+	return B_NO_MEMORY;
+}
+
+
+/*!	Appends the data of the TCP segment in \a next to the one in \a buffer,
+	if it directly follows it in the same flow, and neither of them carries
+	anything that TCP has to see separately. The \a buffer is marked with
+	NET_BUFFER_CHECKSUM_VALID then, and \a next is freed.
+	Returns \c false if the segments cannot be coalesced, leaving both of them
+	unchanged.
+*/
+bool
+coalesce_buffers(net_buffer* buffer, net_buffer* next)
+{
+	if (buffer->interface_address != next->interface_address
+		|| buffer->type != next->type
+		|| buffer->size + next->size > kMaxPacketSize)
+		return false;
+
+	offload_packet packet;
+	offload_packet nextPacket;
+	if (!read_headers(buffer, packet) || !read_headers(next, nextPacket)
+		|| packet.protocol != IPPROTO_TCP
+		|| nextPacket.protocol != IPPROTO_TCP
+		|| packet.version != nextPacket.version
+		|| packet.length != nextPacket.length
+		|| packet.data_length == 0 || nextPacket.data_length == 0)
+		return false;
+
+	// Everything but the lengths, checksums, and IDs must be the same
+	if (packet.version == 4) {
+		ip& header = packet.IPv4();
+		ip& nextHeader = nextPacket.IPv4();
+		if (header.ip_tos != nextHeader.ip_tos
+			|| header.ip_off != nextHeader.ip_off
+			|| header.ip_ttl != nextHeader.ip_ttl
+			|| header.ip_src.s_addr != nextHeader.ip_src.s_addr
+			|| header.ip_dst.s_addr != nextHeader.ip_dst.s_addr
+			|| memcmp(&header + 1, &nextHeader + 1,
+				packet.ip_length - sizeof(ip)) != 0)
+			return false;
+	} else {
+		ip6_hdr& header = packet.IPv6();
+		ip6_hdr& nextHeader = nextPacket.IPv6();
+		if (header.ip6_flow != nextHeader.ip6_flow
+			|| header.ip6_hlim != nextHeader.ip6_hlim
+			|| memcmp(&header.ip6_src, &nextHeader.ip6_src,
+				2 * sizeof(in6_addr)) != 0)
+			return false;
+	}
+
+	tcphdr& header = packet.TCP();
+	tcphdr& nextHeader = nextPacket.TCP();
+	if (header.th_sport != nextHeader.th_sport
+		|| header.th_dport != nextHeader.th_dport
+		|| header.th_ack != nextHeader.th_ack
+		|| header.th_win != nextHeader.th_win
+		|| header.th_flags != kTCPFlagAcknowledge
+		|| (nextHeader.th_flags & ~kTCPFlagPush) != kTCPFlagAcknowledge
+		|| ntohl(header.th_seq) + packet.data_length
+			!= ntohl(nextHeader.th_seq)
+		|| memcmp(&header + 1, &nextHeader + 1,
+			packet.length - packet.ip_length - sizeof(tcphdr)) != 0)
+		return false;
+
+	// Segments with a bad checksum are left to IP or TCP to drop; the IP
+	// header checksum is recomputed below, so it has to be checked here
+	if ((packet.version == 4
+			&& (checksum(packet.headers, packet.ip_length) != 0
+				|| checksum(nextPacket.headers, nextPacket.ip_length) != 0))
+		|| !checksum_valid(buffer, packet) || !checksum_valid(next, nextPacket))
+		return false;
+
+	uint32 size = buffer->size;
+	uint32 segmentSize = packet.data_length;
+
+	packet.data_length += nextPacket.data_length;
+	update_ip_header(packet);
+	header.th_flags |= nextHeader.th_flags;
+
+	if (gNetBufferModule.append_cloned(buffer, next, nextPacket.length,
+			nextPacket.data_length) != B_OK)
+		return false;
+	if (gNetBufferModule.write(buffer, 0, packet.headers, packet.length)
+			!= B_OK) {
+		gNetBufferModule.trim(buffer, size);
+		return false;
+	}
+
+	// If the packet is forwarded, it must be cut into the original segments
+	if (buffer->segment_size == 0)
+		buffer->segment_size = segmentSize;
+
+	buffer->offload_flags |= NET_BUFFER_CHECKSUM_VALID;
+
+	gNetBufferModule.free(next);
+	return true;
+}
@@ -0,0 +1,18 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef OFFLOAD_H
+#define OFFLOAD_H
+
+
+#include <net_buffer.h>
+
+
+status_t limit_segment_size(net_buffer* buffer, uint32 mtu);
+status_t segment_buffer(net_buffer* buffer, uint32 mtu,
+	struct list* segments);
+bool coalesce_buffers(net_buffer* buffer, net_buffer* next);
+
+
+#endif	// OFFLOAD_H
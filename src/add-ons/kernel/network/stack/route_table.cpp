@@ -0,0 +1,432 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+#include "route_table.h"
+
+#include <net_device.h>
+
+#include <AutoDeleter.h>
+#include <util/BitUtils.h>
+
+#include <net/if.h>
+#include <netinet/in.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+static const uint32 kStride = 6;
+static const uint32 kSlotCount = 1 << kStride;
+static const uint32 kMaxKeyLength = 16;
+static const uint32 kMaxLevels = (kMaxKeyLength * 8 + kStride - 1) / kStride;
+
+
+struct RouteTable::node {
+	uint64	children;
+		// the slots that lead to a child node
+	uint64	leaves;
+		// the slots that start a new run of equal leaves
+	uint32	child_base;
+	uint32	leaf_base;
+};
+
+struct RouteTable::prefix {
+	uint32	parent;
+		// the longest shorter prefix that contains this one
+	uint32	first_route;
+	uint32	route_count;
+};
+
+struct RouteTable::prefix_key {
+	uint8	key[kMaxKeyLength + 1];
+		// padded for key_bits()
+	uint32	length;
+	uint32	order;
+	net_route_private* route;
+};
+
+
+static inline uint32
+count_bits(uint64 value)
+{
+	return count_set_bits((uint32)value) + count_set_bits(value >> 32);
+}
+
+
+/*!	Returns the \c kStride bits of \a key that start at bit \a offset. The
+	key must be padded with a zero byte.
+*/
+static inline uint32
+key_bits(const uint8* key, uint32 offset)
+{
+	uint32 value = (key[offset / 8] << 8) | key[offset / 8 + 1];
+	return (value >> (16 - kStride - offset % 8)) & (kSlotCount - 1);
+}
+
+
+static void
+mask_key(uint8* key, uint32 length)
+{
+	if (length % 8 != 0)
+		key[length / 8] &= 0xff << (8 - length % 8);
+	for (uint32 i = (length + 7) / 8; i < kMaxKeyLength; i++)
+		key[i] = 0;
+}
+
+
+static bool
+key_matches(const uint8* key, const uint8* prefix, uint32 length)
+{
+	if (memcmp(key, prefix, length / 8) != 0)
+		return false;
+	if (length % 8 == 0)
+		return true;
+
+	uint8 mask = 0xff << (8 - length % 8);
+	return (key[length / 8] & mask) == prefix[length / 8];
+}
+
+
+static uint32
+leading_ones(const uint8* mask, uint32 bits)
+{
+	uint32 length = 0;
+	while (length < bits && (mask[length / 8] & (0x80 >> length % 8)) != 0)
+		length++;
+
+	return length;
+}
+
+
+//	#pragma mark -
+
+
+RouteTable::RouteTable(int family)
+	:
+	fFamily(family),
+	fKeyBits(family == AF_INET6 ? 128 : 32),
+	fNodes(NULL),
+	fNodeCount(0),
+	fNodeCapacity(0),
+	fLeaves(NULL),
+	fLeafCount(0),
+	fLeafCapacity(0),
+	fPrefixes(NULL),
+	fRoutes(NULL)
+{
+}
+
+
+RouteTable::~RouteTable()
+{
+	free(fNodes);
+	free(fLeaves);
+	free(fPrefixes);
+	free(fRoutes);
+}
+
+
+/*!	Builds the table from \a routes, which must be ordered the way
+	find_route() expects them to be: routes for the same prefix are returned
+	in the order they appear in the list.
+*/
+status_t
+RouteTable::Build(RouteList& routes)
+{
+	uint32 count = 0;
+	RouteList::Iterator iterator = routes.GetIterator();
+	while (iterator.Next() != NULL)
+		count++;
+
+	prefix_key* keys = (prefix_key*)malloc((count + 1) * sizeof(prefix_key));
+	MemoryDeleter keysDeleter(keys);
+	uint32* slots = (uint32*)malloc(kMaxLevels * kSlotCount * sizeof(uint32));
+	MemoryDeleter slotsDeleter(slots);
+	fPrefixes = (prefix*)malloc((count + 1) * sizeof(prefix));
+	fRoutes = (net_route_private**)malloc(
+		(count + 1) * sizeof(net_route_private*));
+	if (keys == NULL || slots == NULL || fPrefixes == NULL || fRoutes == NULL)
+		return B_NO_MEMORY;
+
+	iterator = routes.GetIterator();
+	for (uint32 i = 1; i <= count; i++) {
+		net_route_private* route = iterator.Next();
+		prefix_key& item = keys[i];
+
+		memset(item.key, 0, sizeof(item.key));
+		if (route->destination == NULL
+			|| !_GetKey(route->destination, item.key))
+			return B_BAD_VALUE;
+
+		item.length = fKeyBits;
+		if (route->mask != NULL) {
+			uint8 mask[kMaxKeyLength];
+			memset(mask, 0, sizeof(mask));
+			if (!_GetKey(route->mask, mask))
+				return B_BAD_VALUE;
+
+			item.length = leading_ones(mask, fKeyBits);
+		}
+
+		mask_key(item.key, item.length);
+		item.order = i;
+		item.route = route;
+	}
+
+	qsort(keys + 1, count, sizeof(prefix_key), &_ComparePrefixKeys);
+
+	// Merge the routes of equal prefixes; since a prefix sorts after all
+	// prefixes that contain it, its parent is on the stack.
+
+	uint32 stack[kMaxKeyLength * 8 + 1];
+	uint32 depth = 0;
+	uint32 prefixCount = 0;
+
+	fPrefixes[0].parent = 0;
+	fPrefixes[0].first_route = 0;
+	fPrefixes[0].route_count = 0;
+
+	for (uint32 i = 1; i <= count; i++) {
+		fRoutes[i - 1] = keys[i].route;
+
+		if (prefixCount > 0 && keys[prefixCount].length == keys[i].length
+			&& memcmp(keys[prefixCount].key, keys[i].key, kMaxKeyLength)
+				== 0) {
+			fPrefixes[prefixCount].route_count++;
+			continue;
+		}
+
+		while (depth > 0 && !key_matches(keys[i].key,
+				keys[stack[depth - 1]].key, keys[stack[depth - 1]].length))
+			depth--;
+
+		prefixCount++;
+		keys[prefixCount] = keys[i];
+
+		prefix& entry = fPrefixes[prefixCount];
+		entry.parent = depth > 0 ? stack[depth - 1] : 0;
+		entry.first_route = i - 1;
+		entry.route_count = 1;
+
+		stack[depth++] = prefixCount;
+	}
+
+	uint32 root;
+	status_t status = _AllocateNodes(1, root);
+	if (status != B_OK)
+		return status;
+
+	return _BuildNode(root, 0, keys, 1, prefixCount + 1, 0, slots);
+}
+
+
+/*!	Returns the most specific route for \a address whose device has a link,
+	or, if there is none, the most specific route at all.
+*/
+net_route_private*
+RouteTable::Lookup(const sockaddr* address) const
+{
+	uint8 key[kMaxKeyLength + 1];
+	memset(key, 0, sizeof(key));
+	if (!_GetKey(address, key))
+		return NULL;
+
+	const node* current = &fNodes[0];
+	uint32 offset = 0;
+
+	while (true) {
+		uint64 bit = (uint64)1 << key_bits(key, offset);
+		if ((current->children & bit) == 0)
+			break;
+
+		current = &fNodes[current->child_base
+			+ count_bits(current->children & (bit - 1))];
+		offset += kStride;
+	}
+
+	uint64 bit = (uint64)1 << key_bits(key, offset);
+	uint32 index = fLeaves[current->leaf_base
+		+ count_bits(current->leaves & (bit | (bit - 1))) - 1];
+
+	net_route_private* candidate = NULL;
+
+	for (; index != 0; index = fPrefixes[index].parent) {
+		const prefix& entry = fPrefixes[index];
+
+		for (uint32 i = 0; i < entry.route_count; i++) {
+			net_route_private* route = fRoutes[entry.first_route + i];
+
+			// neglect routes that point to devices that have no link
+			if ((route->interface_address->interface->device->flags
+					& IFF_LINK) != 0)
+				return route;
+
+			if (candidate == NULL)
+				candidate = route;
+		}
+	}
+
+	return candidate;
+}
+
+
+/*static*/ bool
+RouteTable::IsSupported(int family)
+{
+	return family == AF_INET || family == AF_INET6;
+}
+
+
+bool
+RouteTable::_GetKey(const sockaddr* address, uint8* key) const
+{
+	if (address->sa_family != fFamily)
+		return false;
+
+	if (fFamily == AF_INET6) {
+		memcpy(key, &((const sockaddr_in6*)address)->sin6_addr, 16);
+		return true;
+	}
+
+	memcpy(key, &((const sockaddr_in*)address)->sin_addr, 4);
+	return true;
+}
+
+
+/*static*/ int
+RouteTable::_ComparePrefixKeys(const void* _a, const void* _b)
+{
+	const prefix_key* a = (const prefix_key*)_a;
+	const prefix_key* b = (const prefix_key*)_b;
+
+	int compare = memcmp(a->key, b->key, kMaxKeyLength);
+	if (compare != 0)
+		return compare;
+	if (a->length != b->length)
+		return a->length < b->length ? -1 : 1;
+
+	return a->order < b->order ? -1 : 1;
+}
+
+
+/*!	Builds node \a index from the prefixes \a begin to \a end, which all
+	start with the same \a offset bits, and are longer than that. Slots that
+	no prefix in the range covers are set to the \a base prefix. \a slots is
+	scratch space for this node and the ones below it.
+*/
+status_t
+RouteTable::_BuildNode(uint32 index, uint32 offset, const prefix_key* keys,
+	uint32 begin, uint32 end, uint32 base, uint32* slots)
+{
+	for (uint32 slot = 0; slot < kSlotCount; slot++)
+		slots[slot] = base;
+
+	// Prefixes that end in this node are expanded to all slots they cover;
+	// since they are sorted, more specific ones overwrite those containing
+	// them.
+
+	uint64 children = 0;
+	for (uint32 i = begin; i < end; i++) {
+		uint32 slot = key_bits(keys[i].key, offset);
+		if (keys[i].length > offset + kStride) {
+			children |= (uint64)1 << slot;
+			continue;
+		}
+
+		uint32 slotCount = 1 << (offset + kStride - keys[i].length);
+		for (uint32 j = 0; j < slotCount; j++)
+			slots[slot + j] = i;
+	}
+
+	uint32 leafBase = fLeafCount;
+	uint64 leaves = 0;
+	for (uint32 slot = 0; slot < kSlotCount; slot++) {
+		uint64 bit = (uint64)1 << slot;
+		if ((children & bit) != 0
+			|| (fLeafCount > leafBase && fLeaves[fLeafCount - 1] == slots[slot]))
+			continue;
+
+		status_t status = _AddLeaf(slots[slot]);
+		if (status != B_OK)
+			return status;
+
+		leaves |= bit;
+	}
+
+	uint32 childBase = 0;
+	if (children != 0) {
+		status_t status = _AllocateNodes(count_bits(children), childBase);
+		if (status != B_OK)
+			return status;
+	}
+
+	node& current = fNodes[index];
+	current.children = children;
+	current.leaves = leaves;
+	current.child_base = childBase;
+	current.leaf_base = leafBase;
+
+	// The longer prefixes that share a slot follow each other, and come
+	// after the prefixes that end in it.
+
+	uint32 child = childBase;
+	for (uint32 i = begin; i < end;) {
+		if (keys[i].length <= offset + kStride) {
+			i++;
+			continue;
+		}
+
+		uint32 slot = key_bits(keys[i].key, offset);
+		uint32 groupEnd = i + 1;
+		while (groupEnd < end && key_bits(keys[groupEnd].key, offset) == slot)
+			groupEnd++;
+
+		status_t status = _BuildNode(child++, offset + kStride, keys, i,
+			groupEnd, slots[slot], slots + kSlotCount);
+		if (status != B_OK)
+			return status;
+
+		i = groupEnd;
+	}
+
+	return B_OK;
+}
+
+
+status_t
+RouteTable::_AllocateNodes(uint32 count, uint32& _first)
+{
+	if (fNodeCount + count > fNodeCapacity) {
+		uint32 capacity = max_c(fNodeCapacity * 2, fNodeCount + count);
+		node* nodes = (node*)realloc(fNodes, capacity * sizeof(node));
+		if (nodes == NULL)
+			return B_NO_MEMORY;
+
+		fNodes = nodes;
+		fNodeCapacity = capacity;
+	}
+
+	_first = fNodeCount;
+	fNodeCount += count;
+	return B_OK;
+}
+
+
+status_t
+RouteTable::_AddLeaf(uint32 prefix)
+{
+	if (fLeafCount == fLeafCapacity) {
+		uint32 capacity = max_c(fLeafCapacity * 2, kSlotCount);
+		uint32* leaves = (uint32*)realloc(fLeaves, capacity * sizeof(uint32));
+		if (leaves == NULL)
+			return B_NO_MEMORY;
+
+		fLeaves = leaves;
+		fLeafCapacity = capacity;
+	}
+
+	fLeaves[fLeafCount++] = prefix;
+	return B_OK;
+}
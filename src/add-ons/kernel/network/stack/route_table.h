@@ -0,0 +1,59 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef ROUTE_TABLE_H
+#define ROUTE_TABLE_H
+
+
+#include "routes.h"
+
+
+/*!	A longest prefix match table compiled from the route list of a domain.
+	It is a multibit trie of 64-way nodes that store their children and
+	leaves packed behind bitmaps (as in Poptrie), so that an IPv4 lookup
+	touches at most six small nodes. The table never changes once it has
+	been built; the domain builds a new one after its routes changed.
+*/
+class RouteTable {
+public:
+								RouteTable(int family);
+								~RouteTable();
+
+			status_t			Build(RouteList& routes);
+
+			net_route_private*	Lookup(const sockaddr* address) const;
+
+	static	bool				IsSupported(int family);
+
+private:
+			struct node;
+			struct prefix;
+			struct prefix_key;
+
+			bool				_GetKey(const sockaddr* address,
+									uint8* key) const;
+	static	int					_ComparePrefixKeys(const void* _a,
+									const void* _b);
+			status_t			_BuildNode(uint32 index, uint32 offset,
+									const prefix_key* keys, uint32 begin,
+									uint32 end, uint32 base, uint32* slots);
+			status_t			_AllocateNodes(uint32 count, uint32& _first);
+			status_t			_AddLeaf(uint32 prefix);
+
+private:
+			int					fFamily;
+			uint32				fKeyBits;
+
+			node*				fNodes;
+			uint32				fNodeCount;
+			uint32				fNodeCapacity;
+			uint32*				fLeaves;
+			uint32				fLeafCount;
+			uint32				fLeafCapacity;
+			prefix*				fPrefixes;
+			net_route_private**	fRoutes;
+};
+
+
+#endif	// ROUTE_TABLE_H
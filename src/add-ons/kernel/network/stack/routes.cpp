@@ -9,6 +9,7 @@
 
 #include "domains.h"
 #include "interfaces.h"
+#include "route_table.h"
 #include "routes.h"
 #include "stack_private.h"
 #include "utility.h"
@@ -37,6 +38,10 @@
 #endif
 
 
+static int32 sRouteGeneration;
+	// changes whenever a route, or the link of a device changes
+
+
 net_route_private::net_route_private()
 {
 	destination = mask = gateway = NULL;
@@ -142,6 +147,11 @@ find_route(net_domain* _domain, const sockaddr* address)
 {
 	net_domain_private* domain = (net_domain_private*)_domain;
 
+	// The route table is only changed with the domain lock held, and is
+	// always up to date if it exists
+	if (domain->route_table != NULL)
+		return domain->route_table->Lookup(address);
+
 	// find last matching route
 
 	RouteList::Iterator iterator = domain->routes.GetIterator();
@@ -187,6 +197,31 @@ find_route(net_domain* _domain, const sockaddr* address)
 }
 
 
+static net_route_private*
+acquire_route(net_route_private* route)
+{
+	if (route != NULL && atomic_add(&route->ref_count, 1) == 0) {
+		// route has been deleted already
+		return NULL;
+	}
+
+	return route;
+}
+
+
+static void
+delete_route(struct net_domain_private* domain, net_route_private* route)
+{
+	ASSERT_LOCKED_RECURSIVE(&domain->lock);
+
+	// the route must already have been removed at this point
+	if (route->interface_address != NULL)
+		((InterfaceAddress*)route->interface_address)->ReleaseReference();
+
+	delete route;
+}
+
+
 static void
 put_route_internal(struct net_domain_private* domain, net_route* _route)
 {
@@ -196,11 +231,7 @@ put_route_internal(struct net_domain_private* domain, net_route* _route)
 	if (route == NULL || atomic_add(&route->ref_count, -1) != 1)
 		return;
 
-	// delete route - it must already have been removed at this point
-	if (route->interface_address != NULL)
-		((InterfaceAddress*)route->interface_address)->ReleaseReference();
-
-	delete route;
+	delete_route(domain, route);
 }
 
 
@@ -232,12 +263,86 @@ get_route_internal(struct net_domain_private* domain,
 	} else
 		route = find_route(domain, address);
 
-	if (route != NULL && atomic_add(&route->ref_count, 1) == 0) {
-		// route has been deleted already
-		route = NULL;
+	return acquire_route(route);
+}
+
+
+/*!	Must be called whenever the route list changes, before a route that has
+	been removed from it is released.
+*/
+static void
+invalidate_route_table(struct net_domain_private* domain)
+{
+	ASSERT_LOCKED_RECURSIVE(&domain->lock);
+
+	WriteLocker locker(domain->route_table_lock);
+	delete domain->route_table;
+	domain->route_table = NULL;
+	locker.Unlock();
+
+	invalidate_route_caches();
+}
+
+
+static void
+build_route_table(struct net_domain_private* domain)
+{
+	ASSERT_LOCKED_RECURSIVE(&domain->lock);
+
+	RouteTable* table = new(std::nothrow) RouteTable(domain->family);
+	if (table == NULL)
+		return;
+
+	if (table->Build(domain->routes) != B_OK) {
+		// we will fall back to walking the route list
+		delete table;
+		return;
 	}
 
-	return route;
+	WriteLocker locker(domain->route_table_lock);
+	domain->route_table = table;
+}
+
+
+/*!	Returns a reference to the route to \a address. As long as the route
+	table of the domain is up to date, this does not need the domain lock,
+	and lookups can run in parallel.
+*/
+static net_route*
+lookup_route(struct net_domain_private* domain, const sockaddr* address)
+{
+	if (address->sa_family == domain->family) {
+		ReadLocker reader(domain->route_table_lock);
+		if (domain->route_table != NULL)
+			return acquire_route(domain->route_table->Lookup(address));
+	}
+
+	RecursiveLocker locker(domain->lock);
+
+	if (domain->route_table == NULL && RouteTable::IsSupported(domain->family))
+		build_route_table(domain);
+
+	return get_route_internal(domain, address);
+}
+
+
+/*!	Sets the source address of \a buffer to the one of the interface \a route
+	goes through.
+*/
+static status_t
+update_buffer_source(struct net_domain_private* domain, net_buffer* buffer,
+	net_route* route)
+{
+	// TODO: we are quite relaxed in the address checking here
+	// as we might proceed with source = INADDR_ANY.
+
+	if (route->interface_address != NULL
+		&& route->interface_address->local != NULL) {
+		return domain->address_module->update_to(buffer->source,
+			route->interface_address->local);
+	}
+
+	return B_OK;
 }
 
 
@@ -511,6 +616,7 @@ add_route(struct net_domain* _domain, const struct net_route* newRoute)
 	}
 
 	domain->routes.Insert(before, route);
+	invalidate_route_table(domain);
 	update_route_infos(domain);
 
 	return B_OK;
@@ -539,6 +645,7 @@ remove_route(struct net_domain* _domain, const struct net_route* removeRoute)
 		return B_ENTRY_NOT_FOUND;
 
 	domain->routes.Remove(route);
+	invalidate_route_table(domain);
 
 	put_route_internal(domain, route);
 	update_route_infos(domain);
@@ -619,10 +726,7 @@ invalidate_routes(InterfaceAddress* address)
 struct net_route*
 get_route(struct net_domain* _domain, const struct sockaddr* address)
 {
-	struct net_domain_private* domain = (net_domain_private*)_domain;
-	RecursiveLocker locker(domain->lock);
-
-	return get_route_internal(domain, address);
+	return lookup_route((net_domain_private*)_domain, address);
 }
 
 
@@ -649,43 +753,32 @@ get_buffer_route(net_domain* _domain, net_buffer* buffer, net_route** _route)
 {
 	net_domain_private* domain = (net_domain_private*)_domain;
 
-	RecursiveLocker _(domain->lock);
-
-	net_route* route = get_route_internal(domain, buffer->destination);
+	net_route* route = lookup_route(domain, buffer->destination);
 	if (route == NULL)
 		return ENETUNREACH;
 
-	status_t status = B_OK;
-	sockaddr* source = buffer->source;
-
-	// TODO: we are quite relaxed in the address checking here
-	// as we might proceed with source = INADDR_ANY.
-
-	if (route->interface_address != NULL
-		&& route->interface_address->local != NULL) {
-		status = domain->address_module->update_to(source,
-			route->interface_address->local);
+	status_t status = update_buffer_source(domain, buffer, route);
+	if (status != B_OK) {
+		put_route(domain, route);
+		return status;
 	}
 
-	if (status != B_OK)
-		put_route_internal(domain, route);
-	else
-		*_route = route;
-
-	return status;
+	*_route = route;
+	return B_OK;
 }
 
 
 void
-put_route(struct net_domain* _domain, net_route* route)
+put_route(struct net_domain* _domain, net_route* _route)
 {
 	struct net_domain_private* domain = (net_domain_private*)_domain;
-	if (domain == NULL || route == NULL)
+	net_route_private* route = (net_route_private*)_route;
+	if (domain == NULL || route == NULL
+		|| atomic_add(&route->ref_count, -1) != 1)
 		return;
 
 	RecursiveLocker locker(domain->lock);
-
-	put_route_internal(domain, (net_route*)route);
+	delete_route(domain, route);
 }
 
 
@@ -727,3 +820,94 @@ update_route_info(struct net_domain* _domain, struct net_route_info* info)
 	return B_OK;
 }
 
+
+
+//	#pragma mark - route caches
+
+
+void
+init_route_cache(net_route_cache* cache)
+{
+	mutex_init(&cache->lock, "route cache");
+	cache->domain = NULL;
+	cache->route = NULL;
+	cache->generation = 0;
+}
+
+
+void
+uninit_route_cache(net_route_cache* cache)
+{
+	put_route(cache->domain, cache->route);
+	mutex_destroy(&cache->lock);
+}
+
+
+/*!	Like get_buffer_route(), but reuses the route in \a cache if it was
+	looked up for the same destination, and no route changed since.
+*/
+status_t
+get_cached_buffer_route(net_domain* _domain, net_route_cache* cache,
+	net_buffer* buffer, net_route** _route)
+{
+	net_domain_private* domain = (net_domain_private*)_domain;
+	const sockaddr* destination = buffer->destination;
+	if (destination->sa_family != domain->family)
+		return get_buffer_route(domain, buffer, _route);
+
+	int32 generation = atomic_get(&sRouteGeneration);
+
+	MutexLocker locker(cache->lock);
+
+	net_route* route = NULL;
+	if (cache->route != NULL && cache->domain == domain
+		&& cache->generation == generation
+		&& domain->address_module->equal_addresses(destination,
+			(sockaddr*)&cache->destination))
+		route = acquire_route((net_route_private*)cache->route);
+
+	locker.Unlock();
+
+	if (route == NULL) {
+		route = lookup_route(domain, destination);
+		if (route == NULL)
+			return ENETUNREACH;
+
+		if (destination->sa_len <= sizeof(sockaddr_storage)) {
+			// remember the route for the next time; if a route changed in
+			// the mean time, the generation will not match anymore
+			acquire_route((net_route_private*)route);
+
+			locker.Lock();
+			net_domain* previousDomain = cache->domain;
+			net_route* previousRoute = cache->route;
+
+			cache->domain = domain;
+			cache->route = route;
+			cache->generation = generation;
+			memcpy(&cache->destination, destination, destination->sa_len);
+			locker.Unlock();
+
+			put_route(previousDomain, previousRoute);
+		}
+	}
+
+	status_t status = update_buffer_source(domain, buffer, route);
+	if (status != B_OK) {
+		put_route(domain, route);
+		return status;
+	}
+
+	*_route = route;
+	return B_OK;
+}
+
+
+/*!	Makes all route caches look up their route again, as a route, or the
+	link of a device changed.
+*/
+void
+invalidate_route_caches()
+{
+	atomic_add(&sRouteGeneration, 1);
+}
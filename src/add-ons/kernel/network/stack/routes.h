@@ -12,8 +12,11 @@
 #include <net_datalink.h>
 #include <net_stack.h>
 
+#include <lock.h>
 #include <util/DoublyLinkedList.h>
 
+#include <sys/socket.h>
+
 
 class InterfaceAddress;
 
@@ -30,6 +33,17 @@ typedef DoublyLinkedList<net_route_private> RouteList;
 typedef DoublyLinkedList<net_route_info,
 	DoublyLinkedListCLink<net_route_info> > RouteInfoList;
 
+/*!	The route a socket used for its last destination. It is valid as long
+	as no route and no link changed since.
+*/
+struct net_route_cache {
+	mutex				lock;
+	net_domain*			domain;
+	net_route*			route;
+	int32				generation;
+	sockaddr_storage	destination;
+};
+
 
 uint32 route_table_size(struct net_domain_private* domain);
 status_t list_routes(struct net_domain_private* domain, void* buffer,
@@ -60,4 +74,11 @@ status_t unregister_route_info(struct net_domain* domain,
 status_t update_route_info(struct net_domain* domain,
 				struct net_route_info* info);
 
+void init_route_cache(net_route_cache* cache);
+void uninit_route_cache(net_route_cache* cache);
+status_t get_cached_buffer_route(struct net_domain* domain,
+				net_route_cache* cache, struct net_buffer* buffer,
+				struct net_route** _route);
+void invalidate_route_caches();
+
 #endif	// ROUTES_H
@@ -33,6 +33,12 @@ extern net_datalink_module_info gNetDatalinkModule;
 extern net_datalink_protocol_module_info gDatalinkInterfaceProtocolModule;
 extern net_stack_interface_module_info gNetStackInterfaceModule;
 
+// net_buffer.cpp
+bool has_external_data(net_buffer* buffer);
+
+// net_socket.cpp
+struct net_route_cache* get_socket_route_cache(net_socket* socket);
+
 // stack.cpp
 status_t register_domain_datalink_protocols(int family, int type, ...);
 status_t register_domain_protocols(int family, int type, int protocol, ...);
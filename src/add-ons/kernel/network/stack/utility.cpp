@@ -9,11 +9,18 @@
 
 #include "utility.h"
 
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+#include <new>
+
 #include <ByteOrder.h>
 #include <KernelExport.h>
 
 #include <condition_variable.h>
 #include <net_buffer.h>
+#include <smp.h>
 #include <syscall_restart.h>
 #include <util/AutoLock.h>
 
@@ -60,13 +67,43 @@ public:
 
 
 
-static struct list sTimers;
-static mutex sTimerLock;
-static sem_id sTimerWaitSem;
-static ConditionVariable sWaitForTimerCondition;
-static net_timer* sCurrentTimer;
-static thread_id sTimerThread;
-static bigtime_t sTimerTimeout;
+// The timers are kept in hierarchical timing wheels, one per CPU, each
+// served by its own thread. A wheel has kTimerWheelLevels levels of
+// kTimerWheelSlots slots each; the slots of level n cover
+// kTimerWheelSlots^n ticks. A timer is put into the lowest level that can
+// hold its due time, and is moved down ("cascaded") when the wheel reaches
+// its slot. Arming and canceling a timer is O(1).
+static const bigtime_t kTimerTick = 1000;
+static const uint32 kTimerWheelLevelBits = 6;
+static const uint32 kTimerWheelSlots = 1 << kTimerWheelLevelBits;
+static const uint32 kTimerWheelSlotMask = kTimerWheelSlots - 1;
+static const uint32 kTimerWheelLevels = 4;
+static const uint64 kTimerWheelRange
+	= (uint64)1 << (kTimerWheelLevels * kTimerWheelLevelBits);
+static const uint64 kNoTimerTick = ~(uint64)0;
+static const uint32 kMaxTimerWheels = 16;
+
+struct TimerWheel {
+	mutex				lock;
+	sem_id				wait_sem;
+	ConditionVariable	wait_for_timer_condition;
+	net_timer*			current_timer;
+	thread_id			thread;
+	TimerWheel*			waiting_for;
+		// the wheel of the timer a hook run by this wheel waits for
+	bigtime_t			timeout;
+	uint64				current_tick;
+		// the next tick to be processed
+	uint64				occupied[kTimerWheelLevels];
+		// the slots that may contain timers, one bit per slot
+	struct list			slots[kTimerWheelLevels][kTimerWheelSlots];
+	struct list			expired;
+};
+
+static TimerWheel* sTimerWheels;
+static uint32 sTimerWheelCount;
+static mutex sTimerWaitLock = MUTEX_INITIALIZER("net timer wait");
+	// guards TimerWheel::waiting_for
 
 
 static inline void
@@ -184,36 +221,172 @@ UserBuffer::PadToNext(size_t length)
 // #pragma mark -
 
 
-uint16
-compute_checksum(uint8* _buffer, size_t length)
+/*!	Adds \a word to the one's complement sum \a sum. Since the one's
+	complement sum is independent of the byte order and the word size, the
+	16 bit sum of the data is the folded 64 bit sum.
+*/
+static inline uint64
+checksum_add(uint64 sum, uint64 word)
 {
-	uint16* buffer = (uint16*)_buffer;
-	uint32 sum = 0;
+	sum += word;
+	return sum + (sum < word ? 1 : 0);
+}
+
 
-	// TODO: unfold loop for speed
-	// TODO: write processor dependent version for speed
-	while (length >= 2) {
-		sum += *buffer++;
+static inline uint16
+checksum_fold(uint64 sum)
+{
+	sum = (sum & 0xffffffff) + (sum >> 32);
+	sum = (sum & 0xffffffff) + (sum >> 32);
+
+	uint32 sum32 = sum;
+	sum32 = (sum32 & 0xffff) + (sum32 >> 16);
+	sum32 = (sum32 & 0xffff) + (sum32 >> 16);
+	return sum32;
+}
+
+
+/*!	Computes the one's complement sum of \a source, and copies it to
+	\a target at the same time, if \a kCopy is \c true.
+	\a target must be aligned like \a source.
+*/
+template<bool kCopy>
+static inline uint16
+sum_and_copy(const uint8* source, uint8* target, size_t length)
+{
+	uint64 sum = 0;
+
+	// Start at an even address. If the data starts at an odd one, its first
+	// byte is the second one of a word, and the result needs to be swapped.
+	bool odd = ((addr_t)source & 1) != 0;
+	if (odd && length > 0) {
+		uint8 ordered[2];
+		ordered[0] = 0;
+		ordered[1] = *source;
+		sum = *(uint16*)ordered;
+		if (kCopy)
+			*target++ = *source;
+		source++;
+		length--;
+	}
+
+	// align to 64 bit
+	if (((addr_t)source & 2) != 0 && length >= 2) {
+		sum += *(const uint16*)source;
+		if (kCopy) {
+			*(uint16*)target = *(const uint16*)source;
+			target += 2;
+		}
+		source += 2;
 		length -= 2;
 	}
+	if (((addr_t)source & 4) != 0 && length >= 4) {
+		sum += *(const uint32*)source;
+		if (kCopy) {
+			*(uint32*)target = *(const uint32*)source;
+			target += 4;
+		}
+		source += 4;
+		length -= 4;
+	}
 
-	if (length) {
+	// two independent sums of 64 bit words, so that the additions don't
+	// need to wait for each other's carries
+	uint64 sum2 = 0;
+	while (length >= 32) {
+		const uint64* words = (const uint64*)source;
+		uint64 word0 = words[0];
+		uint64 word1 = words[1];
+		uint64 word2 = words[2];
+		uint64 word3 = words[3];
+		if (kCopy) {
+			uint64* targetWords = (uint64*)target;
+			targetWords[0] = word0;
+			targetWords[1] = word1;
+			targetWords[2] = word2;
+			targetWords[3] = word3;
+			target += 32;
+		}
+		sum = checksum_add(sum, word0);
+		sum2 = checksum_add(sum2, word1);
+		sum = checksum_add(sum, word2);
+		sum2 = checksum_add(sum2, word3);
+		source += 32;
+		length -= 32;
+	}
+	while (length >= 8) {
+		uint64 word = *(const uint64*)source;
+		if (kCopy) {
+			*(uint64*)target = word;
+			target += 8;
+		}
+		sum = checksum_add(sum, word);
+		source += 8;
+		length -= 8;
+	}
+	sum = checksum_add(sum, sum2);
+
+	// the remaining bytes
+	if (length >= 4) {
+		sum = checksum_add(sum, *(const uint32*)source);
+		if (kCopy) {
+			*(uint32*)target = *(const uint32*)source;
+			target += 4;
+		}
+		source += 4;
+		length -= 4;
+	}
+	if (length >= 2) {
+		sum = checksum_add(sum, *(const uint16*)source);
+		if (kCopy) {
+			*(uint16*)target = *(const uint16*)source;
+			target += 2;
+		}
+		source += 2;
+		length -= 2;
+	}
+	if (length > 0) {
 		// give the last byte it's proper endian-aware treatment
-#if B_HOST_IS_LENDIAN
-		sum += *(uint8*)buffer;
-#else
 		uint8 ordered[2];
-		ordered[0] = *(uint8*)buffer;
+		ordered[0] = *source;
 		ordered[1] = 0;
-		sum += *(uint16*)ordered;
-#endif
+		sum = checksum_add(sum, *(uint16*)ordered);
+		if (kCopy)
+			*target = *source;
 	}
 
-	while (sum >> 16) {
-		sum = (sum & 0xffff) + (sum >> 16);
+	uint16 result = checksum_fold(sum);
+	return odd ? __swap_int16(result) : result;
+}
+
+
+/*!	Returns the 16 bit one's complement sum of the data, as needed for
+	the Internet checksum (RFC 1071).
+
+	The kernel must not touch the FPU/SIMD registers, so instead of SSE2 or
+	AVX2, the data is summed up in 64 bit words.
+*/
+uint16
+compute_checksum(uint8* buffer, size_t length)
+{
+	return sum_and_copy<false>(buffer, NULL, length);
+}
+
+
+/*!	Copies \a length bytes from \a source to \a target, and returns their
+	one's complement sum like compute_checksum(). The data is only read
+	once. Both buffers must be kernel memory.
+*/
+uint16
+copy_and_compute_checksum(uint8* target, const uint8* source, size_t length)
+{
+	if ((((addr_t)target ^ (addr_t)source) & 7) != 0) {
+		// the buffers can't be aligned both; the copy is still cache hot
+		memcpy(target, source, length);
+		return sum_and_copy<false>(target, NULL, length);
 	}
 
-	return sum;
+	return sum_and_copy<true>(source, target, length);
 }
 
 
@@ -456,51 +629,195 @@ fifo_socket_enqueue_buffer(net_fifo* fifo, net_socket* socket, uint8 event,
 //	#pragma mark - Timer
 
 
+static inline uint64
+timer_tick(bigtime_t time)
+{
+	// round up, so that timers never run early
+	return (uint64)((time + kTimerTick - 1) / kTimerTick);
+}
+
+
+/*!	Returns the wheel of a timer. All timers with the same data are kept in
+	the same wheel, so that the timers of an object are never run
+	concurrently.
+
+	Hooks of different wheels do run concurrently, though. Since all hooks
+	of the stack and its modules (ARP and NDP entries, TCP endpoints, IP
+	fragment packets) only ever wait for the timers of their own object,
+	which are run by the same wheel, this doesn't matter for them.
+*/
+static inline TimerWheel*
+timer_wheel_for(net_timer* timer)
+{
+	addr_t key = timer->data != NULL ? (addr_t)timer->data : (addr_t)timer;
+	return &sTimerWheels[(uint32)((key >> 4) * 2654435761U)
+		% sTimerWheelCount];
+}
+
+
+static TimerWheel*
+timer_wheel_of_thread(thread_id thread)
+{
+	for (uint32 i = 0; i < sTimerWheelCount; i++) {
+		if (sTimerWheels[i].thread == thread)
+			return &sTimerWheels[i];
+	}
+
+	return NULL;
+}
+
+
+static void
+timer_wheel_insert(TimerWheel* wheel, net_timer* timer)
+{
+	uint64 tick = timer_tick(timer->due);
+	if (tick < wheel->current_tick)
+		tick = wheel->current_tick;
+
+	// Timers beyond the range of the wheel are put into its last slot, and
+	// are inserted again when that is cascaded.
+	uint64 delta = tick - wheel->current_tick;
+	if (delta >= kTimerWheelRange) {
+		delta = kTimerWheelRange - 1;
+		tick = wheel->current_tick + delta;
+	}
+
+	uint32 level = 0;
+	while (delta >= (uint64)1 << ((level + 1) * kTimerWheelLevelBits))
+		level++;
+
+	uint32 index = (tick >> (level * kTimerWheelLevelBits))
+		& kTimerWheelSlotMask;
+	list_add_item(&wheel->slots[level][index], timer);
+	wheel->occupied[level] |= (uint64)1 << index;
+}
+
+
+/*!	Moves the timers in the current slot of \a level to the lower levels.
+	Returns the index of the slot.
+*/
+static uint32
+timer_wheel_cascade(TimerWheel* wheel, uint32 level)
+{
+	uint32 index = (wheel->current_tick >> (level * kTimerWheelLevelBits))
+		& kTimerWheelSlotMask;
+
+	struct list timers;
+	list_init(&timers);
+	list_move_to_list(&wheel->slots[level][index], &timers);
+	wheel->occupied[level] &= ~((uint64)1 << index);
+
+	while (net_timer* timer = (net_timer*)list_remove_head_item(&timers))
+		timer_wheel_insert(wheel, timer);
+
+	return index;
+}
+
+
+/*!	Returns the next tick at which a timer might expire or has to be
+	cascaded, or kNoTimerTick, if the wheel is empty.
+*/
+static uint64
+timer_wheel_next_event_tick(TimerWheel* wheel)
+{
+	uint64 next = kNoTimerTick;
+
+	for (uint32 level = 0; level < kTimerWheelLevels; level++) {
+		uint64 occupied = wheel->occupied[level];
+		if (occupied == 0)
+			continue;
+
+		// find the first occupied slot, starting with the first slot boundary
+		// of the level at or after the current tick
+		uint32 shift = level * kTimerWheelLevelBits;
+		uint64 block = (wheel->current_tick + ((uint64)1 << shift) - 1)
+			>> shift;
+		uint32 index = block & kTimerWheelSlotMask;
+		if (index != 0) {
+			occupied = (occupied >> index)
+				| (occupied << (kTimerWheelSlots - index));
+		}
+
+		uint64 tick = (block + __builtin_ctzll(occupied)) << shift;
+		if (tick < next)
+			next = tick;
+	}
+
+	return next;
+}
+
+
+/*!	Processes all ticks up to and including \a nowTick, and moves the timers
+	that are due to the expired list.
+*/
+static void
+timer_wheel_advance(TimerWheel* wheel, uint64 nowTick)
+{
+	while (wheel->current_tick <= nowTick) {
+		// skip the ticks that have nothing to do
+		uint64 tick = timer_wheel_next_event_tick(wheel);
+		if (tick > nowTick) {
+			wheel->current_tick = nowTick + 1;
+			break;
+		}
+
+		wheel->current_tick = tick;
+
+		uint32 index = tick & kTimerWheelSlotMask;
+		if (index == 0) {
+			for (uint32 level = 1; level < kTimerWheelLevels; level++) {
+				if (timer_wheel_cascade(wheel, level) != 0)
+					break;
+			}
+		}
+
+		struct list* slot = &wheel->slots[0][index];
+		while (net_timer* timer = (net_timer*)list_remove_head_item(slot))
+			list_add_item(&wheel->expired, timer);
+		wheel->occupied[0] &= ~((uint64)1 << index);
+
+		wheel->current_tick++;
+	}
+}
+
+
 static status_t
-timer_thread(void* /*data*/)
+timer_thread(void* _wheel)
 {
+	TimerWheel* wheel = (TimerWheel*)_wheel;
 	status_t status = B_OK;
 
 	do {
 		bigtime_t timeout = B_INFINITE_TIMEOUT;
 
 		if (status == B_TIMED_OUT || status == B_OK) {
-			// scan timers for new timeout and/or execute a timer
-			mutex_lock(&sTimerLock);
+			MutexLocker locker(wheel->lock);
 
-			struct net_timer* timer = NULL;
-			while (true) {
-				timer = (net_timer*)list_get_next_item(&sTimers, timer);
-				if (timer == NULL)
-					break;
+			// collect all timers that are due, and execute them in one go
+			timer_wheel_advance(wheel, system_time() / kTimerTick);
 
-				if (timer->due < system_time()) {
-					// execute timer
-					list_remove_item(&sTimers, timer);
-					timer->due = -1;
-					sCurrentTimer = timer;
-
-					mutex_unlock(&sTimerLock);
-					timer->hook(timer, timer->data);
-					mutex_lock(&sTimerLock);
-
-					sCurrentTimer = NULL;
-					sWaitForTimerCondition.NotifyAll();
-
-					timer = NULL;
-						// restart scanning as we unlocked the list
-				} else {
-					// calculate new timeout
-					if (timer->due < timeout)
-						timeout = timer->due;
-				}
+			while (net_timer* timer
+					= (net_timer*)list_remove_head_item(&wheel->expired)) {
+				timer->due = -1;
+				wheel->current_timer = timer;
+
+				locker.Unlock();
+				timer->hook(timer, timer->data);
+				locker.Lock();
+
+				wheel->current_timer = NULL;
+				wheel->wait_for_timer_condition.NotifyAll();
 			}
 
-			sTimerTimeout = timeout;
-			mutex_unlock(&sTimerLock);
+			uint64 tick = timer_wheel_next_event_tick(wheel);
+			if (tick != kNoTimerTick)
+				timeout = tick * kTimerTick;
+
+			wheel->timeout = timeout;
 		}
 
-		status = acquire_sem_etc(sTimerWaitSem, 1, B_ABSOLUTE_TIMEOUT, timeout);
+		status = acquire_sem_etc(wheel->wait_sem, 1, B_ABSOLUTE_TIMEOUT,
+			timeout);
 			// the wait sem normally can't be acquired, so we
 			// have to look at the status value the call returns:
 			//
@@ -538,26 +855,25 @@ init_timer(net_timer* timer, net_timer_func hook, void* data)
 void
 set_timer(net_timer* timer, bigtime_t delay)
 {
-	MutexLocker locker(sTimerLock);
+	TimerWheel* wheel = timer_wheel_for(timer);
+	MutexLocker locker(wheel->lock);
 
 	TRACE("set_timer %p, hook %p, data %p\n", timer, timer->hook, timer->data);
 
-	if (timer->due > 0 && delay < 0) {
-		// this timer is scheduled, cancel it
-		list_remove_item(&sTimers, timer);
+	if (timer->due > 0) {
+		// this timer is scheduled, remove it
+		list_remove_link(&timer->link);
 		timer->due = 0;
 	}
 
 	if (delay >= 0) {
-		// reschedule or add this timer
-		if (timer->due <= 0)
-			list_add_item(&sTimers, timer);
-
+		// (re)schedule this timer
 		timer->due = system_time() + delay;
+		timer_wheel_insert(wheel, timer);
 
 		// notify timer about the change if necessary
-		if (sTimerTimeout > timer->due)
-			release_sem(sTimerWaitSem);
+		if (wheel->timeout > (bigtime_t)timer_tick(timer->due) * kTimerTick)
+			release_sem(wheel->wait_sem);
 	}
 }
 
@@ -565,7 +881,8 @@ set_timer(net_timer* timer, bigtime_t delay)
 bool
 cancel_timer(struct net_timer* timer)
 {
-	MutexLocker locker(sTimerLock);
+	TimerWheel* wheel = timer_wheel_for(timer);
+	MutexLocker locker(wheel->lock);
 
 	TRACE("cancel_timer %p, hook %p, data %p\n", timer, timer->hook,
 		timer->data);
@@ -574,35 +891,64 @@ cancel_timer(struct net_timer* timer)
 		return false;
 
 	// this timer is scheduled, cancel it
-	list_remove_item(&sTimers, timer);
+	list_remove_link(&timer->link);
 	timer->due = 0;
 	return true;
 }
 
 
+/*!	Waits until the \a timer is no longer scheduled nor running. Hooks may
+	only wait for timers of another wheel as long as that doesn't close a
+	cycle of hooks waiting for each other; in that case, \c B_WOULD_BLOCK
+	is returned instead.
+*/
 status_t
 wait_for_timer(struct net_timer* timer)
 {
-	if (find_thread(NULL) == sTimerThread) {
+	TimerWheel* wheel = timer_wheel_for(timer);
+	TimerWheel* callerWheel = timer_wheel_of_thread(find_thread(NULL));
+
+	if (callerWheel == wheel) {
 		// let's not wait for ourselves...
 		return B_BAD_VALUE;
 	}
 
+	if (callerWheel != NULL) {
+		MutexLocker waitLocker(sTimerWaitLock);
+
+		for (TimerWheel* other = wheel; other != NULL;
+				other = other->waiting_for) {
+			if (other == callerWheel) {
+				dprintf("net timer: hook %p would deadlock waiting for timer "
+					"%p\n", callerWheel->current_timer != NULL
+						? callerWheel->current_timer->hook : NULL, timer);
+				return B_WOULD_BLOCK;
+			}
+		}
+
+		callerWheel->waiting_for = wheel;
+	}
+
 	while (true) {
-		MutexLocker locker(sTimerLock);
+		MutexLocker locker(wheel->lock);
 
-		if (timer->due <= 0 && sCurrentTimer != timer)
-			return B_OK;
+		if (timer->due <= 0 && wheel->current_timer != timer)
+			break;
 
 		// we actually need to wait for this timer
 		ConditionVariableEntry entry;
-		sWaitForTimerCondition.Add(&entry);
+		wheel->wait_for_timer_condition.Add(&entry);
 
 		locker.Unlock();
 
 		entry.Wait();
 	}
 
+	if (callerWheel != NULL) {
+		MutexLocker waitLocker(sTimerWaitLock);
+		callerWheel->waiting_for = NULL;
+	}
+
 	return B_OK;
 }
 
@@ -617,77 +963,130 @@ is_timer_active(net_timer* timer)
 bool
 is_timer_running(net_timer* timer)
 {
-	return timer == sCurrentTimer;
+	return timer == timer_wheel_for(timer)->current_timer;
 }
 
 
-static int
-dump_timer(int argc, char** argv)
+static void
+dump_timer_list(struct list* list)
 {
-	kprintf("timer       hook        data        due in\n");
-
 	struct net_timer* timer = NULL;
 	while (true) {
-		timer = (net_timer*)list_get_next_item(&sTimers, timer);
+		timer = (net_timer*)list_get_next_item(list, timer);
 		if (timer == NULL)
 			break;
 
 		kprintf("%p  %p  %p  %" B_PRId64 "\n", timer, timer->hook, timer->data,
 			timer->due > 0 ? timer->due - system_time() : -1);
 	}
+}
+
+
+static int
+dump_timer(int argc, char** argv)
+{
+	kprintf("timer       hook        data        due in\n");
+
+	for (uint32 i = 0; i < sTimerWheelCount; i++) {
+		TimerWheel* wheel = &sTimerWheels[i];
+		for (uint32 level = 0; level < kTimerWheelLevels; level++) {
+			for (uint32 slot = 0; slot < kTimerWheelSlots; slot++)
+				dump_timer_list(&wheel->slots[level][slot]);
+		}
+		dump_timer_list(&wheel->expired);
+	}
 
 	return 0;
 }
 
 
-status_t
-init_timers(void)
+static status_t
+init_timer_wheel(TimerWheel* wheel, uint32 index)
 {
-	list_init(&sTimers);
-	sTimerTimeout = B_INFINITE_TIMEOUT;
+	for (uint32 level = 0; level < kTimerWheelLevels; level++) {
+		for (uint32 slot = 0; slot < kTimerWheelSlots; slot++)
+			list_init(&wheel->slots[level][slot]);
+		wheel->occupied[level] = 0;
+	}
+	list_init(&wheel->expired);
 
-	status_t status = B_OK;
-	mutex_init(&sTimerLock, "net timer");
+	wheel->current_timer = NULL;
+	wheel->waiting_for = NULL;
+	wheel->current_tick = system_time() / kTimerTick;
+	wheel->timeout = B_INFINITE_TIMEOUT;
+
+	mutex_init(&wheel->lock, "net timer");
+	wheel->wait_for_timer_condition.Init(NULL, "wait for net timer");
 
-	sTimerWaitSem = create_sem(0, "net timer wait");
-	if (sTimerWaitSem < B_OK) {
-		status = sTimerWaitSem;
-		goto err1;
+	wheel->wait_sem = create_sem(0, "net timer wait");
+	if (wheel->wait_sem < B_OK) {
+		mutex_destroy(&wheel->lock);
+		return wheel->wait_sem;
 	}
 
-	sTimerThread = spawn_kernel_thread(timer_thread, "net timer",
-		B_NORMAL_PRIORITY, NULL);
-	if (sTimerThread < B_OK) {
-		status = sTimerThread;
-		goto err2;
+	char name[B_OS_NAME_LENGTH];
+	snprintf(name, sizeof(name), "net timer %" B_PRIu32, index);
+
+	wheel->thread = spawn_kernel_thread(timer_thread, name, B_NORMAL_PRIORITY,
+		wheel);
+	if (wheel->thread < B_OK) {
+		delete_sem(wheel->wait_sem);
+		mutex_destroy(&wheel->lock);
+		return wheel->thread;
 	}
 
-	sWaitForTimerCondition.Init(NULL, "wait for net timer");
+	return resume_thread(wheel->thread);
+}
+
+
+static void
+uninit_timer_wheel(TimerWheel* wheel)
+{
+	delete_sem(wheel->wait_sem);
+
+	status_t status;
+	wait_for_thread(wheel->thread, &status);
+
+	mutex_lock(&wheel->lock);
+	mutex_destroy(&wheel->lock);
+}
+
+
+status_t
+init_timers(void)
+{
+	// use one wheel and timer thread per CPU
+	sTimerWheelCount = std::min((uint32)smp_get_num_cpus(), kMaxTimerWheels);
+	sTimerWheels = new(std::nothrow) TimerWheel[sTimerWheelCount];
+	if (sTimerWheels == NULL)
+		return B_NO_MEMORY;
+
+	for (uint32 i = 0; i < sTimerWheelCount; i++) {
+		status_t status = init_timer_wheel(&sTimerWheels[i], i);
+		if (status != B_OK) {
+			while (i-- > 0)
+				uninit_timer_wheel(&sTimerWheels[i]);
+			delete[] sTimerWheels;
+			sTimerWheels = NULL;
+			return status;
+		}
+	}
 
 	add_debugger_command("net_timer", dump_timer,
 		"Lists all active network timer");
 
-	return resume_thread(sTimerThread);
-
-err1:
-	mutex_destroy(&sTimerLock);
-err2:
-	delete_sem(sTimerWaitSem);
-	return status;
+	return B_OK;
 }
 
 
 void
 uninit_timers(void)
 {
-	delete_sem(sTimerWaitSem);
-
-	status_t status;
-	wait_for_thread(sTimerThread, &status);
-
-	mutex_lock(&sTimerLock);
+	for (uint32 i = 0; i < sTimerWheelCount; i++)
+		uninit_timer_wheel(&sTimerWheels[i]);
 
-	mutex_destroy(&sTimerLock);
+	delete[] sTimerWheels;
+	sTimerWheels = NULL;
 
 	remove_debugger_command("net_timer", dump_timer);
 }
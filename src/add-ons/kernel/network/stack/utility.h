@@ -45,7 +45,9 @@ UserBuffer::UserBuffer(void* buffer, size_t size)
 
 
 // checksums
-uint16		compute_checksum(uint8* _buffer, size_t length);
+uint16		compute_checksum(uint8* buffer, size_t length);
+uint16		copy_and_compute_checksum(uint8* target, const uint8* source,
+				size_t length);
 uint16		checksum(uint8* buffer, size_t length);
 
 // notifications
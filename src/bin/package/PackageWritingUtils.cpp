@@ -16,6 +16,23 @@
 #include <AutoDeleter.h>
 
 
+status_t
+parse_compression_algorithm(const char* name, uint32& _compression)
+{
+	if (strcmp(name, "zlib") == 0)
+		_compression = BPackageKit::BHPKG::B_HPKG_COMPRESSION_ZLIB;
+	else if (strcmp(name, "lz4") == 0)
+		_compression = BPackageKit::BHPKG::B_HPKG_COMPRESSION_LZ4;
+	else {
+		fprintf(stderr, "Error: Unknown compression algorithm \"%s\".\n",
+			name);
+		return B_BAD_VALUE;
+	}
+
+	return B_OK;
+}
+
+
 status_t
 add_current_directory_entries(BPackageWriter& packageWriter,
 	BPackageWriterListener& listener, bool skipPackageInfo)
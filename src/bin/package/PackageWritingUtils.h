@@ -15,6 +15,9 @@ using BPackageKit::BHPKG::BPackageWriter;
 using BPackageKit::BHPKG::BPackageWriterListener;
 
 
+status_t	parse_compression_algorithm(const char* name,
+				uint32& _compression);
+
 status_t	add_current_directory_entries(BPackageWriter& packageWriter,
 				BPackageWriterListener& listener, bool skipPackageInfo);
 
@@ -36,6 +36,8 @@ command_add(int argc, const char* const* argv)
 	bool verbose = false;
 	bool force = false;
 	int32 compressionLevel = BPackageKit::BHPKG::B_HPKG_COMPRESSION_LEVEL_BEST;
+	uint32 compression = BPackageKit::BHPKG::B_HPKG_COMPRESSION_ZLIB;
+	int32 compressionThreads = 1;
 
 	while (true) {
 		static struct option sLongOptions[] = {
@@ -46,7 +48,7 @@ command_add(int argc, const char* const* argv)
 		};
 
 		opterr = 0; // don't print errors
-		int c = getopt_long(argc, (char**)argv, "+0123456789C:fhi:qv",
+		int c = getopt_long(argc, (char**)argv, "+0123456789C:fhi:j:qvz:",
 			sLongOptions, NULL);
 		if (c == -1)
 			break;
@@ -81,6 +83,15 @@ command_add(int argc, const char* const* argv)
 				packageInfoFileName = optarg;
 				break;
 
+			case 'j':
+				compressionThreads = atoi(optarg);
+				if (compressionThreads < 1) {
+					fprintf(stderr, "Error: Invalid thread count \"%s\".\n",
+						optarg);
+					return 1;
+				}
+				break;
+
 			case 'q':
 				quiet = true;
 				break;
@@ -89,6 +100,11 @@ command_add(int argc, const char* const* argv)
 				verbose = true;
 				break;
 
+			case 'z':
+				if (parse_compression_algorithm(optarg, compression) != B_OK)
+					return 1;
+				break;
+
 			default:
 				print_usage_and_exit(true);
 				break;
@@ -117,7 +133,9 @@ command_add(int argc, const char* const* argv)
 	if (compressionLevel == 0) {
 		writerParameters.SetCompression(
 			BPackageKit::BHPKG::B_HPKG_COMPRESSION_NONE);
-	}
+	} else
+		writerParameters.SetCompression(compression);
+	writerParameters.SetCompressionThreads(compressionThreads);
 
 	PackageWriterListener listener(verbose, quiet);
 	BPackageWriter packageWriter(&listener);
@@ -36,9 +36,12 @@ command_create(int argc, const char* const* argv)
 	const char* packageInfoFileName = NULL;
 	const char* installPath = NULL;
 	bool isBuildPackage = false;
+	bool addDataHashes = false;
 	bool quiet = false;
 	bool verbose = false;
 	int32 compressionLevel = BPackageKit::BHPKG::B_HPKG_COMPRESSION_LEVEL_BEST;
+	uint32 compression = BPackageKit::BHPKG::B_HPKG_COMPRESSION_ZLIB;
+	int32 compressionThreads = 1;
 
 	while (true) {
 		static struct option sLongOptions[] = {
@@ -49,7 +52,7 @@ command_create(int argc, const char* const* argv)
 		};
 
 		opterr = 0; // don't print errors
-		int c = getopt_long(argc, (char**)argv, "+b0123456789C:hi:I:qv",
+		int c = getopt_long(argc, (char**)argv, "+b0123456789C:hHi:I:j:qvz:",
 			sLongOptions, NULL);
 		if (c == -1)
 			break;
@@ -80,6 +83,10 @@ command_create(int argc, const char* const* argv)
 				print_usage_and_exit(false);
 				break;
 
+			case 'H':
+				addDataHashes = true;
+				break;
+
 			case 'i':
 				packageInfoFileName = optarg;
 				break;
@@ -88,6 +95,15 @@ command_create(int argc, const char* const* argv)
 				installPath = optarg;
 				break;
 
+			case 'j':
+				compressionThreads = atoi(optarg);
+				if (compressionThreads < 1) {
+					fprintf(stderr, "Error: Invalid thread count \"%s\".\n",
+						optarg);
+					return 1;
+				}
+				break;
+
 			case 'q':
 				quiet = true;
 				break;
@@ -96,6 +112,11 @@ command_create(int argc, const char* const* argv)
 				verbose = true;
 				break;
 
+			case 'z':
+				if (parse_compression_algorithm(optarg, compression) != B_OK)
+					return 1;
+				break;
+
 			default:
 				print_usage_and_exit(true);
 				break;
@@ -117,11 +138,17 @@ command_create(int argc, const char* const* argv)
 
 	// create package
 	BPackageWriterParameters writerParameters;
+	if (addDataHashes) {
+		writerParameters.SetFlags(
+			BPackageKit::BHPKG::B_HPKG_WRITER_CONTENT_HASHES);
+	}
 	writerParameters.SetCompressionLevel(compressionLevel);
 	if (compressionLevel == 0) {
 		writerParameters.SetCompression(
 			BPackageKit::BHPKG::B_HPKG_COMPRESSION_NONE);
-	}
+	} else
+		writerParameters.SetCompression(compression);
+	writerParameters.SetCompressionThreads(compressionThreads);
 
 	PackageWriterListener listener(verbose, quiet);
 	BPackageWriter packageWriter(&listener);
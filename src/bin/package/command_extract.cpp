@@ -8,6 +8,7 @@
 #include <fcntl.h>
 #include <errno.h>
 #include <getopt.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -30,7 +31,8 @@
 #include <package/hpkg/PackageDataReader.h>
 #include <package/hpkg/PackageEntry.h>
 #include <package/hpkg/PackageEntryAttribute.h>
-#include <package/hpkg/PackageReader.h>
+#include <package/hpkg/PackageFileHeapReader.h>
+#include <package/hpkg/PackageReaderImpl.h>
 #include <package/hpkg/StandardErrorOutput.h>
 #include <package/hpkg/v1/PackageContentHandler.h>
 #include <package/hpkg/v1/PackageDataReader.h>
@@ -50,6 +52,11 @@ using BPackageKit::BHPKG::BErrorOutput;
 using BPackageKit::BHPKG::BFDDataReader;
 using BPackageKit::BHPKG::BPackageInfoAttributeValue;
 using BPackageKit::BHPKG::BStandardErrorOutput;
+using BPackageKit::BHPKG::BPrivate::PackageFileHeapReader;
+using BPackageKit::BHPKG::BPrivate::PackageReaderImpl;
+
+
+static const int32 kExtractJobsPerThread = 4;
 
 
 struct VersionPolicyV1 {
@@ -97,6 +104,17 @@ struct VersionPolicyV1 {
 		return _heapReader != NULL ? B_OK : B_NO_MEMORY;
 	}
 
+	static inline bool SupportsParallelExtraction()
+	{
+		// the data readers share the buffer pool
+		return false;
+	}
+
+	static HeapReaderBase* CloneHeapReader(PackageReader& packageReader)
+	{
+		return NULL;
+	}
+
 	static status_t CreatePackageDataReader(BBufferPool* bufferPool,
 		HeapReaderBase* heapReader, const PackageData& data,
 		BAbstractBufferedDataReader*& _reader)
@@ -111,7 +129,7 @@ struct VersionPolicyV2 {
 	typedef BPackageKit::BHPKG::BPackageData PackageData;
 	typedef BPackageKit::BHPKG::BPackageEntry PackageEntry;
 	typedef BPackageKit::BHPKG::BPackageEntryAttribute PackageEntryAttribute;
-	typedef BPackageKit::BHPKG::BPackageReader PackageReader;
+	typedef PackageReaderImpl PackageReader;
 	typedef BAbstractBufferedDataReader HeapReaderBase;
 
 	static inline size_t BufferSize()
@@ -150,6 +168,17 @@ struct VersionPolicyV2 {
 		return B_OK;
 	}
 
+	static inline bool SupportsParallelExtraction()
+	{
+		return true;
+	}
+
+	static HeapReaderBase* CloneHeapReader(PackageReader& packageReader)
+	{
+		PackageFileHeapReader* heapReader = packageReader.RawHeapReader();
+		return heapReader != NULL ? heapReader->Clone() : NULL;
+	}
+
 	static status_t CreatePackageDataReader(BBufferPool* bufferPool,
 		HeapReaderBase* heapReader, const PackageData& data,
 		BAbstractBufferedDataReader*& _reader)
@@ -304,6 +333,238 @@ private:
 };
 
 
+struct FDDataOutput : BDataIO {
+	FDDataOutput(int fd)
+		:
+		fFD(fd),
+		fOffset(0)
+	{
+	}
+
+	virtual ssize_t Write(const void* buffer, size_t size)
+	{
+		ssize_t bytesWritten = write_pos(fFD, fOffset, buffer, size);
+		if (bytesWritten < 0)
+			return errno;
+
+		fOffset += bytesWritten;
+		return bytesWritten;
+	}
+
+private:
+	int		fFD;
+	off_t	fOffset;
+};
+
+
+template<typename VersionPolicy>
+static status_t
+extract_file_data(BBufferPool* bufferPool,
+	typename VersionPolicy::HeapReaderBase* dataReader,
+	const typename VersionPolicy::PackageData& data, int fd)
+{
+	// create a PackageDataReader
+	BAbstractBufferedDataReader* reader;
+	status_t error = VersionPolicy::CreatePackageDataReader(bufferPool,
+		dataReader, data, reader);
+	if (error != B_OK)
+		return error;
+	ObjectDeleter<BAbstractBufferedDataReader> readerDeleter(reader);
+
+	// Let the reader write the data directly, so that each heap chunk is
+	// decompressed only once.
+	FDDataOutput output(fd);
+	error = reader->ReadDataToOutput(0,
+		VersionPolicy::PackageDataUncompressedSize(data), &output);
+	if (error != B_OK) {
+		fprintf(stderr, "Error: Failed to extract data: %s\n",
+			strerror(error));
+	}
+
+	return error;
+}
+
+
+/*!	Pool of threads writing the data of regular files, while the main thread
+	continues parsing the TOC and creating the entries.
+	Each thread reads through its own clone of the heap reader, since those
+	aren't thread-safe. The number of queued jobs is bounded, which also bounds
+	the number of open file descriptors.
+*/
+template<typename VersionPolicy>
+struct ExtractPipeline {
+	typedef typename VersionPolicy::PackageData PackageData;
+	typedef typename VersionPolicy::PackageReader PackageReader;
+	typedef typename VersionPolicy::HeapReaderBase HeapReaderBase;
+
+	struct Job {
+		PackageData	data;
+		BString		path;
+		int			fd;
+		timespec	times[2];
+	};
+
+	ExtractPipeline(PackageReader& packageReader)
+		:
+		packageReader(packageReader),
+		threads(NULL),
+		threadCount(0),
+		jobs(NULL),
+		jobCount(0),
+		queued(0),
+		claimed(0),
+		error(B_OK),
+		quit(false)
+	{
+		pthread_mutex_init(&lock, NULL);
+		pthread_cond_init(&jobQueued, NULL);
+		pthread_cond_init(&jobClaimed, NULL);
+	}
+
+	~ExtractPipeline()
+	{
+		Finish();
+
+		delete[] jobs;
+		delete[] threads;
+
+		pthread_cond_destroy(&jobClaimed);
+		pthread_cond_destroy(&jobQueued);
+		pthread_mutex_destroy(&lock);
+	}
+
+	status_t Init(int32 count)
+	{
+		threads = new(std::nothrow) pthread_t[count];
+		jobCount = count * kExtractJobsPerThread;
+		jobs = new(std::nothrow) Job[jobCount];
+		if (threads == NULL || jobs == NULL)
+			return B_NO_MEMORY;
+
+		for (; threadCount < count; threadCount++) {
+			if (pthread_create(&threads[threadCount], NULL, &_Worker, this)
+					!= 0) {
+				break;
+			}
+		}
+
+		if (threadCount == 0)
+			return B_NO_MORE_THREADS;
+		return B_OK;
+	}
+
+	status_t Queue(int fd, const PackageData& data, const BString& path,
+		const timespec* times)
+	{
+		// takes over the file descriptor
+		pthread_mutex_lock(&lock);
+		while (error == B_OK && queued - claimed == jobCount)
+			pthread_cond_wait(&jobClaimed, &lock);
+
+		status_t result = error;
+		if (result == B_OK) {
+			Job& job = jobs[queued % jobCount];
+			job.data = data;
+			job.path = path;
+			job.fd = fd;
+			job.times[0] = times[0];
+			job.times[1] = times[1];
+			queued++;
+			pthread_cond_signal(&jobQueued);
+		}
+		pthread_mutex_unlock(&lock);
+
+		if (result != B_OK)
+			close(fd);
+		return result;
+	}
+
+	status_t Finish()
+	{
+		pthread_mutex_lock(&lock);
+		quit = true;
+		pthread_cond_broadcast(&jobQueued);
+		pthread_mutex_unlock(&lock);
+
+		for (int32 i = 0; i < threadCount; i++)
+			pthread_join(threads[i], NULL);
+		threadCount = 0;
+
+		return error;
+	}
+
+private:
+	static void* _Worker(void* _self)
+	{
+		ExtractPipeline* self = (ExtractPipeline*)_self;
+
+		HeapReaderBase* heapReader
+			= VersionPolicy::CloneHeapReader(self->packageReader);
+		ObjectDeleter<HeapReaderBase> heapReaderDeleter(heapReader);
+
+		pthread_mutex_lock(&self->lock);
+		if (heapReader == NULL)
+			self->_SetError(B_NO_MEMORY);
+
+		while (true) {
+			while (!self->quit && self->claimed == self->queued)
+				pthread_cond_wait(&self->jobQueued, &self->lock);
+			if (self->claimed == self->queued)
+				break;
+
+			Job job = self->jobs[self->claimed++ % self->jobCount];
+			pthread_cond_broadcast(&self->jobClaimed);
+			bool skip = self->error != B_OK;
+			pthread_mutex_unlock(&self->lock);
+
+			// After an error the remaining jobs are only drained.
+			status_t error = B_OK;
+			if (!skip) {
+				error = extract_file_data<VersionPolicy>(NULL, heapReader,
+					job.data, job.fd);
+				if (error == B_OK)
+					futimens(job.fd, job.times);
+				else {
+					fprintf(stderr, "Error: Failed to write file \"%s\"\n",
+						job.path.String());
+				}
+			}
+			close(job.fd);
+
+			pthread_mutex_lock(&self->lock);
+			if (error != B_OK)
+				self->_SetError(error);
+		}
+		pthread_mutex_unlock(&self->lock);
+
+		return NULL;
+	}
+
+	void _SetError(status_t newError)
+	{
+		// the lock must be held
+		if (error == B_OK) {
+			error = newError;
+			pthread_cond_broadcast(&jobClaimed);
+		}
+	}
+
+private:
+	PackageReader&		packageReader;
+	pthread_mutex_t		lock;
+	pthread_cond_t		jobQueued;
+	pthread_cond_t		jobClaimed;
+	pthread_t*			threads;
+	int32				threadCount;
+	Job*				jobs;
+	int32				jobCount;
+	int32				queued;
+	int32				claimed;
+	status_t			error;
+	bool				quit;
+};
+
+
 template<typename VersionPolicy>
 struct PackageContentExtractHandler : VersionPolicy::PackageContentHandler {
 	PackageContentExtractHandler(BBufferPool* bufferPool,
@@ -311,8 +572,7 @@ struct PackageContentExtractHandler : VersionPolicy::PackageContentHandler {
 		:
 		fBufferPool(bufferPool),
 		fPackageFileReader(heapReader),
-		fDataBuffer(NULL),
-		fDataBufferSize(0),
+		fPipeline(NULL),
 		fRootFilterEntry(NULL, NULL, true),
 		fBaseDirectory(AT_FDCWD),
 		fInfoFileName(NULL),
@@ -320,23 +580,9 @@ struct PackageContentExtractHandler : VersionPolicy::PackageContentHandler {
 	{
 	}
 
-	~PackageContentExtractHandler()
-	{
-		free(fDataBuffer);
-	}
-
 	status_t Init()
 	{
-		status_t error = fRootFilterEntry.Init();
-		if (error != B_OK)
-			return error;
-
-		fDataBufferSize = 64 * 1024;
-		fDataBuffer = malloc(fDataBufferSize);
-		if (fDataBuffer == NULL)
-			return B_NO_MEMORY;
-
-		return B_OK;
+		return fRootFilterEntry.Init();
 	}
 
 	void SetBaseDirectory(int fd)
@@ -349,6 +595,11 @@ struct PackageContentExtractHandler : VersionPolicy::PackageContentHandler {
 		fInfoFileName = infoFileName;
 	}
 
+	void SetPipeline(ExtractPipeline<VersionPolicy>* pipeline)
+	{
+		fPipeline = pipeline;
+	}
+
 	void SetExtractAll()
 	{
 		fRootFilterEntry.SetExplicit();
@@ -490,6 +741,7 @@ struct PackageContentExtractHandler : VersionPolicy::PackageContentHandler {
 
 		// create the entry
 		int fd = -1;
+		bool dataQueued = false;
 		if (S_ISREG(entry->Mode())) {
 			if (implicit) {
 				fprintf(stderr, "Error: File \"%s\" was specified as a "
@@ -509,11 +761,39 @@ struct PackageContentExtractHandler : VersionPolicy::PackageContentHandler {
 				return errno;
 			}
 
-			// write data
-			status_t error = _ExtractFileData(fPackageFileReader, entry->Data(),
-				fd);
-			if (error != B_OK)
+			// preallocate the file, so that it doesn't grow with every write
+			const typename VersionPolicy::PackageData& data = entry->Data();
+			off_t size = VersionPolicy::PackageDataUncompressedSize(data);
+			if (size > 0 && ftruncate(fd, size) != 0) {
+				status_t error = errno;
+				fprintf(stderr, "Error: Failed to resize file \"%s\": %s\n",
+					_EntryPath(entry).String(), strerror(error));
 				return error;
+			}
+
+			// Write the data or leave it to the extraction threads. Those
+			// also set the file times afterwards.
+			if (fPipeline != NULL && size > 0 && !data.IsEncodedInline()) {
+				int jobFD = dup(fd);
+				if (jobFD < 0) {
+					status_t error = errno;
+					fprintf(stderr, "Error: Failed to duplicate file "
+						"descriptor: %s\n", strerror(error));
+					return error;
+				}
+
+				timespec times[2] = {entry->AccessTime(),
+					entry->ModifiedTime()};
+				status_t error = fPipeline->Queue(jobFD, data,
+					_EntryPath(entry), times);
+				if (error != B_OK)
+					return error;
+				dataQueued = true;
+			} else {
+				status_t error = _ExtractFileData(fPackageFileReader, data, fd);
+				if (error != B_OK)
+					return error;
+			}
 		} else if (S_ISLNK(entry->Mode())) {
 			if (implicit) {
 				fprintf(stderr, "Error: Symlink \"%s\" was specified as a "
@@ -559,7 +839,7 @@ struct PackageContentExtractHandler : VersionPolicy::PackageContentHandler {
 		token->fd = fd;
 
 		// set the file times
-		if (!entryExists && !implicit) {
+		if (!entryExists && !implicit && !dataQueued) {
 			timespec times[2] = {entry->AccessTime(), entry->ModifiedTime()};
 			futimens(fd, times);
 
@@ -709,52 +989,14 @@ private:
 		typename VersionPolicy::HeapReaderBase* dataReader,
 		const typename VersionPolicy::PackageData& data, int fd)
 	{
-		// create a PackageDataReader
-		BAbstractBufferedDataReader* reader;
-		status_t error = VersionPolicy::CreatePackageDataReader(fBufferPool,
-			dataReader, data, reader);
-		if (error != B_OK)
-			return error;
-		ObjectDeleter<BAbstractBufferedDataReader> readerDeleter(reader);
-
-		// write the data
-		off_t bytesRemaining = VersionPolicy::PackageDataUncompressedSize(data);
-		off_t offset = 0;
-		while (bytesRemaining > 0) {
-			// read
-			size_t toCopy = std::min((off_t)fDataBufferSize, bytesRemaining);
-			error = reader->ReadData(offset, fDataBuffer, toCopy);
-			if (error != B_OK) {
-				fprintf(stderr, "Error: Failed to read data: %s\n",
-					strerror(error));
-				return error;
-			}
-
-			// write
-			ssize_t bytesWritten = write_pos(fd, offset, fDataBuffer, toCopy);
-			if (bytesWritten < 0) {
-				fprintf(stderr, "Error: Failed to write data: %s\n",
-					strerror(errno));
-				return errno;
-			}
-			if ((size_t)bytesWritten != toCopy) {
-				fprintf(stderr, "Error: Failed to write all data (%zd of "
-					"%zu)\n", bytesWritten, toCopy);
-				return B_ERROR;
-			}
-
-			offset += toCopy;
-			bytesRemaining -= toCopy;
-		}
-
-		return B_OK;
+		return extract_file_data<VersionPolicy>(fBufferPool, dataReader, data,
+			fd);
 	}
 
 private:
 	BBufferPool*							fBufferPool;
 	typename VersionPolicy::HeapReaderBase*	fPackageFileReader;
-	void*									fDataBuffer;
-	size_t									fDataBufferSize;
+	ExtractPipeline<VersionPolicy>*			fPipeline;
 	Entry									fRootFilterEntry;
 	int										fBaseDirectory;
 	const char*								fInfoFileName;
@@ -766,7 +1008,7 @@ template<typename VersionPolicy>
 static void
 do_extract(const char* packageFileName, const char* changeToDirectory,
 	const char* packageInfoFileName, const char* const* explicitEntries,
-	int explicitEntryCount, bool ignoreVersionError)
+	int explicitEntryCount, int32 threadCount, bool ignoreVersionError)
 {
 	// open package
 	BStandardErrorOutput errorOutput;
@@ -835,9 +1077,22 @@ do_extract(const char* packageFileName, const char* changeToDirectory,
 	if (packageInfoFileName != NULL)
 		handler.SetPackageInfoFile(packageInfoFileName);
 
+	// start the extraction threads, if requested and supported
+	ExtractPipeline<VersionPolicy> pipeline(packageReader);
+	if (threadCount > 1 && VersionPolicy::SupportsParallelExtraction()) {
+		error = pipeline.Init(threadCount);
+		if (error != B_OK) {
+			fprintf(stderr, "Error: Failed to start the extraction threads: "
+				"%s\n", strerror(error));
+			exit(1);
+		}
+		handler.SetPipeline(&pipeline);
+	}
+
 	// extract
 	error = packageReader.ParseContent(&handler);
-	if (error != B_OK)
+	status_t pipelineError = pipeline.Finish();
+	if (error != B_OK || pipelineError != B_OK)
 		exit(1);
 
 	// check whether all explicitly specified entries have been extracted
@@ -861,6 +1116,7 @@ command_extract(int argc, const char* const* argv)
 {
 	const char* changeToDirectory = NULL;
 	const char* packageInfoFileName = NULL;
+	int32 threadCount = 1;
 
 	while (true) {
 		static struct option sLongOptions[] = {
@@ -869,7 +1125,7 @@ command_extract(int argc, const char* const* argv)
 		};
 
 		opterr = 0; // don't print errors
-		int c = getopt_long(argc, (char**)argv, "+C:hi:", sLongOptions, NULL);
+		int c = getopt_long(argc, (char**)argv, "+C:hi:j:", sLongOptions, NULL);
 		if (c == -1)
 			break;
 
@@ -886,6 +1142,15 @@ command_extract(int argc, const char* const* argv)
 				packageInfoFileName = optarg;
 				break;
 
+			case 'j':
+				threadCount = atoi(optarg);
+				if (threadCount < 1) {
+					fprintf(stderr, "Error: Invalid thread count \"%s\".\n",
+						optarg);
+					return 1;
+				}
+				break;
+
 			default:
 				print_usage_and_exit(true);
 				break;
@@ -901,9 +1166,11 @@ command_extract(int argc, const char* const* argv)
 	const char* const* explicitEntries = argv + optind;
 	int explicitEntryCount = argc - optind;
 	do_extract<VersionPolicyV2>(packageFileName, changeToDirectory,
-		packageInfoFileName, explicitEntries, explicitEntryCount, true);
+		packageInfoFileName, explicitEntries, explicitEntryCount, threadCount,
+		true);
 	do_extract<VersionPolicyV1>(packageFileName, changeToDirectory,
-		packageInfoFileName, explicitEntries, explicitEntryCount, false);
+		packageInfoFileName, explicitEntries, explicitEntryCount, threadCount,
+		false);
 
 	return 0;
 }
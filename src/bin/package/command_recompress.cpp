@@ -23,6 +23,7 @@
 
 #include "package.h"
 #include "PackageWriterListener.h"
+#include "PackageWritingUtils.h"
 
 
 using BPackageKit::BHPKG::BPackageReader;
@@ -45,6 +46,8 @@ command_recompress(int argc, const char* const* argv)
 	bool quiet = false;
 	bool verbose = false;
 	int32 compressionLevel = BPackageKit::BHPKG::B_HPKG_COMPRESSION_LEVEL_BEST;
+	uint32 compression = BPackageKit::BHPKG::B_HPKG_COMPRESSION_ZLIB;
+	int32 compressionThreads = 1;
 
 	while (true) {
 		static struct option sLongOptions[] = {
@@ -55,7 +58,7 @@ command_recompress(int argc, const char* const* argv)
 		};
 
 		opterr = 0; // don't print errors
-		int c = getopt_long(argc, (char**)argv, "+0123456789:hqv",
+		int c = getopt_long(argc, (char**)argv, "+0123456789:hj:qvz:",
 			sLongOptions, NULL);
 		if (c == -1)
 			break;
@@ -78,6 +81,15 @@ command_recompress(int argc, const char* const* argv)
 				print_usage_and_exit(false);
 				break;
 
+			case 'j':
+				compressionThreads = atoi(optarg);
+				if (compressionThreads < 1) {
+					fprintf(stderr, "Error: Invalid thread count \"%s\".\n",
+						optarg);
+					return 1;
+				}
+				break;
+
 			case 'q':
 				quiet = true;
 				break;
@@ -86,6 +98,11 @@ command_recompress(int argc, const char* const* argv)
 				verbose = true;
 				break;
 
+			case 'z':
+				if (parse_compression_algorithm(optarg, compression) != B_OK)
+					return 1;
+				break;
+
 			default:
 				print_usage_and_exit(true);
 				break;
@@ -122,7 +139,9 @@ command_recompress(int argc, const char* const* argv)
 	if (compressionLevel == 0) {
 		writerParameters.SetCompression(
 			BPackageKit::BHPKG::B_HPKG_COMPRESSION_NONE);
-	}
+	} else
+		writerParameters.SetCompression(compression);
+	writerParameters.SetCompressionThreads(compressionThreads);
 
 	PackageWriterListener listener(verbose, quiet);
 	BPackageWriter packageWriter(&listener);
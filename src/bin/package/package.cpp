@@ -38,8 +38,11 @@ static const char* kUsage =
 	"    -i <info>  - Use the package info file <info>. It will be added as\n"
 	"                 \".PackageInfo\", overriding a \".PackageInfo\" file,\n"
 	"                 existing.\n"
+	"    -j <count> - Compress the data on <count> threads. Defaults to 1.\n"
 	"    -q         - Be quiet (don't show any output except for errors).\n"
 	"    -v         - Be verbose (show more info about created package).\n"
+	"    -z <algo>  - Use compression algorithm <algo>, \"zlib\" (default) "
+		"or \"lz4\".\n"
 	"\n"
 	"  checksum [ <options> ] [ <package> ]\n"
 	"    Computes the checksum of package file <package>. If <package> is "
@@ -61,6 +64,9 @@ static const char* kUsage =
 		"will\n"
 	"                 be added.\n"
 	"    -C <dir>   - Change to directory <dir> before adding entries.\n"
+	"    -H         - Add the SHA-256 hashes of the file data, so that "
+		"packagefs\n"
+	"                 can share identical files with other packages.\n"
 	"    -i <info>  - Use the package info file <info>. It will be added as\n"
 	"                 \".PackageInfo\", overriding a \".PackageInfo\" file,\n"
 	"                 existing.\n"
@@ -70,8 +76,11 @@ static const char* kUsage =
 	"                 the package .self link to point to <path>, which is "
 		"useful\n"
 	"                 to redirect a \"make install\". Only allowed with -b.\n"
+	"    -j <count> - Compress the data on <count> threads. Defaults to 1.\n"
 	"    -q         - Be quiet (don't show any output except for errors).\n"
 	"    -v         - Be verbose (show more info about created package).\n"
+	"    -z <algo>  - Use compression algorithm <algo>, \"zlib\" (default) "
+		"or \"lz4\".\n"
 	"\n"
 	"  dump [ <options> ] <package>\n"
 	"    Dumps the TOC section of package file <package>. For debugging only.\n"
@@ -85,6 +94,7 @@ static const char* kUsage =
 		"contents\n"
 	"                  of the archive.\n"
 	"    -i <info>  - Extract the .PackageInfo file to <info> instead.\n"
+	"    -j <count> - Write the file data on <count> threads. Defaults to 1.\n"
 	"\n"
 	"  info [ <options> ] <package>\n"
 	"    Prints individual meta information of package file <package>.\n"
@@ -118,8 +128,11 @@ static const char* kUsage =
 	"    -0 ... -9  - Use compression level 0 ... 9. 0 means no, 9 best "
 		"compression.\n"
 	"                 Defaults to 9.\n"
+	"    -j <count> - Compress the data on <count> threads. Defaults to 1.\n"
 	"    -q         - Be quiet (don't show any output except for errors).\n"
 	"    -v         - Be verbose (show more info about created package).\n"
+	"    -z <algo>  - Use compression algorithm <algo>, \"zlib\" (default) "
+		"or \"lz4\".\n"
 	"\n"
 	"Common Options:\n"
 	"  -h, --help   - Print this usage info.\n"
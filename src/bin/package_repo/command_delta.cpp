@@ -0,0 +1,127 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <Entry.h>
+#include <String.h>
+
+#include <package/ChecksumAccessors.h>
+#include <package/RepositoryCache.h>
+#include <package/RepositoryDelta.h>
+
+#include "package_repo.h"
+
+
+using namespace BPackageKit;
+using BPackageKit::BPrivate::GeneralFileChecksumAccessor;
+using BPackageKit::BPrivate::RepositoryDelta;
+
+
+static bool
+load_repository(const char* fileName, BRepositoryCache& cache,
+	BString& checksum)
+{
+	BEntry entry(fileName);
+	status_t error = cache.SetTo(entry);
+	if (error != B_OK) {
+		fprintf(stderr, "Error: Failed to read repository file \"%s\": %s\n",
+			fileName, strerror(error));
+		return false;
+	}
+
+	error = GeneralFileChecksumAccessor(entry).GetChecksum(checksum);
+	if (error != B_OK) {
+		fprintf(stderr, "Error: Failed to compute the checksum of \"%s\": "
+			"%s\n", fileName, strerror(error));
+		return false;
+	}
+
+	return true;
+}
+
+
+int
+command_delta(int argc, const char* const* argv)
+{
+	bool verbose = false;
+
+	while (true) {
+		static struct option sLongOptions[] = {
+			{ "help", no_argument, 0, 'h' },
+			{ "verbose", no_argument, 0, 'v' },
+			{ 0, 0, 0, 0 }
+		};
+
+		opterr = 0; // don't print errors
+		int c = getopt_long(argc, (char**)argv, "+hv", sLongOptions, NULL);
+		if (c == -1)
+			break;
+
+		switch (c) {
+			case 'h':
+				print_usage_and_exit(false);
+				break;
+
+			case 'v':
+				verbose = true;
+				break;
+
+			default:
+				print_usage_and_exit(true);
+				break;
+		}
+	}
+
+	// The remaining three arguments are the old and new repository file plus
+	// the delta file.
+	if (optind + 3 != argc)
+		print_usage_and_exit(true);
+
+	const char* oldRepositoryFileName = argv[optind++];
+	const char* newRepositoryFileName = argv[optind++];
+	const char* deltaFileName = argv[optind++];
+
+	BRepositoryCache oldRepository;
+	BString oldChecksum;
+	BRepositoryCache newRepository;
+	BString newChecksum;
+	if (!load_repository(oldRepositoryFileName, oldRepository, oldChecksum)
+		|| !load_repository(newRepositoryFileName, newRepository,
+			newChecksum)) {
+		return 1;
+	}
+
+	RepositoryDelta delta;
+	status_t error = delta.SetTo(oldRepository, oldChecksum, newRepository,
+		newChecksum);
+	if (error != B_OK) {
+		fprintf(stderr, "Error: Failed to compute the delta: %s\n",
+			strerror(error));
+		return 1;
+	}
+
+	error = delta.WriteToFile(BEntry(deltaFileName));
+	if (error != B_OK) {
+		fprintf(stderr, "Error: Failed to write delta file \"%s\": %s\n",
+			deltaFileName, strerror(error));
+		return 1;
+	}
+
+	if (verbose) {
+		printf("base checksum:    %s\n", oldChecksum.String());
+		printf("target checksum:  %s\n", newChecksum.String());
+		printf("removed packages: %10" B_PRId32 "\n",
+			delta.CountRemovedPackages());
+		printf("added packages:   %10" B_PRId32 "\n",
+			delta.CountAddedPackages());
+	}
+
+	return 0;
+}
@@ -29,6 +29,15 @@ static const char* kUsage =
 	"    -q         - be quiet (don't show any output except for errors).\n"
 	"    -v         - be verbose (list package attributes as encountered).\n"
 	"\n"
+	"  delta [ <options> ] <old-repo> <new-repo> <delta-file>\n"
+	"    Writes the changes between package repository files <old-repo> and\n"
+	"    <new-repo> to <delta-file>. A client whose repository cache has the\n"
+	"    checksum of <old-repo> fetches it from\n"
+	"    \"<base-url>/delta/<checksum>\" to update the cache without\n"
+	"    fetching <new-repo>.\n"
+	"\n"
+	"    -v         - be verbose (print the checksums and package counts).\n"
+	"\n"
 	"  list [ <options> ] <package-repo>\n"
 	"    Lists the contents of package repository file <package-repo>.\n"
 	"\n"
@@ -68,6 +77,9 @@ main(int argc, const char* const* argv)
 	if (strcmp(command, "create") == 0)
 		return command_create(argc - 1, argv + 1);
 
+	if (strcmp(command, "delta") == 0)
+		return command_delta(argc - 1, argv + 1);
+
 	if (strcmp(command, "list") == 0)
 		return command_list(argc - 1, argv + 1);
 
@@ -16,6 +16,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <sys/ioctl.h>
+#include <time.h>
 #include <unistd.h>
 
 #include <syscall_utils.h>
@@ -279,6 +280,27 @@ recvmsg(int socket, struct msghdr *message, int flags)
 }
 
 
+extern "C" int
+recvmmsg(int socket, struct mmsghdr *messages, unsigned int count, int flags,
+	struct timespec *timeout)
+{
+	bigtime_t timeoutMicros = B_INFINITE_TIMEOUT;
+	if (timeout != NULL) {
+		if (timeout->tv_sec < 0 || timeout->tv_nsec < 0
+			|| timeout->tv_nsec >= 1000000000) {
+			errno = EINVAL;
+			return -1;
+		}
+
+		timeoutMicros = timeout->tv_sec * 1000000LL
+			+ timeout->tv_nsec / 1000LL;
+	}
+
+	RETURN_AND_SET_ERRNO_TEST_CANCEL(_kern_recvmmsg(socket, messages, count,
+		flags, timeoutMicros));
+}
+
+
 extern "C" ssize_t
 send(int socket, const void *data, size_t length, int flags)
 {
@@ -310,6 +332,14 @@ sendmsg(int socket, const struct msghdr *message, int flags)
 }
 
 
+extern "C" int
+sendmmsg(int socket, struct mmsghdr *messages, unsigned int count, int flags)
+{
+	RETURN_AND_SET_ERRNO_TEST_CANCEL(_kern_sendmmsg(socket, messages, count,
+		flags));
+}
+
+
 extern "C" int
 getsockopt(int socket, int level, int option, void *value, socklen_t *_length)
 {
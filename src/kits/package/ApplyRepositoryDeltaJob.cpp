@@ -0,0 +1,122 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+#include <package/ApplyRepositoryDeltaJob.h>
+
+#include <Node.h>
+
+#include <package/ChecksumAccessors.h>
+#include <package/Context.h>
+#include <package/FetchFileJob.h>
+#include <package/PackageRoster.h>
+#include <package/RepositoryCache.h>
+#include <package/RepositoryDelta.h>
+
+
+namespace BPackageKit {
+
+namespace BPrivate {
+
+
+ApplyRepositoryDeltaJob::ApplyRepositoryDeltaJob(const BContext& context,
+	const BString& title, const BString& repositoryName,
+	const BString& baseURL, const BEntry& fetchedChecksumFile,
+	const BEntry& targetEntry)
+	:
+	inherited(context, title),
+	fRepositoryName(repositoryName),
+	fBaseURL(baseURL),
+	fFetchedChecksumFile(fetchedChecksumFile),
+	fTargetEntry(targetEntry),
+	fDeltaApplied(false)
+{
+}
+
+
+ApplyRepositoryDeltaJob::~ApplyRepositoryDeltaJob()
+{
+}
+
+
+bool
+ApplyRepositoryDeltaJob::DeltaApplied() const
+{
+	return fDeltaApplied;
+}
+
+
+const BEntry&
+ApplyRepositoryDeltaJob::TargetEntry() const
+{
+	return fTargetEntry;
+}
+
+
+status_t
+ApplyRepositoryDeltaJob::Execute()
+{
+	fDeltaApplied = false;
+
+	BString targetChecksum;
+	status_t result = ChecksumFileChecksumAccessor(fFetchedChecksumFile)
+		.GetChecksum(targetChecksum);
+	if (result != B_OK)
+		return result;
+
+	// Anything going wrong from here on only means that the complete
+	// repository has to be fetched.
+
+	BRepositoryCache baseCache;
+	BPackageRoster roster;
+	if (roster.GetRepositoryCache(fRepositoryName, &baseCache) != B_OK)
+		return B_OK;
+
+	BString baseChecksum;
+	if (RepositoryCacheChecksumAccessor(baseCache.Entry())
+			.GetChecksum(baseChecksum) != B_OK
+		|| baseChecksum.IsEmpty()) {
+		return B_OK;
+	}
+
+	// fetch the delta from the local repository's checksum
+	BEntry deltaEntry;
+	if (fContext.GetNewTempfile("repodelta-", &deltaEntry) != B_OK)
+		return B_OK;
+	BString deltaURL = BString(fBaseURL) << "/delta/" << baseChecksum;
+	FetchFileJob fetchDeltaJob(fContext,
+		BString("Fetching repository delta from ") << fBaseURL, deltaURL,
+		deltaEntry);
+	if (fetchDeltaJob.Run() != B_OK)
+		return B_OK;
+
+	RepositoryDelta delta;
+	if (delta.SetTo(deltaEntry) != B_OK
+		|| delta.BaseChecksum().ICompare(baseChecksum) != 0
+		|| delta.TargetChecksum().ICompare(targetChecksum) != 0) {
+		return B_OK;
+	}
+
+	if (delta.Apply(baseCache, fTargetEntry) != B_OK)
+		return B_OK;
+
+	// The result isn't identical to the remote repository file, so record
+	// the checksum of the latter.
+	BNode node(&fTargetEntry);
+	if (node.InitCheck() != B_OK
+		|| node.WriteAttrString(
+			RepositoryCacheChecksumAccessor::kChecksumAttribute,
+			&targetChecksum) != B_OK) {
+		return B_OK;
+	}
+
+	fDeltaApplied = true;
+	return B_OK;
+}
+
+
+}	// namespace BPrivate
+
+}	// namespace BPackageKit
@@ -9,6 +9,7 @@
 
 
 #include <File.h>
+#include <Node.h>
 
 #include <AutoDeleter.h>
 #include <SHA256.h>
@@ -137,6 +138,43 @@ GeneralFileChecksumAccessor::GetChecksum(BString& checksum) const
 }
 
 
+// #pragma mark - RepositoryCacheChecksumAccessor
+
+
+/*static*/ const char* const
+	RepositoryCacheChecksumAccessor::kChecksumAttribute
+		= "PKG:repository checksum";
+
+
+RepositoryCacheChecksumAccessor::RepositoryCacheChecksumAccessor(
+	const BEntry& cacheEntry)
+	:
+	fCacheEntry(cacheEntry)
+{
+}
+
+
+/*!	Yields the checksum of the remote repository file a repository cache
+	corresponds to. A cache that has been created by applying a delta carries
+	that checksum in an attribute, since it is not identical to the remote
+	file. Otherwise the checksum of the cache file itself is computed. A
+	missing cache results in an empty checksum.
+*/
+status_t
+RepositoryCacheChecksumAccessor::GetChecksum(BString& checksum) const
+{
+	BNode node(&fCacheEntry);
+	if (node.InitCheck() == B_OK
+		&& node.ReadAttrString(kChecksumAttribute, &checksum) == B_OK
+		&& !checksum.IsEmpty()) {
+		return B_OK;
+	}
+
+	return GeneralFileChecksumAccessor(fCacheEntry, true).GetChecksum(
+		checksum);
+}
+
+
 // #pragma mark - StringChecksumAccessor
 
 
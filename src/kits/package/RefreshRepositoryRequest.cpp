@@ -13,6 +13,7 @@
 #include <Path.h>
 
 #include <package/ActivateRepositoryCacheJob.h>
+#include <package/ApplyRepositoryDeltaJob.h>
 #include <package/ChecksumAccessors.h>
 #include <package/ValidateChecksumJob.h>
 #include <package/FetchFileJob.h>
@@ -32,7 +33,8 @@ BRefreshRepositoryRequest::BRefreshRepositoryRequest(const BContext& context,
 	const BRepositoryConfig& repoConfig)
 	:
 	inherited(context),
-	fRepoConfig(repoConfig)
+	fRepoConfig(repoConfig),
+	fValidateChecksumJob(NULL)
 {
 }
 
@@ -79,8 +81,8 @@ BRefreshRepositoryRequest::CreateInitialJobs()
 			BString("Validating checksum for ") << fRepoConfig.Name(),
 			new (std::nothrow) ChecksumFileChecksumAccessor(
 				fFetchedChecksumFile),
-			new (std::nothrow) GeneralFileChecksumAccessor(repoCache.Entry(),
-				true),
+			new (std::nothrow) RepositoryCacheChecksumAccessor(
+				repoCache.Entry()),
 			false);
 	if (validateChecksumJob == NULL)
 		return B_NO_MEMORY;
@@ -100,11 +102,49 @@ BRefreshRepositoryRequest::JobSucceeded(BJob* job)
 {
 	if (job == fValidateChecksumJob
 		&& !fValidateChecksumJob->ChecksumsMatch()) {
-		// the remote repo cache has a different checksum, we fetch it
+		// the remote repo cache has a different checksum, try to update
+		// ours via a delta first
 		fValidateChecksumJob = NULL;
 			// don't re-trigger fetching if anything goes wrong, fail instead
-		_FetchRepositoryCache();
+		if (_ApplyRepositoryDelta() != B_OK)
+			_FetchRepositoryCache();
+		return;
 	}
+
+	// the delta job is the only one of its kind, it is recognized by its type
+	// so that the class layout doesn't change
+	ApplyRepositoryDeltaJob* applyDeltaJob
+		= dynamic_cast<ApplyRepositoryDeltaJob*>(job);
+	if (applyDeltaJob != NULL) {
+		if (applyDeltaJob->DeltaApplied())
+			_ActivateRepositoryCache(applyDeltaJob->TargetEntry(), NULL);
+		else
+			_FetchRepositoryCache();
+	}
+}
+
+
+status_t
+BRefreshRepositoryRequest::_ApplyRepositoryDelta()
+{
+	BEntry deltaRepoCache;
+	status_t result = fContext.GetNewTempfile("repocache-", &deltaRepoCache);
+	if (result != B_OK)
+		return result;
+
+	ApplyRepositoryDeltaJob* applyDeltaJob
+		= new (std::nothrow) ApplyRepositoryDeltaJob(fContext,
+			BString("Applying repository delta for ") << fRepoConfig.Name(),
+			fRepoConfig.Name(), fRepoConfig.BaseURL(), fFetchedChecksumFile,
+			deltaRepoCache);
+	if (applyDeltaJob == NULL)
+		return B_NO_MEMORY;
+	if ((result = QueueJob(applyDeltaJob)) != B_OK) {
+		delete applyDeltaJob;
+		return result;
+	}
+
+	return B_OK;
 }
 
 
@@ -145,10 +185,18 @@ BRefreshRepositoryRequest::_FetchRepositoryCache()
 		return result;
 	}
 
+	return _ActivateRepositoryCache(tempRepoCache, validateChecksumJob);
+}
+
+
+status_t
+BRefreshRepositoryRequest::_ActivateRepositoryCache(const BEntry& repoCache,
+	BJob* dependency)
+{
 	// job activating the cache
 	BPath targetRepoCachePath;
 	BPackageRoster roster;
-	result = fRepoConfig.IsUserSpecific()
+	status_t result = fRepoConfig.IsUserSpecific()
 		? roster.GetUserRepositoryCachePath(&targetRepoCachePath, true)
 		: roster.GetCommonRepositoryCachePath(&targetRepoCachePath, true);
 	if (result != B_OK)
@@ -157,10 +205,11 @@ BRefreshRepositoryRequest::_FetchRepositoryCache()
 	ActivateRepositoryCacheJob* activateJob
 		= new (std::nothrow) ActivateRepositoryCacheJob(fContext,
 			BString("Activating repository cache for ") << fRepoConfig.Name(),
-			tempRepoCache, fRepoConfig.Name(), targetDirectory);
+			repoCache, fRepoConfig.Name(), targetDirectory);
 	if (activateJob == NULL)
 		return B_NO_MEMORY;
-	activateJob->AddDependency(validateChecksumJob);
+	if (dependency != NULL)
+		activateJob->AddDependency(dependency);
 	if ((result = QueueJob(activateJob)) != B_OK) {
 		delete activateJob;
 		return result;
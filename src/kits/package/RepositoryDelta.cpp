@@ -0,0 +1,322 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+#include <package/RepositoryDelta.h>
+
+#include <map>
+#include <new>
+#include <set>
+
+#include <File.h>
+#include <Message.h>
+#include <Path.h>
+
+#include <package/hpkg/RepositoryWriter.h>
+#include <package/RepositoryCache.h>
+
+
+namespace BPackageKit {
+
+namespace BPrivate {
+
+
+using BHPKG::BRepositoryWriter;
+using BHPKG::BRepositoryWriterListener;
+
+
+static const uint32 kDeltaMessageWhat = 'rpdl';
+
+static const char* const kBaseChecksumField = "base checksum";
+static const char* const kTargetChecksumField = "target checksum";
+static const char* const kRepositoryInfoField = "repository info";
+static const char* const kRemovedField = "removed";
+static const char* const kAddedField = "added";
+
+
+namespace {
+
+
+class SilentRepositoryWriterListener : public BRepositoryWriterListener {
+public:
+	virtual void PrintErrorVarArgs(const char* format, va_list args)
+	{
+	}
+
+	virtual void OnPackageAdded(const BPackageInfo& packageInfo)
+	{
+	}
+
+	virtual void OnRepositoryInfoSectionDone(uint32 uncompressedSize)
+	{
+	}
+
+	virtual void OnPackageAttributesSectionDone(uint32 stringCount,
+		uint32 uncompressedSize)
+	{
+	}
+
+	virtual void OnRepositoryDone(uint32 headerSize, uint32 repositoryInfoSize,
+		uint32 licenseCount, uint32 packageCount, uint32 packageAttributesSize,
+		uint64 totalSize)
+	{
+	}
+};
+
+
+}	// anonymous namespace
+
+
+RepositoryDelta::RepositoryDelta()
+	:
+	fBaseChecksum(),
+	fTargetChecksum(),
+	fRepositoryInfo(),
+	fRemovedPackages(),
+	fAddedPackages(20, true)
+{
+}
+
+
+RepositoryDelta::~RepositoryDelta()
+{
+}
+
+
+status_t
+RepositoryDelta::SetTo(const BEntry& entry)
+{
+	_Unset();
+
+	BFile file(&entry, B_READ_ONLY);
+	status_t result = file.InitCheck();
+	if (result != B_OK)
+		return result;
+
+	BMessage message;
+	result = message.Unflatten(&file);
+	if (result != B_OK)
+		return result;
+	if (message.what != kDeltaMessageWhat)
+		return B_BAD_DATA;
+
+	BMessage repositoryInfoArchive;
+	if ((result = message.FindString(kBaseChecksumField, &fBaseChecksum))
+			!= B_OK
+		|| (result = message.FindString(kTargetChecksumField,
+			&fTargetChecksum)) != B_OK
+		|| (result = message.FindMessage(kRepositoryInfoField,
+			&repositoryInfoArchive)) != B_OK
+		|| (result = fRepositoryInfo.SetTo(&repositoryInfoArchive)) != B_OK) {
+		_Unset();
+		return result == B_NAME_NOT_FOUND ? B_BAD_DATA : result;
+	}
+
+	// the lists may be empty
+	message.FindStrings(kRemovedField, &fRemovedPackages);
+
+	BMessage packageInfoArchive;
+	for (int32 i = 0; message.FindMessage(kAddedField, i, &packageInfoArchive)
+			== B_OK; i++) {
+		BPackageInfo* packageInfo
+			= new(std::nothrow) BPackageInfo(&packageInfoArchive, &result);
+		if (packageInfo == NULL || result != B_OK
+			|| !fAddedPackages.AddItem(packageInfo)) {
+			delete packageInfo;
+			_Unset();
+			return packageInfo == NULL || result == B_OK ? B_NO_MEMORY : result;
+		}
+	}
+
+	return B_OK;
+}
+
+
+status_t
+RepositoryDelta::SetTo(const BRepositoryCache& baseCache,
+	const BString& baseChecksum, const BRepositoryCache& targetCache,
+	const BString& targetChecksum)
+{
+	_Unset();
+
+	if (baseChecksum.IsEmpty() || targetChecksum.IsEmpty())
+		return B_BAD_VALUE;
+
+	typedef std::map<BString, const BPackageInfo*> PackageInfoMap;
+
+	// index the base packages by their canonical file names
+	PackageInfoMap basePackages;
+	try {
+		for (BRepositoryCache::Iterator it = baseCache.GetIterator();
+				it.HasNext();) {
+			const BPackageInfo* packageInfo = it.Next();
+			basePackages[packageInfo->CanonicalFileName()] = packageInfo;
+		}
+	} catch (std::bad_alloc&) {
+		return B_NO_MEMORY;
+	}
+
+	// Every target package that isn't in the base repository with the same
+	// checksum is added. The base packages that remain are removed, which
+	// includes the old version of any package that changed.
+	for (BRepositoryCache::Iterator it = targetCache.GetIterator();
+			it.HasNext();) {
+		const BPackageInfo* packageInfo = it.Next();
+		PackageInfoMap::iterator found
+			= basePackages.find(packageInfo->CanonicalFileName());
+		if (found != basePackages.end()
+			&& !packageInfo->Checksum().IsEmpty()
+			&& found->second->Checksum() == packageInfo->Checksum()) {
+			basePackages.erase(found);
+			continue;
+		}
+
+		BPackageInfo* addedInfo = new(std::nothrow) BPackageInfo(*packageInfo);
+		if (addedInfo == NULL || !fAddedPackages.AddItem(addedInfo)) {
+			delete addedInfo;
+			_Unset();
+			return B_NO_MEMORY;
+		}
+	}
+
+	for (PackageInfoMap::iterator it = basePackages.begin();
+			it != basePackages.end(); ++it) {
+		if (!fRemovedPackages.Add(it->first)) {
+			_Unset();
+			return B_NO_MEMORY;
+		}
+	}
+
+	fRepositoryInfo = targetCache.Info();
+	fBaseChecksum = baseChecksum;
+	fTargetChecksum = targetChecksum;
+
+	return B_OK;
+}
+
+
+status_t
+RepositoryDelta::WriteToFile(const BEntry& entry) const
+{
+	if (fBaseChecksum.IsEmpty())
+		return B_NO_INIT;
+
+	BMessage message(kDeltaMessageWhat);
+	BMessage repositoryInfoArchive;
+	status_t result;
+	if ((result = message.AddString(kBaseChecksumField, fBaseChecksum))
+			!= B_OK
+		|| (result = message.AddString(kTargetChecksumField, fTargetChecksum))
+			!= B_OK
+		|| (result = fRepositoryInfo.Archive(&repositoryInfoArchive)) != B_OK
+		|| (result = message.AddMessage(kRepositoryInfoField,
+			&repositoryInfoArchive)) != B_OK) {
+		return result;
+	}
+
+	if (!fRemovedPackages.IsEmpty()) {
+		result = message.AddStrings(kRemovedField, fRemovedPackages);
+		if (result != B_OK)
+			return result;
+	}
+
+	int32 count = fAddedPackages.CountItems();
+	for (int32 i = 0; i < count; i++) {
+		BMessage packageInfoArchive;
+		if ((result = fAddedPackages.ItemAt(i)->Archive(&packageInfoArchive))
+				!= B_OK
+			|| (result = message.AddMessage(kAddedField, &packageInfoArchive))
+				!= B_OK) {
+			return result;
+		}
+	}
+
+	BFile file(&entry, B_WRITE_ONLY | B_CREATE_FILE | B_ERASE_FILE);
+	result = file.InitCheck();
+	if (result != B_OK)
+		return result;
+
+	return message.Flatten(&file);
+}
+
+
+/*!	Writes a repository file to \a targetEntry that contains the packages of
+	\a baseCache with the delta applied.
+	The caller is responsible for checking that \a baseCache is the repository
+	the delta was computed from.
+*/
+status_t
+RepositoryDelta::Apply(const BRepositoryCache& baseCache,
+	const BEntry& targetEntry) const
+{
+	if (fBaseChecksum.IsEmpty())
+		return B_NO_INIT;
+
+	std::set<BString> removedPackages;
+	try {
+		int32 count = fRemovedPackages.CountStrings();
+		for (int32 i = 0; i < count; i++)
+			removedPackages.insert(fRemovedPackages.StringAt(i));
+	} catch (std::bad_alloc&) {
+		return B_NO_MEMORY;
+	}
+
+	BPath targetPath;
+	status_t result = targetEntry.GetPath(&targetPath);
+	if (result != B_OK)
+		return result;
+
+	// the writer doesn't modify the repository info
+	SilentRepositoryWriterListener listener;
+	BRepositoryWriter writer(&listener,
+		const_cast<BRepositoryInfo*>(&fRepositoryInfo));
+	result = writer.Init(targetPath.Path());
+	if (result != B_OK)
+		return result;
+
+	uint32 removedCount = 0;
+	for (BRepositoryCache::Iterator it = baseCache.GetIterator();
+			it.HasNext();) {
+		const BPackageInfo* packageInfo = it.Next();
+		if (removedPackages.find(packageInfo->CanonicalFileName())
+				!= removedPackages.end()) {
+			removedCount++;
+			continue;
+		}
+
+		result = writer.AddPackageInfo(*packageInfo);
+		if (result != B_OK)
+			return result;
+	}
+
+	// all removed packages must have been there
+	if (removedCount != removedPackages.size())
+		return B_BAD_DATA;
+
+	int32 count = fAddedPackages.CountItems();
+	for (int32 i = 0; i < count; i++) {
+		result = writer.AddPackageInfo(*fAddedPackages.ItemAt(i));
+		if (result != B_OK)
+			return result;
+	}
+
+	return writer.Finish();
+}
+
+
+void
+RepositoryDelta::_Unset()
+{
+	fBaseChecksum.Truncate(0);
+	fTargetChecksum.Truncate(0);
+	fRepositoryInfo = BRepositoryInfo();
+	fRemovedPackages.MakeEmpty();
+	fAddedPackages.MakeEmpty();
+}
+
+
+}	// namespace BPrivate
+
+}	// namespace BPackageKit
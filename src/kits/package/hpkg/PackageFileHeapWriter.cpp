@@ -6,6 +6,8 @@
 
 #include <package/hpkg/PackageFileHeapWriter.h>
 
+#include <pthread.h>
+
 #include <algorithm>
 #include <new>
 
@@ -24,6 +26,12 @@
 // minimum length of data we require before trying to compress them
 static const size_t kCompressionSizeThreshold = 64;
 
+// upper bound for the number of compression threads
+static const int32 kMaxCompressionThreads = 64;
+
+// number of chunks that can be queued per compression thread
+static const int32 kCompressionJobsPerThread = 2;
+
 
 namespace BPackageKit {
 
@@ -194,6 +202,163 @@ private:
 };
 
 
+/*!	A chunk handed to the compression threads. The job owns both of its
+	buffers; the uncompressed one is swapped with the pending data buffer
+	when the job is queued.
+*/
+struct PackageFileHeapWriter::CompressionJob {
+	void*		data;
+	void*		compressedData;
+	size_t		size;
+	size_t		compressedSize;
+	status_t	error;
+	bool		compressed;
+	bool		done;
+};
+
+
+/*!	Compresses the chunks of the heap on a pool of threads. Jobs are kept in
+	a ring buffer in heap order: the threads pick up queued jobs in any order,
+	while the writing thread retires them from the head of the ring, so that
+	the chunks end up in the file in the order they were added.
+	The ring size bounds the memory used for data in flight.
+*/
+struct PackageFileHeapWriter::CompressionPipeline {
+	CompressionPipeline(CompressionAlgorithmOwner* algorithm)
+		:
+		algorithm(algorithm),
+		threads(NULL),
+		threadCount(0),
+		jobs(NULL),
+		jobCount(0),
+		head(0),
+		queued(0),
+		claimed(0),
+		quit(false)
+	{
+		pthread_mutex_init(&lock, NULL);
+		pthread_cond_init(&jobQueued, NULL);
+		pthread_cond_init(&jobDone, NULL);
+	}
+
+	~CompressionPipeline()
+	{
+		if (jobs != NULL) {
+			for (int32 i = 0; i < jobCount; i++) {
+				free(jobs[i].data);
+				free(jobs[i].compressedData);
+			}
+		}
+		delete[] jobs;
+		delete[] threads;
+
+		pthread_cond_destroy(&jobDone);
+		pthread_cond_destroy(&jobQueued);
+		pthread_mutex_destroy(&lock);
+	}
+
+	bool Init(int32 count)
+	{
+		threads = new(std::nothrow) pthread_t[count];
+		jobCount = count * kCompressionJobsPerThread;
+		jobs = new(std::nothrow) CompressionJob[jobCount];
+		if (threads == NULL || jobs == NULL)
+			return false;
+
+		memset(jobs, 0, sizeof(CompressionJob) * jobCount);
+		for (int32 i = 0; i < jobCount; i++) {
+			jobs[i].data = malloc(kChunkSize);
+			jobs[i].compressedData = malloc(kChunkSize);
+			if (jobs[i].data == NULL || jobs[i].compressedData == NULL)
+				return false;
+		}
+
+		for (; threadCount < count; threadCount++) {
+			if (pthread_create(&threads[threadCount], NULL, &_Worker, this)
+					!= 0) {
+				break;
+			}
+		}
+
+		return threadCount > 0;
+	}
+
+	void Stop()
+	{
+		pthread_mutex_lock(&lock);
+		quit = true;
+		pthread_cond_broadcast(&jobQueued);
+		pthread_mutex_unlock(&lock);
+
+		for (int32 i = 0; i < threadCount; i++)
+			pthread_join(threads[i], NULL);
+		threadCount = 0;
+	}
+
+	CompressionJob& JobAt(int32 index)
+	{
+		return jobs[(head + index) % jobCount];
+	}
+
+private:
+	static void* _Worker(void* _self)
+	{
+		CompressionPipeline* self = (CompressionPipeline*)_self;
+
+		pthread_mutex_lock(&self->lock);
+		while (true) {
+			while (!self->quit && self->claimed == self->queued)
+				pthread_cond_wait(&self->jobQueued, &self->lock);
+			if (self->quit)
+				break;
+
+			CompressionJob& job = self->JobAt(self->claimed++);
+			pthread_mutex_unlock(&self->lock);
+
+			self->_Compress(job);
+
+			pthread_mutex_lock(&self->lock);
+			job.done = true;
+			pthread_cond_broadcast(&self->jobDone);
+		}
+		pthread_mutex_unlock(&self->lock);
+
+		return NULL;
+	}
+
+	void _Compress(CompressionJob& job)
+	{
+		job.error = B_OK;
+		job.compressed = false;
+		if (job.size < kCompressionSizeThreshold)
+			return;
+
+		status_t error = algorithm->algorithm->CompressBuffer(job.data,
+			job.size, job.compressedData, job.size, job.compressedSize,
+			algorithm->parameters);
+		if (error == B_OK) {
+			// only use compressed data when we've actually saved space
+			job.compressed = job.compressedSize < job.size;
+		} else if (error != B_BUFFER_OVERFLOW)
+			job.error = error;
+	}
+
+public:
+	CompressionAlgorithmOwner* algorithm;
+	pthread_mutex_t		lock;
+	pthread_cond_t		jobQueued;
+	pthread_cond_t		jobDone;
+	pthread_t*			threads;
+	int32				threadCount;
+	CompressionJob*		jobs;
+	int32				jobCount;
+	int32				head;
+	int32				queued;
+	int32				claimed;
+	bool				quit;
+};
+
+
 PackageFileHeapWriter::PackageFileHeapWriter(BErrorOutput* errorOutput,
 	BPositionIO* file, off_t heapOffset,
 	CompressionAlgorithmOwner* compressionAlgorithm,
@@ -205,7 +370,9 @@ PackageFileHeapWriter::PackageFileHeapWriter(BErrorOutput* errorOutput,
 	fCompressedDataBuffer(NULL),
 	fPendingDataSize(0),
 	fOffsets(),
-	fCompressionAlgorithm(compressionAlgorithm)
+	fCompressionAlgorithm(compressionAlgorithm),
+	fCompressionPipeline(NULL),
+	fCompressionSuspended(false)
 {
 	if (fCompressionAlgorithm != NULL)
 		fCompressionAlgorithm->AcquireReference();
@@ -222,13 +389,17 @@ PackageFileHeapWriter::~PackageFileHeapWriter()
 
 
 void
-PackageFileHeapWriter::Init()
+PackageFileHeapWriter::Init(int32 compressionThreads)
 {
 	// allocate data buffers
 	fPendingDataBuffer = malloc(kChunkSize);
 	fCompressedDataBuffer = malloc(kChunkSize);
 	if (fPendingDataBuffer == NULL || fCompressedDataBuffer == NULL)
 		throw std::bad_alloc();
+
+	// With more than one thread, chunks are compressed in the background.
+	if (fCompressionAlgorithm != NULL && compressionThreads > 1)
+		_StartCompressionThreads(compressionThreads);
 }
 
 
@@ -319,6 +490,14 @@ PackageFileHeapWriter::RemoveDataRanges(
 	// handling and also can use the pending data buffer.
 	_FlushPendingData();
 
+	// The algorithm below relies on the compressed heap size to know which
+	// chunks have been overwritten already, so we have to write all queued
+	// chunks and compress synchronously from here on.
+	status_t error = _WriteCompressionJobs(true, true);
+	if (error != B_OK)
+		throw error;
+	fCompressionSuspended = true;
+
 	// We potentially have to recompress all data from the first affected chunk
 	// to the end (minus the removed ranges, of course). As a basic algorithm we
 	// can use our usual data writing strategy, i.e. read a chunk, decompress it
@@ -430,14 +609,18 @@ PackageFileHeapWriter::RemoveDataRanges(
 	// buffer.
 	if (chunkBuffer.IsEmpty())
 		_UnwriteLastPartialChunk();
+
+	fCompressionSuspended = false;
 }
 
 
 status_t
 PackageFileHeapWriter::Finish()
 {
-	// flush pending data, if any
+	// flush pending data, if any, and wait for all chunks to be written
 	status_t error = _FlushPendingData();
+	if (error == B_OK)
+		error = _WriteCompressionJobs(true, true);
 	if (error != B_OK)
 		return error;
 
@@ -479,6 +662,14 @@ status_t
 PackageFileHeapWriter::ReadAndDecompressChunk(size_t chunkIndex,
 	void* compressedDataBuffer, void* uncompressedDataBuffer)
 {
+	// If the chunk is still being compressed, wait until it has been written.
+	if (chunkIndex >= (size_t)fOffsets.Count()
+		&& fCompressionPipeline != NULL) {
+		status_t error = _WriteCompressionJobs(true, true);
+		if (error != B_OK)
+			return error;
+	}
+
 	if (uint64(chunkIndex + 1) * kChunkSize > fUncompressedHeapSize) {
 		// The chunk has not been written to disk yet. Its data are still in the
 		// pending data buffer.
@@ -501,6 +692,8 @@ PackageFileHeapWriter::ReadAndDecompressChunk(size_t chunkIndex,
 void
 PackageFileHeapWriter::_Uninit()
 {
+	_StopCompressionThreads();
+
 	free(fPendingDataBuffer);
 	free(fCompressedDataBuffer);
 	fPendingDataBuffer = NULL;
@@ -514,6 +707,9 @@ PackageFileHeapWriter::_FlushPendingData()
 	if (fPendingDataSize == 0)
 		return B_OK;
 
+	if (fCompressionPipeline != NULL && !fCompressionSuspended)
+		return _QueueCompressionJob();
+
 	status_t error = _WriteChunk(fPendingDataBuffer, fPendingDataSize, true);
 	if (error == B_OK)
 		fPendingDataSize = 0;
@@ -596,6 +792,134 @@ PackageFileHeapWriter::_WriteDataUncompressed(const void* data, size_t size)
 }
 
 
+void
+PackageFileHeapWriter::_StartCompressionThreads(int32 count)
+{
+	count = std::min(count, kMaxCompressionThreads);
+
+	fCompressionPipeline = new(std::nothrow) CompressionPipeline(
+		fCompressionAlgorithm);
+	if (fCompressionPipeline == NULL)
+		throw std::bad_alloc();
+
+	if (!fCompressionPipeline->Init(count)) {
+		// not fatal -- we just compress synchronously
+		fErrorOutput->PrintError("Warning: Failed to start compression "
+			"threads, compressing on a single thread\n");
+		_StopCompressionThreads();
+	}
+}
+
+
+void
+PackageFileHeapWriter::_StopCompressionThreads()
+{
+	if (fCompressionPipeline == NULL)
+		return;
+
+	fCompressionPipeline->Stop();
+	delete fCompressionPipeline;
+	fCompressionPipeline = NULL;
+}
+
+
+/*!	Hands the pending data over to the compression threads. If all jobs are
+	in use, waits for the oldest one to finish and writes it first.
+*/
+status_t
+PackageFileHeapWriter::_QueueCompressionJob()
+{
+	CompressionPipeline* pipeline = fCompressionPipeline;
+
+	pthread_mutex_lock(&pipeline->lock);
+	bool full = pipeline->queued == pipeline->jobCount;
+	pthread_mutex_unlock(&pipeline->lock);
+
+	if (full) {
+		status_t error = _WriteCompressionJobs(true, false);
+		if (error != B_OK)
+			return error;
+	}
+
+	pthread_mutex_lock(&pipeline->lock);
+	CompressionJob& job = pipeline->JobAt(pipeline->queued);
+	std::swap(job.data, fPendingDataBuffer);
+	job.size = fPendingDataSize;
+	job.done = false;
+	pipeline->queued++;
+	pthread_cond_signal(&pipeline->jobQueued);
+	pthread_mutex_unlock(&pipeline->lock);
+
+	fPendingDataSize = 0;
+
+	// write whatever is done already
+	return _WriteCompressionJobs(false, false);
+}
+
+
+/*!	Writes finished jobs from the head of the queue. If \a wait is \c true,
+	waits for at least one job, or all of them, if \a all is \c true, too.
+*/
+status_t
+PackageFileHeapWriter::_WriteCompressionJobs(bool wait, bool all)
+{
+	CompressionPipeline* pipeline = fCompressionPipeline;
+	if (pipeline == NULL)
+		return B_OK;
+
+	bool waitForNext = wait;
+
+	pthread_mutex_lock(&pipeline->lock);
+	while (pipeline->queued > 0) {
+		CompressionJob& job = pipeline->JobAt(0);
+		if (!job.done) {
+			if (!waitForNext)
+				break;
+			pthread_cond_wait(&pipeline->jobDone, &pipeline->lock);
+			continue;
+		}
+
+		// The job is ours now, we can write it without holding the lock.
+		pthread_mutex_unlock(&pipeline->lock);
+		status_t error = _WriteCompressionJob(job);
+		pthread_mutex_lock(&pipeline->lock);
+
+		if (error != B_OK) {
+			pthread_mutex_unlock(&pipeline->lock);
+			return error;
+		}
+
+		pipeline->head = (pipeline->head + 1) % pipeline->jobCount;
+		pipeline->queued--;
+		pipeline->claimed--;
+		waitForNext = all;
+	}
+	pthread_mutex_unlock(&pipeline->lock);
+
+	return B_OK;
+}
+
+
+status_t
+PackageFileHeapWriter::_WriteCompressionJob(CompressionJob& job)
+{
+	if (job.error != B_OK) {
+		fErrorOutput->PrintError("Failed to compress chunk data: %s\n",
+			strerror(job.error));
+		return job.error;
+	}
+
+	if (!fOffsets.Add(fCompressedHeapSize)) {
+		fErrorOutput->PrintError("Out of memory!\n");
+		return B_NO_MEMORY;
+	}
+
+	if (job.compressed)
+		return _WriteDataUncompressed(job.compressedData, job.compressedSize);
+	return _WriteDataUncompressed(job.data, job.size);
+}
+
+
 void
 PackageFileHeapWriter::_PushChunks(ChunkBuffer& chunkBuffer, uint64 startOffset,
 	uint64 endOffset)
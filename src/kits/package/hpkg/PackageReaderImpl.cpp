@@ -216,6 +216,10 @@ struct PackageReaderImpl::EntryAttributeHandler : AttributeHandler {
 			case B_HPKG_ATTRIBUTE_ID_SYMLINK_PATH:
 				fEntry.SetSymlinkPath(value.string);
 				return B_OK;
+
+			case B_HPKG_ATTRIBUTE_ID_DATA_HASH:
+				fEntry.SetDataHash(value.string);
+				return B_OK;
 		}
 
 		return AttributeHandler::HandleAttribute(context, id, value, _handler);
@@ -273,8 +277,8 @@ private:
 	}
 
 private:
-	BPackageEntry	fEntry;
-	bool			fNotified;
+	PackageEntryImpl	fEntry;
+	bool				fNotified;
 };
 
 
@@ -351,7 +355,7 @@ PackageReaderImpl::Init(BPositionIO* file, bool keepFile, uint32 flags,
 {
 	hpkg_header header;
 	status_t error = inherited::Init<hpkg_header, B_HPKG_MAGIC, B_HPKG_VERSION,
-		B_HPKG_MINOR_VERSION>(file, keepFile, header, flags);
+		B_HPKG_DATA_HASH_MINOR_VERSION>(file, keepFile, header, flags);
 	if (error != B_OK)
 		return error;
 	fHeapSize = UncompressedHeapSize();
@@ -389,7 +393,7 @@ PackageReaderImpl::ParseContent(BPackageContentHandler* contentHandler)
 
 	AttributeHandlerContext context(ErrorOutput(), contentHandler,
 		B_HPKG_SECTION_PACKAGE_ATTRIBUTES,
-		MinorFormatVersion() > B_HPKG_MINOR_VERSION);
+		MinorFormatVersion() > B_HPKG_DATA_HASH_MINOR_VERSION);
 	RootAttributeHandler rootAttributeHandler;
 
 	error = ParsePackageAttributesSection(&context, &rootAttributeHandler);
@@ -412,7 +416,7 @@ PackageReaderImpl::ParseContent(BLowLevelPackageContentHandler* contentHandler)
 
 	AttributeHandlerContext context(ErrorOutput(), contentHandler,
 		B_HPKG_SECTION_PACKAGE_ATTRIBUTES,
-		MinorFormatVersion() > B_HPKG_MINOR_VERSION);
+		MinorFormatVersion() > B_HPKG_DATA_HASH_MINOR_VERSION);
 	LowLevelAttributeHandler rootAttributeHandler;
 
 	error = ParsePackageAttributesSection(&context, &rootAttributeHandler);
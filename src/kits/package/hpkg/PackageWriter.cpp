@@ -6,6 +6,7 @@
 
 #include <package/hpkg/PackageWriter.h>
 
+#include <algorithm>
 #include <new>
 
 #include <package/hpkg/PackageWriterImpl.h>
@@ -19,6 +20,12 @@ namespace BHPKG {
 // #pragma mark - BPackageWriterParameters
 
 
+// The number of compression threads minus one is stored in the upper bits
+// of fFlags, so that the class keeps its size.
+static const uint32 kCompressionThreadsShift = 24;
+static const uint32 kCompressionThreadsMask = 0xff000000;
+
+
 BPackageWriterParameters::BPackageWriterParameters()
 	:
 	fFlags(0),
@@ -36,14 +43,15 @@ BPackageWriterParameters::~BPackageWriterParameters()
 uint32
 BPackageWriterParameters::Flags() const
 {
-	return fFlags;
+	return fFlags & ~kCompressionThreadsMask;
 }
 
 
 void
 BPackageWriterParameters::SetFlags(uint32 flags)
 {
-	fFlags = flags;
+	fFlags = (fFlags & kCompressionThreadsMask)
+		| (flags & ~kCompressionThreadsMask);
 }
 
 
@@ -75,6 +83,27 @@ BPackageWriterParameters::SetCompressionLevel(int32 compressionLevel)
 }
 
 
+int32
+BPackageWriterParameters::CompressionThreads() const
+{
+	return ((fFlags & kCompressionThreadsMask) >> kCompressionThreadsShift)
+		+ 1;
+}
+
+
+void
+BPackageWriterParameters::SetCompressionThreads(int32 threads)
+{
+	uint32 maxThreads = (kCompressionThreadsMask >> kCompressionThreadsShift)
+		+ 1;
+	uint32 count = (uint32)std::max(threads, (int32)1);
+	count = std::min(count, maxThreads);
+
+	fFlags = (fFlags & ~kCompressionThreadsMask)
+		| ((count - 1) << kCompressionThreadsShift);
+}
+
+
 // #pragma mark - BPackageWriter
 
 
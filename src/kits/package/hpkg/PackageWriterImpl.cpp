@@ -34,6 +34,7 @@
 
 #include <AutoDeleter.h>
 #include <RangeArray.h>
+#include <SHA256.h>
 
 #include <package/hpkg/HPKGDefsPrivate.h>
 
@@ -49,6 +50,8 @@ using BPrivate::FileDescriptorCloser;
 
 static const char* const kPublicDomainLicenseName = "Public Domain";
 
+static const size_t kDataHashBufferSize = 64 * 1024;
+
 
 #include <typeinfo>
 
@@ -442,6 +445,7 @@ PackageWriterImpl::PackageWriterImpl(BPackageWriterListener* listener)
 	:
 	inherited("package", listener),
 	fListener(listener),
+	fMinorFormatVersion(B_HPKG_MINOR_VERSION),
 	fHeapRangesToRemove(NULL),
 	fRootEntry(NULL),
 	fRootAttribute(NULL),
@@ -669,6 +673,9 @@ PackageWriterImpl::_Init(BPositionIO* file, bool keepFile, const char* fileName,
 
 		fHeapOffset = packageReader.HeapOffset();
 
+		// the attributes are kept, and need the same format version
+		fMinorFormatVersion = B_BENDIAN_TO_HOST_INT16(header.minor_version);
+
 		PackageContentHandler handler(fRootAttribute, fListener, fStringCache);
 
 		result = packageReader.ParseContent(&handler);
@@ -761,7 +768,7 @@ PackageWriterImpl::_Finish()
 	header.header_size = B_HOST_TO_BENDIAN_INT16(fHeaderSize);
 	header.version = B_HOST_TO_BENDIAN_INT16(B_HPKG_VERSION);
 	header.total_size = B_HOST_TO_BENDIAN_INT64(totalSize);
-	header.minor_version = B_HOST_TO_BENDIAN_INT16(B_HPKG_MINOR_VERSION);
+	header.minor_version = B_HOST_TO_BENDIAN_INT16(fMinorFormatVersion);
 
 	// write the header
 	RawWriteBuffer(&header, sizeof(hpkg_header), 0);
@@ -1504,6 +1511,11 @@ PackageWriterImpl::_AddEntry(int dirFD, Entry* entry, const char* fileName,
 			if (st.st_size > 0) {
 				BFDDataReader dataReader(fd);
 				status_t error = _AddData(dataReader, st.st_size);
+				if (error == B_OK
+					&& (Flags() & B_HPKG_WRITER_CONTENT_HASHES) != 0
+					&& st.st_size > B_HPKG_MAX_INLINE_DATA_SIZE) {
+					error = _AddDataHash(dataReader, st.st_size);
+				}
 				if (error != B_OK)
 					throw status_t(error);
 			}
@@ -1671,6 +1683,49 @@ PackageWriterImpl::_AddData(BDataReader& dataReader, off_t size)
 }
 
 
+/*!	Adds the hex SHA-256 hash of the data as a data hash attribute. Readers
+	can use it to share the contents of identical files.
+*/
+status_t
+PackageWriterImpl::_AddDataHash(BDataReader& dataReader, off_t size)
+{
+	uint8* buffer = (uint8*)malloc(kDataHashBufferSize);
+	if (buffer == NULL)
+		throw std::bad_alloc();
+	MemoryDeleter bufferDeleter(buffer);
+
+	SHA256 sha;
+	for (off_t offset = 0; offset < size;) {
+		size_t toRead = (size_t)std::min(size - offset,
+			(off_t)kDataHashBufferSize);
+		status_t error = dataReader.ReadData(offset, buffer, toRead);
+		if (error != B_OK) {
+			fListener->PrintError("Failed to read data: %s\n", strerror(error));
+			return error;
+		}
+
+		sha.Update(buffer, toRead);
+		offset += toRead;
+	}
+
+	static const char* const kHexDigits = "0123456789abcdef";
+	char hash[2 * SHA_DIGEST_LENGTH + 1];
+	const uint8* digest = sha.Digest();
+	for (int i = 0; i < SHA_DIGEST_LENGTH; i++) {
+		hash[2 * i] = kHexDigits[digest[i] >> 4];
+		hash[2 * i + 1] = kHexDigits[digest[i] & 0xf];
+	}
+	hash[2 * SHA_DIGEST_LENGTH] = '\0';
+
+	_AddStringAttribute(B_HPKG_ATTRIBUTE_ID_DATA_HASH, hash);
+
+	// only packages that contain the attribute need the newer format
+	fMinorFormatVersion = std::max(fMinorFormatVersion,
+		(uint16)B_HPKG_DATA_HASH_MINOR_VERSION);
+	return B_OK;
+}
+
+
 }	// namespace BPrivate
 
 }	// namespace BHPKG
@@ -19,6 +19,7 @@
 #include <ByteOrder.h>
 #include <DataIO.h>
 
+#include <Lz4CompressionAlgorithm.h>
 #include <ZlibCompressionAlgorithm.h>
 
 #include <package/hpkg/HPKGDefsPrivate.h>
@@ -824,6 +825,17 @@ ReaderImplBase::InitHeapReader(uint32 compression, uint32 chunkSize,
 				return B_NO_MEMORY;
 			}
 			break;
+		case B_HPKG_COMPRESSION_LZ4:
+			decompressionAlgorithm = DecompressionAlgorithmOwner::Create(
+				new(std::nothrow) BLz4CompressionAlgorithm,
+				new(std::nothrow) BLz4DecompressionParameters);
+			decompressionAlgorithmReference.SetTo(decompressionAlgorithm, true);
+			if (decompressionAlgorithm == NULL
+				|| decompressionAlgorithm->algorithm == NULL
+				|| decompressionAlgorithm->parameters == NULL) {
+				return B_NO_MEMORY;
+			}
+			break;
 		default:
 			fErrorOutput->PrintError("Error: Invalid heap compression\n");
 			return B_BAD_DATA;
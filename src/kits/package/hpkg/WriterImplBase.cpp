@@ -19,6 +19,7 @@
 #include <File.h>
 
 #include <AutoDeleter.h>
+#include <Lz4CompressionAlgorithm.h>
 #include <ZlibCompressionAlgorithm.h>
 
 #include <package/hpkg/DataReader.h>
@@ -317,6 +318,27 @@ WriterImplBase::InitHeapReader(size_t headerSize)
 				new(std::nothrow) BZlibDecompressionParameters);
 			decompressionAlgorithmReference.SetTo(decompressionAlgorithm, true);
 
+			if (compressionAlgorithm == NULL
+				|| compressionAlgorithm->algorithm == NULL
+				|| compressionAlgorithm->parameters == NULL
+				|| decompressionAlgorithm == NULL
+				|| decompressionAlgorithm->algorithm == NULL
+				|| decompressionAlgorithm->parameters == NULL) {
+				throw std::bad_alloc();
+			}
+			break;
+		case B_HPKG_COMPRESSION_LZ4:
+			compressionAlgorithm = CompressionAlgorithmOwner::Create(
+				new(std::nothrow) BLz4CompressionAlgorithm,
+				new(std::nothrow) BLz4CompressionParameters(
+					fParameters.CompressionLevel()));
+			compressionAlgorithmReference.SetTo(compressionAlgorithm, true);
+
+			decompressionAlgorithm = DecompressionAlgorithmOwner::Create(
+				new(std::nothrow) BLz4CompressionAlgorithm,
+				new(std::nothrow) BLz4DecompressionParameters);
+			decompressionAlgorithmReference.SetTo(decompressionAlgorithm, true);
+
 			if (compressionAlgorithm == NULL
 				|| compressionAlgorithm->algorithm == NULL
 				|| compressionAlgorithm->parameters == NULL
@@ -334,7 +356,7 @@ WriterImplBase::InitHeapReader(size_t headerSize)
 	// create heap writer
 	fHeapWriter = new PackageFileHeapWriter(fErrorOutput, fFile, headerSize,
 		compressionAlgorithm, decompressionAlgorithm);
-	fHeapWriter->Init();
+	fHeapWriter->Init(fParameters.CompressionThreads());
 
 	return B_OK;
 }
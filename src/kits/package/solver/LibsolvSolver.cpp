@@ -10,18 +10,26 @@
 #include "LibsolvSolver.h"
 
 #include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <sys/utsname.h>
+#include <unistd.h>
 
 #include <new>
 
+#include <solv/chksum.h>
 #include <solv/policy.h>
 #include <solv/poolarch.h>
 #include <solv/repo.h>
 #include <solv/repo_haiku.h>
+#include <solv/repo_solv.h>
+#include <solv/repo_write.h>
 #include <solv/selection.h>
 #include <solv/solverdebug.h>
 
 #include <package/PackageResolvableExpression.h>
+#include <package/PackageRoster.h>
 #include <package/RepositoryCache.h>
 #include <package/solver/SolverPackage.h>
 #include <package/solver/SolverPackageSpecifier.h>
@@ -32,12 +40,97 @@
 
 #include <AutoDeleter.h>
 #include <ObjectList.h>
+#include <Path.h>
 
 
 // TODO: libsolv doesn't have any helpful out-of-memory handling. It just just
 // abort()s. Obviously that isn't good behavior for a library.
 
 
+// The libsolv data of a remote repository are cached in a "<name>.solv" file
+// next to the repository cache. The file starts with a header identifying the
+// packages it was generated from, followed by the data in libsolv's solv
+// format.
+
+static const uint32 kSolvCacheMagic = 'hsvc';
+static const uint32 kSolvCacheVersion = 1;
+static const size_t kSolvCacheFingerprintSize = 32;
+
+
+struct SolvCacheHeader {
+	uint32	magic;
+	uint32	version;
+	uint32	packageCount;
+	uint8	fingerprint[kSolvCacheFingerprintSize];
+};
+
+
+static void
+add_fingerprint_string(Chksum* checksum, const char* string)
+{
+	// include the terminating null, so that the strings are delimited
+	solv_chksum_add(checksum, string, strlen(string) + 1);
+}
+
+
+/*!	Computes a fingerprint of the packages of a repository. Since the
+	checksum of a package file covers its package info, the names, versions,
+	and checksums of the packages identify the solver data completely.
+	Returns \c false, if the repository cannot be cached, i.e. if it is the
+	installed repository or one of its packages doesn't have a checksum.
+*/
+static bool
+get_repository_fingerprint(BSolverRepository* repository, uint8* fingerprint)
+{
+	if (repository->IsInstalled())
+		return false;
+
+	Chksum* checksum = solv_chksum_create(REPOKEY_TYPE_SHA256);
+	if (checksum == NULL)
+		return false;
+
+	bool cacheable = true;
+	int32 packageCount = repository->CountPackages();
+	for (int32 i = 0; i < packageCount; i++) {
+		const BPackageInfo& info = repository->PackageAt(i)->Info();
+		if (info.Checksum().IsEmpty()) {
+			cacheable = false;
+			break;
+		}
+
+		add_fingerprint_string(checksum, info.Name());
+		add_fingerprint_string(checksum, info.Version().ToString());
+		add_fingerprint_string(checksum, info.Checksum());
+	}
+
+	if (cacheable) {
+		int size;
+		const unsigned char* digest = solv_chksum_get(checksum, &size);
+		if (digest != NULL && size == (int)kSolvCacheFingerprintSize)
+			memcpy(fingerprint, digest, kSolvCacheFingerprintSize);
+		else
+			cacheable = false;
+	}
+
+	solv_chksum_free(checksum, NULL);
+	return cacheable;
+}
+
+
+static status_t
+get_solv_cache_path(BSolverRepository* repository, BPath& _path)
+{
+	BPackageRoster roster;
+	status_t error = roster.GetUserRepositoryCachePath(&_path, true);
+	if (error != B_OK)
+		return error;
+
+	BString fileName(repository->Name());
+	fileName << ".solv";
+	return _path.Append(fileName);
+}
+
+
 BSolver*
 BPackageKit::create_solver()
 {
@@ -726,21 +819,36 @@ LibsolvSolver::_AddRepositories()
 		repo->priority = -1 - repository->Priority();
 		repo->appdata = (void*)repositoryInfo;
 
-		int32 packageCount = repository->CountPackages();
-		for (int32 k = 0; k < packageCount; k++) {
-			BSolverPackage* package = repository->PackageAt(k);
-			Id solvableId = repo_add_haiku_package_info(repo, package->Info(),
-				REPO_REUSE_REPODATA | REPO_NO_INTERNALIZE);
+		// Try the solv cache first. If it is missing or out of date, add the
+		// packages individually and update the cache.
+		uint8 fingerprint[kSolvCacheFingerprintSize];
+		bool cacheable = get_repository_fingerprint(repository, fingerprint);
+		if (cacheable) {
+			error = _LoadSolvCache(repositoryInfo, fingerprint);
+			if (error == B_NO_MEMORY)
+				return error;
+		}
 
-			try {
-				fSolvablePackages[solvableId] = package;
-				fPackageSolvables[package] = solvableId;
-			} catch (std::bad_alloc&) {
-				return B_NO_MEMORY;
+		if (!cacheable || error != B_OK) {
+			int32 packageCount = repository->CountPackages();
+			for (int32 k = 0; k < packageCount; k++) {
+				BSolverPackage* package = repository->PackageAt(k);
+				Id solvableId = repo_add_haiku_package_info(repo,
+					package->Info(), REPO_REUSE_REPODATA | REPO_NO_INTERNALIZE);
+
+				try {
+					fSolvablePackages[solvableId] = package;
+					fPackageSolvables[package] = solvableId;
+				} catch (std::bad_alloc&) {
+					return B_NO_MEMORY;
+				}
 			}
-		}
 
-		repo_internalize(repo);
+			repo_internalize(repo);
+
+			if (cacheable)
+				_StoreSolvCache(repositoryInfo, fingerprint);
+		}
 
 		if (repository->IsInstalled()) {
 			fInstalledRepository = repositoryInfo;
@@ -757,6 +865,125 @@ LibsolvSolver::_AddRepositories()
 }
 
 
+/*!	Loads the repository's packages from its solv cache file, if that was
+	generated from the packages with the given fingerprint.
+	Returns \c B_NO_MEMORY only, if the solvables couldn't be mapped to their
+	packages. In case of any other error the repository has been left empty.
+*/
+status_t
+LibsolvSolver::_LoadSolvCache(RepositoryInfo* repositoryInfo,
+	const uint8* fingerprint)
+{
+	BSolverRepository* repository = repositoryInfo->Repository();
+	Repo* repo = repositoryInfo->SolvRepo();
+
+	BPath path;
+	status_t error = get_solv_cache_path(repository, path);
+	if (error != B_OK)
+		return error;
+
+	FILE* file = fopen(path.Path(), "r");
+	if (file == NULL)
+		return B_ENTRY_NOT_FOUND;
+	CObjectDeleter<FILE, int> fileCloser(file, fclose);
+
+	int32 packageCount = repository->CountPackages();
+	SolvCacheHeader header;
+	if (fread(&header, sizeof(header), 1, file) != 1
+		|| header.magic != kSolvCacheMagic
+		|| header.version != kSolvCacheVersion
+		|| header.packageCount != (uint32)packageCount
+		|| memcmp(header.fingerprint, fingerprint,
+			kSolvCacheFingerprintSize) != 0) {
+		return B_BAD_DATA;
+	}
+
+	if (repo_add_solv(repo, file, 0) != 0) {
+		repo_empty(repo, 1);
+		return B_BAD_DATA;
+	}
+
+	// The solvables have been written in the order of the packages. Verify
+	// that they match before mapping them.
+	if (repo->nsolvables != packageCount) {
+		repo_empty(repo, 1);
+		return B_BAD_DATA;
+	}
+
+	int32 index = 0;
+	Id solvableId;
+	Solvable* solvable;
+	FOR_REPO_SOLVABLES(repo, solvableId, solvable) {
+		const BPackageInfo& info = repository->PackageAt(index++)->Info();
+		if (info.Name() != pool_id2str(fPool, solvable->name)) {
+			repo_empty(repo, 1);
+			return B_BAD_DATA;
+		}
+	}
+
+	index = 0;
+	FOR_REPO_SOLVABLES(repo, solvableId, solvable) {
+		BSolverPackage* package = repository->PackageAt(index++);
+		try {
+			fSolvablePackages[solvableId] = package;
+			fPackageSolvables[package] = solvableId;
+		} catch (std::bad_alloc&) {
+			return B_NO_MEMORY;
+		}
+	}
+
+	return B_OK;
+}
+
+
+/*!	Writes the repository's solv data to its solv cache file. Failing to do
+	so isn't an error, the repository will simply not be cached.
+*/
+void
+LibsolvSolver::_StoreSolvCache(RepositoryInfo* repositoryInfo,
+	const uint8* fingerprint)
+{
+	BSolverRepository* repository = repositoryInfo->Repository();
+
+	BPath path;
+	if (get_solv_cache_path(repository, path) != B_OK)
+		return;
+
+	// write to a temporary file first, so a concurrent reader never sees a
+	// partial file; its name is unique, so that concurrent writers don't
+	// interfere either
+	BString tempPath(path.Path());
+	tempPath << ".XXXXXX";
+
+	int fd = mkstemp(tempPath.LockBuffer(tempPath.Length()));
+	tempPath.UnlockBuffer();
+	if (fd < 0)
+		return;
+
+	FILE* file = fdopen(fd, "w");
+	if (file == NULL) {
+		close(fd);
+		unlink(tempPath.String());
+		return;
+	}
+
+	SolvCacheHeader header;
+	memset(&header, 0, sizeof(header));
+	header.magic = kSolvCacheMagic;
+	header.version = kSolvCacheVersion;
+	header.packageCount = repository->CountPackages();
+	memcpy(header.fingerprint, fingerprint, kSolvCacheFingerprintSize);
+
+	bool success = fwrite(&header, sizeof(header), 1, file) == 1
+		&& repo_write(repositoryInfo->SolvRepo(), file) == 0;
+	if (fclose(file) != 0)
+		success = false;
+
+	if (!success || rename(tempPath.String(), path.Path()) != 0)
+		unlink(tempPath.String());
+}
+
+
 LibsolvSolver::RepositoryInfo*
 LibsolvSolver::_InstalledRepository() const
 {
@@ -93,6 +93,11 @@ private:
 
 			bool				_HaveRepositoriesChanged() const;
 			status_t			_AddRepositories();
+			status_t			_LoadSolvCache(RepositoryInfo* repositoryInfo,
+									const uint8* fingerprint);
+			void				_StoreSolvCache(
+									RepositoryInfo* repositoryInfo,
+									const uint8* fingerprint);
 			RepositoryInfo*		_InstalledRepository() const;
 			RepositoryInfo*		_GetRepositoryInfo(
 									BSolverRepository* repository) const;
@@ -0,0 +1,355 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+#include <Lz4CompressionAlgorithm.h>
+
+#include <string.h>
+
+#include <algorithm>
+
+
+// build compression support only for userland
+#if !defined(_KERNEL_MODE) && !defined(_BOOT_MODE)
+#	define B_LZ4_COMPRESSION_SUPPORT 1
+#endif
+
+
+// The data are stored in the LZ4 block format: a sequence of a token byte
+// (upper nibble literal length, lower nibble match length - 4), literal length
+// extension bytes, the literals, a 16 bit little endian match offset, and
+// match length extension bytes. The final sequence consists of literals only.
+
+static const size_t kMinMatch			= 4;
+static const size_t kLastLiterals		= 5;
+static const size_t kMatchFindLimit		= 12;
+static const size_t kMaxOffset			= 65535;
+static const uint8 kRunMask				= 15;
+
+
+static inline uint32
+read32(const uint8* data)
+{
+	uint32 value;
+	memcpy(&value, data, sizeof(value));
+	return value;
+}
+
+
+#ifdef B_LZ4_COMPRESSION_SUPPORT
+
+
+static const uint32 kHashLog			= 12;
+static const uint32 kSkipTrigger		= 6;
+static const size_t kMaxInputSize		= 0x7e000000;
+
+
+static inline uint32
+hash_sequence(uint32 sequence)
+{
+	return (sequence * 2654435761U) >> (32 - kHashLog);
+}
+
+
+static inline size_t
+length_bytes(size_t length)
+{
+	return length >= kRunMask ? (length - kRunMask) / 255 + 1 : 0;
+}
+
+
+static inline uint8*
+write_length(uint8* output, size_t length)
+{
+	if (length < kRunMask)
+		return output;
+
+	length -= kRunMask;
+	for (; length >= 255; length -= 255)
+		*output++ = 255;
+	*output++ = (uint8)length;
+	return output;
+}
+
+
+#endif	// B_LZ4_COMPRESSION_SUPPORT
+
+
+/*!	Reads the extension bytes of a literal or match length.
+	Returns \c false, if the input ends prematurely.
+*/
+static inline bool
+read_length(const uint8*& input, const uint8* inputEnd, size_t& length)
+{
+	if (length != kRunMask)
+		return true;
+
+	uint8 value;
+	do {
+		if (input == inputEnd)
+			return false;
+		value = *input++;
+		length += value;
+	} while (value == 255);
+
+	return true;
+}
+
+
+// #pragma mark - BLz4CompressionParameters
+
+
+BLz4CompressionParameters::BLz4CompressionParameters(int compressionLevel)
+	:
+	BCompressionParameters(),
+	fCompressionLevel(compressionLevel)
+{
+}
+
+
+BLz4CompressionParameters::~BLz4CompressionParameters()
+{
+}
+
+
+int32
+BLz4CompressionParameters::CompressionLevel() const
+{
+	return fCompressionLevel;
+}
+
+
+void
+BLz4CompressionParameters::SetCompressionLevel(int32 level)
+{
+	fCompressionLevel = level;
+}
+
+
+// #pragma mark - BLz4DecompressionParameters
+
+
+BLz4DecompressionParameters::BLz4DecompressionParameters()
+	:
+	BDecompressionParameters()
+{
+}
+
+
+BLz4DecompressionParameters::~BLz4DecompressionParameters()
+{
+}
+
+
+// #pragma mark - BLz4CompressionAlgorithm
+
+
+BLz4CompressionAlgorithm::BLz4CompressionAlgorithm()
+	:
+	BCompressionAlgorithm()
+{
+}
+
+
+BLz4CompressionAlgorithm::~BLz4CompressionAlgorithm()
+{
+}
+
+
+/*!	Compresses the input with a greedy single probe hash table match finder.
+	Lower compression levels skip ahead faster over incompressible data.
+	Returns \c B_BUFFER_OVERFLOW, if the result does not fit into \a output.
+*/
+status_t
+BLz4CompressionAlgorithm::CompressBuffer(const void* _input,
+	size_t inputSize, void* _output, size_t outputSize,
+	size_t& _compressedSize, const BCompressionParameters* parameters)
+{
+#ifdef B_LZ4_COMPRESSION_SUPPORT
+	if (inputSize > kMaxInputSize)
+		return B_BAD_VALUE;
+
+	const BLz4CompressionParameters* lz4Parameters
+		= dynamic_cast<const BLz4CompressionParameters*>(parameters);
+	int32 compressionLevel = lz4Parameters != NULL
+		? lz4Parameters->CompressionLevel() : B_LZ4_COMPRESSION_DEFAULT;
+	if (compressionLevel < B_LZ4_COMPRESSION_FASTEST)
+		compressionLevel = B_LZ4_COMPRESSION_FASTEST;
+	else if (compressionLevel > B_LZ4_COMPRESSION_BEST)
+		compressionLevel = B_LZ4_COMPRESSION_BEST;
+	uint32 acceleration = B_LZ4_COMPRESSION_BEST - compressionLevel + 1;
+
+	const uint8* input = (const uint8*)_input;
+	uint8* output = (uint8*)_output;
+	uint8* outputEnd = output + outputSize;
+
+	size_t anchor = 0;
+
+	if (inputSize >= kMatchFindLimit + 1) {
+		uint32 hashTable[1 << kHashLog];
+		memset(hashTable, 0, sizeof(hashTable));
+
+		const size_t matchLimit = inputSize - kLastLiterals;
+		const size_t findLimit = inputSize - kMatchFindLimit;
+		size_t position = 1;
+
+		while (position <= findLimit) {
+			// look for the next match
+			uint32 searchCount = acceleration << kSkipTrigger;
+			size_t match = 0;
+			bool found = false;
+			while (position <= findLimit) {
+				uint32 sequence = read32(input + position);
+				uint32 hash = hash_sequence(sequence);
+				match = hashTable[hash];
+				hashTable[hash] = (uint32)position;
+
+				if (position - match <= kMaxOffset
+					&& read32(input + match) == sequence) {
+					found = true;
+					break;
+				}
+
+				position += searchCount++ >> kSkipTrigger;
+			}
+			if (!found)
+				break;
+
+			// extend the match backwards
+			while (position > anchor && match > 0
+				&& input[position - 1] == input[match - 1]) {
+				position--;
+				match--;
+			}
+
+			// extend the match forwards
+			size_t matchLength = kMinMatch;
+			while (position + matchLength < matchLimit
+				&& input[position + matchLength]
+					== input[match + matchLength]) {
+				matchLength++;
+			}
+
+			// write the sequence
+			size_t literalLength = position - anchor;
+			size_t neededSize = 1 + length_bytes(literalLength) + literalLength
+				+ 2 + length_bytes(matchLength - kMinMatch);
+			if ((size_t)(outputEnd - output) < neededSize)
+				return B_BUFFER_OVERFLOW;
+
+			uint8* token = output++;
+			*token = (uint8)(std::min(literalLength, (size_t)kRunMask) << 4);
+			output = write_length(output, literalLength);
+			memcpy(output, input + anchor, literalLength);
+			output += literalLength;
+
+			size_t offset = position - match;
+			*output++ = (uint8)offset;
+			*output++ = (uint8)(offset >> 8);
+
+			*token |= (uint8)std::min(matchLength - kMinMatch,
+				(size_t)kRunMask);
+			output = write_length(output, matchLength - kMinMatch);
+
+			position += matchLength;
+			anchor = position;
+
+			// make the positions we skipped over findable as well
+			if (position <= findLimit) {
+				hashTable[hash_sequence(read32(input + position - 2))]
+					= (uint32)(position - 2);
+			}
+		}
+	}
+
+	// write the trailing literals
+	size_t literalLength = inputSize - anchor;
+	size_t neededSize = 1 + length_bytes(literalLength) + literalLength;
+	if ((size_t)(outputEnd - output) < neededSize)
+		return B_BUFFER_OVERFLOW;
+
+	*output++ = (uint8)(std::min(literalLength, (size_t)kRunMask) << 4);
+	output = write_length(output, literalLength);
+	memcpy(output, input + anchor, literalLength);
+	output += literalLength;
+
+	_compressedSize = output - (uint8*)_output;
+	return B_OK;
+#else
+	return B_NOT_SUPPORTED;
+#endif
+}
+
+
+status_t
+BLz4CompressionAlgorithm::DecompressBuffer(const void* _input,
+	size_t inputSize, void* _output, size_t outputSize,
+	size_t& _uncompressedSize, const BDecompressionParameters* parameters)
+{
+	const uint8* input = (const uint8*)_input;
+	const uint8* inputEnd = input + inputSize;
+	uint8* output = (uint8*)_output;
+	uint8* outputEnd = output + outputSize;
+
+	if (inputSize == 0)
+		return B_BAD_DATA;
+
+	while (true) {
+		if (input == inputEnd)
+			return B_BAD_DATA;
+		uint8 token = *input++;
+
+		// copy the literals
+		size_t literalLength = token >> 4;
+		if (!read_length(input, inputEnd, literalLength))
+			return B_BAD_DATA;
+		if ((size_t)(inputEnd - input) < literalLength)
+			return B_BAD_DATA;
+		if ((size_t)(outputEnd - output) < literalLength)
+			return B_BUFFER_OVERFLOW;
+
+		memcpy(output, input, literalLength);
+		input += literalLength;
+		output += literalLength;
+
+		// the last sequence has no match part
+		if (input == inputEnd)
+			break;
+
+		if (inputEnd - input < 2)
+			return B_BAD_DATA;
+		size_t offset = input[0] | ((size_t)input[1] << 8);
+		input += 2;
+		if (offset == 0 || offset > (size_t)(output - (uint8*)_output))
+			return B_BAD_DATA;
+
+		size_t matchLength = token & kRunMask;
+		if (!read_length(input, inputEnd, matchLength))
+			return B_BAD_DATA;
+		matchLength += kMinMatch;
+		if ((size_t)(outputEnd - output) < matchLength)
+			return B_BUFFER_OVERFLOW;
+
+		// copy the match -- it may overlap the bytes it produces
+		const uint8* match = output - offset;
+		if (offset >= matchLength) {
+			memcpy(output, match, matchLength);
+			output += matchLength;
+		} else if (offset >= 8) {
+			uint8* end = output + matchLength;
+			for (; end - output >= 8; output += 8, match += 8)
+				memcpy(output, match, 8);
+			while (output < end)
+				*output++ = *match++;
+		} else {
+			uint8* end = output + matchLength;
+			while (output < end)
+				*output++ = *match++;
+		}
+	}
+
+	_uncompressedSize = output - (uint8*)_output;
+	return B_OK;
+}
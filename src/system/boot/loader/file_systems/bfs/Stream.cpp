@@ -308,6 +308,30 @@ Stream::ReadAt(off_t pos, uint8* buffer, size_t* _length)
 	if (pos + length > data.Size())
 		length = data.Size() - pos;
 
+	if ((Flags() & INODE_INLINE_DATA) != 0) {
+		// the data is stored in the small_data section of the inode
+		CachedBlock cached(fVolume);
+		const bfs_inode* node = (const bfs_inode*)cached.SetTo(inode_num);
+		if (node == NULL) {
+			*_length = 0;
+			return B_IO_ERROR;
+		}
+
+		const small_data* item = ((bfs_inode*)node)->SmallDataStart();
+		for (; !item->IsLast(node); item = item->Next()) {
+			if (*item->Name() == FILE_DATA_NAME
+				&& item->NameSize() == FILE_DATA_NAME_LENGTH
+				&& item->DataSize() >= pos + length) {
+				memcpy(buffer, item->Data() + pos, length);
+				*_length = length;
+				return B_OK;
+			}
+		}
+
+		*_length = 0;
+		return B_BAD_DATA;
+	}
+
 	block_run run;
 	off_t offset;
 	if (FindBlockRun(pos, run, offset) < B_OK) {
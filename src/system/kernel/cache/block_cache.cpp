@@ -23,8 +23,10 @@
 #include <util/DoublyLinkedList.h>
 #include <util/AutoLock.h>
 #include <util/khash.h>
+#include <vfs.h>
 #include <vm/vm_page.h>
 
+#include "IORequest.h"
 #include "kernel_debug_config.h"
 
 
@@ -250,6 +252,33 @@ private:
 };
 
 
+class BlockPrefetcher : public AsyncIOCallback {
+public:
+								BlockPrefetcher(block_cache* cache,
+									off_t blockNumber, size_t numBlocks);
+								~BlockPrefetcher();
+
+			status_t			Allocate();
+			void				ReadAsync();
+
+			size_t				NumAllocated() const
+									{ return fNumAllocated; }
+
+	virtual	void				IOFinished(status_t status,
+									bool partialTransfer,
+									generic_size_t bytesTransferred);
+
+private:
+			block_cache*		fCache;
+			off_t				fBlockNumber;
+			size_t				fNumRequested;
+			size_t				fNumAllocated;
+			cached_block**		fBlocks;
+			generic_io_vec*		fDestVecs;
+			struct vnode*		fVnode;
+};
+
+
 class TransactionLocking {
 public:
 	inline bool Lock(block_cache* cache)
@@ -1685,23 +1714,23 @@ mark_block_unbusy_reading(block_cache* cache, cached_block* block)
 }
 
 
-/*!	Cache must be locked.
+/*!	Waits until the block is no longer busy reading, or another block has
+	been read in. If the block could not be read, it is removed from the
+	cache, so the caller must not access it anymore, but look it up again.
+	Cache must be locked.
 */
 static void
 wait_for_busy_reading_block(block_cache* cache, cached_block* block)
 {
-	while (block->busy_reading) {
-		// wait for at least the specified block to be read in
-		ConditionVariableEntry entry;
-		cache->busy_reading_condition.Add(&entry);
-		block->busy_reading_waiters = true;
+	ConditionVariableEntry entry;
+	cache->busy_reading_condition.Add(&entry);
+	block->busy_reading_waiters = true;
 
-		mutex_unlock(&cache->lock);
+	mutex_unlock(&cache->lock);
 
-		entry.Wait();
+	entry.Wait();
 
-		mutex_lock(&cache->lock);
-	}
+	mutex_lock(&cache->lock);
 }
 
 
@@ -1892,6 +1921,8 @@ retry:
 
 		mutex_lock(&cache->lock);
 		if (bytesRead < blockSize) {
+			// waiters look the block up again, and won't find it
+			mark_block_unbusy_reading(cache, block);
 			cache->RemoveBlock(block);
 			TB(Error(cache, blockNumber, "read failed", bytesRead));
 
@@ -2710,6 +2741,124 @@ block_cache_used_memory(void)
 }
 
 
+//	#pragma mark - BlockPrefetcher
+
+
+BlockPrefetcher::BlockPrefetcher(block_cache* cache, off_t blockNumber,
+		size_t numBlocks)
+	:
+	fCache(cache),
+	fBlockNumber(blockNumber),
+	fNumRequested(numBlocks),
+	fNumAllocated(0),
+	fBlocks(NULL),
+	fDestVecs(NULL),
+	fVnode(NULL)
+{
+}
+
+
+BlockPrefetcher::~BlockPrefetcher()
+{
+	if (fVnode != NULL)
+		vfs_put_vnode(fVnode);
+
+	delete[] fBlocks;
+	delete[] fDestVecs;
+}
+
+
+/*!	Allocates the blocks to be read in, and inserts them into the cache as
+	busy reading. Allocation stops at the first block that is already in
+	the cache, so that the range can be read with a single request.
+	The cache must be locked.
+*/
+status_t
+BlockPrefetcher::Allocate()
+{
+	ASSERT_LOCKED_MUTEX(&fCache->lock);
+
+	fBlocks = new(std::nothrow) cached_block*[fNumRequested];
+	fDestVecs = new(std::nothrow) generic_io_vec[fNumRequested];
+	if (fBlocks == NULL || fDestVecs == NULL)
+		return B_NO_MEMORY;
+
+	for (size_t i = 0; i < fNumRequested; i++) {
+		off_t blockNumber = fBlockNumber + i;
+		if (hash_lookup(fCache->hash, &blockNumber) != NULL)
+			break;
+
+		cached_block* block = fCache->NewBlock(blockNumber);
+		if (block == NULL)
+			break;
+
+		hash_insert_grow(fCache->hash, block);
+		mark_block_busy_reading(fCache, block);
+
+		fBlocks[i] = block;
+		fDestVecs[i].base = (generic_addr_t)block->current_data;
+		fDestVecs[i].length = fCache->block_size;
+		fNumAllocated++;
+	}
+
+	return fNumAllocated > 0 ? B_OK : B_ENTRY_NOT_FOUND;
+}
+
+
+/*!	Starts reading the allocated blocks. The object will delete itself once
+	the I/O has been finished. The cache must not be locked.
+*/
+void
+BlockPrefetcher::ReadAsync()
+{
+	status_t status = vfs_get_vnode_from_fd(fCache->fd, true, &fVnode);
+	if (status != B_OK) {
+		fVnode = NULL;
+		IOFinished(status, true, 0);
+		return;
+	}
+
+	vfs_asynchronous_read_pages(fVnode, NULL, fBlockNumber * fCache->block_size,
+		fDestVecs, fNumAllocated, fNumAllocated * fCache->block_size, 0, this);
+}
+
+
+void
+BlockPrefetcher::IOFinished(status_t status, bool partialTransfer,
+	generic_size_t bytesTransferred)
+{
+	MutexLocker locker(&fCache->lock);
+
+	size_t blocksTransferred = status == B_OK
+		? bytesTransferred / fCache->block_size : 0;
+
+	for (size_t i = 0; i < fNumAllocated; i++) {
+		cached_block* block = fBlocks[i];
+		mark_block_unbusy_reading(fCache, block);
+
+		if (i >= blocksTransferred) {
+			// This block could not be read. Since we hold the lock, the
+			// waiters we just woke up will only look for it again after it
+			// has been removed, and then read it by themselves.
+			fCache->RemoveBlock(block);
+			continue;
+		}
+
+		TB(Read(fCache, block));
+
+		if (block->ref_count == 0) {
+			// nobody is using the block yet, it's ready for reuse
+			block->unused = true;
+			fCache->unused_blocks.Add(block);
+			fCache->unused_block_count++;
+		}
+	}
+
+	locker.Unlock();
+	delete this;
+}
+
+
 //	#pragma mark - public transaction API
 
 
@@ -3624,3 +3773,49 @@ block_cache_put(void* _cache, off_t blockNumber)
 	put_cached_block(cache, blockNumber);
 }
 
+
+/*!	Starts reading in up to \a _numBlocks blocks beginning with \a blockNumber
+	asynchronously, so that a later block_cache_get() will find them in the
+	cache already. Prefetching stops at the first block that is already in
+	the cache; \a _numBlocks is set to the number of blocks that are actually
+	going to be read.
+*/
+status_t
+block_cache_prefetch(void* _cache, off_t blockNumber, size_t* _numBlocks)
+{
+	block_cache* cache = (block_cache*)_cache;
+	size_t numBlocks = *_numBlocks;
+	*_numBlocks = 0;
+
+	if (blockNumber < 0 || blockNumber >= cache->max_blocks)
+		return B_BAD_VALUE;
+	if (numBlocks > (size_t)(cache->max_blocks - blockNumber))
+		numBlocks = cache->max_blocks - blockNumber;
+	if (numBlocks == 0)
+		return B_OK;
+
+	// Don't make the situation worse if memory is already tight
+	if (low_resource_state(B_KERNEL_RESOURCE_PAGES | B_KERNEL_RESOURCE_MEMORY
+			| B_KERNEL_RESOURCE_ADDRESS_SPACE) != B_NO_LOW_RESOURCE)
+		return B_OK;
+
+	BlockPrefetcher* prefetcher = new(std::nothrow) BlockPrefetcher(cache,
+		blockNumber, numBlocks);
+	if (prefetcher == NULL)
+		return B_NO_MEMORY;
+
+	MutexLocker locker(&cache->lock);
+
+	status_t status = prefetcher->Allocate();
+	if (status != B_OK && prefetcher->NumAllocated() == 0) {
+		delete prefetcher;
+		return status == B_ENTRY_NOT_FOUND ? B_OK : status;
+	}
+
+	*_numBlocks = prefetcher->NumAllocated();
+	locker.Unlock();
+
+	prefetcher->ReadAsync();
+	return B_OK;
+}
+
@@ -10,6 +10,7 @@
 
 #include <errno.h>
 #include <limits.h>
+#include <new>
 
 #include <module.h>
 
@@ -31,6 +32,7 @@
 #define MAX_SOCKET_ADDRESS_LENGTH	(sizeof(sockaddr_storage))
 #define MAX_SOCKET_OPTION_LENGTH	128
 #define MAX_ANCILLARY_DATA_LENGTH	1024
+#define MAX_BATCHED_MESSAGES		32
 
 #define GET_SOCKET_FD_OR_RETURN(fd, kernel, descriptor)	\
 	do {												\
@@ -45,6 +47,25 @@ static vint32 sStackInterfaceInitialized = 0;
 static mutex sLock = MUTEX_INITIALIZER("stack interface");
 
 
+/*!	The userland pointers of a message that has been copied into the kernel,
+	and the kernel buffers that replace them.
+*/
+struct userland_message {
+	iovec*			vecs;
+	void*			address;
+	void*			ancillary;
+	MemoryDeleter	vecs_deleter;
+	MemoryDeleter	ancillary_deleter;
+	char			kernel_address[MAX_SOCKET_ADDRESS_LENGTH];
+};
+
+//!	A part of the messages of recvmmsg() or sendmmsg() in the kernel.
+struct message_batch {
+	mmsghdr				messages[MAX_BATCHED_MESSAGES];
+	userland_message	user[MAX_BATCHED_MESSAGES];
+};
+
+
 struct FDPutter {
 	FDPutter(file_descriptor* descriptor)
 		: descriptor(descriptor)
@@ -198,6 +219,102 @@ prepare_userland_msghdr(const msghdr* userMessage, msghdr& message,
 }
 
 
+//!	Prepares a message from userland for receiving into it.
+static status_t
+prepare_userland_receive(const msghdr* userMessage, msghdr& message,
+	userland_message& user)
+{
+	status_t error = prepare_userland_msghdr(userMessage, message, user.vecs,
+		user.vecs_deleter, user.address, user.kernel_address);
+	if (error != B_OK)
+		return error;
+
+	// prepare a buffer for ancillary data
+	user.ancillary = message.msg_control;
+	if (user.ancillary != NULL) {
+		if (!IS_USER_ADDRESS(user.ancillary))
+			return B_BAD_ADDRESS;
+		if (message.msg_controllen < 0)
+			return B_BAD_VALUE;
+		if (message.msg_controllen > MAX_ANCILLARY_DATA_LENGTH)
+			message.msg_controllen = MAX_ANCILLARY_DATA_LENGTH;
+
+		message.msg_control = malloc(message.msg_controllen);
+		if (message.msg_control == NULL)
+			return B_NO_MEMORY;
+
+		user.ancillary_deleter.SetTo(message.msg_control);
+	}
+
+	return B_OK;
+}
+
+
+/*!	Copies the address, the ancillary data, and the header of a received
+	message back to userland.
+*/
+static status_t
+copy_received_message_to_userland(msghdr* userMessage, msghdr& message,
+	userland_message& user)
+{
+	void* ancillary = message.msg_control;
+
+	message.msg_name = user.address;
+	message.msg_iov = user.vecs;
+	message.msg_control = user.ancillary;
+	if ((user.address != NULL && user_memcpy(user.address,
+				user.kernel_address, message.msg_namelen) != B_OK)
+		|| (user.ancillary != NULL && user_memcpy(user.ancillary, ancillary,
+				message.msg_controllen) != B_OK)
+		|| user_memcpy(userMessage, &message, sizeof(msghdr)) != B_OK) {
+		return B_BAD_ADDRESS;
+	}
+
+	return B_OK;
+}
+
+
+//!	Copies a message to be sent, including its address and ancillary data.
+static status_t
+prepare_userland_send(const msghdr* userMessage, msghdr& message,
+	userland_message& user)
+{
+	status_t error = prepare_userland_msghdr(userMessage, message, user.vecs,
+		user.vecs_deleter, user.address, user.kernel_address);
+	if (error != B_OK)
+		return error;
+
+	// copy the address from userland
+	if (user.address != NULL && user_memcpy(user.kernel_address,
+			user.address, message.msg_namelen) != B_OK) {
+		return B_BAD_ADDRESS;
+	}
+
+	// copy ancillary data from userland
+	user.ancillary = message.msg_control;
+	if (user.ancillary != NULL) {
+		if (!IS_USER_ADDRESS(user.ancillary))
+			return B_BAD_ADDRESS;
+		if (message.msg_controllen < 0
+				|| message.msg_controllen > MAX_ANCILLARY_DATA_LENGTH) {
+			return B_BAD_VALUE;
+		}
+
+		message.msg_control = malloc(message.msg_controllen);
+		if (message.msg_control == NULL)
+			return B_NO_MEMORY;
+		user.ancillary_deleter.SetTo(message.msg_control);
+
+		if (user_memcpy(message.msg_control, user.ancillary,
+				message.msg_controllen) != B_OK) {
+			return B_BAD_ADDRESS;
+		}
+	}
+
+	return B_OK;
+}
+
+
 static status_t
 get_socket_descriptor(int fd, bool kernel, file_descriptor*& descriptor)
 {
@@ -507,6 +624,19 @@ common_recvmsg(int fd, struct msghdr *message, int flags, bool kernel)
 }
 
 
+static ssize_t
+common_recvmmsg(int fd, struct mmsghdr *messages, unsigned int count,
+	int flags, bigtime_t deadline, bool kernel)
+{
+	file_descriptor* descriptor;
+	GET_SOCKET_FD_OR_RETURN(fd, kernel, descriptor);
+	FDPutter _(descriptor);
+
+	return sStackInterface->recvmmsg(descriptor->u.socket, messages, count,
+		flags, deadline);
+}
+
+
 static ssize_t
 common_send(int fd, const void *data, size_t length, int flags, bool kernel)
 {
@@ -542,6 +672,19 @@ common_sendmsg(int fd, const struct msghdr *message, int flags, bool kernel)
 }
 
 
+static ssize_t
+common_sendmmsg(int fd, struct mmsghdr *messages, unsigned int count,
+	int flags, bool kernel)
+{
+	file_descriptor* descriptor;
+	GET_SOCKET_FD_OR_RETURN(fd, kernel, descriptor);
+	FDPutter _(descriptor);
+
+	return sStackInterface->sendmmsg(descriptor->u.socket, messages, count,
+		flags);
+}
+
+
 static status_t
 common_getsockopt(int fd, int level, int option, void *value,
 	socklen_t *_length, bool kernel)
@@ -963,35 +1106,11 @@ _user_recvmsg(int socket, struct msghdr *userMessage, int flags)
 {
 	// copy message from userland
 	msghdr message;
-	iovec* userVecs;
-	MemoryDeleter vecsDeleter;
-	void* userAddress;
-	char address[MAX_SOCKET_ADDRESS_LENGTH];
-
-	status_t error = prepare_userland_msghdr(userMessage, message, userVecs,
-		vecsDeleter, userAddress, address);
+	userland_message user;
+	status_t error = prepare_userland_receive(userMessage, message, user);
 	if (error != B_OK)
 		return error;
 
-	// prepare a buffer for ancillary data
-	MemoryDeleter ancillaryDeleter;
-	void* ancillary = NULL;
-	void* userAncillary = message.msg_control;
-	if (userAncillary != NULL) {
-		if (!IS_USER_ADDRESS(userAncillary))
-			return B_BAD_ADDRESS;
-		if (message.msg_controllen < 0)
-			return B_BAD_VALUE;
-		if (message.msg_controllen > MAX_ANCILLARY_DATA_LENGTH)
-			message.msg_controllen = MAX_ANCILLARY_DATA_LENGTH;
-
-		message.msg_control = ancillary = malloc(message.msg_controllen);
-		if (message.msg_control == NULL)
-			return B_NO_MEMORY;
-
-		ancillaryDeleter.SetTo(ancillary);
-	}
-
 	// recvmsg()
 	SyscallRestartWrapper<ssize_t> result;
 
@@ -999,20 +1118,96 @@ _user_recvmsg(int socket, struct msghdr *userMessage, int flags)
 	if (result < 0)
 		return result;
 
-	// copy the address, the ancillary data, and the message header back to
-	// userland
-	message.msg_name = userAddress;
-	message.msg_iov = userVecs;
-	message.msg_control = userAncillary;
-	if ((userAddress != NULL && user_memcpy(userAddress, address,
-				message.msg_namelen) != B_OK)
-		|| (userAncillary != NULL && user_memcpy(userAncillary, ancillary,
-				message.msg_controllen) != B_OK)
-		|| user_memcpy(userMessage, &message, sizeof(msghdr)) != B_OK) {
+	error = copy_received_message_to_userland(userMessage, message, user);
+	if (error != B_OK)
+		return error;
+
+	return result;
+}
+
+
+ssize_t
+_user_recvmmsg(int socket, struct mmsghdr *userMessages, unsigned int count,
+	int flags, bigtime_t timeout)
+{
+	if (userMessages == NULL || !IS_USER_ADDRESS(userMessages))
 		return B_BAD_ADDRESS;
+	if (timeout < 0)
+		return B_BAD_VALUE;
+
+	bigtime_t deadline = B_INFINITE_TIMEOUT;
+	if (timeout != B_INFINITE_TIMEOUT)
+		deadline = system_time() + timeout;
+
+	SyscallRestartWrapper<ssize_t> result;
+	status_t error = B_OK;
+	unsigned int received = 0;
+
+	// the messages are copied into the kernel a batch at a time
+	while (received < count) {
+		if (received > 0 && deadline != B_INFINITE_TIMEOUT
+			&& system_time() >= deadline)
+			break;
+
+		message_batch* batch = new(std::nothrow) message_batch;
+		if (batch == NULL) {
+			error = B_NO_MEMORY;
+			break;
+		}
+		ObjectDeleter<message_batch> batchDeleter(batch);
+
+		unsigned int batchCount = min_c(count - received,
+			MAX_BATCHED_MESSAGES);
+		for (unsigned int i = 0; i < batchCount; i++) {
+			error = prepare_userland_receive(
+				&userMessages[received + i].msg_hdr,
+				batch->messages[i].msg_hdr, batch->user[i]);
+			if (error != B_OK) {
+				// receive into the messages that could be prepared
+				batchCount = i;
+				break;
+			}
+		}
+		if (batchCount == 0)
+			break;
+
+		ssize_t batchReceived = common_recvmmsg(socket, batch->messages,
+			batchCount, flags, deadline, false);
+		if (batchReceived < 0) {
+			error = batchReceived;
+			break;
+		}
+
+		for (ssize_t i = 0; i < batchReceived; i++) {
+			mmsghdr* userMessage = &userMessages[received + i];
+			status_t status = copy_received_message_to_userland(
+				&userMessage->msg_hdr, batch->messages[i].msg_hdr,
+				batch->user[i]);
+			if (status == B_OK && user_memcpy(&userMessage->msg_len,
+					&batch->messages[i].msg_len, sizeof(unsigned int))
+						!= B_OK) {
+				status = B_BAD_ADDRESS;
+			}
+			if (status != B_OK) {
+				// report the messages that made it to userland
+				if (received + i > 0)
+					return received + i;
+				return result = status;
+			}
+		}
+
+		received += batchReceived;
+		if ((unsigned int)batchReceived < batchCount || error != B_OK)
+			break;
+
+		if ((flags & MSG_WAITFORONE) != 0)
+			flags |= MSG_DONTWAIT;
 	}
 
-	return result;
+	if (received == 0 && error != B_OK)
+		return result = error;
+
+	return received;
 }
 
 
@@ -1061,48 +1256,77 @@ _user_sendmsg(int socket, const struct msghdr *userMessage, int flags)
 {
 	// copy message from userland
 	msghdr message;
-	iovec* userVecs;
-	MemoryDeleter vecsDeleter;
-	void* userAddress;
-	char address[MAX_SOCKET_ADDRESS_LENGTH];
-
-	status_t error = prepare_userland_msghdr(userMessage, message, userVecs,
-		vecsDeleter, userAddress, address);
+	userland_message user;
+	status_t error = prepare_userland_send(userMessage, message, user);
 	if (error != B_OK)
 		return error;
 
-	// copy the address from userland
-	if (userAddress != NULL
-			&& user_memcpy(address, userAddress, message.msg_namelen) != B_OK) {
+	// sendmsg()
+	SyscallRestartWrapper<ssize_t> result;
+
+	return result = common_sendmsg(socket, &message, flags, false);
+}
+
+
+ssize_t
+_user_sendmmsg(int socket, struct mmsghdr *userMessages, unsigned int count,
+	int flags)
+{
+	if (userMessages == NULL || !IS_USER_ADDRESS(userMessages))
 		return B_BAD_ADDRESS;
-	}
 
-	// copy ancillary data from userland
-	MemoryDeleter ancillaryDeleter;
-	void* userAncillary = message.msg_control;
-	if (userAncillary != NULL) {
-		if (!IS_USER_ADDRESS(userAncillary))
-			return B_BAD_ADDRESS;
-		if (message.msg_controllen < 0
-				|| message.msg_controllen > MAX_ANCILLARY_DATA_LENGTH) {
-			return B_BAD_VALUE;
+	SyscallRestartWrapper<ssize_t> result;
+	status_t error = B_OK;
+	unsigned int sent = 0;
+
+	// the messages are copied into the kernel a batch at a time
+	while (sent < count) {
+		message_batch* batch = new(std::nothrow) message_batch;
+		if (batch == NULL) {
+			error = B_NO_MEMORY;
+			break;
+		}
+		ObjectDeleter<message_batch> batchDeleter(batch);
+
+		unsigned int batchCount = min_c(count - sent, MAX_BATCHED_MESSAGES);
+		for (unsigned int i = 0; i < batchCount; i++) {
+			error = prepare_userland_send(&userMessages[sent + i].msg_hdr,
+				batch->messages[i].msg_hdr, batch->user[i]);
+			if (error != B_OK) {
+				// send what could be prepared
+				batchCount = i;
+				break;
+			}
+		}
+		if (batchCount == 0)
+			break;
+
+		ssize_t batchSent = common_sendmmsg(socket, batch->messages,
+			batchCount, flags, false);
+		if (batchSent < 0) {
+			error = batchSent;
+			break;
 		}
 
-		message.msg_control = malloc(message.msg_controllen);
-		if (message.msg_control == NULL)
-			return B_NO_MEMORY;
-		ancillaryDeleter.SetTo(message.msg_control);
-
-		if (user_memcpy(message.msg_control, userAncillary,
-				message.msg_controllen) != B_OK) {
-			return B_BAD_ADDRESS;
+		for (ssize_t i = 0; i < batchSent; i++) {
+			if (user_memcpy(&userMessages[sent + i].msg_len,
+					&batch->messages[i].msg_len, sizeof(unsigned int))
+						!= B_OK) {
+				// the messages have been sent nevertheless
+				error = B_BAD_ADDRESS;
+				break;
+			}
 		}
+
+		sent += batchSent;
+		if ((unsigned int)batchSent < batchCount || error != B_OK)
+			break;
 	}
 
-	// sendmsg()
-	SyscallRestartWrapper<ssize_t> result;
+	if (sent == 0 && error != B_OK)
+		return result = error;
 
-	return result = common_sendmsg(socket, &message, flags, false);
+	return sent;
 }
 
 
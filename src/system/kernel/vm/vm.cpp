@@ -2201,6 +2201,106 @@ vm_clone_area(team_id team, const char* name, void** address,
 }
 
 
+/*!	Maps the user area containing a range of user memory into the kernel
+	address space, so that the range can be wired there for as long as the
+	kernel needs it, independently of what the team does.
+
+	The new kernel area maps the whole user area, and shares its cache, like
+	a clone does. Unlike vm_clone_area(), the user area is not made
+	B_SHARED_AREA, though, so that copy-on-write still works for the team.
+	This is safe, since the kernel area only participates in what the VM
+	already does for all areas of a cache:
+	- The team may delete or unmap the user area, or exit or exec: the
+	  kernel area keeps a reference to the cache, and the pages wired in it
+	  are not freed before the kernel area is unwired and deleted.
+	- When the team forks, vm_copy_on_write_area() moves the kernel area to
+	  the new top cache together with the user area, and keeps the wired
+	  pages there; only the child gets copies of them.
+	- Resizing the user area resizes all areas of its cache, which is why
+	  the kernel area covers the whole user area at the same offset: a
+	  shrinking area waits until the ranges are no longer wired, growing it
+	  fails if the kernel area cannot grow with it. Cutting the user area
+	  leaves other areas of its cache alone.
+	Only anonymous memory is supported, since file caches may drop their
+	pages when the file is truncated.
+
+	The caller must wire the range for writing (but never write to it): a
+	page wired for reading may still belong to a source cache of the user
+	area's cache; once the team writes to it, the page would only be
+	shadowed, and freed when the caches are merged, even though it is still
+	wired in the kernel area. Wiring for writing copies it into the area's
+	cache first, where the team's writes and forks leave it in place.
+
+	\param team The team whose address space the range belongs to.
+	\param address The start of the range, does not need to be page aligned.
+	\param size The size of the range. Only the part that lies within the
+		user area \a address is in can be used.
+	\param name The name of the new area.
+	\param _address Set to the kernel address \a address is mapped to.
+	\param _size Set to the size of the part of the range that can be used.
+	\return The ID of the new kernel area, or an error code.
+*/
+area_id
+vm_map_user_memory(team_id team, addr_t address, size_t size,
+	const char* name, void** _address, size_t* _size)
+{
+	if (!IS_USER_ADDRESS(address) || size == 0 || address + size < address)
+		return B_BAD_ADDRESS;
+
+	MultiAddressSpaceLocker locker;
+	VMAddressSpace* sourceAddressSpace;
+	status_t status = locker.AddTeam(team, false, &sourceAddressSpace);
+	if (status != B_OK)
+		return status;
+
+	VMAddressSpace* kernelAddressSpace;
+	status = locker.AddTeam(VMAddressSpace::KernelID(), true,
+		&kernelAddressSpace);
+	if (status != B_OK)
+		return status;
+
+	status = locker.Lock();
+	if (status != B_OK)
+		return status;
+
+	VMArea* sourceArea = sourceAddressSpace->LookupArea(address);
+	if (sourceArea == NULL)
+		return B_BAD_ADDRESS;
+	if ((sourceArea->protection & B_READ_AREA) == 0)
+		return B_NOT_ALLOWED;
+
+	VMCache* cache = vm_area_get_locked_cache(sourceArea);
+	if (sourceArea->cache_type != CACHE_TYPE_RAM
+		|| cache->type != CACHE_TYPE_RAM) {
+		vm_area_put_locked_cache(cache);
+		return B_NOT_ALLOWED;
+	}
+
+	virtual_address_restrictions addressRestrictions = {};
+	addressRestrictions.address_specification = B_ANY_KERNEL_ADDRESS;
+	VMArea* area;
+	void* areaAddress;
+	status = map_backing_store(kernelAddressSpace, cache,
+		sourceArea->cache_offset, name, sourceArea->Size(), B_NO_LOCK,
+		B_KERNEL_READ_AREA | B_KERNEL_WRITE_AREA, REGION_NO_PRIVATE_MAP, 0,
+		&addressRestrictions, true, &area, &areaAddress);
+	if (status == B_OK) {
+		// map_backing_store() doesn't acquire a reference for the new area
+		cache->AcquireRefLocked();
+		area->cache_type = sourceArea->cache_type;
+	}
+
+	vm_area_put_locked_cache(cache);
+
+	if (status != B_OK)
+		return status;
+
+	*_address = (uint8*)areaAddress + (address - sourceArea->Base());
+	*_size = min_c(size, sourceArea->Base() + sourceArea->Size() - address);
+	return area->id;
+}
+
+
 /*!	Deletes the specified area of the given address space.
 
 	The address space must be write-locked.
@@ -1349,6 +1349,7 @@ void _kern_realtime_sem_wait() {}
 void _kern_receive_data() {}
 void _kern_recv() {}
 void _kern_recvfrom() {}
+void _kern_recvmmsg() {}
 void _kern_recvmsg() {}
 void _kern_register_file_device() {}
 void _kern_register_image() {}
@@ -1374,6 +1375,7 @@ void _kern_select() {}
 void _kern_send() {}
 void _kern_send_data() {}
 void _kern_send_signal() {}
+void _kern_sendmmsg() {}
 void _kern_sendmsg() {}
 void _kern_sendto() {}
 void _kern_set_area_protection() {}
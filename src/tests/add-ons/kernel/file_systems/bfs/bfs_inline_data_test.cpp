@@ -0,0 +1,201 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	Tests files whose data is stored inline in their inode. Must be run on
+	a volume that was initialized with the "inline_data" parameter; the
+	directory to use is passed as argument.
+*/
+
+
+#include <fcntl.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+static const size_t kInlineSize = 100;
+static const size_t kStreamSize = 64 * 1024;
+	// larger than any inode
+
+static char sPath[PATH_MAX];
+static int sErrorCount = 0;
+
+
+static void
+check(bool condition, const char* text, int line)
+{
+	if (condition)
+		return;
+
+	printf("line %d: \"%s\" failed\n", line, text);
+	sErrorCount++;
+}
+
+#define CHECK(condition) check(condition, #condition, __LINE__)
+
+
+static void
+fill(uint8_t* buffer, size_t size, uint8_t seed)
+{
+	for (size_t i = 0; i < size; i++)
+		buffer[i] = (uint8_t)(i * 7 + seed);
+}
+
+
+//!	Returns whether the file contains exactly \a size bytes of \a data.
+static bool
+contents_match(int fd, const uint8_t* data, size_t size)
+{
+	struct stat stat;
+	if (fstat(fd, &stat) != 0 || stat.st_size != (off_t)size)
+		return false;
+
+	uint8_t* buffer = (uint8_t*)malloc(size + 1);
+	ssize_t bytesRead = pread(fd, buffer, size + 1, 0);
+	bool match = bytesRead == (ssize_t)size
+		&& memcmp(buffer, data, size) == 0;
+
+	free(buffer);
+	return match;
+}
+
+
+static void
+test_read_back()
+{
+	int fd = open(sPath, O_RDWR | O_CREAT | O_TRUNC, 0644);
+	CHECK(fd >= 0);
+
+	uint8_t data[kInlineSize];
+	fill(data, sizeof(data), 1);
+	CHECK(write(fd, data, sizeof(data)) == (ssize_t)sizeof(data));
+	CHECK(contents_match(fd, data, sizeof(data)));
+
+	// overwrite a part of it
+	uint8_t patch[10];
+	fill(patch, sizeof(patch), 2);
+	CHECK(pwrite(fd, patch, sizeof(patch), 20) == (ssize_t)sizeof(patch));
+	memcpy(data + 20, patch, sizeof(patch));
+	CHECK(contents_match(fd, data, sizeof(data)));
+
+	// the data survives syncing and reopening the file
+	CHECK(fsync(fd) == 0);
+	close(fd);
+
+	fd = open(sPath, O_RDONLY);
+	CHECK(contents_match(fd, data, sizeof(data)));
+	close(fd);
+}
+
+
+static void
+test_memory_mapping()
+{
+	int fd = open(sPath, O_RDWR | O_CREAT | O_TRUNC, 0644);
+	CHECK(fd >= 0);
+
+	uint8_t data[kInlineSize];
+	fill(data, sizeof(data), 3);
+	CHECK(write(fd, data, sizeof(data)) == (ssize_t)sizeof(data));
+
+	uint8_t* mapping = (uint8_t*)mmap(NULL, sizeof(data),
+		PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	CHECK(mapping != MAP_FAILED);
+	if (mapping == MAP_FAILED) {
+		close(fd);
+		return;
+	}
+
+	CHECK(memcmp(mapping, data, sizeof(data)) == 0);
+
+	// write() and the mapping see each other's changes
+	data[5] = 0xaa;
+	CHECK(pwrite(fd, data + 5, 1, 5) == 1);
+	CHECK(mapping[5] == 0xaa);
+
+	mapping[6] = 0xbb;
+	data[6] = 0xbb;
+	CHECK(contents_match(fd, data, sizeof(data)));
+
+	CHECK(msync(mapping, sizeof(data), MS_SYNC) == 0);
+	munmap(mapping, sizeof(data));
+	close(fd);
+
+	fd = open(sPath, O_RDONLY);
+	CHECK(contents_match(fd, data, sizeof(data)));
+	close(fd);
+}
+
+
+static void
+test_promotion()
+{
+	int fd = open(sPath, O_RDWR | O_CREAT | O_TRUNC, 0644);
+	CHECK(fd >= 0);
+
+	uint8_t* data = (uint8_t*)malloc(kStreamSize);
+	fill(data, kStreamSize, 4);
+
+	// start inline, then grow beyond what fits into the inode
+	CHECK(write(fd, data, kInlineSize) == (ssize_t)kInlineSize);
+	CHECK(write(fd, data + kInlineSize, kStreamSize - kInlineSize)
+		== (ssize_t)(kStreamSize - kInlineSize));
+	CHECK(contents_match(fd, data, kStreamSize));
+
+	// the same with data that only exists in the file cache so far
+	CHECK(ftruncate(fd, 0) == 0);
+	CHECK(pwrite(fd, data, kInlineSize, 0) == (ssize_t)kInlineSize);
+	CHECK(ftruncate(fd, kStreamSize) == 0);
+	CHECK(pwrite(fd, data + kInlineSize, kStreamSize - kInlineSize,
+		kInlineSize) == (ssize_t)(kStreamSize - kInlineSize));
+	CHECK(contents_match(fd, data, kStreamSize));
+
+	CHECK(fsync(fd) == 0);
+	close(fd);
+
+	fd = open(sPath, O_RDWR);
+	CHECK(contents_match(fd, data, kStreamSize));
+
+	// an empty file may store its data inline again
+	CHECK(ftruncate(fd, 0) == 0);
+	fill(data, kInlineSize, 5);
+	CHECK(write(fd, data, kInlineSize) == (ssize_t)kInlineSize);
+	CHECK(contents_match(fd, data, kInlineSize));
+
+	close(fd);
+	free(data);
+}
+
+
+int
+main(int argc, char** argv)
+{
+	if (argc != 2) {
+		fprintf(stderr, "usage: %s <directory on an inline_data volume>\n",
+			argv[0]);
+		return 1;
+	}
+
+	snprintf(sPath, sizeof(sPath), "%s/bfs_inline_data_test", argv[1]);
+
+	test_read_back();
+	test_memory_mapping();
+	test_promotion();
+
+	unlink(sPath);
+
+	if (sErrorCount > 0) {
+		fprintf(stderr, "FAILED\n");
+		return 1;
+	}
+
+	return 0;
+}
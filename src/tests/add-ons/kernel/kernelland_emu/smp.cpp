@@ -4,7 +4,7 @@
  */
 
 
-//!	This is only needed for the debug build.
+//!	This is mostly needed for the debug build.
 
 
 #include <cpu.h>
@@ -30,3 +30,12 @@ smp_get_current_cpu()
 {
 	return 0;
 }
+
+
+extern "C" int32
+smp_get_num_cpus()
+{
+	// pretend to have several CPUs, so that code keeping per CPU data is
+	// tested with more than one of them
+	return 4;
+}
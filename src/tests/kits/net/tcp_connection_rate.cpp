@@ -0,0 +1,165 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	Measures how many short connections per second can be made over the
+	loopback interface, with one up to the given number of client threads.
+	Each connection sends a small request, and waits for the reply, like
+	a short HTTP request would.
+*/
+
+
+#include <errno.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <OS.h>
+
+
+static const size_t kMessageSize = 64;
+
+static sockaddr_in sServerAddress;
+static int sListenerSocket;
+static volatile bool sQuit;
+static int32 sErrorCount;
+
+
+static void*
+server_thread(void*)
+{
+	char buffer[kMessageSize];
+
+	while (true) {
+		int fd = accept(sListenerSocket, NULL, NULL);
+		if (fd < 0) {
+			if (errno == EINTR)
+				continue;
+			break;
+		}
+
+		ssize_t bytesRead = read(fd, buffer, sizeof(buffer));
+		if (bytesRead > 0)
+			write(fd, buffer, bytesRead);
+
+		close(fd);
+	}
+
+	return NULL;
+}
+
+
+static void*
+client_thread(void* _connections)
+{
+	int64* connections = (int64*)_connections;
+	char buffer[kMessageSize];
+	memset(buffer, 'r', sizeof(buffer));
+
+	while (!sQuit) {
+		int fd = socket(AF_INET, SOCK_STREAM, 0);
+		if (fd < 0) {
+			atomic_add(&sErrorCount, 1);
+			snooze(1000);
+			continue;
+		}
+
+		if (connect(fd, (sockaddr*)&sServerAddress, sizeof(sServerAddress))
+				!= 0
+			|| write(fd, buffer, sizeof(buffer)) != (ssize_t)sizeof(buffer)
+			|| read(fd, buffer, sizeof(buffer)) <= 0)
+			atomic_add(&sErrorCount, 1);
+		else
+			(*connections)++;
+
+		close(fd);
+	}
+
+	return NULL;
+}
+
+
+int
+main(int argc, const char* const* argv)
+{
+	system_info info;
+	get_system_info(&info);
+
+	int maxThreads = argc > 1 ? atoi(argv[1]) : info.cpu_count;
+	int seconds = argc > 2 ? atoi(argv[2]) : 3;
+	if (maxThreads <= 0 || seconds <= 0) {
+		fprintf(stderr, "usage: %s [<max threads>] [<seconds per step>]\n",
+			argv[0]);
+		exit(1);
+	}
+
+	sListenerSocket = socket(AF_INET, SOCK_STREAM, 0);
+	if (sListenerSocket < 0) {
+		fprintf(stderr, "failed to create listener socket: %s\n",
+			strerror(errno));
+		exit(1);
+	}
+
+	memset(&sServerAddress, 0, sizeof(sServerAddress));
+	sServerAddress.sin_len = sizeof(sServerAddress);
+	sServerAddress.sin_family = AF_INET;
+	sServerAddress.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	socklen_t addressLength = sizeof(sServerAddress);
+
+	if (bind(sListenerSocket, (sockaddr*)&sServerAddress, addressLength) < 0
+		|| getsockname(sListenerSocket, (sockaddr*)&sServerAddress,
+			&addressLength) < 0
+		|| listen(sListenerSocket, SOMAXCONN) < 0) {
+		fprintf(stderr, "failed to set up listener socket: %s\n",
+			strerror(errno));
+		exit(1);
+	}
+
+	for (int i = 0; i < maxThreads; i++) {
+		pthread_t thread;
+		if (pthread_create(&thread, NULL, server_thread, NULL) != 0) {
+			fprintf(stderr, "failed to start server thread\n");
+			exit(1);
+		}
+		pthread_detach(thread);
+	}
+
+	pthread_t* threads = new pthread_t[maxThreads];
+	int64* connections = new int64[maxThreads];
+
+	printf("threads  connections/s  errors\n");
+
+	for (int count = 1; count <= maxThreads; count++) {
+		sQuit = false;
+		sErrorCount = 0;
+
+		for (int i = 0; i < count; i++) {
+			connections[i] = 0;
+			pthread_create(&threads[i], NULL, client_thread, &connections[i]);
+		}
+
+		snooze(seconds * 1000000LL);
+		sQuit = true;
+
+		int64 total = 0;
+		for (int i = 0; i < count; i++) {
+			pthread_join(threads[i], NULL);
+			total += connections[i];
+		}
+
+		printf("%7d  %13.1f  %6" B_PRId32 "\n", count, 1.0 * total / seconds,
+			sErrorCount);
+	}
+
+	delete[] threads;
+	delete[] connections;
+
+	close(sListenerSocket);
+	return 0;
+}
@@ -140,6 +140,27 @@ main()
 	add(500, 1000);
 	dump("added data covered by next");
 
+	// SACK blocks: data after gaps, the most recently received first
+	BufferQueue sackQueue(32768);
+	sackQueue.SetInitialSequence(1000);
+	sackQueue.Add(create_filled_buffer(100), 1100);
+	sackQueue.Add(create_filled_buffer(100), 1200);
+	sackQueue.Add(create_filled_buffer(50), 1400);
+	sackQueue.Add(create_filled_buffer(50), 1600);
+
+	tcp_sack sacks[TCP_MAX_SACK_BLOCKS];
+	ASSERT(sackQueue.GetSackBlocks(sacks, TCP_MAX_SACK_BLOCKS, 1400) == 3);
+	ASSERT(ntohl(sacks[0].left_edge) == 1400
+		&& ntohl(sacks[0].right_edge) == 1450);
+	ASSERT(ntohl(sacks[1].left_edge) == 1100
+		&& ntohl(sacks[1].right_edge) == 1300);
+	ASSERT(ntohl(sacks[2].left_edge) == 1600
+		&& ntohl(sacks[2].right_edge) == 1650);
+
+	ASSERT(sackQueue.GetSackBlocks(sacks, 2, 1600) == 2);
+	ASSERT(ntohl(sacks[0].left_edge) == 1600);
+	ASSERT(ntohl(sacks[1].left_edge) == 1100);
+
 	put_module(NET_BUFFER_MODULE_NAME);
 	return 0;
 }
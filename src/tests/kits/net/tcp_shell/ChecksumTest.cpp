@@ -0,0 +1,242 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+//!	Correctness test and benchmark for the Internet checksum functions.
+
+
+#include "utility.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <ByteOrder.h>
+#include <OS.h>
+
+#include <net_buffer.h>
+
+
+extern "C" status_t _add_builtin_module(module_info *info);
+
+extern struct net_buffer_module_info gNetBufferModule;
+	// from net_buffer.cpp
+
+struct net_buffer_module_info* gBufferModule;
+
+
+static const size_t kSizes[] = {20, 40, 64, 256, 576, 1460, 2048, 9000, 65536};
+static const size_t kSizeCount = sizeof(kSizes) / sizeof(kSizes[0]);
+static const size_t kMaxSize = 65536;
+static const size_t kAlignmentCount = 8;
+static const size_t kBenchmarkBytes = 256 * 1024 * 1024;
+
+static uint8 sSource[kMaxSize + kAlignmentCount];
+static uint8 sTarget[kMaxSize + kAlignmentCount];
+
+
+//!	The byte pair loop the optimized versions need to be equal to.
+static uint16
+reference_checksum(const uint8* buffer, size_t length)
+{
+	uint32 sum = 0;
+	while (length >= 2) {
+		uint16 word;
+		memcpy(&word, buffer, 2);
+		sum += word;
+		buffer += 2;
+		length -= 2;
+	}
+
+	if (length > 0) {
+		uint8 ordered[2] = {buffer[0], 0};
+		uint16 word;
+		memcpy(&word, ordered, 2);
+		sum += word;
+	}
+
+	while (sum >> 16)
+		sum = (sum & 0xffff) + (sum >> 16);
+
+	return sum;
+}
+
+
+static bool
+test_checksums()
+{
+	int32 errorCount = 0;
+
+	for (size_t length = 0; length <= 300; length++) {
+		for (size_t sourceAlignment = 0; sourceAlignment < kAlignmentCount;
+				sourceAlignment++) {
+			uint8* source = sSource + sourceAlignment;
+			uint16 expected = reference_checksum(source, length);
+
+			if (compute_checksum(source, length) != expected) {
+				printf("compute_checksum(): wrong result for %zu bytes at "
+					"alignment %zu\n", length, sourceAlignment);
+				errorCount++;
+			}
+
+			for (size_t targetAlignment = 0;
+					targetAlignment < kAlignmentCount; targetAlignment++) {
+				uint8* target = sTarget + targetAlignment;
+				memset(sTarget, 0, sizeof(sTarget));
+
+				if (copy_and_compute_checksum(target, source, length)
+						!= expected
+					|| memcmp(target, source, length) != 0
+					|| target[length] != 0) {
+					printf("copy_and_compute_checksum(): wrong result for %zu "
+						"bytes from alignment %zu to %zu\n", length,
+						sourceAlignment, targetAlignment);
+					errorCount++;
+				}
+			}
+		}
+	}
+
+	return errorCount == 0;
+}
+
+
+/*!	Checks that the checksums net_buffers remember for appended data stay
+	correct when the buffer is changed afterwards.
+*/
+static bool
+test_buffer_checksums()
+{
+	int32 errorCount = 0;
+
+	for (int32 i = 0; i < 2000; i++) {
+		net_buffer* buffer = gBufferModule->create(rand() % 256);
+		if (buffer == NULL)
+			return false;
+
+		// append a few pieces, like the socket layer does for an iovec array
+		int32 pieces = 1 + rand() % 4;
+		for (int32 j = 0; j < pieces; j++) {
+			size_t size = 1 + rand() % 3000;
+			gBufferModule->append(buffer, sSource + rand() % 64, size);
+		}
+
+		// add and change headers, like the protocols do
+		uint8 header[64];
+		memcpy(header, sSource + 1000, sizeof(header));
+		gBufferModule->prepend(buffer, header, 1 + rand() % sizeof(header));
+		if (rand() % 2 == 0) {
+			size_t offset = rand() % buffer->size;
+			size_t size = min_c(sizeof(header), buffer->size - offset);
+			gBufferModule->write(buffer, offset, header, size);
+		}
+		if (rand() % 2 == 0)
+			gBufferModule->remove_header(buffer, rand() % 32);
+		if (rand() % 2 == 0)
+			gBufferModule->remove_trailer(buffer, rand() % 32);
+		if (buffer->size < 2) {
+			gBufferModule->free(buffer);
+			continue;
+		}
+
+		size_t offset = rand() % (buffer->size / 2);
+		size_t size = buffer->size - offset;
+		gBufferModule->read(buffer, offset, sTarget, size);
+		uint16 expected = reference_checksum(sTarget, size);
+		if ((offset & 1) != 0)
+			expected = __swap_int16(expected);
+
+		uint16 sum = gBufferModule->checksum(buffer, offset, size, false);
+		if (sum != expected) {
+			printf("checksum_data(): wrong result for %zu bytes at offset "
+				"%zu of a %zu bytes buffer\n", size, offset,
+				(size_t)buffer->size);
+			errorCount++;
+		}
+
+		gBufferModule->free(buffer);
+	}
+
+	return errorCount == 0;
+}
+
+
+static void
+benchmark()
+{
+	printf("%8s %5s %12s %12s %12s %12s\n", "size", "align", "reference",
+		"checksum", "copy+sum", "fused");
+
+	volatile uint16 result = 0;
+
+	for (size_t i = 0; i < kSizeCount; i++) {
+		size_t size = kSizes[i];
+		int32 iterations = kBenchmarkBytes / size;
+
+		for (size_t alignment = 0; alignment < 4; alignment++) {
+			uint8* source = sSource + alignment;
+			uint8* target = sTarget + alignment;
+			bigtime_t times[4];
+
+			bigtime_t start = system_time();
+			for (int32 j = 0; j < iterations; j++)
+				result = result + reference_checksum(source, size);
+			times[0] = system_time() - start;
+
+			start = system_time();
+			for (int32 j = 0; j < iterations; j++)
+				result = result + compute_checksum(source, size);
+			times[1] = system_time() - start;
+
+			start = system_time();
+			for (int32 j = 0; j < iterations; j++) {
+				memcpy(target, source, size);
+				result = result + compute_checksum(target, size);
+			}
+			times[2] = system_time() - start;
+
+			start = system_time();
+			for (int32 j = 0; j < iterations; j++) {
+				result = result
+					+ copy_and_compute_checksum(target, source, size);
+			}
+			times[3] = system_time() - start;
+
+			// print the throughput in MB/s
+			printf("%8zu %5zu", size, alignment);
+			for (int32 k = 0; k < 4; k++) {
+				printf(" %12.1f", times[k] > 0
+					? (double)kBenchmarkBytes / times[k] : 0.0);
+			}
+			printf("\n");
+		}
+	}
+}
+
+
+int
+main(int argc, char** argv)
+{
+	for (size_t i = 0; i < sizeof(sSource); i++)
+		sSource[i] = rand();
+
+	_add_builtin_module((module_info*)&gNetBufferModule);
+	get_module(NET_BUFFER_MODULE_NAME, (module_info**)&gBufferModule);
+
+	bool success = test_checksums();
+	success &= test_buffer_checksums();
+
+	put_module(NET_BUFFER_MODULE_NAME);
+
+	if (argc < 2 || strcmp(argv[1], "--no-benchmark") != 0)
+		benchmark();
+
+	if (!success) {
+		fprintf(stderr, "FAILED\n");
+		return 1;
+	}
+
+	return 0;
+}
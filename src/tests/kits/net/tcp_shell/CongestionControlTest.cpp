@@ -0,0 +1,280 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	Tests the congestion control algorithms, and compares them on a
+	simulated bottleneck link.
+*/
+
+
+#include "CongestionControl.h"
+
+#include <stdio.h>
+#include <string.h>
+
+
+static const uint32 kMaxSegmentSize = 1000;
+static const int32 kMaxPackets = 65536;
+
+static int32 sErrorCount = 0;
+
+
+static void
+check(bool condition, const char* text, int line)
+{
+	if (condition)
+		return;
+
+	printf("line %d: \"%s\" failed\n", line, text);
+	sErrorCount++;
+}
+
+#define CHECK(condition) check(condition, #condition, __LINE__)
+
+
+struct Packet {
+	bigtime_t	sent;
+	bigtime_t	acknowledged;
+	uint32		sequence;
+	bool		lost;
+};
+
+struct SimulationResult {
+	uint64		delivered;
+	bigtime_t	queue_delay;
+		// average
+	uint32		losses;
+};
+
+static Packet sPackets[kMaxPackets];
+
+
+static tcp_congestion_sample
+make_sample(bigtime_t now, uint32 bytes, uint32 inFlight,
+	bigtime_t roundTripTime, bool inRecovery)
+{
+	tcp_congestion_sample sample;
+	sample.now = now;
+	sample.acknowledged = bytes;
+	sample.delivered = bytes;
+	sample.in_flight = inFlight;
+	sample.round_trip_time = roundTripTime;
+	sample.in_recovery = inRecovery;
+	return sample;
+}
+
+
+/*!	Sends full segments through a link with \a rate bytes per second, a
+	round trip time of \a delay, and a drop tail queue of \a queueSize bytes.
+	Losses are reported with the next acknowledgement, once per window.
+*/
+static void
+simulate(CongestionControl* control, uint32 rate, bigtime_t delay,
+	uint32 queueSize, bigtime_t duration, SimulationResult& result)
+{
+	memset(&result, 0, sizeof(result));
+	control->Init(kMaxSegmentSize, 2 * kMaxSegmentSize, 1024 * 1024);
+
+	bigtime_t transmitTime = (bigtime_t)kMaxSegmentSize * 1000000 / rate;
+	bigtime_t linkFree = 0;
+	bigtime_t queueDelay = 0;
+	int32 sentCount = 0;
+	int32 head = 0;
+	int32 tail = 0;
+	uint32 inFlight = 0;
+	uint32 nextSequence = 0;
+	uint32 recoveryPoint = 0;
+	bool inRecovery = false;
+	bigtime_t now = 1;
+
+	while (now < duration) {
+		// send as much as the window allows
+		while (inFlight + kMaxSegmentSize <= control->CongestionWindow()
+			&& (tail + 1) % kMaxPackets != head) {
+			Packet& packet = sPackets[tail];
+			tail = (tail + 1) % kMaxPackets;
+
+			bigtime_t start = max_c(now, linkFree);
+			uint64 queued = (uint64)(start - now) * rate / 1000000;
+
+			packet.sent = now;
+			packet.sequence = nextSequence;
+			packet.lost = queued + kMaxSegmentSize > queueSize;
+			if (packet.lost)
+				packet.acknowledged = start + delay;
+			else {
+				linkFree = start + transmitTime;
+				packet.acknowledged = linkFree + delay;
+				queueDelay += start - now;
+				sentCount++;
+			}
+
+			nextSequence += kMaxSegmentSize;
+			inFlight += kMaxSegmentSize;
+		}
+
+		if (head == tail)
+			break;
+
+		// process the next acknowledgement
+		Packet& packet = sPackets[head];
+		head = (head + 1) % kMaxPackets;
+		now = packet.acknowledged;
+		inFlight -= kMaxSegmentSize;
+
+		if (packet.lost) {
+			result.losses++;
+			if (!inRecovery) {
+				control->LossDetected(inFlight + kMaxSegmentSize);
+				inRecovery = true;
+				recoveryPoint = nextSequence;
+			}
+			continue;
+		}
+
+		if (inRecovery && packet.sequence >= recoveryPoint) {
+			inRecovery = false;
+			control->RecoveryFinished();
+		}
+
+		result.delivered += kMaxSegmentSize;
+		control->Acknowledged(make_sample(now, kMaxSegmentSize, inFlight,
+			now - packet.sent, inRecovery));
+	}
+
+	if (sentCount > 0)
+		result.queue_delay = queueDelay / sentCount;
+}
+
+
+static void
+test_registry()
+{
+	CongestionControl* control = CongestionControl::Create();
+	CHECK(control != NULL && strcmp(control->Name(), "newreno") == 0);
+	delete control;
+
+	CHECK(CongestionControl::Create("unknown") == NULL);
+	CHECK(CongestionControl::SetDefault("unknown") != B_OK);
+
+	CHECK(CongestionControl::SetDefault("cubic") == B_OK);
+	control = CongestionControl::Create();
+	CHECK(control != NULL && strcmp(control->Name(), "cubic") == 0);
+	delete control;
+
+	CHECK(CongestionControl::SetDefault("newreno") == B_OK);
+}
+
+
+static void
+test_new_reno()
+{
+	CongestionControl* control = CongestionControl::Create("newreno");
+	control->Init(kMaxSegmentSize, 2 * kMaxSegmentSize, 10 * kMaxSegmentSize);
+
+	// slow start
+	for (int32 i = 0; i < 8; i++) {
+		control->Acknowledged(make_sample(1000, kMaxSegmentSize, 0, 0,
+			false));
+	}
+	CHECK(control->CongestionWindow() == 10 * kMaxSegmentSize + 100);
+
+	control->LossDetected(20 * kMaxSegmentSize);
+	CHECK(control->SlowStartThreshold() == 10 * kMaxSegmentSize);
+	CHECK(control->CongestionWindow() == 10 * kMaxSegmentSize);
+
+	// no growth during recovery
+	control->Acknowledged(make_sample(1000, kMaxSegmentSize, 0, 0, true));
+	CHECK(control->CongestionWindow() == 10 * kMaxSegmentSize);
+
+	control->RetransmitTimeout(4 * kMaxSegmentSize);
+	CHECK(control->SlowStartThreshold() == 2 * kMaxSegmentSize);
+	CHECK(control->CongestionWindow() == kMaxSegmentSize);
+
+	delete control;
+}
+
+
+static void
+test_cubic()
+{
+	CongestionControl* control = CongestionControl::Create("cubic");
+	control->Init(kMaxSegmentSize, 100 * kMaxSegmentSize,
+		100 * kMaxSegmentSize);
+
+	control->LossDetected(100 * kMaxSegmentSize);
+	CHECK(control->CongestionWindow() == 70 * kMaxSegmentSize);
+
+	// The window returns to where the loss happened after
+	// K = cbrt(30 / 0.4) = 4.2 seconds, one window per 100 ms round trip.
+	bigtime_t now = 1000000;
+	while (now < 1000000 + 4217000) {
+		uint32 segments = control->CongestionWindow() / kMaxSegmentSize;
+		for (uint32 i = 0; i < segments; i++) {
+			control->Acknowledged(make_sample(now + i * 100000 / segments,
+				kMaxSegmentSize, 0, 100000, false));
+		}
+		now += 100000;
+	}
+	CHECK(control->CongestionWindow() > 95 * kMaxSegmentSize);
+	CHECK(control->CongestionWindow() < 105 * kMaxSegmentSize);
+
+	// fast convergence: a loss below the previous maximum leaves room
+	control->Init(kMaxSegmentSize, 80 * kMaxSegmentSize,
+		100 * kMaxSegmentSize);
+	control->LossDetected(80 * kMaxSegmentSize);
+	CHECK(control->CongestionWindow() == 56 * kMaxSegmentSize);
+
+	delete control;
+}
+
+
+static void
+test_link()
+{
+	// 10 MBit/s, 40 ms, with a queue of twice the bandwidth delay product
+	const uint32 kRate = 1250000;
+	const bigtime_t kDelay = 40000;
+	const uint32 kQueueSize = 100000;
+	const bigtime_t kDuration = 30000000;
+
+	static const char* const kAlgorithms[] = {"newreno", "cubic", "bbr"};
+	SimulationResult results[3];
+
+	for (int32 i = 0; i < 3; i++) {
+		CongestionControl* control = CongestionControl::Create(kAlgorithms[i]);
+		simulate(control, kRate, kDelay, kQueueSize, kDuration, results[i]);
+		delete control;
+
+		printf("%-8s %6" B_PRIu64 " kB/s, queue delay %5" B_PRId64 " us, %"
+			B_PRIu32 " losses\n", kAlgorithms[i],
+			results[i].delivered * 1000000 / kDuration / 1000,
+			results[i].queue_delay, results[i].losses);
+
+		// everyone should use most of the link
+		CHECK(results[i].delivered * 1000000 / kDuration > kRate * 8 / 10);
+	}
+
+	// the model based algorithm keeps the queue short
+	CHECK(results[2].queue_delay < results[0].queue_delay / 2);
+	CHECK(results[2].queue_delay < results[1].queue_delay / 2);
+}
+
+
+int
+main()
+{
+	test_registry();
+	test_new_reno();
+	test_cubic();
+	test_link();
+
+	if (sErrorCount > 0) {
+		fprintf(stderr, "FAILED\n");
+		return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,331 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	Stress test and benchmark for the network stack's timers, and tests of
+	hooks that run in different timer threads.
+*/
+
+
+#include "utility.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+
+#include <OS.h>
+
+
+static const int32 kTimerCount = 100000;
+static const int32 kOperationCount = 5000000;
+static const int32 kFiringTimerCount = 20000;
+static const int32 kObjectCount = 64;
+static const int32 kTimersPerObject = 4;
+
+
+struct TestTimer {
+	net_timer	timer;
+	bigtime_t	due;
+	bigtime_t	fired;
+};
+
+struct TestObject {
+	net_timer	timers[kTimersPerObject];
+	int32		running;
+	int32		fired;
+};
+
+struct WaitTimer {
+	net_timer	timer;
+	WaitTimer*	other;
+		// the timer to wait for in the hook
+	bigtime_t	delay;
+		// how long the hook runs before it waits
+	thread_id	thread;
+	status_t	status;
+	bigtime_t	finished;
+};
+
+static TestTimer sTimers[kTimerCount];
+static int32 sFiredCount;
+static int32 sEarlyCount;
+static TestObject sObjects[kObjectCount];
+static int32 sOverlapCount;
+static WaitTimer sWaitTimers[kObjectCount];
+
+
+static void
+test_timer_hook(net_timer* timer, void* data)
+{
+	TestTimer* testTimer = (TestTimer*)data;
+	testTimer->fired = system_time();
+	if (testTimer->fired < testTimer->due)
+		atomic_add(&sEarlyCount, 1);
+	atomic_add(&sFiredCount, 1);
+}
+
+
+static bigtime_t
+random_delay()
+{
+	// mostly short timers like retransmit and delayed ACK timers, some long
+	// ones like TIME_WAIT timers
+	if (rand() % 8 != 0)
+		return 10000 + rand() % 500000;
+	return 1000000 + (bigtime_t)(rand() % 60) * 1000000;
+}
+
+
+static void
+benchmark_arm_and_cancel()
+{
+	for (int32 i = 0; i < kTimerCount; i++)
+		init_timer(&sTimers[i].timer, test_timer_hook, &sTimers[i]);
+
+	bigtime_t start = system_time();
+
+	for (int32 i = 0; i < kOperationCount; i++) {
+		TestTimer& testTimer = sTimers[rand() % kTimerCount];
+		if (rand() % 4 == 0)
+			cancel_timer(&testTimer.timer);
+		else {
+			bigtime_t delay = 60000000 + random_delay();
+			testTimer.due = system_time() + delay;
+			set_timer(&testTimer.timer, delay);
+		}
+	}
+
+	bigtime_t elapsed = system_time() - start;
+
+	for (int32 i = 0; i < kTimerCount; i++)
+		cancel_timer(&sTimers[i].timer);
+
+	printf("%" B_PRId32 " arm/cancel operations on %" B_PRId32 " timers: "
+		"%" B_PRId64 " us (%.1f ns per operation)\n", kOperationCount,
+		kTimerCount, elapsed, elapsed * 1000.0 / kOperationCount);
+}
+
+
+static bool
+test_firing()
+{
+	sFiredCount = 0;
+	sEarlyCount = 0;
+
+	bigtime_t maxDue = 0;
+	for (int32 i = 0; i < kFiringTimerCount; i++) {
+		TestTimer& testTimer = sTimers[i];
+		init_timer(&testTimer.timer, test_timer_hook, &testTimer);
+
+		bigtime_t delay = rand() % 2000000;
+		testTimer.due = system_time() + delay;
+		testTimer.fired = 0;
+		set_timer(&testTimer.timer, delay);
+
+		if (testTimer.due > maxDue)
+			maxDue = testTimer.due;
+	}
+
+	// cancel every tenth timer again
+	int32 canceledCount = 0;
+	for (int32 i = 0; i < kFiringTimerCount; i += 10) {
+		if (cancel_timer(&sTimers[i].timer))
+			canceledCount++;
+	}
+
+	snooze_until(maxDue + 100000, B_SYSTEM_TIMEBASE);
+
+	bigtime_t maxLateness = 0;
+	int32 pendingCount = 0;
+	for (int32 i = 0; i < kFiringTimerCount; i++) {
+		TestTimer& testTimer = sTimers[i];
+		wait_for_timer(&testTimer.timer);
+		if (is_timer_active(&testTimer.timer))
+			pendingCount++;
+		if (testTimer.fired > 0 && testTimer.fired - testTimer.due > maxLateness)
+			maxLateness = testTimer.fired - testTimer.due;
+	}
+
+	printf("%" B_PRId32 " timers: %" B_PRId32 " fired, %" B_PRId32 " canceled, "
+		"%" B_PRId32 " early, %" B_PRId32 " pending, max. lateness %" B_PRId64
+		" us\n", kFiringTimerCount, sFiredCount, canceledCount, sEarlyCount,
+		pendingCount, maxLateness);
+
+	return sEarlyCount == 0 && pendingCount == 0
+		&& sFiredCount + canceledCount == kFiringTimerCount;
+}
+
+
+static void
+object_timer_hook(net_timer* timer, void* data)
+{
+	TestObject* object = (TestObject*)data;
+	if (atomic_add(&object->running, 1) != 0)
+		atomic_add(&sOverlapCount, 1);
+
+	snooze(100);
+
+	atomic_add(&object->running, -1);
+	atomic_add(&object->fired, 1);
+}
+
+
+//!	The timers of one object must never run concurrently.
+static bool
+test_object_timers()
+{
+	sOverlapCount = 0;
+
+	for (int32 i = 0; i < kObjectCount; i++) {
+		TestObject& object = sObjects[i];
+		object.running = 0;
+		object.fired = 0;
+
+		for (int32 j = 0; j < kTimersPerObject; j++) {
+			init_timer(&object.timers[j], object_timer_hook, &object);
+			set_timer(&object.timers[j], rand() % 5000);
+		}
+	}
+
+	snooze(100000);
+
+	int32 missingCount = 0;
+	for (int32 i = 0; i < kObjectCount; i++) {
+		for (int32 j = 0; j < kTimersPerObject; j++)
+			wait_for_timer(&sObjects[i].timers[j]);
+
+		if (sObjects[i].fired != kTimersPerObject)
+			missingCount++;
+	}
+
+	printf("%" B_PRId32 " objects: %" B_PRId32 " overlapping hooks, %" B_PRId32
+		" objects with missing hooks\n", kObjectCount, sOverlapCount,
+		missingCount);
+
+	return sOverlapCount == 0 && missingCount == 0;
+}
+
+
+static void
+wait_timer_hook(net_timer* timer, void* data)
+{
+	WaitTimer* self = (WaitTimer*)data;
+	self->thread = find_thread(NULL);
+
+	snooze(self->delay);
+	if (self->other != NULL)
+		self->status = wait_for_timer(&self->other->timer);
+
+	self->finished = system_time();
+}
+
+
+static void
+run_wait_timers(WaitTimer* first, bigtime_t firstDelay, WaitTimer* second,
+	bigtime_t secondDelay)
+{
+	first->status = second->status = B_ERROR;
+	set_timer(&first->timer, firstDelay);
+	set_timer(&second->timer, secondDelay);
+
+	snooze(std::max(firstDelay, secondDelay) + 10000);
+	wait_for_timer(&first->timer);
+	wait_for_timer(&second->timer);
+}
+
+
+/*!	Hooks of different timer threads may wait for each other, but must not
+	deadlock when they wait in a cycle; waiting for the own thread fails.
+*/
+static bool
+test_waiting_hooks()
+{
+	for (int32 i = 0; i < kObjectCount; i++) {
+		WaitTimer& waitTimer = sWaitTimers[i];
+		init_timer(&waitTimer.timer, wait_timer_hook, &waitTimer);
+		waitTimer.other = NULL;
+		waitTimer.delay = 0;
+		set_timer(&waitTimer.timer, 0);
+	}
+
+	snooze(50000);
+
+	// find two timers that run in different threads
+	WaitTimer* a = &sWaitTimers[0];
+	WaitTimer* b = NULL;
+	for (int32 i = 0; i < kObjectCount; i++) {
+		wait_for_timer(&sWaitTimers[i].timer);
+		if (b == NULL && sWaitTimers[i].thread != a->thread)
+			b = &sWaitTimers[i];
+	}
+	if (b == NULL) {
+		printf("all timers run in one thread, skipping waiting hooks test\n");
+		return true;
+	}
+
+	bool success = true;
+
+	// a waits for the running hook of b
+	a->other = b;
+	a->delay = 0;
+	b->other = NULL;
+	b->delay = 100000;
+	run_wait_timers(b, 0, a, 20000);
+	if (a->status != B_OK || a->finished < b->finished) {
+		printf("hook did not wait for the hook of another thread\n");
+		success = false;
+	}
+
+	// a and b wait for each other
+	b->other = a;
+	a->delay = b->delay = 30000;
+	run_wait_timers(a, 0, b, 0);
+	if (!((a->status == B_OK && b->status == B_WOULD_BLOCK)
+			|| (a->status == B_WOULD_BLOCK && b->status == B_OK))) {
+		printf("hooks waiting for each other: %s, %s\n", strerror(a->status),
+			strerror(b->status));
+		success = false;
+	}
+
+	// a waits for itself
+	a->other = a;
+	a->delay = 0;
+	b->other = NULL;
+	b->delay = 0;
+	run_wait_timers(a, 0, b, 0);
+	if (a->status != B_BAD_VALUE) {
+		printf("hook waiting for itself: %s\n", strerror(a->status));
+		success = false;
+	}
+
+	return success;
+}
+
+
+int
+main()
+{
+	status_t status = init_timers();
+	if (status != B_OK) {
+		fprintf(stderr, "Could not initialize timers: %s\n", strerror(status));
+		return 1;
+	}
+
+	benchmark_arm_and_cancel();
+	bool success = test_firing();
+	success &= test_object_timers();
+	success &= test_waiting_hooks();
+
+	uninit_timers();
+
+	if (!success) {
+		fprintf(stderr, "FAILED\n");
+		return 1;
+	}
+
+	return 0;
+}
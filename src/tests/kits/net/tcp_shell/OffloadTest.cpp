@@ -0,0 +1,455 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+//!	Tests the software segmentation and receive offload of the stack.
+
+
+#include "offload.h"
+
+#include <netinet/in.h>
+#include <netinet/ip.h>
+#include <netinet/tcp.h>
+#include <netinet/udp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <util/list.h>
+
+#include <net_buffer.h>
+
+
+extern "C" status_t _add_builtin_module(module_info *info);
+
+extern struct net_buffer_module_info gNetBufferModule;
+	// from net_buffer.cpp
+
+struct net_buffer_module_info* gBufferModule;
+
+
+static const uint8 kFlagFinish = 0x01;
+static const uint8 kFlagPush = 0x08;
+static const uint8 kFlagAcknowledge = 0x10;
+
+static const size_t kHeadersLength = sizeof(ip) + sizeof(tcphdr);
+static const size_t kDatagramHeadersLength = sizeof(ip) + sizeof(udphdr);
+static const size_t kDataLength = 10000;
+static const uint16 kSegmentSize = 1448;
+static const uint32 kMTU = 1500;
+static const uint32 kSequence = 0xfffff000;
+	// wraps around within the data
+
+static uint8 sData[kDataLength];
+static int32 sErrorCount = 0;
+
+
+static void
+check(bool condition, const char* text, int line)
+{
+	if (condition)
+		return;
+
+	printf("line %d: \"%s\" failed\n", line, text);
+	sErrorCount++;
+}
+
+#define CHECK(condition) check(condition, #condition, __LINE__)
+
+
+static uint16
+reference_checksum(const uint8* data, size_t length, uint32 sum = 0)
+{
+	for (size_t i = 0; i + 1 < length; i += 2)
+		sum += (data[i] << 8) | data[i + 1];
+	if ((length & 1) != 0)
+		sum += data[length - 1] << 8;
+
+	while ((sum >> 16) != 0)
+		sum = (sum & 0xffff) + (sum >> 16);
+
+	return sum;
+}
+
+
+//!	Returns whether the IP and transport checksums of \a packet are valid.
+static bool
+checksums_valid(const uint8* packet, size_t length)
+{
+	if (reference_checksum(packet, sizeof(ip)) != 0xffff)
+		return false;
+
+	// pseudo header: addresses, protocol, and transport length
+	uint32 sum = reference_checksum(packet + 12, 8) + ((ip*)packet)->ip_p
+		+ length - sizeof(ip);
+	return reference_checksum(packet + sizeof(ip), length - sizeof(ip), sum)
+		== 0xffff;
+}
+
+
+static net_buffer*
+create_packet(uint32 sequence, const uint8* data, size_t length, uint8 flags)
+{
+	uint8 headers[kHeadersLength];
+	memset(headers, 0, sizeof(headers));
+
+	ip& ipHeader = *(ip*)headers;
+	headers[0] = 0x45;
+	ipHeader.ip_len = htons(kHeadersLength + length);
+	ipHeader.ip_id = htons(1000);
+	ipHeader.ip_ttl = 64;
+	ipHeader.ip_p = IPPROTO_TCP;
+	ipHeader.ip_src.s_addr = htonl(0x0a000001);
+	ipHeader.ip_dst.s_addr = htonl(0x0a000002);
+	ipHeader.ip_sum = htons(~reference_checksum(headers, sizeof(ip)));
+
+	tcphdr& tcpHeader = *(tcphdr*)(headers + sizeof(ip));
+	tcpHeader.th_sport = htons(40000);
+	tcpHeader.th_dport = htons(80);
+	tcpHeader.th_seq = htonl(sequence);
+	tcpHeader.th_ack = htonl(12345);
+	headers[sizeof(ip) + 12] = (sizeof(tcphdr) / 4) << 4;
+	tcpHeader.th_flags = flags;
+	tcpHeader.th_win = htons(65535);
+
+	net_buffer* buffer = gBufferModule->create(256);
+	if (buffer == NULL
+		|| gBufferModule->append(buffer, headers, kHeadersLength) != B_OK
+		|| gBufferModule->append(buffer, data, length) != B_OK)
+		exit(1);
+
+	// compute the TCP checksum over the whole packet
+	uint8* packet = (uint8*)malloc(buffer->size);
+	gBufferModule->read(buffer, 0, packet, buffer->size);
+	uint32 sum = reference_checksum(packet + 12, 8) + IPPROTO_TCP
+		+ buffer->size - sizeof(ip);
+	uint16 checksum = htons(~reference_checksum(packet + sizeof(ip),
+		buffer->size - sizeof(ip), sum));
+	gBufferModule->write(buffer, sizeof(ip) + 16, &checksum, 2);
+	free(packet);
+
+	return buffer;
+}
+
+
+static net_buffer*
+create_datagram(const uint8* data, size_t length)
+{
+	uint8 headers[kDatagramHeadersLength];
+	memset(headers, 0, sizeof(headers));
+
+	ip& ipHeader = *(ip*)headers;
+	headers[0] = 0x45;
+	ipHeader.ip_len = htons(kDatagramHeadersLength + length);
+	ipHeader.ip_id = htons(1000);
+	ipHeader.ip_ttl = 64;
+	ipHeader.ip_p = IPPROTO_UDP;
+	ipHeader.ip_src.s_addr = htonl(0x0a000001);
+	ipHeader.ip_dst.s_addr = htonl(0x0a000002);
+	ipHeader.ip_sum = htons(~reference_checksum(headers, sizeof(ip)));
+
+	// the checksum is left to the segmentation
+	udphdr& udpHeader = *(udphdr*)(headers + sizeof(ip));
+	udpHeader.uh_sport = htons(40000);
+	udpHeader.uh_dport = htons(53);
+	udpHeader.uh_ulen = htons(sizeof(udphdr) + length);
+
+	net_buffer* buffer = gBufferModule->create(256);
+	if (buffer == NULL
+		|| gBufferModule->append(buffer, headers, kDatagramHeadersLength)
+			!= B_OK
+		|| gBufferModule->append(buffer, data, length) != B_OK)
+		exit(1);
+
+	buffer->protocol = IPPROTO_UDP;
+	return buffer;
+}
+
+
+static void
+test_segmentation()
+{
+	net_buffer* buffer = create_packet(kSequence, sData, kDataLength,
+		kFlagAcknowledge | kFlagPush | kFlagFinish);
+	buffer->segment_size = kSegmentSize;
+	size_t size = buffer->size;
+
+	struct list segments;
+	CHECK(segment_buffer(buffer, kMTU, &segments) == B_OK);
+	CHECK(buffer->size == size);
+
+	uint8 packet[kHeadersLength + kSegmentSize];
+	size_t offset = 0;
+	uint16 id = 1000;
+	int32 count = 0;
+
+	while (net_buffer* segment
+			= (net_buffer*)list_remove_head_item(&segments)) {
+		size_t dataLength = min_c(kDataLength - offset, kSegmentSize);
+		bool last = offset + dataLength == kDataLength;
+		count++;
+
+		CHECK(segment->size == kHeadersLength + dataLength);
+		if (segment->size > sizeof(packet)) {
+			gBufferModule->free(segment);
+			continue;
+		}
+
+		gBufferModule->read(segment, 0, packet, segment->size);
+		ip& ipHeader = *(ip*)packet;
+		tcphdr& tcpHeader = *(tcphdr*)(packet + sizeof(ip));
+
+		CHECK(ntohs(ipHeader.ip_len) == segment->size);
+		CHECK(ntohs(ipHeader.ip_id) == id++);
+		CHECK(ntohl(tcpHeader.th_seq) == (uint32)(kSequence + offset));
+		CHECK(tcpHeader.th_flags == (last
+			? kFlagAcknowledge | kFlagPush | kFlagFinish : kFlagAcknowledge));
+		CHECK(memcmp(packet + kHeadersLength, sData + offset, dataLength)
+			== 0);
+		CHECK(checksums_valid(packet, segment->size));
+
+		offset += dataLength;
+		gBufferModule->free(segment);
+	}
+
+	CHECK(offset == kDataLength);
+	CHECK(count == (kDataLength + kSegmentSize - 1) / kSegmentSize);
+
+	gBufferModule->free(buffer);
+}
+
+
+static void
+test_segmentation_mtu()
+{
+	// TCP segments are cut smaller to fit into the MTU
+	net_buffer* buffer = create_packet(kSequence, sData, kDataLength,
+		kFlagAcknowledge);
+	buffer->segment_size = 4000;
+
+	struct list segments;
+	CHECK(segment_buffer(buffer, kMTU, &segments) == B_OK);
+
+	uint8 packet[kMTU];
+	size_t offset = 0;
+	while (net_buffer* segment
+			= (net_buffer*)list_remove_head_item(&segments)) {
+		CHECK(segment->size == kHeadersLength
+			+ min_c(kDataLength - offset, kMTU - kHeadersLength));
+		if (segment->size <= sizeof(packet)) {
+			gBufferModule->read(segment, 0, packet, segment->size);
+			CHECK(checksums_valid(packet, segment->size));
+		}
+
+		offset += segment->size - kHeadersLength;
+		gBufferModule->free(segment);
+	}
+	CHECK(offset == kDataLength);
+
+	// and so is the segment size the device uses
+	CHECK(limit_segment_size(buffer, kMTU) == B_OK);
+	CHECK(buffer->segment_size == kMTU - kHeadersLength);
+	gBufferModule->free(buffer);
+
+	// but datagrams cannot be
+	buffer = create_datagram(sData, kDataLength);
+	buffer->segment_size = 4000;
+	CHECK(segment_buffer(buffer, kMTU, &segments) == EMSGSIZE);
+	CHECK(list_is_empty(&segments));
+	CHECK(limit_segment_size(buffer, kMTU) == EMSGSIZE);
+	gBufferModule->free(buffer);
+}
+
+
+static void
+test_datagram_segmentation()
+{
+	net_buffer* buffer = create_datagram(sData, kDataLength);
+	buffer->segment_size = kSegmentSize;
+
+	struct list datagrams;
+	CHECK(segment_buffer(buffer, kMTU, &datagrams) == B_OK);
+
+	uint8 packet[kDatagramHeadersLength + kSegmentSize];
+	size_t offset = 0;
+	uint16 id = 1000;
+
+	while (net_buffer* datagram
+			= (net_buffer*)list_remove_head_item(&datagrams)) {
+		size_t dataLength = min_c(kDataLength - offset, kSegmentSize);
+
+		CHECK(datagram->size == kDatagramHeadersLength + dataLength);
+		if (datagram->size > sizeof(packet)) {
+			gBufferModule->free(datagram);
+			continue;
+		}
+
+		gBufferModule->read(datagram, 0, packet, datagram->size);
+		udphdr& udpHeader = *(udphdr*)(packet + sizeof(ip));
+
+		CHECK(ntohs(((ip*)packet)->ip_len) == datagram->size);
+		CHECK(ntohs(((ip*)packet)->ip_id) == id++);
+		CHECK(ntohs(udpHeader.uh_ulen) == sizeof(udphdr) + dataLength);
+		CHECK(memcmp(packet + kDatagramHeadersLength, sData + offset,
+			dataLength) == 0);
+		CHECK(checksums_valid(packet, datagram->size));
+
+		offset += dataLength;
+		gBufferModule->free(datagram);
+	}
+
+	CHECK(offset == kDataLength);
+	gBufferModule->free(buffer);
+
+	// datagrams are never coalesced
+	buffer = create_datagram(sData, kSegmentSize);
+	net_buffer* next = create_datagram(sData + kSegmentSize, kSegmentSize);
+	CHECK(!coalesce_buffers(buffer, next));
+
+	gBufferModule->free(next);
+	gBufferModule->free(buffer);
+}
+
+
+static void
+test_coalescing()
+{
+	// consecutive segments are merged into one
+	net_buffer* buffer = create_packet(kSequence, sData, kSegmentSize,
+		kFlagAcknowledge);
+	size_t offset = kSegmentSize;
+	while (offset < kDataLength) {
+		size_t length = min_c(kDataLength - offset, kSegmentSize);
+		bool last = offset + length == kDataLength;
+		net_buffer* next = create_packet(kSequence + offset, sData + offset,
+			length, last ? kFlagAcknowledge | kFlagPush : kFlagAcknowledge);
+
+		CHECK(coalesce_buffers(buffer, next));
+		offset += length;
+	}
+
+	CHECK(buffer->size == kHeadersLength + kDataLength);
+	CHECK(buffer->segment_size == kSegmentSize);
+	CHECK((buffer->offload_flags & NET_BUFFER_CHECKSUM_VALID) != 0);
+
+	uint8* packet = (uint8*)malloc(buffer->size);
+	gBufferModule->read(buffer, 0, packet, buffer->size);
+	tcphdr& tcpHeader = *(tcphdr*)(packet + sizeof(ip));
+
+	CHECK(ntohs(((ip*)packet)->ip_len) == buffer->size);
+	CHECK(reference_checksum(packet, sizeof(ip)) == 0xffff);
+	CHECK(ntohl(tcpHeader.th_seq) == kSequence);
+	CHECK(tcpHeader.th_flags == (kFlagAcknowledge | kFlagPush));
+	CHECK(memcmp(packet + kHeadersLength, sData, kDataLength) == 0);
+
+	free(packet);
+	gBufferModule->free(buffer);
+
+	// segments that don't follow each other are not
+	buffer = create_packet(kSequence, sData, kSegmentSize, kFlagAcknowledge);
+	net_buffer* next = create_packet(kSequence + kSegmentSize + 1, sData,
+		kSegmentSize, kFlagAcknowledge);
+	CHECK(!coalesce_buffers(buffer, next));
+	gBufferModule->free(next);
+	gBufferModule->free(buffer);
+
+	// nor is anything appended to a segment with a PSH flag
+	buffer = create_packet(kSequence, sData, kSegmentSize,
+		kFlagAcknowledge | kFlagPush);
+	next = create_packet(kSequence + kSegmentSize, sData, kSegmentSize,
+		kFlagAcknowledge);
+	CHECK(!coalesce_buffers(buffer, next));
+	gBufferModule->free(next);
+	gBufferModule->free(buffer);
+
+	// nor are segments with a bad checksum
+	buffer = create_packet(kSequence, sData, kSegmentSize, kFlagAcknowledge);
+	next = create_packet(kSequence + kSegmentSize, sData, kSegmentSize,
+		kFlagAcknowledge);
+	uint8 byte = sData[0] ^ 0xff;
+	gBufferModule->write(next, kHeadersLength, &byte, 1);
+	CHECK(!coalesce_buffers(buffer, next));
+	CHECK(buffer->size == kHeadersLength + kSegmentSize);
+
+	gBufferModule->free(next);
+	gBufferModule->free(buffer);
+
+	// or a bad IP header checksum
+	buffer = create_packet(kSequence, sData, kSegmentSize, kFlagAcknowledge);
+	next = create_packet(kSequence + kSegmentSize, sData, kSegmentSize,
+		kFlagAcknowledge);
+	uint16 checksum = 0x1234;
+	gBufferModule->write(next, offsetof(ip, ip_sum), &checksum, 2);
+	CHECK(!coalesce_buffers(buffer, next));
+
+	gBufferModule->free(next);
+	gBufferModule->free(buffer);
+}
+
+
+static void
+test_round_trip()
+{
+	// what is cut on the sending side is put together again on receipt
+	net_buffer* buffer = create_packet(kSequence, sData, kDataLength,
+		kFlagAcknowledge | kFlagPush);
+	buffer->segment_size = kSegmentSize;
+
+	struct list segments;
+	CHECK(segment_buffer(buffer, kMTU, &segments) == B_OK);
+
+	net_buffer* coalesced = (net_buffer*)list_remove_head_item(&segments);
+	while (net_buffer* segment
+			= (net_buffer*)list_remove_head_item(&segments)) {
+		if (!coalesce_buffers(coalesced, segment)) {
+			CHECK(!"segment not coalesced");
+			gBufferModule->free(segment);
+		}
+	}
+
+	CHECK(coalesced->size == buffer->size);
+
+	uint8* original = (uint8*)malloc(buffer->size);
+	uint8* packet = (uint8*)malloc(buffer->size);
+	gBufferModule->read(buffer, 0, original, buffer->size);
+	gBufferModule->read(coalesced, 0, packet, buffer->size);
+
+	// all but the IP ID and the checksums must be equal
+	CHECK(memcmp(packet + kHeadersLength, original + kHeadersLength,
+		kDataLength) == 0);
+	CHECK(memcmp(packet + 12, original + 12, 8 + 16) == 0);
+	CHECK(checksums_valid(original, buffer->size));
+
+	free(original);
+	free(packet);
+	gBufferModule->free(coalesced);
+	gBufferModule->free(buffer);
+}
+
+
+int
+main()
+{
+	for (size_t i = 0; i < sizeof(sData); i++)
+		sData[i] = rand();
+
+	_add_builtin_module((module_info*)&gNetBufferModule);
+	get_module(NET_BUFFER_MODULE_NAME, (module_info**)&gBufferModule);
+
+	test_segmentation();
+	test_segmentation_mtu();
+	test_datagram_segmentation();
+	test_coalescing();
+	test_round_trip();
+
+	put_module(NET_BUFFER_MODULE_NAME);
+
+	if (sErrorCount > 0) {
+		fprintf(stderr, "FAILED\n");
+		return 1;
+	}
+
+	return 0;
+}
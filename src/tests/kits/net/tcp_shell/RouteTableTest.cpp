@@ -0,0 +1,376 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	Tests the route table of the stack against a walk of the route list,
+	and compares the speed of both with a table of 100000 routes.
+*/
+
+
+#include "route_table.h"
+
+#include <net/if.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <OS.h>
+
+#include <net_device.h>
+
+
+static const uint32 kBenchmarkRoutes = 100000;
+
+static net_device sDevices[2];
+static net_interface sInterfaces[2];
+static net_interface_address sAddresses[2];
+static int32 sErrorCount = 0;
+
+
+static void
+check(bool condition, const char* text, int line)
+{
+	if (condition)
+		return;
+
+	printf("line %d: \"%s\" failed\n", line, text);
+	sErrorCount++;
+}
+
+#define CHECK(condition) check(condition, #condition, __LINE__)
+
+
+// from routes.cpp, which is not part of the test
+
+
+net_route_private::net_route_private()
+{
+	destination = mask = gateway = NULL;
+}
+
+
+net_route_private::~net_route_private()
+{
+	free(destination);
+	free(mask);
+	free(gateway);
+}
+
+
+//	#pragma mark -
+
+
+static size_t
+key_length(int family)
+{
+	return family == AF_INET6 ? 16 : 4;
+}
+
+
+static uint8*
+address_key(sockaddr* address)
+{
+	if (address->sa_family == AF_INET6)
+		return (uint8*)&((sockaddr_in6*)address)->sin6_addr;
+
+	return (uint8*)&((sockaddr_in*)address)->sin_addr;
+}
+
+
+static sockaddr*
+create_address(int family, const uint8* key)
+{
+	size_t size = family == AF_INET6
+		? sizeof(sockaddr_in6) : sizeof(sockaddr_in);
+
+	sockaddr* address = (sockaddr*)calloc(1, size);
+	address->sa_len = size;
+	address->sa_family = family;
+	memcpy(address_key(address), key, key_length(family));
+
+	return address;
+}
+
+
+static void
+random_key(int family, uint8* key)
+{
+	for (size_t i = 0; i < key_length(family); i++)
+		key[i] = rand();
+}
+
+
+static void
+mask_key(uint8* key, uint32 length, size_t keyLength)
+{
+	for (size_t i = 0; i < keyLength; i++) {
+		if (length >= (i + 1) * 8)
+			continue;
+
+		key[i] &= length > i * 8 ? 0xff << (8 - length % 8) : 0;
+	}
+}
+
+
+static bool
+matches(const sockaddr* route, uint32 length, const uint8* key)
+{
+	uint8 masked[16];
+	size_t keyLength = key_length(route->sa_family);
+	memcpy(masked, key, keyLength);
+	mask_key(masked, length, keyLength);
+
+	return memcmp(masked, address_key((sockaddr*)route), keyLength) == 0;
+}
+
+
+/*!	Adds a route sorted by the length of its prefix, like add_route() does;
+	\a length is stored in the route's MTU for the reference lookup.
+*/
+static void
+add_route(RouteList& routes, int family, const uint8* _key, uint32 length,
+	int device)
+{
+	uint8 key[16];
+	memcpy(key, _key, key_length(family));
+	mask_key(key, length, key_length(family));
+
+	uint8 mask[16];
+	memset(mask, 0xff, sizeof(mask));
+	mask_key(mask, length, key_length(family));
+
+	net_route_private* route = new net_route_private;
+	route->destination = create_address(family, key);
+	route->mask = create_address(family, mask);
+	route->interface_address = &sAddresses[device];
+	route->mtu = length;
+
+	// search from the end, so that adding routes by decreasing prefix length
+	// is fast
+	net_route_private* after = routes.Tail();
+	while (after != NULL && after->mtu < length)
+		after = routes.GetPrevious(after);
+
+	routes.InsertAfter(after, route);
+}
+
+
+static void
+delete_routes(RouteList& routes)
+{
+	while (net_route_private* route = routes.RemoveHead())
+		delete route;
+}
+
+
+static net_route_private*
+reference_lookup(RouteList& routes, const uint8* key)
+{
+	net_route_private* candidate = NULL;
+
+	RouteList::Iterator iterator = routes.GetIterator();
+	while (net_route_private* route = iterator.Next()) {
+		if (!matches(route->destination, route->mtu, key))
+			continue;
+
+		if ((route->interface_address->interface->device->flags & IFF_LINK)
+				!= 0)
+			return route;
+
+		if (candidate == NULL)
+			candidate = route;
+	}
+
+	return candidate;
+}
+
+
+static void
+compare_lookups(RouteList& routes, int family, uint32 lookups)
+{
+	RouteTable table(family);
+	CHECK(table.Build(routes) == B_OK);
+
+	RouteList::Iterator iterator = routes.GetIterator();
+	for (uint32 i = 0; i < lookups; i++) {
+		// alternate between addresses within a route, and random ones
+		uint8 key[16];
+		random_key(family, key);
+
+		net_route_private* route = iterator.Next();
+		if (route == NULL)
+			iterator = routes.GetIterator();
+		else if ((i & 1) != 0) {
+			// an address within the network of the route
+			uint8 mask[16];
+			memset(mask, 0xff, sizeof(mask));
+			mask_key(mask, route->mtu, key_length(family));
+
+			const uint8* network = address_key(route->destination);
+			for (size_t j = 0; j < key_length(family); j++)
+				key[j] = (network[j] & mask[j]) | (key[j] & ~mask[j]);
+		}
+
+		sockaddr* address = create_address(family, key);
+		CHECK(table.Lookup(address) == reference_lookup(routes, key));
+		free(address);
+	}
+}
+
+
+//	#pragma mark -
+
+
+static void
+test_empty_table()
+{
+	RouteList routes;
+	RouteTable table(AF_INET);
+	CHECK(table.Build(routes) == B_OK);
+
+	uint8 key[4] = {10, 0, 0, 1};
+	sockaddr* address = create_address(AF_INET, key);
+	CHECK(table.Lookup(address) == NULL);
+	free(address);
+}
+
+
+static void
+test_link_fallback()
+{
+	RouteList routes;
+	uint8 any[4] = {0, 0, 0, 0};
+	uint8 network[4] = {192, 168, 0, 0};
+	uint8 host[4] = {192, 168, 1, 2};
+
+	// the more specific route goes through the device without a link
+	add_route(routes, AF_INET, any, 0, 0);
+	add_route(routes, AF_INET, network, 16, 1);
+	add_route(routes, AF_INET, network, 16, 0);
+
+	RouteTable table(AF_INET);
+	CHECK(table.Build(routes) == B_OK);
+
+	sockaddr* address = create_address(AF_INET, host);
+	net_route_private* route = table.Lookup(address);
+	CHECK(route != NULL && route->mtu == 16
+		&& route->interface_address == &sAddresses[0]);
+
+	// without any link, the most specific route is used
+	sDevices[0].flags &= ~IFF_LINK;
+	route = table.Lookup(address);
+	CHECK(route != NULL && route->mtu == 16
+		&& route->interface_address == &sAddresses[1]);
+	sDevices[0].flags |= IFF_LINK;
+
+	free(address);
+	delete_routes(routes);
+}
+
+
+static void
+test_random_routes(int family, uint32 count)
+{
+	RouteList routes;
+	uint32 bits = key_length(family) * 8;
+
+	for (uint32 i = 0; i < count; i++) {
+		uint8 key[16];
+		random_key(family, key);
+
+		// favor short prefixes, so that they nest
+		uint32 length = rand() % (bits + 1);
+		if ((i & 1) != 0)
+			length /= 2;
+
+		add_route(routes, family, key, length, rand() % 2);
+	}
+
+	compare_lookups(routes, family, 20000);
+	delete_routes(routes);
+}
+
+
+static void
+benchmark()
+{
+	RouteList routes;
+
+	// mostly /24 networks, as in a full routing table
+	for (uint32 length = 32; length >= 16; length--) {
+		uint32 count = length == 24
+			? kBenchmarkRoutes / 2 : kBenchmarkRoutes / 32;
+		for (uint32 i = 0; i < count; i++) {
+			uint8 key[4];
+			random_key(AF_INET, key);
+			add_route(routes, AF_INET, key, length, 0);
+		}
+	}
+
+	uint8 any[4] = {0, 0, 0, 0};
+	add_route(routes, AF_INET, any, 0, 0);
+
+	RouteTable* table = new RouteTable(AF_INET);
+	bigtime_t start = system_time();
+	CHECK(table->Build(routes) == B_OK);
+	bigtime_t buildTime = system_time() - start;
+
+	static const uint32 kLookups = 1000000;
+	sockaddr_in address;
+	memset(&address, 0, sizeof(address));
+	address.sin_len = sizeof(address);
+	address.sin_family = AF_INET;
+
+	uint32 found = 0;
+	start = system_time();
+	for (uint32 i = 0; i < kLookups; i++) {
+		address.sin_addr.s_addr = i * 2654435761U;
+		if (table->Lookup((sockaddr*)&address) != NULL)
+			found++;
+	}
+	bigtime_t tableTime = system_time() - start;
+	CHECK(found == kLookups);
+
+	static const uint32 kListLookups = 200;
+	start = system_time();
+	for (uint32 i = 0; i < kListLookups; i++) {
+		address.sin_addr.s_addr = i * 2654435761U;
+		reference_lookup(routes, (uint8*)&address.sin_addr);
+	}
+	bigtime_t listTime = system_time() - start;
+
+	printf("%" B_PRId32 " routes: built in %" B_PRId64 " ms, %.1f ns per "
+		"lookup (route list: %.1f us)\n", routes.Count(),
+		buildTime / 1000, tableTime * 1000.0 / kLookups,
+		1.0 * listTime / kListLookups);
+
+	delete table;
+	delete_routes(routes);
+}
+
+
+int
+main()
+{
+	for (int i = 0; i < 2; i++) {
+		sDevices[i].flags = IFF_UP | (i == 0 ? IFF_LINK : 0);
+		sInterfaces[i].device = &sDevices[i];
+		sAddresses[i].interface = &sInterfaces[i];
+	}
+
+	test_empty_table();
+	test_link_fallback();
+	test_random_routes(AF_INET, 2000);
+	test_random_routes(AF_INET6, 2000);
+	benchmark();
+
+	if (sErrorCount > 0) {
+		fprintf(stderr, "FAILED\n");
+		return 1;
+	}
+
+	return 0;
+}
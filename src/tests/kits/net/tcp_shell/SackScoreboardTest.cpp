@@ -0,0 +1,176 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+//!	Tests the SACK scoreboard and its time based loss detection.
+
+
+#include "SackScoreboard.h"
+
+#include <stdio.h>
+
+
+static int32 sErrorCount = 0;
+
+
+static void
+check(bool condition, const char* text, int line)
+{
+	if (condition)
+		return;
+
+	printf("line %d: \"%s\" failed\n", line, text);
+	sErrorCount++;
+}
+
+#define CHECK(condition) check(condition, #condition, __LINE__)
+
+
+static bool
+has_lost(const SackScoreboard& scoreboard)
+{
+	tcp_sequence start;
+	tcp_sequence end;
+	return scoreboard.GetLost(start, end);
+}
+
+
+static bool
+lost_range_is(const SackScoreboard& scoreboard, uint32 start, uint32 end)
+{
+	tcp_sequence lostStart;
+	tcp_sequence lostEnd;
+	return scoreboard.GetLost(lostStart, lostEnd)
+		&& lostStart == start && lostEnd == end;
+}
+
+
+static void
+test_loss_detection()
+{
+	SackScoreboard scoreboard;
+	bigtime_t timeout;
+
+	// ten segments, one each millisecond
+	for (uint32 i = 0; i < 10; i++)
+		scoreboard.SegmentSent(i * 1000, (i + 1) * 1000, i * 1000);
+	CHECK(scoreboard.InFlight() == 10000);
+
+	scoreboard.Acknowledge(2000, 50000);
+	CHECK(scoreboard.InFlight() == 8000);
+	CHECK(scoreboard.Delivered() == 2000);
+
+	// the third and fourth segment are missing
+	scoreboard.SelectiveAcknowledge(4000, 10000, 52000);
+	CHECK(scoreboard.InFlight() == 2000);
+	CHECK(scoreboard.Delivered() == 8000);
+
+	// The last segment took 43 ms, the reordering window is a quarter of
+	// that, so the third segment is lost at 2 + 43 + 10.75 ms.
+	CHECK(scoreboard.DetectLosses(52000, timeout) == 0);
+	CHECK(timeout == 3750);
+	CHECK(!has_lost(scoreboard));
+
+	CHECK(scoreboard.DetectLosses(56000, timeout) == 1);
+	CHECK(timeout == 750);
+	CHECK(scoreboard.InFlight() == 1000);
+	CHECK(lost_range_is(scoreboard, 2000, 3000));
+
+	// the retransmission is in flight again
+	scoreboard.SegmentSent(2000, 3000, 57000);
+	CHECK(scoreboard.InFlight() == 2000);
+
+	CHECK(scoreboard.DetectLosses(57000, timeout) == 1);
+	CHECK(lost_range_is(scoreboard, 3000, 4000));
+
+	scoreboard.Acknowledge(10000, 100000);
+	CHECK(scoreboard.Delivered() == 10000);
+	CHECK(scoreboard.IsEmpty());
+	CHECK(scoreboard.InFlight() == 0);
+}
+
+
+static void
+test_partial_blocks()
+{
+	SackScoreboard scoreboard;
+
+	scoreboard.SegmentSent(10000, 12000, 1000);
+	scoreboard.SelectiveAcknowledge(10500, 11000, 20000);
+	CHECK(scoreboard.InFlight() == 1500);
+
+	// blocks outside the data sent are ignored
+	scoreboard.SelectiveAcknowledge(12000, 13000, 20000);
+	CHECK(scoreboard.InFlight() == 1500);
+
+	scoreboard.Acknowledge(10200, 21000);
+	CHECK(scoreboard.InFlight() == 1300);
+
+	// a timeout forgets about the SACKed data
+	scoreboard.MarkAllLost();
+	CHECK(scoreboard.InFlight() == 0);
+	CHECK(lost_range_is(scoreboard, 10200, 10500));
+
+	scoreboard.SegmentSent(10200, 10500, 30000);
+	CHECK(lost_range_is(scoreboard, 10500, 11000));
+	CHECK(scoreboard.InFlight() == 300);
+
+	// a retransmission may span several segments, and new data
+	scoreboard.SegmentSent(10500, 12500, 31000);
+	CHECK(scoreboard.InFlight() == 2300);
+	CHECK(!has_lost(scoreboard));
+}
+
+
+static void
+test_many_segments()
+{
+	static const uint32 kCount = 2000;
+	SackScoreboard scoreboard;
+	bigtime_t timeout;
+
+	for (uint32 i = 0; i < kCount; i++)
+		scoreboard.SegmentSent(i * 100, (i + 1) * 100, i);
+
+	// every other segment arrives, the blocks come out of order, and do not
+	// end at segment boundaries
+	for (uint32 i = 1; i < kCount; i += 2) {
+		uint32 segment = (i * 7919) % kCount;
+		scoreboard.SelectiveAcknowledge(segment * 100, segment * 100 + 50,
+			10000);
+		scoreboard.SelectiveAcknowledge(segment * 100 + 50,
+			(segment + 1) * 100, 10000);
+	}
+	CHECK(scoreboard.DetectLosses(100000, timeout) == kCount / 2);
+	CHECK(scoreboard.InFlight() == 0);
+
+	// the lost segments are retransmitted in order
+	for (uint32 i = 0; i < kCount; i += 2) {
+		CHECK(lost_range_is(scoreboard, i * 100, (i + 1) * 100));
+		scoreboard.SegmentSent(i * 100, (i + 1) * 100, 100000 + i);
+	}
+	CHECK(!has_lost(scoreboard));
+	CHECK(scoreboard.InFlight() == kCount / 2 * 100);
+
+	scoreboard.Acknowledge(kCount * 100, 200000);
+	CHECK(scoreboard.IsEmpty());
+	CHECK(scoreboard.InFlight() == 0);
+}
+
+
+int
+main()
+{
+	test_loss_detection();
+	test_partial_blocks();
+	test_many_segments();
+
+	if (sErrorCount > 0) {
+		fprintf(stderr, "FAILED\n");
+		return 1;
+	}
+
+	return 0;
+}
@@ -29,7 +29,9 @@
 #include <Locker.h>
 
 #include <ctype.h>
+#include <deque>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <new>
 #include <set>
 #include <stdio.h>
@@ -44,6 +46,15 @@ struct context {
 	net_route	route;
 	bool		server;
 	thread_id	thread;
+
+	// link emulation
+	std::deque<bigtime_t> delivery;
+		// when the buffers in the list arrive
+	bigtime_t	link_free;
+	bigtime_t	queue_delay;
+	bigtime_t	max_queue_delay;
+	uint32		queued_packets;
+	uint32		link_drops;
 };
 
 struct cmd_entry {
@@ -98,6 +109,12 @@ static set<uint32> sReorderList;
 static bool sSimultaneousConnect = false;
 static bool sSimultaneousClose = false;
 static bool sServerActiveClose = false;
+static int64 sServerReceived = 0;
+static bool sBenchmarking = false;
+static uint32 sLinkRate = 0;
+	// bytes per second, 0 means unlimited
+static bigtime_t sLinkDelay = 0;
+static uint32 sLinkQueueSize = 0;
 
 static struct net_domain sDomain = {
 	"ipv4",
@@ -670,6 +687,7 @@ net_socket_module_info gNetSocketModule = {
 	NULL, // getsockopt,
 	NULL, // listen,
 	NULL, // receive,
+	NULL, // receive_multiple,
 	NULL, // send,
 	NULL, // setsockopt,
 	NULL, // shutdown,
@@ -721,7 +739,31 @@ datalink_send_data(struct net_route *route, net_buffer *buffer)
 	buffer->interface = &gInterface;
 
 	context->lock.Lock();
+
+	bigtime_t delivery = 0;
+	if (sLinkRate > 0) {
+		// a bottleneck link with a drop tail queue
+		bigtime_t now = system_time();
+		bigtime_t start = max_c(now, context->link_free);
+		if ((start - now) * sLinkRate / 1000000 + buffer->size
+				> sLinkQueueSize) {
+			context->link_drops++;
+			context->lock.Unlock();
+			gNetBufferModule.free(buffer);
+			return B_OK;
+		}
+
+		context->link_free = start
+			+ (bigtime_t)buffer->size * 1000000 / sLinkRate;
+		context->queue_delay += start - now;
+		context->max_queue_delay = max_c(context->max_queue_delay,
+			start - now);
+		context->queued_packets++;
+		delivery = context->link_free + sLinkDelay;
+	}
+
 	list_add_item(&context->list, buffer);
+	context->delivery.push_back(delivery);
 	context->lock.Unlock();
 
 	release_sem(context->wait_sem);
@@ -919,7 +961,7 @@ domain_receive_data(net_buffer *buffer)
 
 	bool drop = false;
 	if (sDropList.find(packetNumber) != sDropList.end()
-		|| (sRandomDrop > 0.0 && (1.0 * rand() / RAND_MAX) > sRandomDrop))
+		|| (sRandomDrop > 0.0 && (1.0 * rand() / RAND_MAX) < sRandomDrop))
 		drop = true;
 
 	if (!drop && (sRoundTripTime > 0 || sRandomRoundTrip || sIncreasingRoundTrip)) {
@@ -1006,6 +1048,23 @@ domain_receive_data(net_buffer *buffer)
 						printf(" <ts %lu:%lu>", option->timestamp.value, option->timestamp.reply);
 						length = 10;
 						break;
+					case TCP_OPTION_SACK_PERMITTED:
+						printf(" <sackOK>");
+						length = 2;
+						break;
+					case TCP_OPTION_SACK:
+						length = option->length;
+						if (length < 2)
+							length = size;
+						printf(" <sack");
+						for (uint32 i = 0; i < (length - 2) / sizeof(tcp_sack);
+								i++) {
+							printf(" %lu-%lu",
+								ntohl(option->sack[i].left_edge),
+								ntohl(option->sack[i].right_edge));
+						}
+						printf(">");
+						break;
 
 					default:
 						length = option->length;
@@ -1110,11 +1169,19 @@ receiving_thread(void* _data)
 			context->lock.Lock();
 			net_buffer* buffer = (net_buffer*)list_remove_head_item(
 				&context->list);
+			bigtime_t delivery = 0;
+			if (buffer != NULL) {
+				delivery = context->delivery.front();
+				context->delivery.pop_front();
+			}
 			context->lock.Unlock();
 
 			if (buffer == NULL)
 				break;
 
+			if (delivery > 0)
+				snooze_until(delivery, B_SYSTEM_TIMEBASE);
+
 			if (sSimultaneousConnect && context->server && is_syn(buffer)) {
 				// delay getting the SYN request, and connect as well
 				sockaddr_in address;
@@ -1134,10 +1201,10 @@ receiving_thread(void* _data)
 				close_protocol(gClientSocket->first_protocol);
 				sSimultaneousClose = false;
 			}
-			if ((sRandomReorder > 0.0
-					|| sReorderList.find(sPacketNumber) != sReorderList.end())
-				&& reorderBuffer == NULL
-				&& (1.0 * rand() / RAND_MAX) > sRandomReorder) {
+			if ((sReorderList.find(sPacketNumber) != sReorderList.end()
+					|| (sRandomReorder > 0.0
+						&& (1.0 * rand() / RAND_MAX) < sRandomReorder))
+				&& reorderBuffer == NULL) {
 				reorderBuffer = buffer;
 			} else {
 				if (sDomain.module->receive_data(buffer) < B_OK)
@@ -1177,7 +1244,9 @@ server_thread(void*)
 		ssize_t bytesRead;
 		while ((bytesRead = socket_recv(connectionSocket, buffer,
 				sizeof(buffer), 0)) > 0) {
-			printf("server: received %ld bytes\n", bytesRead);
+			atomic_add64(&sServerReceived, bytesRead);
+			if (!sBenchmarking)
+				printf("server: received %ld bytes\n", bytesRead);
 
 			if (sServerActiveClose) {
 				printf("server: active close\n");
@@ -1242,6 +1311,11 @@ setup_context(struct context& context, bool server)
 		// backpointer to the context
 	context.route.mtu = 1500;
 	context.server = server;
+	context.link_free = 0;
+	context.queue_delay = 0;
+	context.max_queue_delay = 0;
+	context.queued_packets = 0;
+	context.link_drops = 0;
 	context.wait_sem = create_sem(0, "receive wait");
 
 	context.thread = spawn_thread(receiving_thread,
@@ -1316,23 +1390,33 @@ do_connect(int argc, char** argv)
 }
 
 
+static bool
+parse_size(const char* string, size_t& _size)
+{
+	char *unit;
+	_size = strtoul(string, &unit, 0);
+	if (unit != NULL && unit[0]) {
+		if (unit[0] == 'k' || unit[0] == 'K')
+			_size *= 1024;
+		else if (unit[0] == 'm' || unit[0] == 'M')
+			_size *= 1024 * 1024;
+		else {
+			fprintf(stderr, "unknown unit specified!\n");
+			return false;
+		}
+	}
+
+	return true;
+}
+
+
 static void
 do_send(int argc, char** argv)
 {
 	size_t size = 1024;
 	if (argc > 1 && isdigit(argv[1][0])) {
-		char *unit;
-		size = strtoul(argv[1], &unit, 0);
-		if (unit != NULL && unit[0]) {
-			if (unit[0] == 'k' || unit[0] == 'K')
-				size *= 1024;
-			else if (unit[0] == 'm' || unit[0] == 'M')
-				size *= 1024 * 1024;
-			else {
-				fprintf(stderr, "unknown unit specified!\n");
-				return;
-			}
-		}
+		if (!parse_size(argv[1], size))
+			return;
 	} else if (argc > 1) {
 		fprintf(stderr, "invalid args!\n");
 		return;
@@ -1529,6 +1613,145 @@ do_round_trip_time(int argc, char** argv)
 }
 
 
+static void
+do_link(int argc, char** argv)
+{
+	if (argc == 2 && !strcmp(argv[1], "off")) {
+		sLinkRate = 0;
+		printf("Link emulation is off.\n");
+		return;
+	}
+
+	if (argc < 3 || !isdigit(argv[1][0]) || !isdigit(argv[2][0])) {
+		if (sLinkRate > 0) {
+			printf("Current link: %lu kbit/s, %g ms, %lu bytes queue\n",
+				sLinkRate * 8 / 1000, sLinkDelay / 1000.0, sLinkQueueSize);
+		}
+		puts("usage: link <rate in kbit/s> <delay in ms> [<queue in packets>]\n"
+			"   or: link off\n\n"
+			"Emulates a bottleneck link with a drop tail queue in each "
+			"direction;\nthe delay is added once per direction, the queue "
+			"defaults to 100 packets.");
+		return;
+	}
+
+	sLinkRate = strtoul(argv[1], NULL, 0) * 1000 / 8;
+	sLinkDelay = 1000LL * strtoul(argv[2], NULL, 0);
+	sLinkQueueSize = (argc > 3 ? strtoul(argv[3], NULL, 0) : 100) * 1500;
+}
+
+
+static bool
+set_congestion_control(const char* name)
+{
+	status_t status = gTCPModule->setsockopt(gClientSocket->first_protocol,
+		IPPROTO_TCP, TCP_CONGESTION, name, strlen(name));
+	if (status != B_OK) {
+		fprintf(stderr, "tcp_tester: cannot use \"%s\": %s\n", name,
+			strerror(status));
+		return false;
+	}
+
+	return true;
+}
+
+
+static void
+do_congestion_control(int argc, char** argv)
+{
+	if (argc > 1 && !set_congestion_control(argv[1]))
+		return;
+
+	char name[TCP_CA_NAME_MAX];
+	int length = sizeof(name);
+	if (gTCPModule->getsockopt(gClientSocket->first_protocol, IPPROTO_TCP,
+			TCP_CONGESTION, name, &length) == B_OK)
+		printf("Congestion control: %s\n", name);
+}
+
+
+/*!	Sends the given amount of data with each of the congestion control
+	algorithms in turn, and reports the throughput, and how long the packets
+	waited in the queue of the emulated link.
+*/
+static void
+do_bench(int argc, char** argv)
+{
+	size_t size;
+	if (argc < 2 || !isdigit(argv[1][0])) {
+		puts("usage: bench <size> [<congestion control>...]\n\n"
+			"Connect first; use \"link\" to set up a bottleneck. The window is "
+			"limited\nby the socket buffers of 64 kB.");
+		return;
+	}
+	if (!parse_size(argv[1], size))
+		return;
+
+	if (gClientSocket->peer.ss_len == 0) {
+		fprintf(stderr, "not connected!\n");
+		return;
+	}
+
+	const size_t kChunkSize = 65536;
+	char* buffer = (char*)malloc(kChunkSize);
+	if (buffer == NULL) {
+		fprintf(stderr, "not enough memory!\n");
+		return;
+	}
+	memset(buffer, 'b', kChunkSize);
+
+	bool tcpDump = sTCPDump;
+	sTCPDump = false;
+	sBenchmarking = true;
+
+	for (int i = 2; i < argc || i == 2; i++) {
+		if (i < argc && !set_congestion_control(argv[i]))
+			continue;
+
+		sServerContext.lock.Lock();
+		sServerContext.queue_delay = 0;
+		sServerContext.max_queue_delay = 0;
+		sServerContext.queued_packets = 0;
+		sServerContext.link_drops = 0;
+		sServerContext.lock.Unlock();
+
+		int64 target = atomic_get64(&sServerReceived) + size;
+		bigtime_t start = system_time();
+
+		for (size_t sent = 0; sent < size; sent += kChunkSize) {
+			ssize_t bytesWritten = socket_send(gClientSocket, buffer,
+				min_c(kChunkSize, size - sent), 0);
+			if (bytesWritten < B_OK) {
+				fprintf(stderr, "failed sending buffer: %s\n",
+					strerror(bytesWritten));
+				break;
+			}
+		}
+
+		while (atomic_get64(&sServerReceived) < target
+			&& system_time() - start < 300000000LL) {
+			snooze(1000);
+		}
+
+		bigtime_t elapsed = system_time() - start;
+
+		sServerContext.lock.Lock();
+		uint32 packets = max_c(sServerContext.queued_packets, 1);
+		printf("%-8s %9.1f kB/s, queue delay %6.1f ms (max %6.1f ms), "
+			"%lu drops\n", i < argc ? argv[i] : "default",
+			size * 1000000.0 / elapsed / 1024,
+			sServerContext.queue_delay / 1000.0 / packets,
+			sServerContext.max_queue_delay / 1000.0,
+			sServerContext.link_drops);
+		sServerContext.lock.Unlock();
+	}
+
+	sBenchmarking = false;
+	sTCPDump = tcpDump;
+	free(buffer);
+}
+
+
 static void
 do_dprintf(int argc, char** argv)
 {
@@ -1550,6 +1773,9 @@ static cmd_entry sBuiltinCommands[] = {
 	{"reorder", do_reorder, "Lets you reorder packets during transfer"},
 	{"help", do_help, "prints this help text"},
 	{"rtt", do_round_trip_time, "Specifies the round trip time"},
+	{"link", do_link, "Emulates a bottleneck link"},
+	{"cc", do_congestion_control, "Shows or sets the congestion control"},
+	{"bench", do_bench, "Compares the congestion control algorithms"},
 	{"quit", NULL, "exits the application"},
 	{NULL, NULL, NULL},
 };
@@ -0,0 +1,182 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	Measures the combined throughput of one up to the given number of TCP
+	streams over the loopback interface. As the flows are spread over the
+	receive queues of the interface, the throughput should grow with the
+	number of streams until all CPUs are busy.
+*/
+
+
+#include <errno.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <OS.h>
+
+
+static const size_t kChunkSize = 65536;
+
+static sockaddr_in sServerAddress;
+static int sListenerSocket;
+static volatile bool sQuit;
+static int32 sErrorCount;
+
+
+static void*
+receiver_thread(void* _fd)
+{
+	int fd = (int)(addr_t)_fd;
+	char* buffer = new char[kChunkSize];
+
+	while (read(fd, buffer, kChunkSize) > 0)
+		;
+
+	delete[] buffer;
+	close(fd);
+	return NULL;
+}
+
+
+static void*
+server_thread(void*)
+{
+	while (true) {
+		int fd = accept(sListenerSocket, NULL, NULL);
+		if (fd < 0) {
+			if (errno == EINTR)
+				continue;
+			break;
+		}
+
+		pthread_t thread;
+		if (pthread_create(&thread, NULL, receiver_thread,
+				(void*)(addr_t)fd) != 0) {
+			close(fd);
+			continue;
+		}
+		pthread_detach(thread);
+	}
+
+	return NULL;
+}
+
+
+static void*
+sender_thread(void* _bytes)
+{
+	int64* bytes = (int64*)_bytes;
+	char* buffer = new char[kChunkSize];
+	memset(buffer, 's', kChunkSize);
+
+	int fd = socket(AF_INET, SOCK_STREAM, 0);
+	if (fd < 0
+		|| connect(fd, (sockaddr*)&sServerAddress, sizeof(sServerAddress))
+			!= 0) {
+		atomic_add(&sErrorCount, 1);
+		if (fd >= 0)
+			close(fd);
+		delete[] buffer;
+		return NULL;
+	}
+
+	while (!sQuit) {
+		ssize_t bytesWritten = write(fd, buffer, kChunkSize);
+		if (bytesWritten <= 0) {
+			atomic_add(&sErrorCount, 1);
+			break;
+		}
+
+		*bytes += bytesWritten;
+	}
+
+	close(fd);
+	delete[] buffer;
+	return NULL;
+}
+
+
+int
+main(int argc, const char* const* argv)
+{
+	system_info info;
+	get_system_info(&info);
+
+	int maxStreams = argc > 1 ? atoi(argv[1]) : info.cpu_count;
+	int seconds = argc > 2 ? atoi(argv[2]) : 3;
+	if (maxStreams <= 0 || seconds <= 0) {
+		fprintf(stderr, "usage: %s [<max streams>] [<seconds per step>]\n",
+			argv[0]);
+		exit(1);
+	}
+
+	sListenerSocket = socket(AF_INET, SOCK_STREAM, 0);
+	if (sListenerSocket < 0) {
+		fprintf(stderr, "failed to create listener socket: %s\n",
+			strerror(errno));
+		exit(1);
+	}
+
+	memset(&sServerAddress, 0, sizeof(sServerAddress));
+	sServerAddress.sin_len = sizeof(sServerAddress);
+	sServerAddress.sin_family = AF_INET;
+	sServerAddress.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	socklen_t addressLength = sizeof(sServerAddress);
+
+	if (bind(sListenerSocket, (sockaddr*)&sServerAddress, addressLength) < 0
+		|| getsockname(sListenerSocket, (sockaddr*)&sServerAddress,
+			&addressLength) < 0
+		|| listen(sListenerSocket, SOMAXCONN) < 0) {
+		fprintf(stderr, "failed to set up listener socket: %s\n",
+			strerror(errno));
+		exit(1);
+	}
+
+	pthread_t serverThread;
+	if (pthread_create(&serverThread, NULL, server_thread, NULL) != 0) {
+		fprintf(stderr, "failed to start server thread\n");
+		exit(1);
+	}
+	pthread_detach(serverThread);
+
+	pthread_t* threads = new pthread_t[maxStreams];
+	int64* bytes = new int64[maxStreams];
+
+	printf("streams       MB/s  errors\n");
+
+	for (int count = 1; count <= maxStreams; count++) {
+		sQuit = false;
+		sErrorCount = 0;
+
+		for (int i = 0; i < count; i++) {
+			bytes[i] = 0;
+			pthread_create(&threads[i], NULL, sender_thread, &bytes[i]);
+		}
+
+		snooze(seconds * 1000000LL);
+		sQuit = true;
+
+		int64 total = 0;
+		for (int i = 0; i < count; i++) {
+			pthread_join(threads[i], NULL);
+			total += bytes[i];
+		}
+
+		printf("%7d  %9.1f  %6" B_PRId32 "\n", count,
+			total / 1048576.0 / seconds, sErrorCount);
+	}
+
+	delete[] threads;
+	delete[] bytes;
+
+	close(sListenerSocket);
+	return 0;
+}
@@ -0,0 +1,373 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	Tests that memory sent with MSG_ZEROCOPY stays intact until it has been
+	sent, no matter what the team does with it in the meantime: forking
+	and writing to it in the child, deleting or resizing the area, or
+	exiting. The receiver only reads once the sender is done with its
+	buffer, so that the sends are still pending at that time.
+*/
+
+
+#include <errno.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <OS.h>
+
+
+static const size_t kSize = 8 * B_PAGE_SIZE;
+
+static int sErrorCount;
+
+
+static void
+check(bool condition, const char* test, const char* what)
+{
+	if (condition)
+		return;
+
+	fprintf(stderr, "%s: %s failed: %s\n", test, what, strerror(errno));
+	sErrorCount++;
+}
+
+
+static void
+fill(uint8* buffer, uint8 seed)
+{
+	for (size_t i = 0; i < kSize; i++)
+		buffer[i] = (uint8)(i * 7 + seed);
+}
+
+
+static void
+connect_sockets(int& sender, int& receiver)
+{
+	int listener = socket(AF_INET, SOCK_STREAM, 0);
+
+	sockaddr_in address;
+	memset(&address, 0, sizeof(address));
+	address.sin_len = sizeof(address);
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	socklen_t addressLength = sizeof(address);
+
+	if (listener < 0
+		|| bind(listener, (sockaddr*)&address, addressLength) != 0
+		|| getsockname(listener, (sockaddr*)&address, &addressLength) != 0
+		|| listen(listener, 1) != 0) {
+		fprintf(stderr, "failed to set up listener: %s\n", strerror(errno));
+		exit(1);
+	}
+
+	sender = socket(AF_INET, SOCK_STREAM, 0);
+	if (sender < 0
+		|| connect(sender, (sockaddr*)&address, addressLength) != 0
+		|| (receiver = accept(listener, NULL, NULL)) < 0) {
+		fprintf(stderr, "failed to connect: %s\n", strerror(errno));
+		exit(1);
+	}
+
+	close(listener);
+
+	int32 enable = 1;
+	if (setsockopt(sender, SOL_SOCKET, SO_ZEROCOPY, &enable, sizeof(enable))
+			!= 0) {
+		fprintf(stderr, "SO_ZEROCOPY is not supported: %s\n",
+			strerror(errno));
+		exit(1);
+	}
+}
+
+
+static area_id
+create_buffer(uint8** _buffer, uint8 seed)
+{
+	area_id area = create_area("zero copy buffer", (void**)_buffer,
+		B_ANY_ADDRESS, kSize, B_NO_LOCK, B_READ_AREA | B_WRITE_AREA);
+	if (area < 0) {
+		fprintf(stderr, "failed to create area: %s\n", strerror(area));
+		exit(1);
+	}
+
+	fill(*_buffer, seed);
+	return area;
+}
+
+
+/*!	Reads \a kSize bytes from \a fd, and compares them against the pattern
+	that fill() wrote with \a seed. If the team wrote to the buffer while it
+	was being sent, each byte may also come from its \a newSeed pattern.
+*/
+static void
+receive_and_verify(int fd, uint8 seed, const char* test, int newSeed = -1)
+{
+	uint8* expected = new uint8[kSize];
+	uint8* received = new uint8[kSize];
+	fill(expected, seed);
+
+	size_t bytesRead = 0;
+	while (bytesRead < kSize) {
+		ssize_t bytes = read(fd, received + bytesRead, kSize - bytesRead);
+		if (bytes <= 0)
+			break;
+		bytesRead += bytes;
+	}
+
+	check(bytesRead == kSize, test, "read");
+
+	bool valid = true;
+	for (size_t i = 0; i < bytesRead; i++) {
+		if (received[i] != expected[i]
+			&& (newSeed < 0 || received[i] != (uint8)(i * 7 + newSeed))) {
+			valid = false;
+			break;
+		}
+	}
+	check(valid, test, "received data");
+
+	delete[] expected;
+	delete[] received;
+}
+
+
+/*!	Waits until the send buffers of \a count sends can be reused again.
+*/
+static void
+wait_for_notifications(int fd, int32 count, const char* test)
+{
+	while (count > 0) {
+		fd_set errorSet;
+		FD_ZERO(&errorSet);
+		FD_SET(fd, &errorSet);
+		if (select(fd + 1, NULL, NULL, &errorSet, NULL) < 0) {
+			check(false, test, "select");
+			return;
+		}
+
+		char control[CMSG_SPACE(sizeof(zerocopy_notification))];
+		msghdr message;
+		memset(&message, 0, sizeof(message));
+		message.msg_control = control;
+		message.msg_controllen = sizeof(control);
+
+		if (recvmsg(fd, &message, MSG_ERRQUEUE | MSG_DONTWAIT) < 0) {
+			if (errno == EAGAIN || errno == EWOULDBLOCK)
+				continue;
+			check(false, test, "notification");
+			return;
+		}
+
+		cmsghdr* header = CMSG_FIRSTHDR(&message);
+		if (header == NULL || header->cmsg_type != SCM_ZEROCOPY) {
+			check(false, test, "notification header");
+			return;
+		}
+
+		zerocopy_notification notification;
+		memcpy(&notification, CMSG_DATA(header), sizeof(notification));
+		count -= notification.zc_last - notification.zc_first + 1;
+	}
+}
+
+
+static void
+send_buffer(int fd, const uint8* buffer, const char* test)
+{
+	check(send(fd, buffer, kSize, MSG_ZEROCOPY) == (ssize_t)kSize, test,
+		"send");
+}
+
+
+//	#pragma mark - tests
+
+
+static void
+test_fork_child_writes(int sender, int receiver)
+{
+	const char* test = "fork, child writes";
+
+	uint8* buffer;
+	area_id area = create_buffer(&buffer, 1);
+	send_buffer(sender, buffer, test);
+
+	pid_t child = fork();
+	if (child == 0) {
+		memset(buffer, 0xff, kSize);
+		_exit(0);
+	}
+	check(child > 0, test, "fork");
+	waitpid(child, NULL, 0);
+
+	receive_and_verify(receiver, 1, test);
+	wait_for_notifications(sender, 1, test);
+	delete_area(area);
+}
+
+
+/*!	The pages of the buffer belong to the cache the child shares with its
+	parent when they are sent. The parent then writes to its buffer, which
+	it shouldn't do before the notification, and the child exits, so that
+	the caches are merged. The data sent may be either version, but the
+	pages must not be freed while they are still being sent.
+*/
+static void
+test_send_after_fork(int sender, int receiver)
+{
+	const char* test = "send after fork";
+
+	uint8* buffer;
+	area_id area = create_buffer(&buffer, 2);
+
+	int pipes[2];
+	check(pipe(pipes) == 0, test, "pipe");
+
+	pid_t child = fork();
+	if (child == 0) {
+		char dummy;
+		read(pipes[0], &dummy, 1);
+		_exit(0);
+	}
+	check(child > 0, test, "fork");
+
+	send_buffer(sender, buffer, test);
+	fill(buffer, 3);
+
+	write(pipes[1], "", 1);
+	waitpid(child, NULL, 0);
+	close(pipes[0]);
+	close(pipes[1]);
+
+	// reuse the memory the child's pages may have been freed to
+	uint8* other;
+	area_id otherArea = create_buffer(&other, 4);
+
+	receive_and_verify(receiver, 2, test, 3);
+	wait_for_notifications(sender, 1, test);
+	delete_area(otherArea);
+	delete_area(area);
+}
+
+
+static void
+test_delete_area(int sender, int receiver)
+{
+	const char* test = "delete area";
+
+	uint8* buffer;
+	area_id area = create_buffer(&buffer, 5);
+	send_buffer(sender, buffer, test);
+	check(delete_area(area) == B_OK, test, "delete_area");
+
+	uint8* other;
+	area_id otherArea = create_buffer(&other, 6);
+
+	receive_and_verify(receiver, 5, test);
+	wait_for_notifications(sender, 1, test);
+	delete_area(otherArea);
+}
+
+
+struct receive_args {
+	int			fd;
+	uint8		seed;
+	const char*	test;
+};
+
+
+static void*
+receiver_thread(void* _args)
+{
+	receive_args* args = (receive_args*)_args;
+	snooze(100000);
+	receive_and_verify(args->fd, args->seed, args->test);
+	return NULL;
+}
+
+
+/*!	Growing the area may fail while the data is pending, shrinking it has
+	to wait until it has been sent.
+*/
+static void
+test_resize_area(int sender, int receiver)
+{
+	const char* test = "resize area";
+
+	uint8* buffer;
+	area_id area = create_buffer(&buffer, 7);
+	send_buffer(sender, buffer, test);
+
+	if (resize_area(area, 2 * kSize) == B_OK)
+		memset(buffer + kSize, 0xff, kSize);
+
+	receive_args args = { receiver, 7, test };
+	pthread_t thread;
+	check(pthread_create(&thread, NULL, receiver_thread, &args) == 0, test,
+		"pthread_create");
+
+	check(resize_area(area, B_PAGE_SIZE) == B_OK, test, "shrink");
+	pthread_join(thread, NULL);
+
+	wait_for_notifications(sender, 1, test);
+	delete_area(area);
+}
+
+
+static void
+test_child_exits(int sender, int receiver)
+{
+	const char* test = "child exits";
+
+	pid_t child = fork();
+	if (child == 0) {
+		uint8* buffer;
+		create_buffer(&buffer, 8);
+		send(sender, buffer, kSize, MSG_ZEROCOPY);
+		_exit(0);
+	}
+	check(child > 0, test, "fork");
+	waitpid(child, NULL, 0);
+
+	uint8* other;
+	area_id otherArea = create_buffer(&other, 9);
+
+	receive_and_verify(receiver, 8, test);
+	wait_for_notifications(sender, 1, test);
+	delete_area(otherArea);
+}
+
+
+int
+main()
+{
+	int sender;
+	int receiver;
+	connect_sockets(sender, receiver);
+
+	test_fork_child_writes(sender, receiver);
+	test_send_after_fork(sender, receiver);
+	test_delete_area(sender, receiver);
+	test_resize_area(sender, receiver);
+	test_child_exits(sender, receiver);
+
+	close(sender);
+	close(receiver);
+
+	if (sErrorCount != 0) {
+		fprintf(stderr, "%d checks FAILED\n", sErrorCount);
+		return 1;
+	}
+
+	printf("All tests passed.\n");
+	return 0;
+}
@@ -0,0 +1,248 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	Compares the throughput of a TCP stream over the loopback interface when
+	sending with and without MSG_ZEROCOPY, and the CPU time the sender needs
+	for it. A buffer sent without copying is only reused once its
+	notification has been received. Over loopback, the data is still copied
+	once when it is delivered, so only the copy on send is saved.
+*/
+
+
+#include <errno.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <OS.h>
+
+
+static const int kBufferCount = 8;
+
+static sockaddr_in sServerAddress;
+static int sListenerSocket;
+static size_t sChunkSize = 1024 * 1024;
+
+
+static void*
+receiver_thread(void*)
+{
+	int fd = accept(sListenerSocket, NULL, NULL);
+	if (fd < 0)
+		return NULL;
+
+	char* buffer = new char[sChunkSize];
+
+	while (read(fd, buffer, sChunkSize) > 0)
+		;
+
+	delete[] buffer;
+	close(fd);
+	return NULL;
+}
+
+
+/*!	Receives the pending notifications, waiting for one if \a wait is
+	\c true. Returns the number of sends that completed, or -1 on error.
+*/
+static int32
+receive_notifications(int fd, bool wait, int32& copied)
+{
+	int32 completed = 0;
+
+	while (true) {
+		if (wait && completed == 0) {
+			fd_set errorSet;
+			FD_ZERO(&errorSet);
+			FD_SET(fd, &errorSet);
+			if (select(fd + 1, NULL, NULL, &errorSet, NULL) < 0)
+				return -1;
+		}
+
+		char control[CMSG_SPACE(sizeof(zerocopy_notification))];
+		msghdr message;
+		memset(&message, 0, sizeof(message));
+		message.msg_control = control;
+		message.msg_controllen = sizeof(control);
+
+		if (recvmsg(fd, &message, MSG_ERRQUEUE | MSG_DONTWAIT) < 0) {
+			if (errno == EAGAIN || errno == EWOULDBLOCK) {
+				if (!wait || completed > 0)
+					return completed;
+				continue;
+			}
+			return -1;
+		}
+
+		cmsghdr* header = CMSG_FIRSTHDR(&message);
+		if (header == NULL || header->cmsg_level != SOL_SOCKET
+			|| header->cmsg_type != SCM_ZEROCOPY)
+			return -1;
+
+		zerocopy_notification notification;
+		memcpy(&notification, CMSG_DATA(header), sizeof(notification));
+
+		int32 count = notification.zc_last - notification.zc_first + 1;
+		completed += count;
+		if ((notification.zc_flags & ZEROCOPY_COPIED) != 0)
+			copied += count;
+	}
+}
+
+
+static bool
+run(bool zeroCopy, int seconds)
+{
+	pthread_t receiverThread;
+	if (pthread_create(&receiverThread, NULL, receiver_thread, NULL) != 0)
+		return false;
+
+	int fd = socket(AF_INET, SOCK_STREAM, 0);
+	if (fd < 0
+		|| connect(fd, (sockaddr*)&sServerAddress, sizeof(sServerAddress))
+			!= 0) {
+		fprintf(stderr, "failed to connect: %s\n", strerror(errno));
+		exit(1);
+	}
+
+	int32 enable = 1;
+	if (zeroCopy
+		&& setsockopt(fd, SOL_SOCKET, SO_ZEROCOPY, &enable, sizeof(enable))
+			!= 0) {
+		fprintf(stderr, "SO_ZEROCOPY is not supported: %s\n",
+			strerror(errno));
+		exit(1);
+	}
+
+	char* buffers[kBufferCount];
+	for (int i = 0; i < kBufferCount; i++) {
+		buffers[i] = new char[sChunkSize];
+		memset(buffers[i], 'a' + i, sChunkSize);
+	}
+
+	thread_info info;
+	get_thread_info(find_thread(NULL), &info);
+	bigtime_t startCPUTime = info.user_time + info.kernel_time;
+
+	bigtime_t start = system_time();
+	bigtime_t end = start + seconds * 1000000LL;
+	int64 bytes = 0;
+	int32 sends = 0;
+	int32 completed = 0;
+	int32 copied = 0;
+	bool success = true;
+
+	while (system_time() < end) {
+		if (zeroCopy) {
+			// wait until the buffer we want to use is no longer in use
+			int32 count = receive_notifications(fd,
+				sends - completed >= kBufferCount, copied);
+			if (count < 0) {
+				fprintf(stderr, "failed to receive notifications: %s\n",
+					strerror(errno));
+				success = false;
+				break;
+			}
+			completed += count;
+		}
+
+		ssize_t bytesWritten = send(fd, buffers[sends % kBufferCount],
+			sChunkSize, zeroCopy ? MSG_ZEROCOPY : 0);
+		if (bytesWritten <= 0) {
+			fprintf(stderr, "failed to send: %s\n", strerror(errno));
+			success = false;
+			break;
+		}
+
+		bytes += bytesWritten;
+		sends++;
+	}
+
+	bigtime_t elapsed = system_time() - start;
+	get_thread_info(find_thread(NULL), &info);
+	bigtime_t cpuTime = info.user_time + info.kernel_time - startCPUTime;
+
+	while (zeroCopy && success && completed < sends) {
+		int32 count = receive_notifications(fd, true, copied);
+		if (count < 0) {
+			success = false;
+			break;
+		}
+		completed += count;
+	}
+
+	close(fd);
+	pthread_join(receiverThread, NULL);
+
+	for (int i = 0; i < kBufferCount; i++)
+		delete[] buffers[i];
+
+	printf("%-9s  %9.1f  %12.1f", zeroCopy ? "zero copy" : "copy",
+		bytes / 1048576.0 * 1000000 / elapsed,
+		1.0 * cpuTime / (bytes / 1048576.0));
+	if (zeroCopy) {
+		printf("  %" B_PRId32 " of %" B_PRId32 " sends copied", copied,
+			sends);
+	}
+	printf("\n");
+
+	return success;
+}
+
+
+int
+main(int argc, const char* const* argv)
+{
+	int seconds = argc > 1 ? atoi(argv[1]) : 3;
+	if (argc > 2)
+		sChunkSize = strtoul(argv[2], NULL, 0);
+	if (seconds <= 0 || sChunkSize == 0) {
+		fprintf(stderr, "usage: %s [<seconds>] [<bytes per send>]\n",
+			argv[0]);
+		exit(1);
+	}
+
+	sListenerSocket = socket(AF_INET, SOCK_STREAM, 0);
+	if (sListenerSocket < 0) {
+		fprintf(stderr, "failed to create listener socket: %s\n",
+			strerror(errno));
+		exit(1);
+	}
+
+	memset(&sServerAddress, 0, sizeof(sServerAddress));
+	sServerAddress.sin_len = sizeof(sServerAddress);
+	sServerAddress.sin_family = AF_INET;
+	sServerAddress.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	socklen_t addressLength = sizeof(sServerAddress);
+
+	if (bind(sListenerSocket, (sockaddr*)&sServerAddress, addressLength) < 0
+		|| getsockname(sListenerSocket, (sockaddr*)&sServerAddress,
+			&addressLength) < 0
+		|| listen(sListenerSocket, SOMAXCONN) < 0) {
+		fprintf(stderr, "failed to set up listener socket: %s\n",
+			strerror(errno));
+		exit(1);
+	}
+
+	printf("mode            MB/s  CPU us/MB\n");
+
+	bool success = run(false, seconds);
+	success &= run(true, seconds);
+
+	close(sListenerSocket);
+
+	if (!success) {
+		fprintf(stderr, "FAILED\n");
+		return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,237 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	Measures how many UDP datagrams per second can be sent over the loopback
+	interface with one syscall per datagram, with sendmmsg()/recvmmsg(), and
+	with UDP_SEGMENT.
+*/
+
+
+#include <errno.h>
+#include <netinet/in.h>
+#include <netinet/udp.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <OS.h>
+
+
+enum send_mode {
+	SEND_SINGLE,
+	SEND_BATCHED,
+	SEND_SEGMENTED
+};
+
+static const unsigned int kBatchSize = 32;
+
+static sockaddr_in sReceiverAddress;
+static int sReceiverSocket;
+static size_t sDatagramSize = 64;
+static volatile bool sDone;
+static int64 sReceived;
+
+
+static void*
+receiver_thread(void* _batched)
+{
+	bool batched = _batched != NULL;
+	char* buffer = new char[kBatchSize * sDatagramSize];
+
+	iovec vecs[kBatchSize];
+	mmsghdr messages[kBatchSize];
+	memset(messages, 0, sizeof(messages));
+	for (unsigned int i = 0; i < kBatchSize; i++) {
+		vecs[i].iov_base = buffer + i * sDatagramSize;
+		vecs[i].iov_len = sDatagramSize;
+		messages[i].msg_hdr.msg_iov = &vecs[i];
+		messages[i].msg_hdr.msg_iovlen = 1;
+	}
+
+	while (true) {
+		int count = 1;
+		if (batched) {
+			count = recvmmsg(sReceiverSocket, messages, kBatchSize,
+				MSG_WAITFORONE, NULL);
+		} else if (recv(sReceiverSocket, buffer, sDatagramSize, 0) < 0)
+			count = -1;
+
+		if (count < 0) {
+			if (sDone)
+				break;
+			continue;
+		}
+
+		sReceived += count;
+	}
+
+	delete[] buffer;
+	return NULL;
+}
+
+
+static int
+send_datagrams(int fd, send_mode mode, char* buffer, mmsghdr* messages)
+{
+	switch (mode) {
+		case SEND_SINGLE:
+			return send(fd, buffer, sDatagramSize, 0) < 0 ? -1 : 1;
+
+		case SEND_BATCHED:
+			return sendmmsg(fd, messages, kBatchSize, 0);
+
+		case SEND_SEGMENTED:
+		{
+			ssize_t bytesSent = send(fd, buffer, kBatchSize * sDatagramSize,
+				0);
+			return bytesSent < 0 ? -1 : bytesSent / sDatagramSize;
+		}
+	}
+
+	return -1;
+}
+
+
+static bool
+run(send_mode mode, int seconds)
+{
+	static const char* const kModeNames[] = {
+		"single", "sendmmsg", "UDP_SEGMENT"
+	};
+
+	sDone = false;
+	sReceived = 0;
+
+	pthread_t receiverThread;
+	if (pthread_create(&receiverThread, NULL, receiver_thread,
+			mode != SEND_SINGLE ? (void*)1 : NULL) != 0)
+		return false;
+
+	int fd = socket(AF_INET, SOCK_DGRAM, 0);
+	if (fd < 0
+		|| connect(fd, (sockaddr*)&sReceiverAddress, sizeof(sReceiverAddress))
+			!= 0) {
+		fprintf(stderr, "failed to connect: %s\n", strerror(errno));
+		exit(1);
+	}
+
+	int segmentSize = sDatagramSize;
+	if (mode == SEND_SEGMENTED
+		&& setsockopt(fd, IPPROTO_UDP, UDP_SEGMENT, &segmentSize,
+			sizeof(segmentSize)) != 0) {
+		fprintf(stderr, "UDP_SEGMENT is not supported: %s\n",
+			strerror(errno));
+		exit(1);
+	}
+
+	char* buffer = new char[kBatchSize * sDatagramSize];
+	memset(buffer, 'u', kBatchSize * sDatagramSize);
+
+	iovec vecs[kBatchSize];
+	mmsghdr messages[kBatchSize];
+	memset(messages, 0, sizeof(messages));
+	for (unsigned int i = 0; i < kBatchSize; i++) {
+		vecs[i].iov_base = buffer + i * sDatagramSize;
+		vecs[i].iov_len = sDatagramSize;
+		messages[i].msg_hdr.msg_iov = &vecs[i];
+		messages[i].msg_hdr.msg_iovlen = 1;
+	}
+
+	bigtime_t start = system_time();
+	bigtime_t end = start + seconds * 1000000LL;
+	int64 sent = 0;
+	bool success = true;
+
+	while (system_time() < end) {
+		int count = send_datagrams(fd, mode, buffer, messages);
+		if (count < 0) {
+			if (errno == ENOBUFS)
+				continue;
+
+			fprintf(stderr, "failed to send: %s\n", strerror(errno));
+			success = false;
+			break;
+		}
+
+		sent += count;
+	}
+
+	bigtime_t elapsed = system_time() - start;
+
+	// let the receiver drain its queue
+	snooze(200000);
+	sDone = true;
+	pthread_join(receiverThread, NULL);
+
+	close(fd);
+	delete[] buffer;
+
+	printf("%-12s  %12.0f  %12.0f\n", kModeNames[mode],
+		sent * 1000000.0 / elapsed, sReceived * 1000000.0 / elapsed);
+
+	return success;
+}
+
+
+int
+main(int argc, const char* const* argv)
+{
+	int seconds = argc > 1 ? atoi(argv[1]) : 3;
+	if (argc > 2)
+		sDatagramSize = strtoul(argv[2], NULL, 0);
+	if (seconds <= 0 || sDatagramSize == 0
+		|| kBatchSize * sDatagramSize > 65000) {
+		fprintf(stderr, "usage: %s [<seconds>] [<bytes per datagram>]\n",
+			argv[0]);
+		exit(1);
+	}
+
+	sReceiverSocket = socket(AF_INET, SOCK_DGRAM, 0);
+	if (sReceiverSocket < 0) {
+		fprintf(stderr, "failed to create receiver socket: %s\n",
+			strerror(errno));
+		exit(1);
+	}
+
+	memset(&sReceiverAddress, 0, sizeof(sReceiverAddress));
+	sReceiverAddress.sin_len = sizeof(sReceiverAddress);
+	sReceiverAddress.sin_family = AF_INET;
+	sReceiverAddress.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	socklen_t addressLength = sizeof(sReceiverAddress);
+
+	int bufferSize = 1024 * 1024;
+	timeval timeout = { 0, 100000 };
+	if (bind(sReceiverSocket, (sockaddr*)&sReceiverAddress, addressLength) < 0
+		|| getsockname(sReceiverSocket, (sockaddr*)&sReceiverAddress,
+			&addressLength) < 0
+		|| setsockopt(sReceiverSocket, SOL_SOCKET, SO_RCVBUF, &bufferSize,
+			sizeof(bufferSize)) < 0
+		|| setsockopt(sReceiverSocket, SOL_SOCKET, SO_RCVTIMEO, &timeout,
+			sizeof(timeout)) < 0) {
+		fprintf(stderr, "failed to set up receiver socket: %s\n",
+			strerror(errno));
+		exit(1);
+	}
+
+	printf("mode           sent pkts/s   recv pkts/s\n");
+
+	bool success = run(SEND_SINGLE, seconds);
+	success &= run(SEND_BATCHED, seconds);
+	success &= run(SEND_SEGMENTED, seconds);
+
+	close(sReceiverSocket);
+
+	if (!success) {
+		fprintf(stderr, "FAILED\n");
+		return 1;
+	}
+
+	return 0;
+}
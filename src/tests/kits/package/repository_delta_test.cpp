@@ -0,0 +1,291 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	Computes deltas between repository files, and checks that applying them
+	to the base repository results in the packages of the target repository.
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <Entry.h>
+#include <String.h>
+
+#include <package/hpkg/RepositoryWriter.h>
+#include <package/PackageInfo.h>
+#include <package/RepositoryCache.h>
+#include <package/RepositoryDelta.h>
+#include <package/RepositoryInfo.h>
+
+
+using namespace BPackageKit;
+using BPackageKit::BHPKG::BRepositoryWriter;
+using BPackageKit::BHPKG::BRepositoryWriterListener;
+using BPackageKit::BPrivate::RepositoryDelta;
+
+
+struct package {
+	const char*	name;
+	const char*	version;
+	const char*	checksum;
+};
+
+
+static char sDirectory[] = "/tmp/repository_delta_testXXXXXX";
+static int sErrorCount = 0;
+
+
+static void
+check(bool condition, const char* text, int line)
+{
+	if (condition)
+		return;
+
+	printf("line %d: \"%s\" failed\n", line, text);
+	sErrorCount++;
+}
+
+#define CHECK(condition) check(condition, #condition, __LINE__)
+
+
+class Listener : public BRepositoryWriterListener {
+public:
+	virtual void PrintErrorVarArgs(const char* format, va_list args)
+	{
+		vfprintf(stderr, format, args);
+	}
+
+	virtual void OnPackageAdded(const BPackageInfo& packageInfo)
+	{
+	}
+
+	virtual void OnRepositoryInfoSectionDone(uint32 uncompressedSize)
+	{
+	}
+
+	virtual void OnPackageAttributesSectionDone(uint32 stringCount,
+		uint32 uncompressedSize)
+	{
+	}
+
+	virtual void OnRepositoryDone(uint32 headerSize, uint32 repositoryInfoSize,
+		uint32 licenseCount, uint32 packageCount, uint32 packageAttributesSize,
+		uint64 totalSize)
+	{
+	}
+};
+
+
+static BEntry
+entry_for(const char* name)
+{
+	return BEntry((BString(sDirectory) << "/" << name).String());
+}
+
+
+static void
+init_package_info(BPackageInfo& info, const package& package)
+{
+	info.SetName(package.name);
+	info.SetSummary("summary");
+	info.SetDescription("description");
+	info.SetVendor("vendor");
+	info.SetPackager("packager");
+	info.SetArchitecture(B_PACKAGE_ARCHITECTURE_ANY);
+	info.SetVersion(BPackageVersion(package.version));
+	info.SetChecksum(package.checksum);
+	info.AddCopyright("copyright");
+	info.AddLicense("MIT");
+	info.AddProvides(BPackageResolvable(package.name,
+		BPackageVersion(package.version)));
+}
+
+
+static status_t
+write_repository(const char* name, const package* packages, int count)
+{
+	BRepositoryInfo repositoryInfo;
+	repositoryInfo.SetName("test");
+	repositoryInfo.SetOriginalBaseURL("file:///test");
+	repositoryInfo.SetVendor("vendor");
+	repositoryInfo.SetSummary("summary");
+	repositoryInfo.SetPriority(1);
+	repositoryInfo.SetArchitecture(B_PACKAGE_ARCHITECTURE_ANY);
+
+	BString path = BString(sDirectory) << "/" << name;
+
+	Listener listener;
+	BRepositoryWriter writer(&listener, &repositoryInfo);
+	status_t status = writer.Init(path.String());
+	for (int i = 0; status == B_OK && i < count; i++) {
+		BPackageInfo info;
+		init_package_info(info, packages[i]);
+		status = writer.AddPackageInfo(info);
+	}
+	if (status != B_OK)
+		return status;
+
+	return writer.Finish();
+}
+
+
+//!	Returns whether \a cache contains exactly the given packages.
+static bool
+contains_exactly(const BRepositoryCache& cache, const package* packages,
+	int count)
+{
+	if ((int)cache.CountPackages() != count)
+		return false;
+
+	for (int i = 0; i < count; i++) {
+		BPackageInfo expected;
+		init_package_info(expected, packages[i]);
+
+		bool found = false;
+		for (BRepositoryCache::Iterator it = cache.GetIterator();
+				it.HasNext();) {
+			const BPackageInfo* info = it.Next();
+			if (info->CanonicalFileName() == expected.CanonicalFileName()
+				&& info->Checksum() == expected.Checksum()) {
+				found = true;
+				break;
+			}
+		}
+		if (!found)
+			return false;
+	}
+
+	return true;
+}
+
+
+static void
+test_delta(const package* base, int baseCount, const package* target,
+	int targetCount, int32 removedCount, int32 addedCount)
+{
+	BEntry baseEntry = entry_for("base");
+	BEntry targetEntry = entry_for("target");
+	BEntry deltaEntry = entry_for("delta");
+	BEntry resultEntry = entry_for("result");
+
+	CHECK(write_repository("base", base, baseCount) == B_OK);
+	CHECK(write_repository("target", target, targetCount) == B_OK);
+
+	BRepositoryCache baseCache;
+	BRepositoryCache targetCache;
+	CHECK(baseCache.SetTo(baseEntry) == B_OK);
+	CHECK(targetCache.SetTo(targetEntry) == B_OK);
+
+	RepositoryDelta delta;
+	CHECK(delta.SetTo(baseCache, "base", targetCache, "target") == B_OK);
+	CHECK(delta.CountRemovedPackages() == removedCount);
+	CHECK(delta.CountAddedPackages() == addedCount);
+
+	// the delta survives being written to a file
+	CHECK(delta.WriteToFile(deltaEntry) == B_OK);
+	RepositoryDelta readDelta;
+	CHECK(readDelta.SetTo(deltaEntry) == B_OK);
+	CHECK(readDelta.BaseChecksum() == "base");
+	CHECK(readDelta.TargetChecksum() == "target");
+
+	CHECK(readDelta.Apply(baseCache, resultEntry) == B_OK);
+
+	BRepositoryCache resultCache;
+	CHECK(resultCache.SetTo(resultEntry) == B_OK);
+	CHECK(contains_exactly(resultCache, target, targetCount));
+
+	baseEntry.Remove();
+	targetEntry.Remove();
+	deltaEntry.Remove();
+	resultEntry.Remove();
+}
+
+
+static void
+test_unchanged()
+{
+	const package packages[] = {
+		{ "alpha", "1.0-1", "aaaa" },
+		{ "beta", "2.0-1", "bbbb" }
+	};
+
+	test_delta(packages, 2, packages, 2, 0, 0);
+}
+
+
+static void
+test_added_and_removed()
+{
+	const package base[] = {
+		{ "alpha", "1.0-1", "aaaa" },
+		{ "beta", "2.0-1", "bbbb" }
+	};
+	const package target[] = {
+		{ "alpha", "1.0-1", "aaaa" },
+		{ "gamma", "3.0-1", "cccc" }
+	};
+
+	test_delta(base, 2, target, 2, 1, 1);
+}
+
+
+static void
+test_version_change()
+{
+	const package base[] = {
+		{ "alpha", "1.0-1", "aaaa" },
+		{ "beta", "2.0-1", "bbbb" }
+	};
+	const package target[] = {
+		{ "alpha", "1.1-1", "a111" },
+		{ "beta", "2.0-1", "bbbb" }
+	};
+
+	test_delta(base, 2, target, 2, 1, 1);
+}
+
+
+static void
+test_rebuilt_package()
+{
+	// same version, but different contents
+	const package base[] = {
+		{ "alpha", "1.0-1", "aaaa" },
+		{ "beta", "2.0-1", "bbbb" }
+	};
+	const package target[] = {
+		{ "alpha", "1.0-1", "a222" },
+		{ "beta", "2.0-1", "bbbb" }
+	};
+
+	test_delta(base, 2, target, 2, 1, 1);
+}
+
+
+int
+main()
+{
+	if (mkdtemp(sDirectory) == NULL) {
+		fprintf(stderr, "could not create a temporary directory\n");
+		return 1;
+	}
+
+	test_unchanged();
+	test_added_and_removed();
+	test_version_change();
+	test_rebuilt_package();
+
+	rmdir(sDirectory);
+
+	if (sErrorCount > 0) {
+		fprintf(stderr, "FAILED\n");
+		return 1;
+	}
+
+	return 0;
+}
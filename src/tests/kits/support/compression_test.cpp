@@ -11,7 +11,9 @@
 #include <string.h>
 
 #include <File.h>
+#include <OS.h>
 
+#include <Lz4CompressionAlgorithm.h>
 #include <ZlibCompressionAlgorithm.h>
 
 
@@ -22,21 +24,32 @@ const char* kCommandName = __progname;
 enum CompressionType {
 	ZlibCompression,
 	GzipCompression,
+	Lz4Compression,
 };
 
 
+static const size_t kBenchmarkChunkSize = 64 * 1024;
+static const int kBenchmarkDecompressionRounds = 10;
+
+
 static const char* kUsage =
 	"Usage: %s <options> <input file> <output file>\n"
-	"Compresses or decompresses (option -d) a file.\n"
+	"       %s -b <options> <input file>\n"
+	"Compresses or decompresses (option -d) a file, or measures the buffer\n"
+	"compression and decompression throughput on 64 KiB chunks of a file, as\n"
+	"used by package file heaps (option -b).\n"
 	"\n"
 	"Options:\n"
 	"  -0 ... -9\n"
 	"      Use compression level 0 ... 9. 0 means no, 9 best compression.\n"
 	"      Defaults to 9.\n"
+	"  -b, --benchmark\n"
+	"      Measure the buffer compression and decompression throughput.\n"
 	"  -d, --decompress\n"
 	"      Decompress the input file (default is compress).\n"
 	"  -f <format>\n"
-	"      Specify the compression format: \"zlib\" (default), or \"gzip\"\n"
+	"      Specify the compression format: \"zlib\" (default), \"gzip\", or\n"
+	"      \"lz4\". \"lz4\" only supports -b.\n"
 	"  -h, --help\n"
 	"      Print this usage info.\n"
 	"  -i, --input-stream\n"
@@ -47,21 +60,103 @@ static const char* kUsage =
 static void
 print_usage_and_exit(bool error)
 {
-    fprintf(error ? stderr : stdout, kUsage, kCommandName);
+    fprintf(error ? stderr : stdout, kUsage, kCommandName, kCommandName);
     exit(error ? 1 : 0);
 }
 
 
+static int
+run_benchmark(BCompressionAlgorithm* algorithm,
+	BCompressionParameters* compressionParameters,
+	BDecompressionParameters* decompressionParameters, BFile& inputFile)
+{
+	static uint8 chunk[kBenchmarkChunkSize];
+	static uint8 compressedChunk[kBenchmarkChunkSize];
+	static uint8 uncompressedChunk[kBenchmarkChunkSize];
+
+	uint64 totalSize = 0;
+	uint64 totalCompressedSize = 0;
+	bigtime_t compressionTime = 0;
+	bigtime_t decompressionTime = 0;
+	uint64 decompressedSize = 0;
+
+	for (;;) {
+		ssize_t bytesRead = inputFile.Read(chunk, sizeof(chunk));
+		if (bytesRead < 0) {
+			fprintf(stderr, "Error: Failed to read from input file: %s\n",
+				strerror(bytesRead));
+			return 1;
+		}
+		if (bytesRead == 0)
+			break;
+
+		totalSize += bytesRead;
+
+		size_t compressedSize;
+		bigtime_t startTime = system_time();
+		status_t error = algorithm->CompressBuffer(chunk, bytesRead,
+			compressedChunk, bytesRead, compressedSize,
+			compressionParameters);
+		compressionTime += system_time() - startTime;
+		if (error == B_BUFFER_OVERFLOW) {
+			// the chunk would be stored uncompressed
+			totalCompressedSize += bytesRead;
+			continue;
+		}
+		if (error != B_OK) {
+			fprintf(stderr, "Error: Failed to compress chunk: %s\n",
+				strerror(error));
+			return 1;
+		}
+
+		totalCompressedSize += compressedSize;
+
+		startTime = system_time();
+		for (int i = 0; i < kBenchmarkDecompressionRounds; i++) {
+			size_t uncompressedSize;
+			error = algorithm->DecompressBuffer(compressedChunk,
+				compressedSize, uncompressedChunk, bytesRead,
+				uncompressedSize, decompressionParameters);
+			if (error == B_OK && uncompressedSize != (size_t)bytesRead)
+				error = B_BAD_DATA;
+			if (error != B_OK) {
+				fprintf(stderr, "Error: Failed to decompress chunk: %s\n",
+					strerror(error));
+				return 1;
+			}
+		}
+		decompressionTime += system_time() - startTime;
+		decompressedSize += (uint64)bytesRead * kBenchmarkDecompressionRounds;
+
+		if (memcmp(chunk, uncompressedChunk, bytesRead) != 0) {
+			fprintf(stderr, "Error: Decompressed data differ\n");
+			return 1;
+		}
+	}
+
+	printf("size:          %" B_PRIu64 " -> %" B_PRIu64 " bytes (%.1f %%)\n",
+		totalSize, totalCompressedSize,
+		totalSize > 0 ? 100.0 * totalCompressedSize / totalSize : 0.0);
+	printf("compression:   %.1f MB/s\n", compressionTime > 0
+		? (double)totalSize / compressionTime : 0.0);
+	printf("decompression: %.1f MB/s\n", decompressionTime > 0
+		? (double)decompressedSize / decompressionTime : 0.0);
+	return 0;
+}
+
+
 int
 main(int argc, const char* const* argv)
 {
 	int compressionLevel = B_ZLIB_COMPRESSION_DEFAULT;
 	bool compress = true;
 	bool useInputStream = true;
+	bool benchmark = false;
 	CompressionType compressionType = ZlibCompression;
 
 	while (true) {
 		static struct option sLongOptions[] = {
+			{ "benchmark", no_argument, 0, 'b' },
 			{ "decompress", no_argument, 0, 'd' },
 			{ "help", no_argument, 0, 'h' },
 			{ "input-stream", no_argument, 0, 'i' },
@@ -69,7 +164,7 @@ main(int argc, const char* const* argv)
 		};
 
 		opterr = 0; // don't print errors
-		int c = getopt_long(argc, (char**)argv, "+0123456789df:hi",
+		int c = getopt_long(argc, (char**)argv, "+0123456789bdf:hi",
 			sLongOptions, NULL);
 		if (c == -1)
 			break;
@@ -88,6 +183,10 @@ main(int argc, const char* const* argv)
 				compressionLevel = c - '0';
 				break;
 
+			case 'b':
+				benchmark = true;
+				break;
+
 			case 'h':
 				print_usage_and_exit(false);
 				break;
@@ -101,6 +200,8 @@ main(int argc, const char* const* argv)
 					compressionType = ZlibCompression;
 				} else if (strcmp(optarg, "gzip") == 0) {
 					compressionType = GzipCompression;
+				} else if (strcmp(optarg, "lz4") == 0) {
+					compressionType = Lz4Compression;
 				} else {
 					fprintf(stderr, "Error: Unsupported compression type "
 						"\"%s\"\n", optarg);
@@ -119,11 +220,11 @@ main(int argc, const char* const* argv)
 	}
 
 	// The remaining arguments are input and output file.
-	if (optind + 2 != argc)
+	if (optind + (benchmark ? 1 : 2) != argc)
 		print_usage_and_exit(true);
 
 	const char* inputFilePath = argv[optind++];
-	const char* outputFilePath = argv[optind++];
+	const char* outputFilePath = benchmark ? NULL : argv[optind++];
 
 	// open input file
 	BFile inputFile;
@@ -136,8 +237,10 @@ main(int argc, const char* const* argv)
 
 	// open output file
 	BFile outputFile;
-	error = outputFile.SetTo(outputFilePath,
-		B_WRITE_ONLY | B_CREATE_FILE | B_ERASE_FILE);
+	if (!benchmark) {
+		error = outputFile.SetTo(outputFilePath,
+			B_WRITE_ONLY | B_CREATE_FILE | B_ERASE_FILE);
+	}
 	if (error != B_OK) {
 		fprintf(stderr, "Error: Failed to open \"%s\": %s\n", outputFilePath,
 			strerror(errno));
@@ -161,6 +264,18 @@ main(int argc, const char* const* argv)
 			decompressionParameters = new BZlibDecompressionParameters;
 			break;
 		}
+
+		case Lz4Compression:
+			compressionAlgorithm = new BLz4CompressionAlgorithm;
+			compressionParameters
+				= new BLz4CompressionParameters(compressionLevel);
+			decompressionParameters = new BLz4DecompressionParameters;
+			break;
+	}
+
+	if (benchmark) {
+		return run_benchmark(compressionAlgorithm, compressionParameters,
+			decompressionParameters, inputFile);
 	}
 
 	if (useInputStream) {
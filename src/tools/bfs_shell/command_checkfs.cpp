@@ -17,15 +17,26 @@ namespace FSShell {
 fssh_status_t
 command_checkfs(int argc, const char* const* argv)
 {
-	if (argc == 2 && !strcmp(argv[1], "--help")) {
-		fssh_dprintf("Usage: %s [-c]\n"
-			"  -c  Check only; don't perform any changes\n", argv[0]);
-		return B_OK;
-	}
-
 	bool checkOnly = false;
-	if (argc == 2 && !strcmp(argv[1], "-c"))
-		checkOnly = true;
+	bool incremental = false;
+	uint32 threads = 0;
+
+	for (int i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "-c"))
+			checkOnly = true;
+		else if (!strcmp(argv[i], "-i"))
+			incremental = true;
+		else if (!strcmp(argv[i], "-j") && i + 1 < argc)
+			threads = strtoul(argv[++i], NULL, 0);
+		else {
+			fssh_dprintf("Usage: %s [-c] [-i] [-j <threads>]\n"
+				"  -c  Check only; don't perform any changes\n"
+				"  -i  Only check the allocation groups that have been changed\n"
+				"      since the last complete check\n"
+				"  -j  Number of threads to check the files with\n", argv[0]);
+			return B_OK;
+		}
+	}
 
 	int rootDir = _kern_open_dir(-1, "/myfs");
 	if (rootDir < 0)
@@ -39,6 +50,9 @@ command_checkfs(int argc, const char* const* argv)
 		result.flags |= BFS_FIX_BITMAP_ERRORS | BFS_REMOVE_WRONG_TYPES
 			| BFS_REMOVE_INVALID | BFS_FIX_NAME_MISMATCHES | BFS_FIX_BPLUSTREES;
 	}
+	if (incremental)
+		result.flags |= BFS_CHECK_INCREMENTAL;
+	result.flags |= BFS_CHECK_THREADS(min_c(threads, 255U));
 
 	// start checking
 	fssh_status_t status = _kern_ioctl(rootDir, BFS_IOCTL_START_CHECKING,
@@ -54,6 +68,11 @@ command_checkfs(int argc, const char* const* argv)
 	// check all files and report errors
 	while (_kern_ioctl(rootDir, BFS_IOCTL_CHECK_NEXT_NODE, &result,
 			sizeof(result)) == B_OK) {
+		if (incremental && (result.flags & BFS_CHECK_INCREMENTAL) == 0) {
+			fssh_dprintf("Changed allocation groups are unknown, checking "
+				"everything.\n");
+			incremental = false;
+		}
 		if (++counter % 50 == 0)
 			fssh_dprintf("%9Ld nodes processed\x1b[1A\n", counter);
 
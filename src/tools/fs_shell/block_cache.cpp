@@ -1743,3 +1743,15 @@ fssh_block_cache_put(void* _cache, fssh_off_t blockNumber)
 	put_cached_block(cache, blockNumber);
 }
 
+
+
+/*!	The FS shell does not do any asynchronous I/O, and reading ahead would
+	only delay the caller; no blocks are prefetched.
+*/
+fssh_status_t
+fssh_block_cache_prefetch(void* _cache, fssh_off_t blockNumber,
+	fssh_size_t* _numBlocks)
+{
+	*_numBlocks = 0;
+	return FSSH_B_OK;
+}